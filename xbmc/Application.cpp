@@ -1906,10 +1906,10 @@ void CApplication::Render()
 
   g_Windowing.EndRender();
 
-  // reset our info cache - we do this at the end of Render so that it is
+  // update our info cache - we do this at the end of Render so that it is
   // fresh for the next process(), or after a windowclose animation (where process()
-  // isn't called)
-  g_infoManager.ResetCache();
+  // isn't called). Only conditions whose sources changed are evaluated again.
+  g_infoManager.UpdateCache();
 
   if (hasRendered)
   {
@@ -2737,7 +2737,11 @@ void CApplication::FrameMove(bool processEvents, bool processGUI)
     if (!m_bStop)
     {
       if (!m_skipGuiRender)
+      {
+        // pick up player and window changes caused by the input processed above
+        g_infoManager.UpdateCache(false);
         g_windowManager.Process(CTimeUtils::GetFrameTime());
+      }
     }
     g_windowManager.FrameMove();
   }
@@ -63,6 +63,7 @@
 #include "utils/log.h"
 #include "utils/Variant.h"
 #include "utils/Mime.h"
+#include "utils/Parallel.h"
 #include "utils/Random.h"
 #include "events/IEvent.h"
 
@@ -2146,7 +2147,10 @@ void CFileItemList::Sort(FILEITEMLISTCOMPARISONFUNC func)
 void CFileItemList::FillSortFields(FILEITEMFILLFUNC func)
 {
   CSingleLock lock(m_lock);
-  std::for_each(m_items.begin(), m_items.end(), func);
+  if (g_advancedSettings.m_sortParallelThreshold > 0 && m_items.size() >= g_advancedSettings.m_sortParallelThreshold)
+    KODI::UTILS::ParallelForEach(m_items.begin(), m_items.end(), func);
+  else
+    std::for_each(m_items.begin(), m_items.end(), func);
 }
 
 void CFileItemList::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute sortAttributes /* = SortAttributeNone */)
@@ -2187,15 +2191,33 @@ void CFileItemList::Sort(SortDescription sortDescription)
 
   const Fields fields = SortUtils::GetFieldsForSorting(sortDescription.sortBy);
   SortItems sortItems((size_t)Size());
-  for (int index = 0; index < Size(); index++)
+  auto toSortable = [&](int index)
   {
     sortItems[index] = std::shared_ptr<SortItem>(new SortItem);
     m_items[index]->ToSortable(*sortItems[index], fields);
     (*sortItems[index])[FieldId] = index;
+  };
+
+  // large lists are converted and sorted on the job manager's workers, which results in the same order
+  size_t parallelThreshold = g_advancedSettings.m_sortParallelThreshold;
+  if (parallelThreshold > 0 && sortItems.size() >= parallelThreshold)
+  {
+    size_t count = sortItems.size();
+    size_t parts = KODI::UTILS::GetParallelism();
+    KODI::UTILS::ParallelFor(parts, [&](size_t part)
+    {
+      for (size_t index = count * part / parts; index < count * (part + 1) / parts; index++)
+        toSortable((int)index);
+    });
+  }
+  else
+  {
+    for (int index = 0; index < Size(); index++)
+      toSortable(index);
   }
 
   // do the sorting
-  SortUtils::Sort(sortDescription, sortItems);
+  SortUtils::Sort(sortDescription, sortItems, parallelThreshold);
 
   // apply the new order to the existing CFileItems
   VECFILEITEMS sortedFileItems;
@@ -624,6 +624,12 @@ typedef std::map<std::string, CFileItemPtr >::iterator IMAPFILEITEMS;
 typedef std::pair<std::string, CFileItemPtr > MAPFILEITEMSPAIR;
 
 typedef bool (*FILEITEMLISTCOMPARISONFUNC) (const CFileItemPtr &pItem1, const CFileItemPtr &pItem2);
+
+/*!
+  \brief Fills in the sort fields of an item
+  \note Large lists are filled in on several threads at once, see CFileItemList::FillSortFields(),
+  so the function may only change the item it is given and must not use shared state.
+  */
 typedef void (*FILEITEMFILLFUNC) (CFileItemPtr &item);
 
 /*!
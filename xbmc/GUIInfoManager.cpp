@@ -153,6 +153,9 @@ CGUIInfoManager::CGUIInfoManager(void) :
   m_playerShowTime = false;
   m_playerShowInfo = false;
   m_fps = 0.0f;
+  m_boolEvaluations = 0;
+  m_boolCacheHits = 0;
+  m_sourceState = SourceState();
   ResetLibraryBools();
 }
 
@@ -10762,6 +10765,142 @@ void CGUIInfoManager::ResetCache()
     (*i)->SetDirty();
 }
 
+void CGUIInfoManager::UpdateCache(bool newFrame /* = true */)
+{
+  unsigned int changed = 0;
+  if (newFrame)
+  {
+    // reset any animation triggers as well
+    m_containerMoves.clear();
+    changed |= DEPENDS_FRAME;
+
+    InfoBool::GetCounters(m_boolEvaluations, m_boolCacheHits);
+  }
+
+  SourceState state;
+  GetSourceState(state);
+  if (state.player != m_sourceState.player || state.playerSpeed != m_sourceState.playerSpeed)
+    changed |= DEPENDS_PLAYER;
+  if (state.activeWindow != m_sourceState.activeWindow ||
+      state.topMostDialog != m_sourceState.topMostDialog ||
+      state.topMostOpenDialog != m_sourceState.topMostOpenDialog ||
+      state.nextWindow != m_sourceState.nextWindow ||
+      state.prevWindow != m_sourceState.prevWindow)
+    changed |= DEPENDS_WINDOW;
+  if (state.time != m_sourceState.time)
+    changed |= DEPENDS_TIME;
+  m_sourceState = state;
+
+  if (changed)
+    InvalidateCache(changed);
+}
+
+void CGUIInfoManager::InvalidateCache(unsigned int dependencies)
+{
+  CSingleLock lock(m_critInfo);
+  for (std::vector<InfoPtr>::iterator i = m_bools.begin(); i != m_bools.end(); ++i)
+  {
+    if ((*i)->GetDependencies() & dependencies)
+      (*i)->SetDirty();
+  }
+}
+
+void CGUIInfoManager::GetSourceState(SourceState &state) const
+{
+  state.player = 0;
+  state.playerSpeed = 0.0f;
+  if (g_application.m_pPlayer->IsPlaying())
+  {
+    state.player = 1;
+    if (g_application.m_pPlayer->IsPausedPlayback())
+      state.player |= 2;
+    if (g_application.m_pPlayer->IsPlayingAudio())
+      state.player |= 4;
+    if (g_application.m_pPlayer->IsPlayingVideo())
+      state.player |= 8;
+    if (g_application.m_pPlayer->IsPlayingGame())
+      state.player |= 16;
+    state.playerSpeed = g_application.m_pPlayer->GetPlaySpeed();
+  }
+
+  state.activeWindow = g_windowManager.GetActiveWindow();
+  state.topMostDialog = g_windowManager.GetTopMostModalDialogID(false);
+  state.topMostOpenDialog = g_windowManager.GetTopMostModalDialogID(true);
+  state.nextWindow = m_nextWindowID;
+  state.prevWindow = m_prevWindowID;
+
+  CDateTime now = CDateTime::GetCurrentDateTime();
+  state.time = (now.GetMonth() * 100 + now.GetDay()) * 24 * 60 + now.GetMinuteOfDay();
+}
+
+unsigned int CGUIInfoManager::GetDependencies(int condition) const
+{
+  condition = abs(condition);
+  if (condition >= MULTI_INFO_START && condition <= MULTI_INFO_END)
+  {
+    const GUIInfo &info = m_multiInfo[condition - MULTI_INFO_START];
+    switch (info.m_info)
+    {
+      case SKIN_BOOL:
+      case SKIN_STRING:
+      case SKIN_HAS_THEME:
+        return DEPENDS_SKIN;
+      case WINDOW_NEXT:
+      case WINDOW_PREVIOUS:
+        return DEPENDS_WINDOW;
+      case SYSTEM_DATE:
+      case SYSTEM_TIME:
+        return DEPENDS_TIME;
+      default:
+        return DEPENDS_FRAME;
+    }
+  }
+
+  switch (condition)
+  {
+    case SYSTEM_ALWAYS_TRUE:
+    case SYSTEM_ALWAYS_FALSE:
+    case SYSTEM_ETHERNET_LINK_ACTIVE:
+    case SYSTEM_PLATFORM_LINUX:
+    case SYSTEM_PLATFORM_WINDOWS:
+    case SYSTEM_PLATFORM_DARWIN:
+    case SYSTEM_PLATFORM_DARWIN_OSX:
+    case SYSTEM_PLATFORM_DARWIN_IOS:
+    case SYSTEM_PLATFORM_ANDROID:
+    case SYSTEM_PLATFORM_LINUX_RASPBERRY_PI:
+      return DEPENDS_NOTHING;
+    case WINDOW_IS_MEDIA:
+      return DEPENDS_WINDOW;
+    case PLAYER_HAS_MEDIA:
+    case PLAYER_HAS_AUDIO:
+    case PLAYER_HAS_VIDEO:
+    case PLAYER_HAS_GAME:
+    case PLAYER_PLAYING:
+    case PLAYER_PAUSED:
+    case PLAYER_REWINDING:
+    case PLAYER_FORWARDING:
+    case PLAYER_REWINDING_2x:
+    case PLAYER_REWINDING_4x:
+    case PLAYER_REWINDING_8x:
+    case PLAYER_REWINDING_16x:
+    case PLAYER_REWINDING_32x:
+    case PLAYER_FORWARDING_2x:
+    case PLAYER_FORWARDING_4x:
+    case PLAYER_FORWARDING_8x:
+    case PLAYER_FORWARDING_16x:
+    case PLAYER_FORWARDING_32x:
+      return DEPENDS_PLAYER;
+    default:
+      return DEPENDS_FRAME;
+  }
+}
+
+void CGUIInfoManager::GetCacheStats(unsigned int &evaluations, unsigned int &cacheHits) const
+{
+  evaluations = m_boolEvaluations;
+  cacheHits = m_boolCacheHits;
+}
+
 std::string CGUIInfoManager::GetPictureLabel(int info)
 {
   if (info == SLIDE_FILE_NAME)
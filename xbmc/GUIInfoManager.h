@@ -204,7 +204,31 @@ public:
   void SetNextWindow(int windowID) { m_nextWindowID = windowID; };
   void SetPreviousWindow(int windowID) { m_prevWindowID = windowID; };
 
+  /*! \brief Mark all info bools dirty, they're evaluated again the next time they're used
+   */
   void ResetCache();
+
+  /*! \brief Mark the info bools dirty whose sources changed since the last update
+   \param newFrame true at the end of a frame, info bools with unknown sources are marked dirty as well
+   \sa INFO::InfoDependency
+   */
+  void UpdateCache(bool newFrame = true);
+
+  /*! \brief Mark the info bools dirty which depend on any of the given sources
+   \param dependencies combination of INFO::InfoDependency flags
+   */
+  void InvalidateCache(unsigned int dependencies);
+
+  /*! \brief Get the sources a condition depends on
+   \param condition a condition as returned by TranslateSingleString()
+   \return combination of INFO::InfoDependency flags
+   */
+  unsigned int GetDependencies(int condition) const;
+
+  /*! \brief Get the number of info bools evaluated and taken from the cache during the last frame
+   */
+  void GetCacheStats(unsigned int &evaluations, unsigned int &cacheHits) const;
+
   bool GetItemInt(int &value, const CGUIListItem *item, int info) const;
   std::string GetItemLabel(const CFileItem *item, int info, std::string *fallback = NULL);
   std::string GetItemImage(const CFileItem *item, int info, std::string *fallback = NULL);
@@ -328,6 +352,23 @@ protected:
   int m_nextWindowID;
   int m_prevWindowID;
 
+  //! State of the sources info bools depend on, see UpdateCache()
+  struct SourceState
+  {
+    unsigned int player;   ///< playing, paused, audio, video, game flags
+    float playerSpeed;
+    int activeWindow;
+    int topMostDialog;     ///< including closing dialogs
+    int topMostOpenDialog; ///< without closing dialogs
+    int nextWindow;
+    int prevWindow;
+    int time;              ///< date and minute of the day
+  };
+  void GetSourceState(SourceState &state) const;
+  SourceState m_sourceState;
+  unsigned int m_boolEvaluations;   ///< info bools evaluated during the last frame
+  unsigned int m_boolCacheHits;     ///< info bools taken from the cache during the last frame
+
   std::vector<INFO::InfoPtr> m_bools;
   std::vector<INFO::CSkinVariableString> m_skinVariableStrings;
 
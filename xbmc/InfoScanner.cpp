@@ -33,7 +33,7 @@ bool CInfoScanner::HasNoMedia(const std::string &strDirectory) const
   return XFILE::CFile::Exists(noMediaFile);
 }
 
-bool CInfoScanner::IsExcluded(const std::string& strDirectory, const std::vector<std::string> &regexps)
+bool CInfoScanner::IsExcluded(const std::string& strDirectory, const std::vector<std::string> &regexps) const
 {
   if (CUtil::ExcludeFileOrFolder(strDirectory, regexps))
     return true;
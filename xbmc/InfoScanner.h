@@ -31,7 +31,7 @@ public:
    \param regexps Regular expression to exclude from the scan
    \return true if there is a .nomedia file or one of the regexps is a match
    */
-  bool IsExcluded(const std::string& strDirectory, const std::vector<std::string> &regexps);
+  bool IsExcluded(const std::string& strDirectory, const std::vector<std::string> &regexps) const;
 private:
   bool HasNoMedia(const std::string& strDirectory) const;
 };
@@ -2031,15 +2031,7 @@ bool CActiveAE::RunStages()
 
               for(int j=0; j<out->pkt->planes; j++)
               {
-#if defined(HAVE_SSE) && defined(__SSE__)
-                CAEUtil::SSEMulArray((float*)out->pkt->data[j]+i*nb_floats, volume, nb_floats);
-#else
-                float* fbuffer = (float*) out->pkt->data[j]+i*nb_floats;
-                for (int k = 0; k < nb_floats; ++k)
-                {
-                  fbuffer[k] *= volume;
-                }
-#endif
+                CAEUtil::MulArray((float*)out->pkt->data[j]+i*nb_floats, volume, nb_floats);
               }
             }
           }
@@ -2100,24 +2092,8 @@ bool CActiveAE::RunStages()
               {
                 float *dst = (float*)out->pkt->data[j]+i*nb_floats;
                 float *src = (float*)mix->pkt->data[j]+i*nb_floats;
-#if defined(HAVE_SSE) && defined(__SSE__)
-                CAEUtil::SSEMulAddArray(dst, src, volume, nb_floats);
-                for (int k = 0; k < nb_floats; ++k)
-                {
-                  if (fabs(dst[k]) > 1.0f)
-                  {
-                    needClamp = true;
-                    break;
-                  }
-                }
-#else
-                for (int k = 0; k < nb_floats; ++k)
-                {
-                  dst[k] += src[k] * volume;
-                  if (fabs(dst[k]) > 1.0f)
-                    needClamp = true;
-                }
-#endif
+                if (CAEUtil::MulAddArray(dst, src, volume, nb_floats))
+                  needClamp = true;
               }
             }
             mix->Return();
@@ -2492,12 +2468,7 @@ void CActiveAE::MixSounds(CSoundPacket &dstSample)
       out = (float*)dstSample.data[j];
       sample_buffer = (float*)(it->sound->GetSound(false)->data[j]+start);
       int nb_floats = mix_samples * dstSample.config.channels / dstSample.planes;
-#if defined(HAVE_SSE) && defined(__SSE__)
-      CAEUtil::SSEMulAddArray(out, sample_buffer, volume, nb_floats);
-#else
-      for (int k = 0; k < nb_floats; ++k)
-        *out++ += *sample_buffer++ * volume;
-#endif
+      CAEUtil::MulAddArray(out, sample_buffer, volume, nb_floats);
     }
 
     it->samples_played += mix_samples;
@@ -2523,13 +2494,7 @@ void CActiveAE::Deamplify(CSoundPacket &dstSample)
     for(int j=0; j<dstSample.planes; j++)
     {
       buffer = (float*)dstSample.data[j];
-#if defined(HAVE_SSE) && defined(__SSE__)
-      CAEUtil::SSEMulArray(buffer, volume, nb_floats);
-#else
-      float *fbuffer = buffer;
-      for (int i = 0; i < nb_floats; i++)
-        *fbuffer++ *= volume;
-#endif
+      CAEUtil::MulArray(buffer, volume, nb_floats);
     }
   }
 }
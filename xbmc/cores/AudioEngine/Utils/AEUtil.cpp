@@ -22,9 +22,18 @@
 #endif
 
 #include "AEUtil.h"
+#include "utils/CPUInfo.h"
 #include "utils/log.h"
 #include "utils/TimeUtils.h"
 
+#if defined(HAVE_AE_AVX2)
+#include "AEUtilAVX2.h"
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <cassert>
 
 extern "C" {
@@ -231,106 +240,9 @@ const char* CAEUtil::DataFormatToStr(const enum AEDataFormat dataFormat)
   return formats[dataFormat];
 }
 
-#if defined(HAVE_SSE) && defined(__SSE__)
-void CAEUtil::SSEMulArray(float *data, const float mul, uint32_t count)
+namespace
 {
-  const __m128 m = _mm_set_ps1(mul);
-
-  /* work around invalid alignment */
-  while (((uintptr_t)data & 0xF) && count > 0)
-  {
-    data[0] *= mul;
-    ++data;
-    --count;
-  }
-
-  uint32_t even = count & ~0x3;
-  for (uint32_t i = 0; i < even; i+=4, data+=4)
-  {
-    __m128 to      = _mm_load_ps(data);
-    *(__m128*)data = _mm_mul_ps (to, m);
-  }
-
-  if (even != count)
-  {
-    uint32_t odd = count - even;
-    if (odd == 1)
-      data[0] *= mul;
-    else
-    {
-      __m128 to;
-      if (odd == 2)
-      {
-        to = _mm_setr_ps(data[0], data[1], 0, 0);
-        __m128 ou = _mm_mul_ps(to, m);
-        data[0] = ((float*)&ou)[0];
-        data[1] = ((float*)&ou)[1];
-      }
-      else
-      {
-        to = _mm_setr_ps(data[0], data[1], data[2], 0);
-        __m128 ou = _mm_mul_ps(to, m);
-        data[0] = ((float*)&ou)[0];
-        data[1] = ((float*)&ou)[1];
-        data[2] = ((float*)&ou)[2];
-      }
-    }
-  }
-}
-
-void CAEUtil::SSEMulAddArray(float *data, float *add, const float mul, uint32_t count)
-{
-  const __m128 m = _mm_set_ps1(mul);
-
-  /* work around invalid alignment */
-  while ((((uintptr_t)data & 0xF) || ((uintptr_t)add & 0xF)) && count > 0)
-  {
-    data[0] += add[0] * mul;
-    ++add;
-    ++data;
-    --count;
-  }
-
-  uint32_t even = count & ~0x3;
-  for (uint32_t i = 0; i < even; i+=4, data+=4, add+=4)
-  {
-    __m128 ad      = _mm_load_ps(add );
-    __m128 to      = _mm_load_ps(data);
-    *(__m128*)data = _mm_add_ps (to, _mm_mul_ps(ad, m));
-  }
-
-  if (even != count)
-  {
-    uint32_t odd = count - even;
-    if (odd == 1)
-      data[0] += add[0] * mul;
-    else
-    {
-      __m128 ad;
-      __m128 to;
-      if (odd == 2)
-      {
-        ad = _mm_setr_ps(add [0], add [1], 0, 0);
-        to = _mm_setr_ps(data[0], data[1], 0, 0);
-        __m128 ou = _mm_add_ps(to, _mm_mul_ps(ad, m));
-        data[0] = ((float*)&ou)[0];
-        data[1] = ((float*)&ou)[1];
-      }
-      else
-      {
-        ad = _mm_setr_ps(add [0], add [1], add [2], 0);
-        to = _mm_setr_ps(data[0], data[1], data[2], 0);
-        __m128 ou = _mm_add_ps(to, _mm_mul_ps(ad, m));
-        data[0] = ((float*)&ou)[0];
-        data[1] = ((float*)&ou)[1];
-        data[2] = ((float*)&ou)[2];
-      }
-    }
-  }
-}
-#endif
-
-inline float CAEUtil::SoftClamp(const float x)
+inline float SoftClamp(float x)
 {
 #if 1
     /*
@@ -365,85 +277,243 @@ inline float CAEUtil::SoftClamp(const float x)
 #endif
 }
 
-void CAEUtil::ClampArray(float *data, uint32_t count)
+typedef void (*MulArrayFunc)(float *data, const float mul, uint32_t count);
+typedef bool (*MulAddArrayFunc)(float *data, const float *add, const float mul, uint32_t count);
+typedef void (*ClampArrayFunc)(float *data, uint32_t count);
+
+struct SMixingKernels
+{
+  AEKernels kernels;
+  MulArrayFunc mulArray;
+  MulAddArrayFunc mulAddArray;
+  ClampArrayFunc clampArray;
+};
+
+void ScalarMulArray(float *data, const float mul, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; ++i)
+    data[i] *= mul;
+}
+
+bool ScalarMulAddArray(float *data, const float *add, const float mul, uint32_t count)
+{
+  bool needClamp = false;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    data[i] += add[i] * mul;
+    if (fabs(data[i]) > 1.0f)
+      needClamp = true;
+  }
+  return needClamp;
+}
+
+void ScalarClampArray(float *data, uint32_t count)
 {
-#if !defined(HAVE_SSE) || !defined(__SSE__)
   for (uint32_t i = 0; i < count; ++i)
     data[i] = SoftClamp(data[i]);
+}
 
-#else
+#if defined(HAVE_SSE) && defined(__SSE__)
+void SSEMulArray(float *data, const float mul, uint32_t count)
+{
+  const __m128 m = _mm_set_ps1(mul);
+
+  uint32_t even = count & ~0x3;
+  for (uint32_t i = 0; i < even; i+=4, data+=4)
+    _mm_storeu_ps(data, _mm_mul_ps(_mm_loadu_ps(data), m));
+
+  ScalarMulArray(data, mul, count - even);
+}
+
+bool SSEMulAddArray(float *data, const float *add, const float mul, uint32_t count)
+{
+  const __m128 m = _mm_set_ps1(mul);
+  const __m128 one = _mm_set_ps1(1.0f);
+  const __m128 minusOne = _mm_set_ps1(-1.0f);
+  __m128 over = _mm_setzero_ps();
+
+  uint32_t even = count & ~0x3;
+  for (uint32_t i = 0; i < even; i+=4, data+=4, add+=4)
+  {
+    __m128 to = _mm_add_ps(_mm_loadu_ps(data), _mm_mul_ps(_mm_loadu_ps(add), m));
+    _mm_storeu_ps(data, to);
+    over = _mm_or_ps(over, _mm_or_ps(_mm_cmpgt_ps(to, one), _mm_cmplt_ps(to, minusOne)));
+  }
+
+  bool needClamp = ScalarMulAddArray(data, add, mul, count - even);
+  return _mm_movemask_ps(over) != 0 || needClamp;
+}
+
+void SSEClampArray(float *data, uint32_t count)
+{
   const __m128 c1 = _mm_set_ps1(27.0f);
-  const __m128 c2 = _mm_set_ps1(27.0f + 9.0f);
+  const __m128 c2 = _mm_set_ps1(9.0f);
+  const __m128 min = _mm_set_ps1(-3.0f);
+  const __m128 max = _mm_set_ps1(3.0f);
 
-  /* work around invalid alignment */
-  while (((uintptr_t)data & 0xF) && count > 0)
+  uint32_t even = count & ~0x3;
+  for (uint32_t i = 0; i < even; i+=4, data+=4)
   {
-    data[0] = SoftClamp(data[0]);
-    ++data;
-    --count;
+    /* tanh approx clamp, see SoftClamp() */
+    __m128 dt  = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(data), min), max);
+    __m128 tmp = _mm_mul_ps(dt, dt);
+    _mm_storeu_ps(data, _mm_div_ps(_mm_mul_ps(dt, _mm_add_ps(c1, tmp)),
+                                   _mm_add_ps(c1, _mm_mul_ps(c2, tmp))));
   }
 
+  ScalarClampArray(data, count - even);
+}
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+void NEONMulArray(float *data, const float mul, uint32_t count)
+{
   uint32_t even = count & ~0x3;
   for (uint32_t i = 0; i < even; i+=4, data+=4)
+    vst1q_f32(data, vmulq_n_f32(vld1q_f32(data), mul));
+
+  ScalarMulArray(data, mul, count - even);
+}
+
+bool NEONMulAddArray(float *data, const float *add, const float mul, uint32_t count)
+{
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  uint32x4_t over = vdupq_n_u32(0);
+
+  uint32_t even = count & ~0x3;
+  for (uint32_t i = 0; i < even; i+=4, data+=4, add+=4)
   {
-    /* tanh approx clamp */
-    __m128 dt = _mm_load_ps(data);
-    __m128 tmp     = _mm_mul_ps(dt, dt);
-    *(__m128*)data = _mm_div_ps(
-      _mm_mul_ps(
-        dt,
-        _mm_add_ps(c1, tmp)
-      ),
-      _mm_add_ps(c2, tmp)
-    );
+    float32x4_t to = vmlaq_n_f32(vld1q_f32(data), vld1q_f32(add), mul);
+    vst1q_f32(data, to);
+    over = vorrq_u32(over, vcagtq_f32(to, one));
   }
 
-  if (even != count)
+  uint32x2_t any = vorr_u32(vget_low_u32(over), vget_high_u32(over));
+  bool needClamp = ScalarMulAddArray(data, add, mul, count - even);
+  return (vget_lane_u32(any, 0) | vget_lane_u32(any, 1)) != 0 || needClamp;
+}
+
+void NEONClampArray(float *data, uint32_t count)
+{
+  const float32x4_t c1 = vdupq_n_f32(27.0f);
+  const float32x4_t c2 = vdupq_n_f32(9.0f);
+  const float32x4_t min = vdupq_n_f32(-3.0f);
+  const float32x4_t max = vdupq_n_f32(3.0f);
+
+  uint32_t even = count & ~0x3;
+  for (uint32_t i = 0; i < even; i+=4, data+=4)
   {
-    uint32_t odd = count - even;
-    if (odd == 1)
-      data[0] = SoftClamp(data[0]);
-    else
-    {
-      __m128 dt;
-      __m128 tmp;
-      __m128 out;
-      if (odd == 2)
-      {
-        /* tanh approx clamp */
-        dt  = _mm_setr_ps(data[0], data[1], 0, 0);
-        tmp = _mm_mul_ps(dt, dt);
-        out = _mm_div_ps(
-          _mm_mul_ps(
-            dt,
-            _mm_add_ps(c1, tmp)
-          ),
-          _mm_add_ps(c2, tmp)
-        );
-
-        data[0] = ((float*)&out)[0];
-        data[1] = ((float*)&out)[1];
-      }
-      else
-      {
-        /* tanh approx clamp */
-        dt  = _mm_setr_ps(data[0], data[1], data[2], 0);
-        tmp = _mm_mul_ps(dt, dt);
-        out = _mm_div_ps(
-          _mm_mul_ps(
-            dt,
-            _mm_add_ps(c1, tmp)
-          ),
-          _mm_add_ps(c2, tmp)
-        );
-
-        data[0] = ((float*)&out)[0];
-        data[1] = ((float*)&out)[1];
-        data[2] = ((float*)&out)[2];
-      }
-    }
+    /* tanh approx clamp, see SoftClamp() */
+    float32x4_t dt = vminq_f32(vmaxq_f32(vld1q_f32(data), min), max);
+    float32x4_t tmp = vmulq_f32(dt, dt);
+    float32x4_t num = vmulq_f32(dt, vaddq_f32(c1, tmp));
+    float32x4_t den = vmlaq_f32(c1, c2, tmp);
+#if defined(__aarch64__)
+    vst1q_f32(data, vdivq_f32(num, den));
+#else
+    /* no division on armv7, refine the estimated reciprocal twice instead */
+    float32x4_t rcp = vrecpeq_f32(den);
+    rcp = vmulq_f32(vrecpsq_f32(den, rcp), rcp);
+    rcp = vmulq_f32(vrecpsq_f32(den, rcp), rcp);
+    vst1q_f32(data, vmulq_f32(num, rcp));
+#endif
   }
+
+  ScalarClampArray(data, count - even);
+}
 #endif
+
+bool GetMixingKernels(AEKernels kernels, SMixingKernels &mixing)
+{
+  mixing.kernels = kernels;
+  switch (kernels)
+  {
+  case AE_KERNELS_SCALAR:
+    mixing.mulArray = ScalarMulArray;
+    mixing.mulAddArray = ScalarMulAddArray;
+    mixing.clampArray = ScalarClampArray;
+    return true;
+#if defined(HAVE_SSE) && defined(__SSE__)
+  case AE_KERNELS_SSE:
+    mixing.mulArray = SSEMulArray;
+    mixing.mulAddArray = SSEMulAddArray;
+    mixing.clampArray = SSEClampArray;
+    return true;
+#endif
+#if defined(HAVE_AE_AVX2)
+  case AE_KERNELS_AVX2:
+    if ((g_cpuInfo.GetCPUFeatures() & (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA3)) != (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA3))
+      return false;
+    mixing.mulArray = CAEUtilAVX2::MulArray;
+    mixing.mulAddArray = CAEUtilAVX2::MulAddArray;
+    mixing.clampArray = CAEUtilAVX2::ClampArray;
+    return true;
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+  case AE_KERNELS_NEON:
+#if !defined(__aarch64__)
+    if (!(g_cpuInfo.GetCPUFeatures() & CPU_FEATURE_NEON))
+      return false;
+#endif
+    mixing.mulArray = NEONMulArray;
+    mixing.mulAddArray = NEONMulAddArray;
+    mixing.clampArray = NEONClampArray;
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+SMixingKernels GetWidestMixingKernels()
+{
+  static const AEKernels widest[] = { AE_KERNELS_AVX2, AE_KERNELS_NEON, AE_KERNELS_SSE };
+  SMixingKernels mixing;
+  for (size_t i = 0; i < sizeof(widest) / sizeof(widest[0]); i++)
+  {
+    if (GetMixingKernels(widest[i], mixing))
+      return mixing;
+  }
+  GetMixingKernels(AE_KERNELS_SCALAR, mixing);
+  return mixing;
+}
+
+// picked with the first samples processed, the cpu features are known by then
+SMixingKernels& MixingKernels()
+{
+  static SMixingKernels mixing = GetWidestMixingKernels();
+  return mixing;
+}
+}
+
+void CAEUtil::MulArray(float *data, const float mul, uint32_t count)
+{
+  MixingKernels().mulArray(data, mul, count);
+}
+
+bool CAEUtil::MulAddArray(float *data, const float *add, const float mul, uint32_t count)
+{
+  return MixingKernels().mulAddArray(data, add, mul, count);
+}
+
+void CAEUtil::ClampArray(float *data, uint32_t count)
+{
+  MixingKernels().clampArray(data, count);
+}
+
+AEKernels CAEUtil::GetKernels()
+{
+  return MixingKernels().kernels;
+}
+
+bool CAEUtil::SetKernels(AEKernels kernels)
+{
+  SMixingKernels mixing;
+  if (!GetMixingKernels(kernels, mixing))
+    return false;
+
+  MixingKernels() = mixing;
+  return true;
 }
 
 bool CAEUtil::S16NeedsByteSwap(AEDataFormat in, AEDataFormat out)
@@ -43,6 +43,15 @@ extern "C" {
   #define MEMALIGN(b, x) __declspec(align(b)) x
 #endif
 
+// sets of vector instructions the mixing kernels of CAEUtil are available in
+enum AEKernels
+{
+  AE_KERNELS_SCALAR = 0,
+  AE_KERNELS_SSE,
+  AE_KERNELS_AVX2,
+  AE_KERNELS_NEON
+};
+
 // AV sync options
 enum AVSync
 {
@@ -133,8 +142,6 @@ private:
     static __m128i m_sseSeed;
   #endif
 
-  static float SoftClamp(const float x);
-
 public:
   static CAEChannelInfo          GuessChLayout     (const unsigned int channels);
   static const char*             GetStdChLayoutName(const enum AEStdChLayout layout);
@@ -202,12 +209,42 @@ public:
     return 20*log10(scale);
   }
 
-  #if defined(HAVE_SSE) && defined(__SSE__)
-  static void SSEMulArray     (float *data, const float mul, uint32_t count);
-  static void SSEMulAddArray  (float *data, float *add, const float mul, uint32_t count);
-  #endif
+  /*! \brief multiply samples by a volume
+   Like all mixing kernels it uses the widest vector instructions the cpu supports.
+   \param data the samples, multiplied in place
+   \param mul the volume
+   \param count number of samples
+   */
+  static void MulArray(float *data, const float mul, uint32_t count);
+
+  /*! \brief mix samples in at a volume
+   \param data the samples mixed into
+   \param add the samples mixed in
+   \param mul the volume of the samples mixed in
+   \param count number of samples
+   \return true if any of the mixed samples is out of -1..1, so they have to be clamped
+   \sa ClampArray
+   */
+  static bool MulAddArray(float *data, const float *add, const float mul, uint32_t count);
+
+  /*! \brief soft clamp samples to -1..1
+   \param data the samples, clamped in place
+   \param count number of samples
+   */
   static void ClampArray(float *data, uint32_t count);
 
+  /*! \brief the set of vector instructions the mixing kernels use
+   It's the widest one the cpu supports, unless a different one was set.
+   \sa SetKernels
+   */
+  static AEKernels GetKernels();
+
+  /*! \brief use the mixing kernels of a different set of vector instructions, i.e. to compare them
+   Must not be called while audio is processed.
+   \return false if the cpu or the build doesn't support them
+   */
+  static bool SetKernels(AEKernels kernels);
+
   static bool S16NeedsByteSwap(AEDataFormat in, AEDataFormat out);
 
   static uint64_t GetAVChannelLayout(const CAEChannelInfo &info);
@@ -0,0 +1,98 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "AEUtilAVX2.h"
+
+#include <immintrin.h>
+
+namespace
+{
+// lanes below count are loaded and stored by the masked tail of each kernel
+inline __m256i TailMask(uint32_t count)
+{
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), lanes);
+}
+
+inline __m256 Clamp(__m256 data)
+{
+  /* tanh approx clamp, see SoftClamp() in AEUtil.cpp */
+  const __m256 c1 = _mm256_set1_ps(27.0f);
+  const __m256 c2 = _mm256_set1_ps(9.0f);
+  __m256 dt  = _mm256_min_ps(_mm256_max_ps(data, _mm256_set1_ps(-3.0f)), _mm256_set1_ps(3.0f));
+  __m256 tmp = _mm256_mul_ps(dt, dt);
+  return _mm256_div_ps(_mm256_mul_ps(dt, _mm256_add_ps(c1, tmp)), _mm256_fmadd_ps(c2, tmp, c1));
+}
+}
+
+void CAEUtilAVX2::MulArray(float *data, const float mul, uint32_t count)
+{
+  const __m256 m = _mm256_set1_ps(mul);
+
+  uint32_t even = count & ~0x7;
+  for (uint32_t i = 0; i < even; i+=8, data+=8)
+    _mm256_storeu_ps(data, _mm256_mul_ps(_mm256_loadu_ps(data), m));
+
+  if (even != count)
+  {
+    __m256i mask = TailMask(count - even);
+    _mm256_maskstore_ps(data, mask, _mm256_mul_ps(_mm256_maskload_ps(data, mask), m));
+  }
+}
+
+bool CAEUtilAVX2::MulAddArray(float *data, const float *add, const float mul, uint32_t count)
+{
+  const __m256 m = _mm256_set1_ps(mul);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  __m256 over = _mm256_setzero_ps();
+
+  uint32_t even = count & ~0x7;
+  for (uint32_t i = 0; i < even; i+=8, data+=8, add+=8)
+  {
+    __m256 to = _mm256_fmadd_ps(_mm256_loadu_ps(add), m, _mm256_loadu_ps(data));
+    _mm256_storeu_ps(data, to);
+    over = _mm256_or_ps(over, _mm256_cmp_ps(_mm256_and_ps(to, abs), one, _CMP_GT_OQ));
+  }
+
+  if (even != count)
+  {
+    // masked off lanes load as 0, so they never count as over
+    __m256i mask = TailMask(count - even);
+    __m256 to = _mm256_fmadd_ps(_mm256_maskload_ps(add, mask), m, _mm256_maskload_ps(data, mask));
+    _mm256_maskstore_ps(data, mask, to);
+    over = _mm256_or_ps(over, _mm256_cmp_ps(_mm256_and_ps(to, abs), one, _CMP_GT_OQ));
+  }
+
+  return _mm256_movemask_ps(over) != 0;
+}
+
+void CAEUtilAVX2::ClampArray(float *data, uint32_t count)
+{
+  uint32_t even = count & ~0x7;
+  for (uint32_t i = 0; i < even; i+=8, data+=8)
+    _mm256_storeu_ps(data, Clamp(_mm256_loadu_ps(data)));
+
+  if (even != count)
+  {
+    __m256i mask = TailMask(count - even);
+    _mm256_maskstore_ps(data, mask, Clamp(_mm256_maskload_ps(data, mask)));
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+
+/*!
+ \brief Mixing kernels of CAEUtil using AVX2 and FMA
+
+ Built with -mavx2 -mfma on their own, so they must only be called if the cpu
+ supports both. Use them through CAEUtil, which checks that.
+ \sa CAEUtil::MulArray, CAEUtil::MulAddArray, CAEUtil::ClampArray
+ */
+class CAEUtilAVX2
+{
+public:
+  static void MulArray(float *data, const float mul, uint32_t count);
+  static bool MulAddArray(float *data, const float *add, const float mul, uint32_t count);
+  static void ClampArray(float *data, uint32_t count);
+};
@@ -0,0 +1,203 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cores/AudioEngine/Utils/AEUtil.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const AEKernels allKernels[] = { AE_KERNELS_SCALAR, AE_KERNELS_SSE, AE_KERNELS_AVX2, AE_KERNELS_NEON };
+const char *kernelNames[] = { "scalar", "sse", "avx2", "neon" };
+
+// puts back the kernels picked for the cpu
+class KernelsGuard
+{
+public:
+  KernelsGuard() : m_kernels(CAEUtil::GetKernels()) {}
+  ~KernelsGuard() { CAEUtil::SetKernels(m_kernels); }
+private:
+  AEKernels m_kernels;
+};
+
+std::vector<float> GetSamples(size_t count, float range)
+{
+  std::vector<float> samples(count);
+  unsigned int seed = 1;
+  for (size_t i = 0; i < count; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    samples[i] = ((seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f) * range;
+  }
+  return samples;
+}
+}
+
+TEST(TestAEUtil, Kernels)
+{
+  KernelsGuard guard;
+
+  EXPECT_TRUE(CAEUtil::SetKernels(AE_KERNELS_SCALAR));
+  EXPECT_EQ(AE_KERNELS_SCALAR, CAEUtil::GetKernels());
+}
+
+TEST(TestAEUtil, KernelsMatchScalar)
+{
+  KernelsGuard guard;
+
+  // odd counts and offsets to get unaligned buffers and partial vectors
+  const uint32_t counts[] = { 0, 1, 3, 7, 8, 15, 17, 1023 };
+  const std::vector<float> data = GetSamples(1030, 1.0f);
+  const std::vector<float> add = GetSamples(1030, 4.0f);
+
+  for (size_t k = 1; k < sizeof(allKernels) / sizeof(allKernels[0]); k++)
+  {
+    if (!CAEUtil::SetKernels(allKernels[k]))
+      continue;
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+      for (uint32_t offset = 0; offset < 3; offset++)
+      {
+        SCOPED_TRACE(std::string(kernelNames[k]) + " count " + std::to_string(counts[c]) + " offset " + std::to_string(offset));
+
+        std::vector<float> expected = data;
+        std::vector<float> actual = data;
+        CAEUtil::SetKernels(AE_KERNELS_SCALAR);
+        CAEUtil::MulArray(&expected[offset], 0.7f, counts[c]);
+        CAEUtil::SetKernels(allKernels[k]);
+        CAEUtil::MulArray(&actual[offset], 0.7f, counts[c]);
+        for (size_t i = 0; i < data.size(); i++)
+          ASSERT_NEAR(expected[i], actual[i], 1e-6f);
+
+        expected = data;
+        actual = data;
+        CAEUtil::SetKernels(AE_KERNELS_SCALAR);
+        bool expectedClamp = CAEUtil::MulAddArray(&expected[offset], &add[offset], 0.3f, counts[c]);
+        CAEUtil::SetKernels(allKernels[k]);
+        bool actualClamp = CAEUtil::MulAddArray(&actual[offset], &add[offset], 0.3f, counts[c]);
+        EXPECT_EQ(expectedClamp, actualClamp);
+        for (size_t i = 0; i < data.size(); i++)
+          ASSERT_NEAR(expected[i], actual[i], 1e-6f);
+
+        std::vector<float> clamped = expected;
+        CAEUtil::SetKernels(AE_KERNELS_SCALAR);
+        CAEUtil::ClampArray(&expected[offset], counts[c]);
+        CAEUtil::SetKernels(allKernels[k]);
+        CAEUtil::ClampArray(&clamped[offset], counts[c]);
+        for (size_t i = 0; i < data.size(); i++)
+          ASSERT_NEAR(expected[i], clamped[i], 1e-5f);
+      }
+    }
+  }
+}
+
+TEST(TestAEUtil, MulAddArrayNeedsClamp)
+{
+  KernelsGuard guard;
+
+  for (size_t k = 0; k < sizeof(allKernels) / sizeof(allKernels[0]); k++)
+  {
+    if (!CAEUtil::SetKernels(allKernels[k]))
+      continue;
+    SCOPED_TRACE(kernelNames[k]);
+
+    // a single sample out of range, anywhere in a vector or the tail
+    for (uint32_t at = 0; at < 19; at++)
+    {
+      std::vector<float> data(19, 0.5f);
+      std::vector<float> add(19, 0.5f);
+      EXPECT_FALSE(CAEUtil::MulAddArray(data.data(), add.data(), 1.0f, data.size()));
+
+      data.assign(19, 0.5f);
+      add[at] = -4.0f;
+      EXPECT_TRUE(CAEUtil::MulAddArray(data.data(), add.data(), 1.0f, data.size()));
+    }
+  }
+}
+
+TEST(TestAEUtil, ClampArray)
+{
+  KernelsGuard guard;
+
+  for (size_t k = 0; k < sizeof(allKernels) / sizeof(allKernels[0]); k++)
+  {
+    if (!CAEUtil::SetKernels(allKernels[k]))
+      continue;
+    SCOPED_TRACE(kernelNames[k]);
+
+    std::vector<float> data = GetSamples(1027, 10.0f);
+    CAEUtil::ClampArray(data.data(), data.size());
+    for (size_t i = 0; i < data.size(); i++)
+    {
+      ASSERT_LE(data[i], 1.0f);
+      ASSERT_GE(data[i], -1.0f);
+    }
+
+    float limits[] = { 3.0f, -3.0f, 100.0f, -100.0f, 0.0f };
+    CAEUtil::ClampArray(limits, 5);
+    EXPECT_NEAR(1.0f, limits[0], 1e-6f);
+    EXPECT_NEAR(-1.0f, limits[1], 1e-6f);
+    EXPECT_NEAR(1.0f, limits[2], 1e-6f);
+    EXPECT_NEAR(-1.0f, limits[3], 1e-6f);
+    EXPECT_EQ(0.0f, limits[4]);
+  }
+}
+
+// Mixes 7.1 at 192kHz with each mixing kernel the CPU supports. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestAEUtil, DISABLED_KernelsBenchmark)
+{
+  KernelsGuard guard;
+
+  // a second of 7.1 at 192kHz in periods of 1024 frames: two streams mixed,
+  // clamped and deamplified like ActiveAE does
+  const uint32_t period = 1024 * 8;
+  const uint32_t periods = 192000 / 1024;
+  const std::vector<float> stream = GetSamples(period, 0.8f);
+  const std::vector<float> mixed = GetSamples(period, 0.8f);
+  std::vector<float> out(period);
+
+  for (size_t k = 0; k < sizeof(allKernels) / sizeof(allKernels[0]); k++)
+  {
+    if (!CAEUtil::SetKernels(allKernels[k]))
+      continue;
+
+    CStopWatch timer;
+    timer.StartZero();
+    for (int run = 0; run < 10; run++)
+    {
+      for (uint32_t p = 0; p < periods; p++)
+      {
+        out = stream;
+        CAEUtil::MulArray(out.data(), 0.9f, period);
+        if (CAEUtil::MulAddArray(out.data(), mixed.data(), 0.9f, period))
+          CAEUtil::ClampArray(out.data(), period);
+        CAEUtil::MulArray(out.data(), 0.5f, period);
+      }
+    }
+    std::cout << "10 s of 7.1 at 192kHz mixed with " << kernelNames[k] << ": "
+              << timer.GetElapsedMilliseconds() << " ms" << std::endl;
+  }
+}
@@ -25,6 +25,7 @@
 CDataCacheCore::CDataCacheCore()
 {
   m_hasAVInfoChanges = false;
+  m_demuxInfo = SDemuxInfo();
 }
 
 CDataCacheCore& GetInstance()
@@ -235,3 +236,42 @@ bool CDataCacheCore::CDataCacheCore::IsSeeking()
 
   return m_stateInfo.m_stateSeeking;
 }
+
+// demuxer info
+void CDataCacheCore::SetDemuxPacketStats(uint64_t allocated, uint64_t recycled, uint64_t referenced, uint64_t pooledBytes)
+{
+  CSingleLock lock(m_demuxSection);
+
+  m_demuxInfo.packetsAllocated = allocated;
+  m_demuxInfo.packetsRecycled = recycled;
+  m_demuxInfo.packetsReferenced = referenced;
+  m_demuxInfo.pooledBytes = pooledBytes;
+}
+
+uint64_t CDataCacheCore::GetDemuxPacketsAllocated()
+{
+  CSingleLock lock(m_demuxSection);
+
+  return m_demuxInfo.packetsAllocated;
+}
+
+uint64_t CDataCacheCore::GetDemuxPacketsRecycled()
+{
+  CSingleLock lock(m_demuxSection);
+
+  return m_demuxInfo.packetsRecycled;
+}
+
+uint64_t CDataCacheCore::GetDemuxPacketsReferenced()
+{
+  CSingleLock lock(m_demuxSection);
+
+  return m_demuxInfo.packetsReferenced;
+}
+
+uint64_t CDataCacheCore::GetDemuxPooledBytes()
+{
+  CSingleLock lock(m_demuxSection);
+
+  return m_demuxInfo.pooledBytes;
+}
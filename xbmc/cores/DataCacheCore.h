@@ -21,6 +21,7 @@
 */
 
 #include <atomic>
+#include <stdint.h>
 #include <string>
 #include "threads/CriticalSection.h"
 
@@ -67,6 +68,13 @@ public:
   void SetStateSeeking(bool active);
   bool IsSeeking();
 
+  // demuxer info
+  void SetDemuxPacketStats(uint64_t allocated, uint64_t recycled, uint64_t referenced, uint64_t pooledBytes);
+  uint64_t GetDemuxPacketsAllocated();
+  uint64_t GetDemuxPacketsRecycled();
+  uint64_t GetDemuxPacketsReferenced();
+  uint64_t GetDemuxPooledBytes();
+
 protected:
   std::atomic_bool m_hasAVInfoChanges;
 
@@ -103,4 +111,13 @@ protected:
   {
     bool m_stateSeeking;
   } m_stateInfo;
+
+  CCriticalSection m_demuxSection;
+  struct SDemuxInfo
+  {
+    uint64_t packetsAllocated;
+    uint64_t packetsRecycled;
+    uint64_t packetsReferenced;
+    uint64_t pooledBytes;
+  } m_demuxInfo;
 };
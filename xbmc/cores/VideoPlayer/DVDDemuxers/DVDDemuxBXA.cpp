@@ -134,7 +134,7 @@ DemuxPacket* CDVDDemuxBXA::Read()
 
   if(pPacket->iSize < 1)
   {
-    delete pPacket;
+    CDVDDemuxUtils::FreeDemuxPacket(pPacket);
     pPacket = NULL;
   }
   else
@@ -925,7 +925,7 @@ DemuxPacket* CDVDDemuxFFmpeg::Read()
           {
             if(m_pkt.pkt.stream_index == (int)m_pFormatContext->programs[m_program]->stream_index[i])
             {
-              pPacket = CDVDDemuxUtils::AllocateDemuxPacket(m_pkt.pkt.size);
+              pPacket = CreatePacket(m_pkt.pkt);
               break;
             }
           }
@@ -934,7 +934,7 @@ DemuxPacket* CDVDDemuxFFmpeg::Read()
             bReturnEmpty = true;
         }
         else
-          pPacket = CDVDDemuxUtils::AllocateDemuxPacket(m_pkt.pkt.size);
+          pPacket = CreatePacket(m_pkt.pkt);
       }
       else
         bReturnEmpty = true;
@@ -948,13 +948,6 @@ DemuxPacket* CDVDDemuxFFmpeg::Read()
           m_pkt.pkt.pts = AV_NOPTS_VALUE;
         }
 
-        // copy contents into our own packet
-        pPacket->iSize = m_pkt.pkt.size;
-
-        // maybe we can avoid a memcpy here by detecting where pkt.destruct is pointing too?
-        if (m_pkt.pkt.data)
-          memcpy(pPacket->pData, m_pkt.pkt.data, pPacket->iSize);
-
         pPacket->pts = ConvertTimestamp(m_pkt.pkt.pts, stream->time_base.den, stream->time_base.num);
         pPacket->dts = ConvertTimestamp(m_pkt.pkt.dts, stream->time_base.den, stream->time_base.num);
         pPacket->duration =  DVD_SEC_TO_TIME((double)m_pkt.pkt.duration * stream->time_base.num / stream->time_base.den);
@@ -1062,6 +1055,27 @@ DemuxPacket* CDVDDemuxFFmpeg::Read()
   return pPacket;
 }
 
+DemuxPacket* CDVDDemuxFFmpeg::CreatePacket(const AVPacket &pkt)
+{
+  // hand on the data of ffmpeg's reference counted buffer if we can
+  if (g_advancedSettings.m_videoDemuxZeroCopy)
+  {
+    DemuxPacket* packet = CDVDDemuxUtils::ReferenceDemuxPacket(&pkt);
+    if (packet)
+      return packet;
+  }
+
+  // copy contents into our own packet
+  DemuxPacket* packet = CDVDDemuxUtils::AllocateDemuxPacket(pkt.size);
+  if (packet)
+  {
+    packet->iSize = pkt.size;
+    if (pkt.data && pkt.size > 0)
+      memcpy(packet->pData, pkt.data, pkt.size);
+  }
+  return packet;
+}
+
 bool CDVDDemuxFFmpeg::SeekTime(double time, bool backwards, double *startpts)
 {
   bool hitEnd = false;
@@ -128,6 +128,7 @@ protected:
   void CreateStreams(unsigned int program = UINT_MAX);
   void DisposeStreams();
   void ParsePacket(AVPacket *pkt);
+  DemuxPacket* CreatePacket(const AVPacket &pkt);
   bool IsVideoReady();
   void ResetVideoStreams();
   AVDictionary *GetFFMpegOptionsFromInput();
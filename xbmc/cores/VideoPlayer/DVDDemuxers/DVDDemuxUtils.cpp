@@ -21,9 +21,15 @@
 #include "DVDDemuxUtils.h"
 #include "TimingConstants.h"
 #include "DemuxCrypto.h"
+#include "threads/CriticalSection.h"
+#include "threads/SingleLock.h"
 #include "utils/log.h"
 #include "system.h"
 
+#include <atomic>
+#include <string.h>
+#include <vector>
+
 #ifdef TARGET_POSIX
 #include "linux/XMemUtils.h"
 #endif
@@ -32,13 +38,148 @@ extern "C" {
 #include "libavcodec/avcodec.h"
 }
 
+// buffers of 2^POOL_MIN_CLASS up to 2^POOL_MAX_CLASS bytes are pooled
+#define POOL_MIN_CLASS 10
+#define POOL_MAX_CLASS 22
+#define POOL_MAX_BYTES (32 * 1024 * 1024)
+// packets without data of their own
+#define POOL_MAX_EMPTY 1024
+
+namespace
+{
+
+struct SPooledPacket : public DemuxPacket
+{
+  SPooledPacket() : sizeClass(-1), buffer(nullptr) { pData = nullptr; }
+
+  int sizeClass;       // size class of pData, 0 without data, -1 if it isn't pooled
+  AVBufferRef* buffer; // set if pData is referenced instead of owned
+};
+
+class CDemuxPacketPool
+{
+public:
+  CDemuxPacketPool() : m_pooledBytes(0)
+  {
+    m_allocated = 0;
+    m_recycled = 0;
+    m_referenced = 0;
+  }
+
+  SPooledPacket* Get(int sizeClass)
+  {
+    {
+      CSingleLock lock(m_section);
+      std::vector<SPooledPacket*> &packets = m_packets[sizeClass];
+      if (!packets.empty())
+      {
+        SPooledPacket* packet = packets.back();
+        packets.pop_back();
+        if (sizeClass > 0)
+        {
+          m_pooledBytes -= 1 << sizeClass;
+          m_recycled++;
+        }
+        return packet;
+      }
+    }
+
+    SPooledPacket* packet = new SPooledPacket;
+    packet->sizeClass = sizeClass;
+    if (sizeClass > 0)
+    {
+      packet->pData = (uint8_t*)_aligned_malloc(1 << sizeClass, 16);
+      if (!packet->pData)
+      {
+        delete packet;
+        return nullptr;
+      }
+      m_allocated++;
+    }
+    return packet;
+  }
+
+  bool Put(SPooledPacket* packet)
+  {
+    int sizeClass = packet->sizeClass;
+    CSingleLock lock(m_section);
+    if (sizeClass > 0)
+    {
+      if (m_pooledBytes + (1 << sizeClass) > POOL_MAX_BYTES)
+        return false;
+      m_pooledBytes += 1 << sizeClass;
+    }
+    else if (m_packets[0].size() >= POOL_MAX_EMPTY)
+      return false;
+    m_packets[sizeClass].push_back(packet);
+    return true;
+  }
+
+  size_t GetPooledBytes() const
+  {
+    CSingleLock lock(m_section);
+    return m_pooledBytes;
+  }
+
+  std::atomic<uint64_t> m_allocated;
+  std::atomic<uint64_t> m_recycled;
+  std::atomic<uint64_t> m_referenced;
+
+private:
+  CCriticalSection m_section;
+  std::vector<SPooledPacket*> m_packets[POOL_MAX_CLASS + 1];
+  size_t m_pooledBytes;
+};
+
+CDemuxPacketPool& GetPool()
+{
+  // never destroyed, packets may still be freed during static destruction
+  static CDemuxPacketPool* pool = new CDemuxPacketPool;
+  return *pool;
+}
+
+int GetSizeClass(int size)
+{
+  int sizeClass = POOL_MIN_CLASS;
+  while ((1 << sizeClass) < size)
+    sizeClass++;
+  return sizeClass;
+}
+
+void ResetPacket(DemuxPacket* pPacket)
+{
+  pPacket->iSize     = 0;
+  pPacket->iStreamId = -1;
+  pPacket->demuxerId = 0;
+  pPacket->iGroupId  = 0;
+  pPacket->dts       = DVD_NOPTS_VALUE;
+  pPacket->pts       = DVD_NOPTS_VALUE;
+  pPacket->duration  = 0;
+  pPacket->dispTime  = 0;
+  pPacket->cryptoInfo.reset();
+}
+
+}
+
 void CDVDDemuxUtils::FreeDemuxPacket(DemuxPacket* pPacket)
 {
   if (pPacket)
   {
     try {
-      if (pPacket->pData) _aligned_free(pPacket->pData);
-      delete pPacket;
+      SPooledPacket* packet = static_cast<SPooledPacket*>(pPacket);
+      if (packet->buffer)
+      {
+        av_buffer_unref(&packet->buffer);
+        packet->pData = nullptr;
+        packet->sizeClass = 0;
+      }
+      packet->cryptoInfo.reset();
+
+      if (packet->sizeClass >= 0 && GetPool().Put(packet))
+        return;
+
+      if (packet->pData) _aligned_free(packet->pData);
+      delete packet;
     }
     catch(...) {
       CLog::Log(LOGERROR, "%s - Exception thrown while freeing packet", __FUNCTION__);
@@ -48,13 +189,10 @@ void CDVDDemuxUtils::FreeDemuxPacket(DemuxPacket* pPacket)
 
 DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(int iDataSize)
 {
-  DemuxPacket* pPacket = new DemuxPacket;
-  if (!pPacket) return NULL;
+  SPooledPacket* pPacket = nullptr;
 
   try
   {
-    memset(pPacket, 0, sizeof(DemuxPacket));
-
     if (iDataSize > 0)
     {
       // need to allocate a few bytes more.
@@ -66,22 +204,34 @@ DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(int iDataSize)
         * Note, if the first 23 bits of the additional bytes are not 0 then damaged
         * MPEG bitstreams could cause overread and segfault
         */
-      pPacket->pData =(uint8_t*)_aligned_malloc(iDataSize + FF_INPUT_BUFFER_PADDING_SIZE, 16);
-      if (!pPacket->pData)
+      int sizeClass = GetSizeClass(iDataSize + FF_INPUT_BUFFER_PADDING_SIZE);
+      if (sizeClass <= POOL_MAX_CLASS)
+        pPacket = GetPool().Get(sizeClass);
+      else
       {
-        FreeDemuxPacket(pPacket);
-        return NULL;
+        pPacket = new SPooledPacket;
+        pPacket->pData = (uint8_t*)_aligned_malloc(iDataSize + FF_INPUT_BUFFER_PADDING_SIZE, 16);
+        if (!pPacket->pData)
+        {
+          FreeDemuxPacket(pPacket);
+          return NULL;
+        }
+        GetPool().m_allocated++;
       }
+      if (!pPacket)
+        return NULL;
 
       // reset the last 8 bytes to 0;
       memset(pPacket->pData + iDataSize, 0, FF_INPUT_BUFFER_PADDING_SIZE);
     }
+    else
+    {
+      pPacket = GetPool().Get(0);
+      pPacket->pData = NULL;
+    }
 
     // setup defaults
-    pPacket->dts       = DVD_NOPTS_VALUE;
-    pPacket->pts       = DVD_NOPTS_VALUE;
-    pPacket->iStreamId = -1;
-    pPacket->dispTime = 0;
+    ResetPacket(pPacket);
   }
   catch(...)
   {
@@ -99,3 +249,39 @@ DemuxPacket* CDVDDemuxUtils::AllocateDemuxPacket(unsigned int iDataSize, unsigne
     ret->cryptoInfo = std::shared_ptr<DemuxCryptoInfo>(new DemuxCryptoInfo(encryptedSubsampleCount));
   return ret;
 }
+
+DemuxPacket* CDVDDemuxUtils::ReferenceDemuxPacket(const AVPacket* pkt)
+{
+  if (!pkt->buf || !pkt->data || pkt->size <= 0)
+    return NULL;
+
+  // decoders may read past the end of the data
+  const uint8_t* end = pkt->buf->data + pkt->buf->size;
+  if (pkt->data < pkt->buf->data || pkt->data + pkt->size + FF_INPUT_BUFFER_PADDING_SIZE > end)
+    return NULL;
+
+  AVBufferRef* buffer = av_buffer_ref(pkt->buf);
+  if (!buffer)
+    return NULL;
+
+  SPooledPacket* pPacket = GetPool().Get(0);
+  ResetPacket(pPacket);
+  pPacket->buffer = buffer;
+  pPacket->pData = pkt->data;
+  pPacket->iSize = pkt->size;
+  GetPool().m_referenced++;
+
+  return pPacket;
+}
+
+DemuxPacketStats CDVDDemuxUtils::GetPacketStats()
+{
+  CDemuxPacketPool& pool = GetPool();
+
+  DemuxPacketStats stats;
+  stats.allocated = pool.m_allocated;
+  stats.recycled = pool.m_recycled;
+  stats.referenced = pool.m_referenced;
+  stats.pooledBytes = pool.GetPooledBytes();
+  return stats;
+}
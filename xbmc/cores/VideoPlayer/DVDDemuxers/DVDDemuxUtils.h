@@ -20,13 +20,42 @@
  *
  */
 
+#include <stdint.h>
+
 #include "DVDDemuxPacket.h"
 
+struct AVPacket;
+
+struct DemuxPacketStats
+{
+  uint64_t allocated;  // packets for which a buffer was allocated
+  uint64_t recycled;   // packets which reused a buffer of the pool
+  uint64_t referenced; // packets which reference the data of an AVPacket
+  uint64_t pooledBytes; // size of the buffers waiting in the pool
+};
+
 class CDVDDemuxUtils
 {
 public:
+  /*!
+   * \brief Frees a packet of AllocateDemuxPacket() or ReferenceDemuxPacket()
+   *
+   * Buffers of common sizes go back to a pool and are handed out again by
+   * AllocateDemuxPacket().
+   */
   static void FreeDemuxPacket(DemuxPacket* pPacket);
   static DemuxPacket* AllocateDemuxPacket(int iDataSize = 0);
   static DemuxPacket* AllocateDemuxPacket(unsigned int iDataSize, unsigned int encryptedSubsampleCount);
+
+  /*!
+   * \brief Creates a packet holding a reference to the data of pkt instead of a copy
+   *
+   * \return NULL if the data of pkt can't be referenced, e.g. because it isn't
+   * reference counted or lacks the padding decoders expect. The caller has to
+   * copy it into a packet of AllocateDemuxPacket() then.
+   */
+  static DemuxPacket* ReferenceDemuxPacket(const AVPacket* pkt);
+
+  static DemuxPacketStats GetPacketStats();
 };
 
@@ -22,11 +22,63 @@
 #include "DVDDemuxers/DVDDemuxPacket.h"
 #include "utils/log.h"
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
 #include "TimingConstants.h"
 #include "math.h"
 
-CDVDMessageQueue::CDVDMessageQueue(const std::string &owner) : m_hEvent(true), m_owner(owner)
+#define MSGQ_RING_SIZE 256
+
+CDVDMessageRing::CDVDMessageRing() : m_items(MSGQ_RING_SIZE), m_back(0), m_size(0)
+{
+}
+
+CDVDMessageRing::~CDVDMessageRing()
+{
+  remove_if([](const Item &item){ return true; });
+}
+
+void CDVDMessageRing::push_front(CDVDMsg* msg, int priority)
+{
+  if (m_size == m_items.size())
+    Grow();
+
+  Item &item = at(m_size);
+  item.message = msg->Acquire();
+  item.priority = priority;
+  m_size++;
+}
+
+void CDVDMessageRing::push_back(CDVDMsg* msg, int priority)
+{
+  if (m_size == m_items.size())
+    Grow();
+
+  m_back = (m_back - 1) & (m_items.size() - 1);
+  Item &item = at(0);
+  item.message = msg->Acquire();
+  item.priority = priority;
+  m_size++;
+}
+
+void CDVDMessageRing::pop_back()
+{
+  at(0).message->Release();
+  m_back = (m_back + 1) & (m_items.size() - 1);
+  m_size--;
+}
+
+void CDVDMessageRing::Grow()
 {
+  std::vector<Item> items(m_items.size() * 2);
+  for (size_t i = 0; i < m_size; i++)
+    items[i] = at(i);
+  m_items.swap(items);
+  m_back = 0;
+}
+
+CDVDMessageQueue::CDVDMessageQueue(const std::string &owner) : m_owner(owner)
+{
+  m_waiting = 0;
   m_iDataSize     = 0;
   m_bAbortRequest = false;
   m_bInitialized = false;
@@ -57,7 +109,7 @@ void CDVDMessageQueue::Flush(CDVDMsg::Message type)
 {
   CSingleLock lock(m_section);
 
-  m_messages.remove_if([type](const DVDMessageListItem &item){
+  m_messages.remove_if([type](const CDVDMessageRing::Item &item){
     return type == CDVDMsg::NONE || item.message->IsType(type);
   });
 
@@ -80,7 +132,7 @@ void CDVDMessageQueue::Abort()
   m_bAbortRequest = true;
 
   // inform waiter for abort action
-  m_hEvent.Set();
+  m_condition.notifyAll();
 }
 
 void CDVDMessageQueue::End()
@@ -142,9 +194,9 @@ MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority, bool front
     }
 
     if (front)
-      m_messages.emplace_front(pMsg, priority);
+      m_messages.push_front(pMsg, priority);
     else
-      m_messages.emplace_back(pMsg, priority);
+      m_messages.push_back(pMsg, priority);
   }
 
   if (pMsg->IsType(CDVDMsg::DEMUXER_PACKET) && priority == 0)
@@ -162,8 +214,10 @@ MsgQueueReturnCode CDVDMessageQueue::Put(CDVDMsg* pMsg, int priority, bool front
 
   pMsg->Release();
 
-  // inform waiter for new packet
-  m_hEvent.Set();
+  // inform waiter for new packet. Unlike an event this costs nothing while
+  // the consumer is busy, which is most of the time.
+  if (m_waiting)
+    m_condition.notifyAll();
 
   return MSGQ_OK;
 }
@@ -182,13 +236,26 @@ MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutIn
     return MSGQ_NOT_INITIALIZED;
   }
 
+  XbmcThreads::EndTime timeout(iTimeoutInMilliSeconds);
+
   while (!m_bAbortRequest)
   {
-    std::list<DVDMessageListItem> &msgs = (priority > 0 || !m_prioMessages.empty()) ? m_prioMessages : m_messages;
-
-    if (!msgs.empty() && (msgs.back().priority >= priority || m_drain))
+    if (priority > 0 || !m_prioMessages.empty())
+    {
+      if (!m_prioMessages.empty() && (m_prioMessages.back().priority >= priority || m_drain))
+      {
+        DVDMessageListItem& item(m_prioMessages.back());
+        priority = item.priority;
+        *pMsg = item.message->Acquire();
+        m_prioMessages.pop_back();
+        UpdateTimeBack();
+        ret = MSGQ_OK;
+        break;
+      }
+    }
+    else if (!m_messages.empty())
     {
-      DVDMessageListItem& item(msgs.back());
+      CDVDMessageRing::Item& item(m_messages.back());
       priority = item.priority;
 
       if (item.message->IsType(CDVDMsg::DEMUXER_PACKET) && item.priority == 0)
@@ -201,27 +268,22 @@ MsgQueueReturnCode CDVDMessageQueue::Get(CDVDMsg** pMsg, unsigned int iTimeoutIn
       }
 
       *pMsg = item.message->Acquire();
-      msgs.pop_back();
+      m_messages.pop_back();
       UpdateTimeBack();
       ret = MSGQ_OK;
       break;
     }
-    else if (!iTimeoutInMilliSeconds)
+
+    if (timeout.IsTimePast())
     {
       ret = MSGQ_TIMEOUT;
       break;
     }
-    else
-    {
-      m_hEvent.Reset();
-      lock.Leave();
-
-      // wait for a new message
-      if (!m_hEvent.WaitMSec(iTimeoutInMilliSeconds))
-        return MSGQ_TIMEOUT;
 
-      lock.Enter();
-    }
+    // wait for a new message
+    m_waiting++;
+    m_condition.wait(lock, timeout.MillisLeft());
+    m_waiting--;
   }
 
   if (m_bAbortRequest)
@@ -282,9 +344,9 @@ unsigned CDVDMessageQueue::GetPacketCount(CDVDMsg::Message type)
     return 0;
 
   unsigned count = 0;
-  for (const auto &item : m_messages)
+  for (size_t i = 0; i < m_messages.size(); i++)
   {
-    if(item.message->IsType(type))
+    if(m_messages.at(i).message->IsType(type))
       count++;
   }
   for (const auto &item : m_prioMessages)
@@ -24,9 +24,10 @@
 #include <atomic>
 #include <string>
 #include <list>
+#include <vector>
 #include <algorithm>
+#include "threads/Condition.h"
 #include "threads/CriticalSection.h"
-#include "threads/Event.h"
 
 struct DVDMessageListItem
 {
@@ -53,6 +54,72 @@ struct DVDMessageListItem
   int priority;
 };
 
+/**
+ * Ring of messages, ordered like the lists of the message queue: the front
+ * holds the newest message, the back the oldest one.
+ *
+ * The storage grows to the largest number of messages queued at once and
+ * is reused after that, so queueing a message doesn't allocate.
+ * The ring holds a reference to every message in it.
+ */
+class CDVDMessageRing
+{
+public:
+  struct Item
+  {
+    CDVDMsg* message;
+    int priority;
+  };
+
+  CDVDMessageRing();
+  ~CDVDMessageRing();
+
+  bool empty() const { return m_size == 0; }
+  size_t size() const { return m_size; }
+
+  Item& front() { return at(m_size - 1); }
+  Item& back() { return at(0); }
+
+  /**
+   * index 0 is the oldest message
+   */
+  Item& at(size_t index) { return m_items[(m_back + index) & (m_items.size() - 1)]; }
+  const Item& at(size_t index) const { return m_items[(m_back + index) & (m_items.size() - 1)]; }
+
+  void push_front(CDVDMsg* msg, int priority);
+  void push_back(CDVDMsg* msg, int priority);
+
+  /**
+   * releases the oldest message
+   */
+  void pop_back();
+
+  template<typename P>
+  void remove_if(P predicate)
+  {
+    size_t kept = 0;
+    for (size_t i = 0; i < m_size; i++)
+    {
+      Item &item = at(i);
+      if (predicate(item))
+        item.message->Release();
+      else
+        at(kept++) = item;
+    }
+    m_size = kept;
+  }
+
+private:
+  CDVDMessageRing(const CDVDMessageRing&) = delete;
+  CDVDMessageRing& operator=(const CDVDMessageRing&) = delete;
+
+  void Grow();
+
+  std::vector<Item> m_items; // size is a power of 2
+  size_t m_back;
+  size_t m_size;
+};
+
 enum MsgQueueReturnCode
 {
   MSGQ_OK = 1,
@@ -114,8 +181,9 @@ private:
   void UpdateTimeFront();
   void UpdateTimeBack();
 
-  CEvent m_hEvent;
   mutable CCriticalSection m_section;
+  XbmcThreads::ConditionVariable m_condition;
+  int m_waiting;
 
   std::atomic<bool> m_bAbortRequest;
   bool m_bInitialized;
@@ -129,7 +197,7 @@ private:
   int m_iMaxDataSize;
   std::string m_owner;
 
-  std::list<DVDMessageListItem> m_messages;
+  CDVDMessageRing m_messages;
   std::list<DVDMessageListItem> m_prioMessages;
 };
 
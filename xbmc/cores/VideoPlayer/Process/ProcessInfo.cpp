@@ -21,6 +21,7 @@
 #include "ProcessInfo.h"
 #include "ServiceBroker.h"
 #include "cores/DataCacheCore.h"
+#include "cores/VideoPlayer/DVDDemuxers/DVDDemuxUtils.h"
 #include "threads/SingleLock.h"
 
 // Override for platform ports
@@ -381,3 +382,12 @@ bool CProcessInfo::IsSeeking()
 
   return m_stateSeeking;
 }
+
+// demuxer info
+void CProcessInfo::UpdateDemuxPacketStats()
+{
+  DemuxPacketStats stats = CDVDDemuxUtils::GetPacketStats();
+
+  CServiceBroker::GetDataCacheCore().SetDemuxPacketStats(stats.allocated, stats.recycled,
+                                                         stats.referenced, stats.pooledBytes);
+}
@@ -76,6 +76,9 @@ public:
   void SetStateSeeking(bool active);
   bool IsSeeking();
 
+  // demuxer info
+  void UpdateDemuxPacketStats();
+
 protected:
   CProcessInfo();
 
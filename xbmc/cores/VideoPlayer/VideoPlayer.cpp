@@ -5035,6 +5035,8 @@ void CVideoPlayer::UpdatePlayState(double timeout)
   else
     state.cache_bytes = 0;
 
+  m_processInfo->UpdateDemuxPacketStats();
+
   state.timestamp = m_clock.GetAbsoluteClock();
 
   CSingleLock lock(m_StateSection);
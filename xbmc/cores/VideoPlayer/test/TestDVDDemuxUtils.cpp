@@ -0,0 +1,170 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "cores/VideoPlayer/DVDDemuxers/DVDDemuxFFmpeg.h"
+#include "cores/VideoPlayer/DVDDemuxers/DVDDemuxUtils.h"
+#include "cores/VideoPlayer/DVDInputStreams/DVDInputStreamFile.h"
+#include "cores/VideoPlayer/TimingConstants.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/Stopwatch.h"
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+
+// file to run the demux benchmark on, e.g. a local movie sample
+#define DEMUX_BENCHMARK_FILE_ENV "KODI_TEST_DEMUX_FILE"
+
+TEST(TestDVDDemuxUtils, RecyclesBuffers)
+{
+  DemuxPacket* packet = CDVDDemuxUtils::AllocateDemuxPacket(3000);
+  ASSERT_TRUE(packet != NULL);
+  ASSERT_TRUE(packet->pData != NULL);
+  uint8_t* data = packet->pData;
+  memset(data, 0xff, 3000);
+  packet->iSize = 3000;
+  packet->iStreamId = 1;
+  packet->dts = 1000.0;
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+
+  DemuxPacketStats before = CDVDDemuxUtils::GetPacketStats();
+
+  // a packet of the same size class gets the buffer of the pool
+  packet = CDVDDemuxUtils::AllocateDemuxPacket(2500);
+  ASSERT_TRUE(packet != NULL);
+  EXPECT_EQ(data, packet->pData);
+  EXPECT_EQ(0, packet->iSize);
+  EXPECT_EQ(-1, packet->iStreamId);
+  EXPECT_EQ(DVD_NOPTS_VALUE, packet->dts);
+
+  // the padding behind the requested size has to be cleared again
+  for (int i = 0; i < FF_INPUT_BUFFER_PADDING_SIZE; i++)
+    ASSERT_EQ(0, packet->pData[2500 + i]);
+
+  DemuxPacketStats after = CDVDDemuxUtils::GetPacketStats();
+  EXPECT_EQ(before.recycled + 1, after.recycled);
+  EXPECT_EQ(before.allocated, after.allocated);
+
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+}
+
+TEST(TestDVDDemuxUtils, EmptyPackets)
+{
+  DemuxPacket* packet = CDVDDemuxUtils::AllocateDemuxPacket();
+  ASSERT_TRUE(packet != NULL);
+  EXPECT_TRUE(packet->pData == NULL);
+  EXPECT_EQ(0, packet->iSize);
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+
+  // bigger than the largest size class
+  packet = CDVDDemuxUtils::AllocateDemuxPacket(8 * 1024 * 1024);
+  ASSERT_TRUE(packet != NULL);
+  ASSERT_TRUE(packet->pData != NULL);
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+}
+
+TEST(TestDVDDemuxUtils, ReferencesPackets)
+{
+  AVPacket pkt;
+  av_init_packet(&pkt);
+  ASSERT_EQ(0, av_new_packet(&pkt, 1000));
+  memset(pkt.data, 0x42, pkt.size);
+
+  DemuxPacketStats before = CDVDDemuxUtils::GetPacketStats();
+  DemuxPacket* packet = CDVDDemuxUtils::ReferenceDemuxPacket(&pkt);
+  ASSERT_TRUE(packet != NULL);
+  EXPECT_EQ(pkt.data, packet->pData);
+  EXPECT_EQ(1000, packet->iSize);
+  EXPECT_EQ(before.referenced + 1, CDVDDemuxUtils::GetPacketStats().referenced);
+
+  // the packet keeps the data alive after ffmpeg dropped its reference
+  av_packet_unref(&pkt);
+  for (int i = 0; i < 1000; i++)
+    ASSERT_EQ(0x42, packet->pData[i]);
+  CDVDDemuxUtils::FreeDemuxPacket(packet);
+
+  // data which isn't reference counted has to be copied
+  uint8_t data[64] = { 0 };
+  av_init_packet(&pkt);
+  pkt.data = data;
+  pkt.size = sizeof(data) - FF_INPUT_BUFFER_PADDING_SIZE;
+  EXPECT_TRUE(CDVDDemuxUtils::ReferenceDemuxPacket(&pkt) == NULL);
+}
+
+static void RunDemuxBenchmark(const std::string &path, bool zeroCopy)
+{
+  bool oldZeroCopy = g_advancedSettings.m_videoDemuxZeroCopy;
+  g_advancedSettings.m_videoDemuxZeroCopy = zeroCopy;
+
+  CFileItem item(path, false);
+  CDVDInputStreamFile input(item);
+  ASSERT_TRUE(input.Open());
+
+  CDVDDemuxFFmpeg demuxer;
+  ASSERT_TRUE(demuxer.Open(&input));
+
+  DemuxPacketStats before = CDVDDemuxUtils::GetPacketStats();
+  CStopWatch timer;
+  timer.StartZero();
+
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+  DemuxPacket* packet;
+  while ((packet = demuxer.Read()) != NULL)
+  {
+    packets++;
+    bytes += packet->iSize;
+    CDVDDemuxUtils::FreeDemuxPacket(packet);
+  }
+
+  float elapsed = timer.GetElapsedSeconds();
+  DemuxPacketStats after = CDVDDemuxUtils::GetPacketStats();
+  g_advancedSettings.m_videoDemuxZeroCopy = oldZeroCopy;
+
+  std::cout << (zeroCopy ? "zero copy: " : "copy: ")
+            << packets / elapsed << " packets/s, "
+            << bytes / elapsed / (1024 * 1024) << " MB/s, "
+            << after.allocated - before.allocated << " allocated, "
+            << after.recycled - before.recycled << " recycled, "
+            << after.referenced - before.referenced << " referenced" << std::endl;
+}
+
+// Demuxes the file named by DEMUX_BENCHMARK_FILE_ENV copying and referencing the
+// packets. Run with --gtest_also_run_disabled_tests.
+TEST(TestDVDDemuxUtils, DISABLED_Benchmark)
+{
+  const char* path = getenv(DEMUX_BENCHMARK_FILE_ENV);
+  if (!path || !*path)
+  {
+    std::cout << "set " DEMUX_BENCHMARK_FILE_ENV " to run the demux benchmark" << std::endl;
+    return;
+  }
+
+  RunDemuxBenchmark(path, false);
+  RunDemuxBenchmark(path, true);
+}
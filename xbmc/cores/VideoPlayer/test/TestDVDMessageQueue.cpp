@@ -0,0 +1,194 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cores/VideoPlayer/DVDDemuxers/DVDDemuxUtils.h"
+#include "cores/VideoPlayer/DVDMessageQueue.h"
+#include "cores/VideoPlayer/TimingConstants.h"
+#include "threads/Thread.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+#define BENCHMARK_PACKETS 200000
+#define BENCHMARK_PACKET_SIZE 4096
+
+static CDVDMsg* CreatePacket(int size, double dts)
+{
+  DemuxPacket* packet = CDVDDemuxUtils::AllocateDemuxPacket(size);
+  packet->iSize = size;
+  packet->dts = dts;
+  packet->pts = dts;
+  return new CDVDMsgDemuxerPacket(packet);
+}
+
+static double GetDts(CDVDMsg* msg)
+{
+  return static_cast<CDVDMsgDemuxerPacket*>(msg)->GetPacket()->dts;
+}
+
+TEST(TestDVDMessageQueue, Order)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init();
+
+  // more than fit into the initial ring
+  for (int i = 0; i < 1000; i++)
+    EXPECT_EQ(MSGQ_OK, queue.Put(CreatePacket(10, i)));
+  EXPECT_EQ(MSGQ_OK, queue.PutBack(CreatePacket(10, -1)));
+  EXPECT_EQ(10010, queue.GetDataSize());
+  EXPECT_EQ(1001u, queue.GetPacketCount(CDVDMsg::DEMUXER_PACKET));
+
+  // put back messages come first, then the oldest ones
+  for (int i = -1; i < 1000; i++)
+  {
+    CDVDMsg* msg;
+    ASSERT_EQ(MSGQ_OK, queue.Get(&msg, 0));
+    EXPECT_EQ(i, GetDts(msg));
+    msg->Release();
+  }
+  EXPECT_EQ(0, queue.GetDataSize());
+
+  CDVDMsg* msg;
+  EXPECT_EQ(MSGQ_TIMEOUT, queue.Get(&msg, 0));
+  EXPECT_EQ(MSGQ_TIMEOUT, queue.Get(&msg, 10));
+}
+
+TEST(TestDVDMessageQueue, Priority)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init();
+
+  queue.Put(CreatePacket(10, 0));
+  queue.Put(new CDVDMsg(CDVDMsg::GENERAL_RESYNC), 1);
+  queue.Put(new CDVDMsg(CDVDMsg::GENERAL_FLUSH), 2);
+
+  // priority messages bypass the packets, highest priority first
+  CDVDMsg* msg;
+  int priority = 0;
+  ASSERT_EQ(MSGQ_OK, queue.Get(&msg, 0, priority));
+  EXPECT_TRUE(msg->IsType(CDVDMsg::GENERAL_FLUSH));
+  EXPECT_EQ(2, priority);
+  msg->Release();
+
+  // only messages of at least the given priority
+  priority = 2;
+  EXPECT_EQ(MSGQ_TIMEOUT, queue.Get(&msg, 0, priority));
+
+  priority = 1;
+  ASSERT_EQ(MSGQ_OK, queue.Get(&msg, 0, priority));
+  EXPECT_TRUE(msg->IsType(CDVDMsg::GENERAL_RESYNC));
+  msg->Release();
+
+  priority = 0;
+  ASSERT_EQ(MSGQ_OK, queue.Get(&msg, 0, priority));
+  EXPECT_TRUE(msg->IsType(CDVDMsg::DEMUXER_PACKET));
+  msg->Release();
+}
+
+TEST(TestDVDMessageQueue, Flush)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init();
+  queue.SetMaxDataSize(100);
+  queue.SetMaxTimeSize(1.0);
+
+  for (int i = 0; i < 5; i++)
+  {
+    queue.Put(CreatePacket(10, i * DVD_TIME_BASE / 10));
+    queue.Put(new CDVDMsg(CDVDMsg::GENERAL_RESYNC));
+  }
+  EXPECT_EQ(50, queue.GetDataSize());
+  EXPECT_EQ(40, queue.GetLevel());
+
+  queue.Flush();
+  EXPECT_EQ(0, queue.GetDataSize());
+  EXPECT_EQ(0, queue.GetLevel());
+  EXPECT_EQ(0u, queue.GetPacketCount(CDVDMsg::DEMUXER_PACKET));
+  EXPECT_EQ(5u, queue.GetPacketCount(CDVDMsg::GENERAL_RESYNC));
+
+  queue.Flush(CDVDMsg::NONE);
+  CDVDMsg* msg;
+  EXPECT_EQ(MSGQ_TIMEOUT, queue.Get(&msg, 0));
+}
+
+TEST(TestDVDMessageQueue, Abort)
+{
+  CDVDMessageQueue queue("test");
+  queue.Init();
+  queue.Abort();
+
+  CDVDMsg* msg;
+  EXPECT_EQ(MSGQ_ABORT, queue.Get(&msg, 1000));
+}
+
+namespace
+{
+class CPacketProducer : public IRunnable
+{
+public:
+  explicit CPacketProducer(CDVDMessageQueue &queue) : m_queue(queue) {}
+
+  void Run() override
+  {
+    for (int i = 0; i < BENCHMARK_PACKETS; i++)
+    {
+      // like the demuxer, back off while the decoder catches up
+      while (m_queue.IsFull())
+        XbmcThreads::ThreadSleep(0);
+      m_queue.Put(CreatePacket(BENCHMARK_PACKET_SIZE, i));
+    }
+  }
+
+private:
+  CDVDMessageQueue &m_queue;
+};
+}
+
+// Passes BENCHMARK_PACKETS packets from a producer thread through the queue. Run
+// with --gtest_also_run_disabled_tests.
+TEST(TestDVDMessageQueue, DISABLED_Benchmark)
+{
+  CDVDMessageQueue queue("benchmark");
+  queue.Init();
+  queue.SetMaxDataSize(256 * BENCHMARK_PACKET_SIZE);
+
+  CStopWatch timer;
+  timer.StartZero();
+
+  CPacketProducer producer(queue);
+  CThread thread(&producer, "PacketProducer");
+  thread.Create();
+
+  int received = 0;
+  while (received < BENCHMARK_PACKETS)
+  {
+    CDVDMsg* msg;
+    ASSERT_EQ(MSGQ_OK, queue.Get(&msg, 1000));
+    EXPECT_EQ(received, GetDts(msg));
+    msg->Release();
+    received++;
+  }
+  thread.StopThread();
+  float elapsed = timer.GetElapsedSeconds();
+
+  std::cout << BENCHMARK_PACKETS / elapsed << " packets/s" << std::endl;
+}
@@ -155,6 +155,8 @@ CDatabase::CDatabase(void)
   m_sqlite = true;
   m_bMultiWrite = false;
   m_multipleExecute = false;
+  m_batch = false;
+  m_savepoints = 0;
 }
 
 CDatabase::~CDatabase(void)
@@ -306,6 +308,53 @@ bool CDatabase::ResultQuery(const std::string &strQuery)
   return bReturn;
 }
 
+bool CDatabase::ExecutePreparedQuery(const std::string &strQuery, const std::vector<field_value> &params)
+{
+  bool bReturn = false;
+
+  try
+  {
+    if (NULL == m_pDB.get()) return bReturn;
+
+    if (m_multipleExecute)
+    {
+      m_multipleQueries.push_back(m_pDB->bind_params(strQuery, params));
+      return true;
+    }
+
+    if (NULL == m_pDS.get()) return bReturn;
+    m_pDS->exec_prepared(strQuery, params);
+    bReturn = true;
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s - failed to execute query '%s'",
+        __FUNCTION__, strQuery.c_str());
+  }
+
+  return bReturn;
+}
+
+bool CDatabase::ResultPreparedQuery(const std::string &strQuery, const std::vector<field_value> &params)
+{
+  bool bReturn = false;
+
+  try
+  {
+    if (NULL == m_pDB.get()) return bReturn;
+    if (NULL == m_pDS.get()) return bReturn;
+
+    bReturn = m_pDS->query_prepared(strQuery, params);
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s - failed to execute query '%s'",
+        __FUNCTION__, strQuery.c_str());
+  }
+
+  return bReturn;
+}
+
 bool CDatabase::QueueInsertQuery(const std::string &strQuery)
 {
   if (strQuery.empty())
@@ -414,47 +463,60 @@ void CDatabase::DropAnalytics()
   m_pDB->drop_analytics();
 }
 
-bool CDatabase::Connect(const std::string &dbName, const DatabaseSettings &dbSettings, bool create)
+Database *CDatabase::CreateConnection(const DatabaseSettings &settings)
 {
   // create the appropriate database structure
-  if (dbSettings.type == "sqlite3")
+  Database *db;
+  if (settings.type == "sqlite3")
   {
-    m_pDB.reset( new SqliteDatabase() ) ;
+    db = new SqliteDatabase();
   }
 #ifdef HAS_MYSQL
-  else if (dbSettings.type == "mysql")
+  else if (settings.type == "mysql")
   {
-    m_pDB.reset( new MysqlDatabase() ) ;
+    db = new MysqlDatabase();
   }
 #endif
   else
   {
-    CLog::Log(LOGERROR, "Unable to determine database type: %s", dbSettings.type.c_str());
-    return false;
+    CLog::Log(LOGERROR, "Unable to determine database type: %s", settings.type.c_str());
+    return NULL;
   }
 
   // host name is always required
-  m_pDB->setHostName(dbSettings.host.c_str());
+  db->setHostName(settings.host.c_str());
 
-  if (!dbSettings.port.empty())
-    m_pDB->setPort(dbSettings.port.c_str());
+  if (!settings.port.empty())
+    db->setPort(settings.port.c_str());
 
-  if (!dbSettings.user.empty())
-    m_pDB->setLogin(dbSettings.user.c_str());
+  if (!settings.user.empty())
+    db->setLogin(settings.user.c_str());
 
-  if (!dbSettings.pass.empty())
-    m_pDB->setPasswd(dbSettings.pass.c_str());
+  if (!settings.pass.empty())
+    db->setPasswd(settings.pass.c_str());
 
   // database name is always required
-  m_pDB->setDatabase(dbName.c_str());
+  db->setDatabase(settings.name.c_str());
 
   // set configuration regardless if any are empty
-  m_pDB->setConfig(dbSettings.key.c_str(),
-                   dbSettings.cert.c_str(),
-                   dbSettings.ca.c_str(),
-                   dbSettings.capath.c_str(),
-                   dbSettings.ciphers.c_str(),
-                   dbSettings.compression);
+  db->setConfig(settings.key.c_str(),
+                settings.cert.c_str(),
+                settings.ca.c_str(),
+                settings.capath.c_str(),
+                settings.ciphers.c_str(),
+                settings.compression);
+
+  return db;
+}
+
+bool CDatabase::Connect(const std::string &dbName, const DatabaseSettings &dbSettings, bool create)
+{
+  DatabaseSettings settings = dbSettings;
+  settings.name = dbName;
+
+  m_pDB.reset(CreateConnection(settings));
+  if (NULL == m_pDB.get())
+    return false;
 
   // create the datasets
   m_pDS.reset(m_pDB->CreateDataset());
@@ -500,6 +562,8 @@ bool CDatabase::Connect(const std::string &dbName, const DatabaseSettings &dbSet
   }
 
   m_openCount = 1; // our database is open
+  m_connectionSettings.reset(new DatabaseSettings(settings));
+  OnConnected();
   return true;
 }
 
@@ -530,12 +594,16 @@ void CDatabase::Close()
   m_openCount = 0;
   m_multipleExecute = false;
 
+  if (m_batch)
+    CommitBatch();
+
   if (NULL == m_pDB.get() ) return ;
   if (NULL != m_pDS.get()) m_pDS->close();
   m_pDB->disconnect();
   m_pDB.reset();
   m_pDS.reset();
   m_pDS2.reset();
+  m_connectionSettings.reset();
 }
 
 bool CDatabase::Compress(bool bForce /* =true */)
@@ -581,6 +649,12 @@ void CDatabase::Interrupt()
 
 void CDatabase::BeginTransaction()
 {
+  if (m_batch)
+  {
+    ExecuteSavepoint("SAVEPOINT", ++m_savepoints);
+    return;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -594,6 +668,16 @@ void CDatabase::BeginTransaction()
 
 bool CDatabase::CommitTransaction()
 {
+  if (m_batch && m_savepoints > 0)
+    return ExecuteSavepoint("RELEASE SAVEPOINT", m_savepoints--);
+
+  if (m_batch)
+  {
+    // unbalanced, this commits the batch itself
+    CLog::Log(LOGWARNING, "database:committransaction without a transaction ends the batch");
+    m_batch = false;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -609,6 +693,21 @@ bool CDatabase::CommitTransaction()
 
 void CDatabase::RollbackTransaction()
 {
+  if (m_batch && m_savepoints > 0)
+  {
+    // rolling back to a savepoint keeps it open
+    ExecuteSavepoint("ROLLBACK TO SAVEPOINT", m_savepoints);
+    ExecuteSavepoint("RELEASE SAVEPOINT", m_savepoints--);
+    return;
+  }
+
+  if (m_batch)
+  {
+    // unbalanced, this throws away the whole batch
+    CLog::Log(LOGWARNING, "database:rollbacktransaction without a transaction ends the batch");
+    m_batch = false;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -626,6 +725,50 @@ bool CDatabase::InTransaction()
   return m_pDB->in_transaction();
 }
 
+void CDatabase::BeginBatch()
+{
+  if (m_batch || NULL == m_pDB.get())
+    return;
+
+  BeginTransaction();
+  m_batch = true;
+  m_savepoints = 0;
+}
+
+bool CDatabase::CommitBatch()
+{
+  if (!m_batch)
+    return true;
+
+  if (m_savepoints > 0)
+    CLog::Log(LOGWARNING, "database:commitbatch %u transactions are still open", m_savepoints);
+
+  m_batch = false;
+  m_savepoints = 0;
+  return CommitTransaction();
+}
+
+bool CDatabase::ExecuteSavepoint(const char *command, unsigned int savepoint)
+{
+  if (NULL == m_pDB.get())
+    return false;
+
+  try
+  {
+    // the datasets of the caller may still hold a result
+    std::unique_ptr<dbiplus::Dataset> pDS(m_pDB->CreateDataset());
+    if (NULL == pDS.get())
+      return false;
+    pDS->exec(StringUtils::Format("%s sp%u", command, savepoint));
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "database:%s sp%u failed", command, savepoint);
+    return false;
+  }
+  return true;
+}
+
 bool CDatabase::CreateDatabase()
 {
   BeginTransaction();
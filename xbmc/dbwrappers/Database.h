@@ -23,6 +23,7 @@
 namespace dbiplus {
   class Database;
   class Dataset;
+  class field_value;
 }
 
 #include <memory>
@@ -86,6 +87,15 @@ public:
   virtual bool CommitTransaction();
   void RollbackTransaction();
   bool InTransaction();
+
+  /*!
+   * @brief Collect the following transactions into a single one until CommitBatch() is called.
+   * @remarks Transactions started meanwhile become savepoints, so each of them can still be rolled back on its own
+   * while inserting a lot of items only syncs the database once per batch.
+   */
+  void BeginBatch();
+  bool CommitBatch();
+  bool InBatch() const { return m_batch; }
   void CopyDB(const std::string& latestDb);
   void DropAnalytics();
 
@@ -136,6 +146,29 @@ public:
    */
   bool ResultQuery(const std::string &strQuery);
 
+  /*!
+   * @brief Execute a query with bound parameters that does not return any result.
+   *        The statement is prepared once per connection and cached, so executing
+   *        the same statement again only needs the parameters to be bound.
+   *        Note that if BeginMultipleExecute() has been called, the query will be
+   *        queued with its parameters substituted.
+   * @param strQuery The query to execute, using '?' as placeholders for the parameters.
+   * @param params The values to bind to the placeholders, in order.
+   * @return True if the query was executed successfully, false otherwise.
+   * @sa ExecuteQuery
+   */
+  bool ExecutePreparedQuery(const std::string &strQuery, const std::vector<dbiplus::field_value> &params);
+
+  /*!
+   * @brief Execute a query with bound parameters that returns a result.
+   * @remarks Call m_pDS->close(); to clean up the dataset when done.
+   * @param strQuery The query to execute, using '?' as placeholders for the parameters.
+   * @param params The values to bind to the placeholders, in order.
+   * @return True if the query was executed successfully, false otherwise.
+   * @sa ResultQuery
+   */
+  bool ResultPreparedQuery(const std::string &strQuery, const std::vector<dbiplus::field_value> &params);
+
   /*!
    * @brief Start a multiple execution queue. Any ExecuteQuery() function
    *        following this call will be queued rather than executed until
@@ -203,6 +236,23 @@ protected:
    */
   virtual void UpdateTables(int version) {};
 
+  /* \brief Called by Connect() once the connection is established.
+   Child classes can resume work left unfinished by a previous session here.
+   */
+  virtual void OnConnected() {};
+
+  /*! \brief Settings of the current connection, with the versioned database name.
+   \return NULL if not connected
+   \sa CreateConnection()
+   */
+  const DatabaseSettings *GetConnectionSettings() const { return m_connectionSettings.get(); }
+
+  /*! \brief Create a connection as described by settings, without connecting it.
+   Connections can't be shared between threads, background jobs use this to open their own.
+   \return the connection (owned by the caller), NULL if the database type is not supported
+   */
+  static dbiplus::Database *CreateConnection(const DatabaseSettings &settings);
+
   /* \brief The minimum schema version that we support updating from.
    */
   virtual int GetMinSchemaVersion() const { return 0; };
@@ -231,4 +281,11 @@ private:
 
   bool m_multipleExecute;
   std::vector<std::string> m_multipleQueries;
+
+  bool m_batch;                    /*!< True between BeginBatch() and CommitBatch() */
+  unsigned int m_savepoints;       /*!< Number of transactions currently open inside the batch */
+
+  bool ExecuteSavepoint(const char *command, unsigned int savepoint);
+
+  std::unique_ptr<DatabaseSettings> m_connectionSettings;
 };
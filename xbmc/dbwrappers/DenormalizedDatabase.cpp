@@ -18,19 +18,16 @@
  *
  */
 
-#define USE_BSON 0
-
 #include "DenormalizedDatabase.h"
 #include "FileItem.h"
+#include "settings/AdvancedSettings.h"
+#include "threads/SingleLock.h"
+#include "utils/JobManager.h"
 #include "utils/IDeserializable.h"
 #include "utils/ISerializable.h"
-#if USE_BSON
-  #include "utils/BSONVariantParser.h"
-  #include "utils/BSONVariantWriter.h"
-#else
-  #include "utils/JSONVariantParser.h"
-  #include "utils/JSONVariantWriter.h"
-#endif
+#include "utils/BinaryVariant.h"
+#include "utils/JSONVariantParser.h"
+#include "utils/JSONVariantWriter.h"
 #include "utils/log.h"
 #include "utils/StringUtils.h"
 #include "utils/URIUtils.h"
@@ -39,10 +36,46 @@
 
 #include <algorithm>
 #include <assert.h>
-#include <queue>
+#include <set>
 
 using namespace dbiplus;
 
+// Rows per multi-row INSERT or IN () lookup, well below SQLite's compound limit
+#define BATCH_ROWS ((size_t)100)
+
+// Objects normalized per transaction by the background job
+#define NORMALIZE_CHUNK_ROWS 500
+
+static void ParseContent(const std::string &content, CVariant &var)
+{
+  // Objects serialize to a JSON object, base64 never contains '{'
+  if (!content.empty() && content[0] == '{')
+    CJSONVariantParser::Parse(content, var);
+  else
+    CBinaryVariant::ParseBase64(content, var);
+}
+
+// Values of a field, simple types count as a list of one for N:N fields
+static std::vector<const CVariant*> GetFieldValues(const CVariant &field, bool isManyToMany)
+{
+  std::vector<const CVariant*> values;
+  if (!isManyToMany)
+  {
+    values.push_back(&field);
+  }
+  else if (field.isArray())
+  {
+    for (CVariant::const_iterator_array it = field.begin_array(); it != field.end_array(); ++it)
+      values.push_back(&*it);
+  }
+  else if (field.isDouble() || field.isString() || field.isWideString() || field.isBoolean() ||
+           field.isInteger() || field.isUnsignedInteger())
+  {
+    values.push_back(&field);
+  }
+  return values;
+}
+
 std::string CDenormalizedDatabase::MakeForeignKeyName(const std::string &primary, const std::string &foreign)
 {
   return "FK_" + foreign + "_" + primary; // FK_foreign_primary
@@ -78,6 +111,11 @@ std::string CDenormalizedDatabase::MakeUniqueIndexName(const std::string &primar
   return indexName;
 }
 
+std::string CDenormalizedDatabase::MakeNormalizeTableName(const std::string &primary)
+{
+  return primary + "normalize"; // primarynormalize
+}
+
 std::string CDenormalizedDatabase::MakeUniqueIndexClause(const std::string &primary, const std::string &secondary, int ord)
 {
   if (ord == 1)
@@ -135,17 +173,34 @@ CVariant CDenormalizedDatabase::FieldAsVarient(const field_value &fv, const std:
     return fv.get_asString();
 }
 
+std::string CDenormalizedDatabase::WriteContent(const CVariant &object) const
+{
+  std::string content;
+  if (m_contentFormat == CONTENT_FORMAT_BINARY)
+    CBinaryVariant::WriteBase64(object, content);
+  else
+    CJSONVariantWriter::Write(object, content, true);
+  return content;
+}
+
 std::string CDenormalizedDatabase::PrepareVariant(const CVariant &value, const std::string &type)
+{
+  if (NULL == m_pDB.get())
+    return "";
+  return PrepareVariant(*m_pDB, value, type);
+}
+
+std::string CDenormalizedDatabase::PrepareVariant(Database &db, const CVariant &value, const std::string &type)
 {
   if (IsText(type))
-    return PrepareSQL("'%s'", value.asString().c_str());
+    return db.prepare("'%s'", value.asString().c_str());
   else if (IsInteger(type) || IsBool(type))
-    return PrepareSQL("%i", value.asInteger());
+    return db.prepare("%i", value.asInteger());
   else if (IsFloat(type))
-    return PrepareSQL("%f", value.asFloat());
+    return db.prepare("%f", value.asFloat());
   else
     // Probably a datetime. Interpret as a string for now
-    return PrepareSQL("'%s'", value.asString().c_str());
+    return db.prepare("'%s'", value.asString().c_str());
 }
 
 void CDenormalizedDatabase::CreateIndex(const std::string &table, const std::string &column, bool isFK)
@@ -169,9 +224,23 @@ void CDenormalizedDatabase::CreateUniqueLinks(const std::string &primary, const
 
 // --- CDenormalizedDatabase --------------------------------------------------------
 
-CDenormalizedDatabase::CDenormalizedDatabase(const char *predominantObject) :
-  m_table(predominantObject)
+CDenormalizedDatabase::CDenormalizedDatabase(const char *predominantObject, ContentFormat format /* = CONTENT_FORMAT_BINARY */) :
+  m_table(predominantObject),
+  m_contentFormat(format),
+  m_normalizeJob(0),
+  m_normalizeSerial(0),
+  m_bNormalizeQueued(false),
+  m_normalizeProgress(0),
+  m_normalizeTotal(0)
+{
+}
+
+CDenormalizedDatabase::~CDenormalizedDatabase()
 {
+  // The job stops after its current chunk, the rest is resumed on the next connect
+  CSingleLock lock(m_pendingSection);
+  if (m_normalizeJob)
+    CJobManager::GetInstance().CancelJob(m_normalizeJob);
 }
 
 void CDenormalizedDatabase::CreateTables()
@@ -329,35 +398,7 @@ void CDenormalizedDatabase::AddIndexInternal(const char *column, const char *typ
   CreateIndex(m_table, column, false);
 
   // Populate the new column with value from the content column
-  strSQL = PrepareSQL("SELECT id%s, content FROM %s", m_table, m_table);
-  if (m_pDS->query(strSQL))
-  {
-    while (!m_pDS->eof())
-    {
-#if USE_BSON
-      CVariant var = CBSONVariantParser::ParseBase64(m_pDS->fv(1).get_asString());
-#else
-      const char *output = m_pDS->fv(1).get_asString().c_str();
-      CVariant var;
-      CJSONVariantParser::Parse(output, var);
-#endif
-
-      std::string value = PrepareVariant(var[column], type);
-      if (value.empty() || value == "''")
-        continue;
-
-      strSQL = PrepareSQL(
-        "UPDATE %s "
-        "SET %s=" + value + " "
-        "WHERE id%s=%i",
-        m_table, column, m_table, m_pDS->fv(0).get_asInt()
-      );
-      m_pDS2->exec(strSQL);
-
-      m_pDS->next();
-    }
-    m_pDS->close();
-  }
+  QueueNormalize(column, RELATION_INDEX, type);
 }
 
 void CDenormalizedDatabase::DropIndex(const char *column)
@@ -367,6 +408,8 @@ void CDenormalizedDatabase::DropIndex(const char *column)
   if (it != m_indices.end())
     m_indices.erase(it);
 
+  DequeueNormalize(column);
+
   std::string strSQL;
 
   // Tip of the day: the SQLite dataset removes "ON %s" automatically
@@ -455,70 +498,7 @@ void CDenormalizedDatabase::AddOneToManyInternal(const char *column, const char
   }
 
   // Populate the new foreign key value
-  std::queue<std::pair<int, CVariant> > idItems; // idObject -> item value
-  strSQL = PrepareSQL("SELECT id%s, content FROM %s", m_table, m_table);
-  if (m_pDS->query(strSQL))
-  {
-    while (!m_pDS->eof())
-    {
-      // Need to resolve a string into a foreign key ID
-      int fkId;
-
-#if USE_BSON
-      CVariant var = CBSONVariantParser::ParseBase64(m_pDS->fv(1).get_asString());
-#else
-      const char *output = m_pDS->fv(1).get_asString().c_str();
-      CVariant var;
-      CJSONVariantParser::Parse(output, var);
-#endif
-
-      std::string value = PrepareVariant(var[column], type);
-      if (value.empty() || value == "''")
-        continue;
-
-      // Test to see if the item exists in the new table
-      strSQL = PrepareSQL(
-        "SELECT id%s "
-        "FROM %s "
-        "WHERE %s=" + value,
-        column, column, column
-      );
-      if (!m_pDS2->query(strSQL))
-        continue;
-      if (m_pDS2->num_rows() == 0)
-      {
-        // Item doesn't exist in new table, create it now
-        m_pDS2->close();
-
-        strSQL = PrepareSQL(
-          "INSERT INTO %s (id%s, %s) "
-          "VALUES (NULL, " + value + ")",
-          column, column, column
-        );
-        m_pDS2->exec(strSQL);
-        fkId = (int)m_pDS2->lastinsertid();
-        if (fkId < 0)
-          continue;
-      }
-      else
-      {
-        fkId = m_pDS2->fv(0).get_asInt();
-        m_pDS2->close();
-      }
-
-      // Got our FK, update the main table
-      strSQL = PrepareSQL(
-        "UPDATE %s "
-        "SET id%s=%i "
-        "WHERE id%s=%i",
-        m_table, column, fkId, m_table, m_pDS->fv(0).get_asInt()
-      );
-      m_pDS2->exec(strSQL);
-
-      m_pDS->next();
-    }
-    m_pDS->close();
-  }
+  QueueNormalize(column, RELATION_ONE_TO_MANY, type);
 }
 
 void CDenormalizedDatabase::DropOneToManyInternal(const char *column, bool tempDrop /* = false */)
@@ -535,6 +515,8 @@ void CDenormalizedDatabase::DropOneToManyInternal(const char *column, bool tempD
       m_singleLinks.erase(it);
   }
 
+  DequeueNormalize(column);
+
   std::string strSQL;
 
   if (!m_sqlite)
@@ -664,85 +646,8 @@ void CDenormalizedDatabase::AddManyToManyInternal(const char *column, const char
     m_pDS->exec(strSQL);
   }
 
-  // Populate the new foreign key value
-  strSQL = PrepareSQL("SELECT id%s, content FROM %s", m_table, m_table);
-  if (m_pDS->query(strSQL))
-  {
-    while (!m_pDS->eof())
-    {
-#if USE_BSON
-      CVariant var = CBSONVariantParser::ParseBase64(m_pDS->fv(1).get_asString());
-#else
-      const char *output = m_pDS->fv(1).get_asString().c_str();
-      CVariant var;
-      CJSONVariantParser::Parse(output, var);
-#endif
-
-      CVariant varColumnValues = var[column];
-      if (varColumnValues.isDouble() ||
-          varColumnValues.isString() ||
-          varColumnValues.isWideString() ||
-          varColumnValues.isBoolean() ||
-          varColumnValues.isInteger() ||
-          varColumnValues.isUnsignedInteger())
-      {
-        // Promote simple types to array
-        CVariant temp;
-        temp.push_back(varColumnValues);
-        varColumnValues.swap(temp);
-      }
-
-      // Each item needs its own entry in its table and link in the link table
-      for (CVariant::const_iterator_array itemIt = varColumnValues.begin_array(); itemIt != varColumnValues.end_array(); itemIt++)
-      {
-        std::string value = PrepareVariant(*itemIt, type);
-        if (value.empty() || value == "''")
-          continue;
-
-        // Need to resolve a value into a foreign key ID
-        int fkId;
-
-        strSQL = PrepareSQL(
-          "SELECT id%s "
-          "FROM %s "
-          "WHERE %s=" + value,
-          column, column, column
-        );
-
-        if (!m_pDS2->query(strSQL))
-          continue;
-        if (m_pDS2->num_rows() == 0)
-        {
-          // Item doesn't exist in new table, create it now
-          m_pDS2->close();
-
-          strSQL = PrepareSQL(
-            "INSERT INTO %s (id%s, %s) "
-            "VALUES (NULL, " + value + ")",
-            column, column, column
-          );
-          m_pDS2->exec(strSQL);
-          fkId = (int)m_pDS->lastinsertid();
-          if (fkId < 0)
-            continue;
-        }
-        else
-        {
-          fkId = m_pDS2->fv(0).get_asInt();
-          m_pDS2->close();
-        }
-        // Add relation to the link table
-        strSQL = PrepareSQL(
-          "INSERT INTO %s (id%s, id%s) "
-          "VALUES (%i, %i)",
-          MakeLinkTableName(m_table, column).c_str(), m_table, column, m_pDS->fv(0).get_asInt(), fkId
-        );
-        m_pDS2->exec(strSQL);
-      }
-      m_pDS->next();
-    }
-    m_pDS->close();
-  }
+  // Populate the link table
+  QueueNormalize(column, RELATION_MANY_TO_MANY, type);
 }
 
 void CDenormalizedDatabase::DropManyToManyInternal(const char *column, bool tempDrop /* = false */)
@@ -758,6 +663,8 @@ void CDenormalizedDatabase::DropManyToManyInternal(const char *column, bool temp
       m_multiLinks.erase(it);
   }
 
+  DequeueNormalize(column);
+
   std::string strSQL;
 
   strSQL = PrepareSQL("DROP TABLE %s", MakeLinkTableName(m_table, column).c_str());
@@ -832,13 +739,7 @@ int CDenormalizedDatabase::AddObject(const ISerializable *obj, bool bUpdate /* =
 
       COLUMNS += ", content";
 
-#if USE_BSON
-      VALUES += PrepareSQL(", '%s'", CBSONVariantWriter::WriteBase64(var).c_str());
-#else
-      std::string value;
-      CJSONVariantWriter::Write(var, value, true);
-      VALUES += PrepareSQL(", '%s'", value.c_str());
-#endif
+      VALUES += PrepareSQL(", '%s'", WriteContent(var).c_str());
 
       // Add the indexed pairs (this keeps our indexed values in sync)
       for (std::map<std::string, std::string>::const_iterator it = indices.begin(); it != indices.end(); it++)
@@ -889,6 +790,174 @@ int CDenormalizedDatabase::AddObject(const ISerializable *obj, bool bUpdate /* =
   return idObject;
 }
 
+// Look up an item resolved by AddOneToManyItems(), -1 if there is none
+static int FindItemID(const std::map<std::string, std::map<std::string, int> > &items,
+                      const std::string &column, const std::string &value)
+{
+  std::map<std::string, std::map<std::string, int> >::const_iterator it = items.find(column);
+  if (it == items.end())
+    return -1;
+  std::map<std::string, int>::const_iterator it2 = it->second.find(value);
+  return it2 != it->second.end() ? it2->second : -1;
+}
+
+bool CDenormalizedDatabase::AddObjects(const std::vector<const ISerializable*> &objects, std::vector<int> &ids, bool bUpdate /* = true */)
+{
+  ids.assign(objects.size(), -1);
+  if (NULL == m_pDB.get()) return false;
+  if (NULL == m_pDS.get()) return false;
+
+  std::string strSQL;
+
+  // Join the caller's transaction if there is one
+  bool bOwnTransaction = !m_pDB->in_transaction();
+
+  try
+  {
+    if (bOwnTransaction)
+      BeginTransaction();
+
+    // Serialize everything first and work out which objects need to be written
+    std::vector<CVariant> vars(objects.size());
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+      if (!objects[i])
+        continue;
+
+      CVariant &var = vars[i];
+      objects[i]->Serialize(var);
+      if (!IsValid(var))
+        continue;
+
+      int idObject = (int)var["databaseid"].asInteger(-1);
+      bool bExists = (idObject != -1 || Exists(var, idObject));
+      ids[i] = idObject;
+
+      if (bExists && !bUpdate)
+        continue;
+
+      // See AddObject() for why updates are a delete and re-insert
+      if (bExists)
+        DeleteObjectByID(idObject);
+      pending.push_back(i);
+    }
+
+    // Gather the distinct 1:N and N:N values of the whole batch, so that every
+    // value is looked up (and added) once instead of once per object
+    std::map<std::string, std::map<std::string, int> > items; // column -> (value -> idItem)
+    for (std::vector<size_t>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+    {
+      const CVariant &var = vars[*it];
+      for (std::vector<Item>::const_iterator it2 = m_singleLinks.begin(); it2 != m_singleLinks.end(); ++it2)
+      {
+        std::string value = PrepareVariant(var[it2->name], it2->type);
+        if (!value.empty() && value != "''")
+          items[it2->name][value] = -1;
+      }
+      for (std::vector<Item>::const_iterator it2 = m_multiLinks.begin(); it2 != m_multiLinks.end(); ++it2)
+      {
+        const CVariant &multiValue = var[it2->name];
+        if (!multiValue.isArray())
+          continue;
+        for (CVariant::const_iterator_array it3 = multiValue.begin_array(); it3 != multiValue.end_array(); ++it3)
+        {
+          std::string value = PrepareVariant(*it3, it2->type);
+          if (!value.empty() && value != "''")
+            items[it2->name][value] = -1;
+        }
+      }
+    }
+    for (std::map<std::string, std::map<std::string, int> >::iterator it = items.begin(); it != items.end(); ++it)
+      AddOneToManyItems(*m_pDB, *m_pDS, m_sqlite, it->first, GetType(it->first), it->second);
+
+    // Hand out IDs ourselves, a multi-row INSERT can't tell us what it assigned.
+    // This has to be a locking read so no other writer can take the same IDs
+    // before we commit: SQLite transactions are started IMMEDIATE and already
+    // hold the write lock, MySQL needs FOR UPDATE to lock the end of the index.
+    strSQL = PrepareSQL("SELECT MAX(id%s) FROM %s", m_table, m_table);
+    if (!m_sqlite)
+      strSQL += " FOR UPDATE";
+    int nextId = 0;
+    if (m_pDS->query(strSQL))
+    {
+      if (!m_pDS->eof())
+        nextId = m_pDS->fv(0).get_asInt();
+      m_pDS->close();
+    }
+    for (std::vector<size_t>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+      nextId = std::max(nextId, ids[*it]);
+    for (std::vector<size_t>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+    {
+      if (ids[*it] < 0)
+        ids[*it] = ++nextId;
+    }
+
+    // Main table, same columns as AddObject()
+    std::string COLUMNS = "id" + std::string(m_table) + ", content";
+    for (std::vector<Item>::const_iterator it = m_indices.begin(); it != m_indices.end(); ++it)
+      COLUMNS += ", " + it->name;
+    for (std::vector<Item>::const_iterator it = m_singleLinks.begin(); it != m_singleLinks.end(); ++it)
+      COLUMNS += ", id" + it->name;
+
+    std::vector<std::string> rows;
+    std::map<std::string, std::vector<std::string> > links; // column -> link table rows
+    for (std::vector<size_t>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+    {
+      const CVariant &var = vars[*it];
+      int idObject = ids[*it];
+
+      std::string VALUES = StringUtils::Format("%d", idObject);
+      VALUES += PrepareSQL(", '%s'", WriteContent(var).c_str());
+      for (std::vector<Item>::const_iterator it2 = m_indices.begin(); it2 != m_indices.end(); ++it2)
+        VALUES += ", " + PrepareVariant(var[it2->name], it2->type);
+      for (std::vector<Item>::const_iterator it2 = m_singleLinks.begin(); it2 != m_singleLinks.end(); ++it2)
+      {
+        int idItem = FindItemID(items, it2->name, PrepareVariant(var[it2->name], it2->type));
+        VALUES += idItem >= 0 ? StringUtils::Format(", %d", idItem) : std::string(", NULL");
+      }
+      rows.push_back("(" + VALUES + ")");
+
+      for (std::vector<Item>::const_iterator it2 = m_multiLinks.begin(); it2 != m_multiLinks.end(); ++it2)
+      {
+        const CVariant &multiValue = var[it2->name];
+        if (!multiValue.isArray())
+          continue;
+
+        std::set<int> linked; // an object may list the same value twice
+        for (CVariant::const_iterator_array it3 = multiValue.begin_array(); it3 != multiValue.end_array(); ++it3)
+        {
+          int idItem = FindItemID(items, it2->name, PrepareVariant(*it3, it2->type));
+          if (idItem >= 0 && linked.insert(idItem).second)
+            links[it2->name].push_back(StringUtils::Format("(%d, %d)", idObject, idItem));
+        }
+      }
+    }
+
+    strSQL = "INSERT INTO " + std::string(m_table) + " (" + COLUMNS + ") VALUES ";
+    InsertRows(*m_pDS, strSQL, rows);
+
+    for (std::map<std::string, std::vector<std::string> >::const_iterator it = links.begin(); it != links.end(); ++it)
+    {
+      strSQL = PrepareSQL("INSERT INTO %s (id%s, id%s) VALUES ",
+                          MakeLinkTableName(m_table, it->first).c_str(), m_table, it->first.c_str());
+      InsertRows(*m_pDS, strSQL, it->second);
+    }
+
+    if (bOwnTransaction)
+      CommitTransaction();
+    return true;
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s - Unable to add %u objects. SQL: %s", __FUNCTION__, (unsigned int)objects.size(), strSQL.c_str());
+    if (bOwnTransaction)
+      RollbackTransaction();
+  }
+  ids.assign(objects.size(), -1);
+  return false;
+}
+
 // If the type is not known, call GetType(item) and pass the result to this function
 // parent is the parent table referenced by e.g. the "idparent" column
 int CDenormalizedDatabase::AddOneToManyItem(const std::string &parent, const std::string &type, const CVariant &var)
@@ -958,6 +1027,79 @@ void CDenormalizedDatabase::AddLink(const std::string &item, int idObject, int i
   }
 }
 
+void CDenormalizedDatabase::AddOneToManyItems(Database &db, Dataset &ds, bool sqlite,
+                                              const std::string &parent, const std::string &type, std::map<std::string, int> &values)
+{
+  LookupOneToManyItems(db, ds, sqlite, parent, type, values);
+
+  std::vector<std::string> rows;
+  for (std::map<std::string, int>::const_iterator it = values.begin(); it != values.end(); ++it)
+  {
+    if (it->second < 0)
+      rows.push_back("(NULL, " + it->first + ")");
+  }
+  if (rows.empty())
+    return;
+
+  std::string strSQL = db.prepare("INSERT INTO %s (id%s, %s) VALUES ", parent.c_str(), parent.c_str(), parent.c_str());
+  InsertRows(ds, strSQL, rows);
+
+  // Read back the IDs of the rows we just added
+  LookupOneToManyItems(db, ds, sqlite, parent, type, values);
+}
+
+void CDenormalizedDatabase::LookupOneToManyItems(Database &db, Dataset &ds, bool sqlite,
+                                                 const std::string &parent, const std::string &type, std::map<std::string, int> &values)
+{
+  std::vector<std::string> unresolved;
+  for (std::map<std::string, int>::const_iterator it = values.begin(); it != values.end(); ++it)
+  {
+    if (it->second < 0)
+      unresolved.push_back(it->first);
+  }
+
+  for (size_t start = 0; start < unresolved.size(); start += BATCH_ROWS)
+  {
+    std::vector<std::string> batch(unresolved.begin() + start,
+                                   unresolved.begin() + std::min(unresolved.size(), start + BATCH_ROWS));
+    std::string strSQL = db.prepare("SELECT id%s, %s FROM %s WHERE %s IN (",
+                                    parent.c_str(), parent.c_str(), parent.c_str(), parent.c_str());
+    strSQL += StringUtils::Join(batch, ", ") + ")";
+    if (!ds.query(strSQL))
+      continue;
+
+    while (!ds.eof())
+    {
+      // Map the stored value back to the form it was requested in
+      std::string value = PrepareVariant(db, FieldAsVarient(ds.fv(1), type), type);
+      std::map<std::string, int>::iterator it = values.find(value);
+      if (it == values.end() && !sqlite)
+      {
+        // MySQL compares text case insensitively, the row may match a value
+        // that differs in case only
+        for (it = values.begin(); it != values.end(); ++it)
+        {
+          if (it->second < 0 && StringUtils::EqualsNoCase(it->first, value))
+            break;
+        }
+      }
+      if (it != values.end())
+        it->second = ds.fv(0).get_asInt();
+      ds.next();
+    }
+    ds.close();
+  }
+}
+
+void CDenormalizedDatabase::InsertRows(Dataset &ds, const std::string &insert, const std::vector<std::string> &rows)
+{
+  for (size_t start = 0; start < rows.size(); start += BATCH_ROWS)
+  {
+    std::vector<std::string> batch(rows.begin() + start, rows.begin() + std::min(rows.size(), start + BATCH_ROWS));
+    ds.exec(insert + StringUtils::Join(batch, ", "));
+  }
+}
+
 std::string CDenormalizedDatabase::GetType(const std::string &column)
 {
   std::vector<Item>::const_iterator it;
@@ -983,13 +1125,8 @@ bool CDenormalizedDatabase::GetObjectByID(int idObject, IDeserializable *obj)
     {
       if (m_pDS->num_rows() != 0)
       {
-#if USE_BSON
-        CVariant var = CBSONVariantParser::ParseBase64(m_pDS->fv(0).get_asString());
-#else
-        const char *output = m_pDS->fv(0).get_asString().c_str();
         CVariant var;
-        CJSONVariantParser::Parse(output, var);
-#endif
+        ParseContent(m_pDS->fv(0).get_asString(), var);
         var["databaseid"] = idObject;
         obj->Deserialize(var);
 
@@ -1011,49 +1148,21 @@ bool CDenormalizedDatabase::GetObjectByIndex(const std::string &column, const CV
   if (NULL == m_pDB.get()) return false;
   if (NULL == m_pDS.get()) return false;
 
-  std::string strSQL;
-
   try
   {
-    // Look up the column type
-    std::string type;
-    std::vector<Item>::const_iterator it = std::find(m_indices.begin(), m_indices.end(), column);
-    if (it != m_indices.end())
-      type = it->type;
-    else
-      return false;
-
-    strSQL = PrepareSQL(
-      "SELECT id%s, content "
-      "FROM %s "
-      "WHERE %s=" + PrepareVariant(value, type),
-      m_table, m_table, column.c_str()
-    );
-
-    // Run the query and, if found, use the object ID to instantiate the info tag
-    if (m_pDS->query(strSQL))
+    // If found, use the object ID to instantiate the info tag
+    CVariant var;
+    int idObject = FindObjectByIndex(column, value, var);
+    if (idObject >= 0)
     {
-      if (m_pDS->num_rows() != 0)
-      {
-#if USE_BSON
-        CVariant var = CBSONVariantParser::ParseBase64(m_pDS->fv(1).get_asString());
-#else
-        const char *output = m_pDS->fv(1).get_asString().c_str();
-        CVariant var;
-        CJSONVariantParser::Parse(output, var);
-#endif
-        var["databaseid"] = m_pDS->fv(0).get_asInt();
-        obj->Deserialize(var);
-
-        m_pDS->close();
-        return true;
-      }
-      m_pDS->close();
+      var["databaseid"] = idObject;
+      obj->Deserialize(var);
+      return true;
     }
   }
   catch (...)
   {
-    CLog::Log(LOGERROR, "%s - Unable to get object. SQL: %s", __FUNCTION__, strSQL.c_str());
+    CLog::Log(LOGERROR, "%s - Unable to get object with %s=%s", __FUNCTION__, column.c_str(), value.asString().c_str());
   }
   return false;
 }
@@ -1105,6 +1214,17 @@ bool CDenormalizedDatabase::GetObjectsNav(CFileItemList &items, const std::map<s
       }
     }
 
+    // Objects that haven't been normalized yet are matched on their content below
+    std::vector<std::string> columns;
+    for (std::map<std::string, int>::const_iterator it = predicates.begin(); it != predicates.end(); it++)
+      columns.push_back(it->first);
+    std::string range = GetPendingRange(columns);
+    if (!range.empty())
+    {
+      wheres.push_back((firstWhere ? "WHERE NOT " : "AND NOT ") + range + " ");
+      firstWhere = false;
+    }
+
     // Build the query
     strSQL = PrepareSQL("SELECT %s.id%s, content FROM %s ", m_table, m_table, m_table);
 
@@ -1113,30 +1233,36 @@ bool CDenormalizedDatabase::GetObjectsNav(CFileItemList &items, const std::map<s
     for (std::vector<std::string>::const_iterator it = wheres.begin(); it != wheres.end(); it++)
       strSQL += *it;
 
-    if (m_pDS->query(strSQL))
+    if (!m_pDS->query(strSQL))
+      return false;
+
+    while (!m_pDS->eof())
     {
-      while (!m_pDS->eof())
-      {
-        // Use the CreateFileItem() callback provided by the subclass to instantiate the object
-        CFileItemPtr pItem;
+      // Use the CreateFileItem() callback provided by the subclass to instantiate the object
+      CFileItemPtr pItem;
 
-#if USE_BSON
-        CVariant var = CBSONVariantParser::ParseBase64(m_pDS->fv(1).get_asString());
-#else
-        const char *output = m_pDS->fv(1).get_asString().c_str();
-        CVariant var;
-        CJSONVariantParser::Parse(output, var);
-#endif
+      CVariant var;
+      ParseContent(m_pDS->fv(1).get_asString(), var);
 
-        var["databaseid"] = m_pDS->fv(0).get_asInt();
-        pItem = CFileItemPtr(CreateFileItem(var));
-        items.Add(pItem);
-        m_pDS->next();
+      var["databaseid"] = m_pDS->fv(0).get_asInt();
+      pItem = CFileItemPtr(CreateFileItem(var));
+      items.Add(pItem);
+      m_pDS->next();
+    }
+    m_pDS->close();
+
+    std::map<std::string, std::string> values;
+    if (!range.empty() && GetPredicateValues(predicates, values))
+    {
+      std::vector<std::pair<int, CVariant> > objects;
+      GetPendingObjects(range, values, objects);
+      for (std::vector<std::pair<int, CVariant> >::iterator it = objects.begin(); it != objects.end(); ++it)
+      {
+        it->second["databaseid"] = it->first;
+        items.Add(CFileItemPtr(CreateFileItem(it->second)));
       }
-      m_pDS->close();
-      return true;
     }
-    return false;
+    return true;
   }
   catch (...)
   {
@@ -1195,13 +1321,9 @@ bool CDenormalizedDatabase::GetItemID(const std::string &itemTable, const CVaria
 
   try
   {
-    strSQL = PrepareSQL(
-      "SELECT id%s "
-      "FROM %s "
-      "WHERE %s=" + PrepareVariant(value, type) + " "
-      "LIMIT 1",
-      itemTable.c_str(), itemTable.c_str(), itemTable.c_str()
-    );
+    strSQL = PrepareSQL("SELECT id%s FROM %s WHERE %s=", itemTable.c_str(), itemTable.c_str(), itemTable.c_str()) +
+             PrepareVariant(value, type) + " LIMIT 1";
+
     if (m_pDS->query(strSQL))
     {
       if (m_pDS->num_rows() > 0)
@@ -1352,12 +1474,34 @@ bool CDenormalizedDatabase::GetItemNav(const char *column, CFileItemList &items,
       }
     }
 
+    // Objects that haven't been normalized yet lack their links, they are
+    // matched on their content
+    std::vector<std::string> pendingItems;
+    if (!strSubquery.empty())
+    {
+      std::vector<std::string> columns(1, column);
+      for (std::map<std::string, int>::const_iterator it = predicates.begin(); it != predicates.end(); it++)
+        columns.push_back(it->first);
+      std::string range = GetPendingRange(columns);
+      std::map<std::string, std::string> values;
+      if (!range.empty() && GetPredicateValues(predicates, values))
+      {
+        std::set<int> idItems;
+        LookupPendingItems(column, range, values, idItems);
+        for (std::set<int>::const_iterator it = idItems.begin(); it != idItems.end(); ++it)
+          pendingItems.push_back(StringUtils::Format("%d", *it));
+      }
+    }
+
     if (strSubquery.empty())
       strSQL = PrepareSQL("SELECT id%s, %s FROM %s", column, column, column);
     else
       strSQL = PrepareSQL("SELECT id%s, %s FROM %s WHERE id%s IN (%s)",
           column, column, column, column, strSubquery.c_str());
 
+    if (!pendingItems.empty())
+      strSQL += PrepareSQL(" OR id%s IN (", column) + StringUtils::Join(pendingItems, ", ") + ")";
+
     if (m_pDS->query(strSQL))
     {
       while (!m_pDS->eof())
@@ -1460,7 +1604,16 @@ bool CDenormalizedDatabase::DeleteObjectByID(int idObject, bool killOrphansMwaha
         if (!m_pDS->query(strSQL))
           return false;
 
-        // Now that we have the results in our dataset, delete the link table
+        std::set<int> orphans;
+        while (!m_pDS->eof())
+        {
+          orphans.insert(m_pDS->fv(0).get_asInt());
+          m_pDS->next();
+        }
+        m_pDS->close();
+        GetPendingOrphans(item, idObject, orphans);
+
+        // Now that we have the orphans, delete the link table
         strSQL = PrepareSQL(
           "DELETE FROM %s "
           "WHERE id%s=%i",
@@ -1469,13 +1622,11 @@ bool CDenormalizedDatabase::DeleteObjectByID(int idObject, bool killOrphansMwaha
         m_pDS2->exec(strSQL);
 
         // Finally, remove the items one by one
-        while (!m_pDS->eof())
+        for (std::set<int>::const_iterator orphan = orphans.begin(); orphan != orphans.end(); ++orphan)
         {
-          strSQL = PrepareSQL("DELETE FROM %s WHERE id%s=%i", item.c_str(), item.c_str(), m_pDS->fv(0).get_asInt());
+          strSQL = PrepareSQL("DELETE FROM %s WHERE id%s=%i", item.c_str(), item.c_str(), *orphan);
           m_pDS2->exec(strSQL);
-          m_pDS->next();
         }
-        m_pDS->close();
       }
 
       // Next, the one-to-many items. "columns" becomes a comma-separated list of index column names
@@ -1488,10 +1639,16 @@ bool CDenormalizedDatabase::DeleteObjectByID(int idObject, bool killOrphansMwaha
       if (!m_pDS->query(strSQL))
         return false;
 
-      for (unsigned int i = 0; i < m_singleLinks.size() && i < (unsigned int)m_pDS->fieldCount(); i++)
+      std::vector<int> foreignKeys;
+      for (unsigned int i = 0; i < m_singleLinks.size() && i < (unsigned int)m_pDS->fieldCount() && !m_pDS->eof(); i++)
+        foreignKeys.push_back(m_pDS->fv(i).get_asInt());
+      m_pDS->close();
+
+      for (unsigned int i = 0; i < foreignKeys.size(); i++)
       {
         std::string item = m_singleLinks[i].name;
-        int foreignKey = m_pDS->fv(i).get_asInt();
+        int foreignKey = foreignKeys[i];
+        std::set<int> orphans;
 
         // Count the number of rows with the same FK to see if we need to delete it
         strSQL = PrepareSQL("SELECT COUNT(*) FROM %s WHERE id%s=%i", m_table, item.c_str(), foreignKey);
@@ -1504,14 +1661,16 @@ bool CDenormalizedDatabase::DeleteObjectByID(int idObject, bool killOrphansMwaha
           int count = m_pDS2->fv(0).get_asInt();
           m_pDS2->close();
           if (count == 1)
-          {
-            // Only one record found, continue with the delete
-            strSQL = PrepareSQL("DELETE FROM %s WHERE id%s=%i", item.c_str(), item.c_str(), foreignKey);
-            m_pDS2->exec(strSQL);
-          }
+            orphans.insert(foreignKey); // Only one record found, continue with the delete
+        }
+        GetPendingOrphans(item, idObject, orphans);
+
+        for (std::set<int>::const_iterator orphan = orphans.begin(); orphan != orphans.end(); ++orphan)
+        {
+          strSQL = PrepareSQL("DELETE FROM %s WHERE id%s=%i", item.c_str(), item.c_str(), *orphan);
+          m_pDS2->exec(strSQL);
         }
       }
-      m_pDS->close();
     }
 
     strSQL = PrepareSQL("DELETE FROM %s WHERE id%s=%i", m_table, m_table, idObject);
@@ -1530,40 +1689,665 @@ bool CDenormalizedDatabase::DeleteObjectByIndex(const std::string &column, const
   if (NULL == m_pDB.get()) return false;
   if (NULL == m_pDS.get()) return false;
 
-  std::string strSQL;
-
   try
   {
-    // Look up the column type
-    std::string type;
-    std::vector<Item>::const_iterator it = std::find(m_indices.begin(), m_indices.end(), column);
-    if (it != m_indices.end())
-      type = it->type;
-    else
+    CVariant var;
+    int idObject = FindObjectByIndex(column, value, var);
+    if (idObject >= 0)
+      return DeleteObjectByID(idObject, deleteOrphans);
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s - Unable to get object with %s=%s", __FUNCTION__, column.c_str(), value.asString().c_str());
+  }
+  return false;
+}
+
+
+// --- Background normalization ---------------------------------------------------
+
+/*!
+ * Normalizes the relations queued in the primarynormalize table, one chunk of
+ * objects per transaction. The queue is read inside the transaction, so the
+ * job continues where any previous job left off and leaves relations that
+ * have been dropped meanwhile alone.
+ */
+class CDenormalizedDatabase::CNormalizeJob : public CJob
+{
+public:
+  CNormalizeJob(const std::string &table, const DatabaseSettings &settings) :
+    m_table(table),
+    m_settings(settings),
+    m_serial(0),
+    m_lastId(0)
+  {
+  }
+
+  virtual bool DoWork() override;
+  virtual const char *GetType() const override { return "normalize"; }
+
+private:
+  friend class CDenormalizedDatabase;
+
+  /*!
+   * @param remaining Object IDs left to normalize after this chunk
+   * @return Object IDs covered by the chunk, -1 if the queue is empty
+   * @throw dbiplus::DbErrors
+   */
+  int NormalizeChunk(Database &db, Dataset &ds, unsigned int &remaining);
+
+  const std::string m_table;
+  const DatabaseSettings m_settings;
+
+  // The last chunk, reported through OnJobProgress()
+  std::string m_relation;
+  int m_serial;
+  int m_lastId; // -1 once the relation is done
+};
+
+bool CDenormalizedDatabase::CNormalizeJob::DoWork()
+{
+  std::unique_ptr<Database> db(CreateConnection(m_settings));
+  if (NULL == db.get() || db->connect(false) != DB_CONNECTION_OK)
+  {
+    CLog::Log(LOGERROR, "%s - Unable to connect to %s", __FUNCTION__, m_settings.name.c_str());
+    return false;
+  }
+  std::unique_ptr<Dataset> ds(db->CreateDataset());
+
+  unsigned int progress = 0;
+  while (true)
+  {
+    unsigned int remaining = 0;
+    int count;
+    try
+    {
+      db->start_transaction();
+      count = NormalizeChunk(*db, *ds, remaining);
+      db->commit_transaction();
+    }
+    catch (...)
+    {
+      CLog::Log(LOGERROR, "%s - Unable to normalize %s.%s", __FUNCTION__, m_table.c_str(), m_relation.c_str());
+      db->rollback_transaction();
+      return false;
+    }
+
+    if (count < 0)
+      break;
+
+    progress += count;
+    if (ShouldCancel(progress, progress + remaining))
       return false;
+  }
+
+  CLog::Log(LOGDEBUG, "%s - Finished normalizing %s", __FUNCTION__, m_table.c_str());
+  return true;
+}
 
+int CDenormalizedDatabase::CNormalizeJob::NormalizeChunk(Database &db, Dataset &ds, unsigned int &remaining)
+{
+  const bool sqlite = (m_settings.type == "sqlite3");
+  const std::string normalizeTable = MakeNormalizeTableName(m_table);
+  const char *table = m_table.c_str();
+
+  // The first queued relation gets the next chunk
+  std::string strSQL = db.prepare("SELECT relation, kind, sqltype, serial, lastid, maxid FROM %s ORDER BY relation",
+                                  normalizeTable.c_str());
+  if (!sqlite)
+    strSQL += " FOR UPDATE";
+  if (!ds.query(strSQL))
+    return -1;
+  if (ds.eof())
+  {
+    ds.close();
+    return -1;
+  }
+  std::string column = ds.fv(0).get_asString();
+  RelationType relation = (RelationType)ds.fv(1).get_asInt();
+  std::string type = ds.fv(2).get_asString();
+  int serial = ds.fv(3).get_asInt();
+  int lastId = ds.fv(4).get_asInt();
+  int maxId = ds.fv(5).get_asInt();
+  while (!ds.eof())
+  {
+    remaining += ds.fv(5).get_asInt() - ds.fv(4).get_asInt();
+    ds.next();
+  }
+  ds.close();
+
+  std::vector<std::pair<int, CVariant> > objects; // idObject -> object
+  strSQL = db.prepare("SELECT id%s, content FROM %s WHERE id%s>%i AND id%s<=%i ORDER BY id%s LIMIT %i",
+                      table, table, table, lastId, table, maxId, table, NORMALIZE_CHUNK_ROWS);
+  if (ds.query(strSQL))
+  {
+    while (!ds.eof())
+    {
+      objects.push_back(std::make_pair(ds.fv(0).get_asInt(), CVariant()));
+      ParseContent(ds.fv(1).get_asString(), objects.back().second);
+      ds.next();
+    }
+    ds.close();
+  }
+  int chunkEnd = (objects.size() < NORMALIZE_CHUNK_ROWS ? maxId : objects.back().first);
+
+  // Resolve the values of the chunk to item IDs in one go. QueueNormalize()
+  // added them already, unless they were deleted and added back meanwhile.
+  std::map<std::string, int> items; // value -> idItem
+  if (relation != RELATION_INDEX)
+  {
+    for (std::vector<std::pair<int, CVariant> >::const_iterator it = objects.begin(); it != objects.end(); ++it)
+    {
+      const CVariant &object = it->second;
+      std::vector<const CVariant*> values = GetFieldValues(object[column], relation == RELATION_MANY_TO_MANY);
+      for (std::vector<const CVariant*>::const_iterator it2 = values.begin(); it2 != values.end(); ++it2)
+      {
+        std::string value = PrepareVariant(db, **it2, type);
+        if (!value.empty() && value != "''")
+          items[value] = -1;
+      }
+    }
+    AddOneToManyItems(db, ds, sqlite, column, type, items);
+  }
+
+  switch (relation)
+  {
+  case RELATION_INDEX:
+    for (std::vector<std::pair<int, CVariant> >::const_iterator it = objects.begin(); it != objects.end(); ++it)
+    {
+      const CVariant &object = it->second;
+      std::string value = PrepareVariant(db, object[column], type);
+      if (value.empty() || value == "''")
+        continue;
+
+      strSQL = db.prepare("UPDATE %s SET %s=", table, column.c_str()) + value +
+               db.prepare(" WHERE id%s=%i", table, it->first);
+      ds.exec(strSQL);
+    }
+    break;
+
+  case RELATION_ONE_TO_MANY:
+  {
+    // Objects sharing an item are updated together
+    std::map<int, std::vector<std::string> > idObjects; // idItem -> object IDs
+    for (std::vector<std::pair<int, CVariant> >::const_iterator it = objects.begin(); it != objects.end(); ++it)
+    {
+      const CVariant &object = it->second;
+      std::map<std::string, int>::const_iterator item = items.find(PrepareVariant(db, object[column], type));
+      if (item != items.end() && item->second >= 0)
+        idObjects[item->second].push_back(StringUtils::Format("%d", it->first));
+    }
+    for (std::map<int, std::vector<std::string> >::const_iterator it = idObjects.begin(); it != idObjects.end(); ++it)
+    {
+      for (size_t start = 0; start < it->second.size(); start += BATCH_ROWS)
+      {
+        std::vector<std::string> batch(it->second.begin() + start,
+                                       it->second.begin() + std::min(it->second.size(), start + BATCH_ROWS));
+        strSQL = db.prepare("UPDATE %s SET id%s=%i WHERE id%s IN (", table, column.c_str(), it->first, table);
+        ds.exec(strSQL + StringUtils::Join(batch, ", ") + ")");
+      }
+    }
+    break;
+  }
+
+  case RELATION_MANY_TO_MANY:
+  {
+    std::string linkTable = MakeLinkTableName(m_table, column);
+
+    // Objects (re)added meanwhile already have their links, start over for the
+    // whole chunk rather than looking them up
+    strSQL = db.prepare("DELETE FROM %s WHERE id%s>%i AND id%s<=%i", linkTable.c_str(), table, lastId, table, chunkEnd);
+    ds.exec(strSQL);
+
+    std::vector<std::string> rows;
+    for (std::vector<std::pair<int, CVariant> >::const_iterator it = objects.begin(); it != objects.end(); ++it)
+    {
+      const CVariant &object = it->second;
+      std::vector<const CVariant*> values = GetFieldValues(object[column], true);
+      std::set<int> linked; // an object may list the same value twice
+      for (std::vector<const CVariant*>::const_iterator it2 = values.begin(); it2 != values.end(); ++it2)
+      {
+        std::map<std::string, int>::const_iterator item = items.find(PrepareVariant(db, **it2, type));
+        if (item != items.end() && item->second >= 0 && linked.insert(item->second).second)
+          rows.push_back(StringUtils::Format("(%d, %d)", it->first, item->second));
+      }
+    }
+    strSQL = db.prepare("INSERT INTO %s (id%s, id%s) VALUES ", linkTable.c_str(), table, column.c_str());
+    InsertRows(ds, strSQL, rows);
+    break;
+  }
+  }
+
+  m_relation = column;
+  m_serial = serial;
+  if (chunkEnd >= maxId)
+  {
+    strSQL = db.prepare("DELETE FROM %s WHERE relation='%s'", normalizeTable.c_str(), column.c_str());
+    m_lastId = -1;
+  }
+  else
+  {
+    strSQL = db.prepare("UPDATE %s SET lastid=%i WHERE relation='%s'", normalizeTable.c_str(), chunkEnd, column.c_str());
+    m_lastId = chunkEnd;
+  }
+  ds.exec(strSQL);
+
+  remaining -= chunkEnd - lastId;
+  return chunkEnd - lastId;
+}
+
+void CDenormalizedDatabase::OnConnected()
+{
+  CSingleLock lock(m_pendingSection);
+  m_pending.clear();
+  lock.Leave();
+
+  std::string strSQL;
+  try
+  {
+    // Databases created before background normalization lack the queue
     strSQL = PrepareSQL(
-      "SELECT id%s "
-      "FROM %s "
-      "WHERE %s=" + PrepareVariant(value, type),
-      m_table, m_table, column.c_str()
+      "CREATE TABLE IF NOT EXISTS %s ("
+        "relation VARCHAR(64) PRIMARY KEY, "
+        "kind INTEGER, "
+        "sqltype VARCHAR(64), "
+        "serial INTEGER, "
+        "lastid INTEGER, "
+        "maxid INTEGER"
+      ")", MakeNormalizeTableName(m_table).c_str()
     );
+    m_pDS->exec(strSQL);
 
+    strSQL = PrepareSQL("SELECT relation, serial, lastid, maxid FROM %s", MakeNormalizeTableName(m_table).c_str());
     if (m_pDS->query(strSQL))
     {
-      if (m_pDS->num_rows() != 0)
+      lock.Enter();
+      while (!m_pDS->eof())
       {
-        int id = m_pDS->fv(0).get_asInt();
-        m_pDS->close();
-
-        return DeleteObjectByID(id, deleteOrphans);
+        Pending &pending = m_pending[m_pDS->fv(0).get_asString()];
+        pending.serial = m_pDS->fv(1).get_asInt();
+        pending.lastId = m_pDS->fv(2).get_asInt();
+        pending.maxId = m_pDS->fv(3).get_asInt();
+        m_normalizeSerial = std::max(m_normalizeSerial, pending.serial);
+        m_pDS->next();
       }
+      lock.Leave();
       m_pDS->close();
     }
   }
   catch (...)
   {
-    CLog::Log(LOGERROR, "%s - Unable to get object. SQL: %s", __FUNCTION__, strSQL.c_str());
+    CLog::Log(LOGERROR, "%s - Unable to read the normalizer queue. SQL: %s", __FUNCTION__, strSQL.c_str());
+  }
+
+  lock.Enter();
+  if (!m_pending.empty())
+  {
+    CLog::Log(LOGINFO, "%s - Resuming normalization of %u relations of %s", __FUNCTION__, (unsigned int)m_pending.size(), m_table);
+    StartNormalize();
+  }
+}
+
+bool CDenormalizedDatabase::CommitTransaction()
+{
+  if (!CDatabase::CommitTransaction())
+    return false;
+  if (InBatch())
+    return true;
+
+  // Relations added during the transaction can be normalized now, this also
+  // retries after a failed job
+  CSingleLock lock(m_pendingSection);
+  if (m_bNormalizeQueued || (!m_pending.empty() && !m_normalizeJob))
+    StartNormalize();
+  return true;
+}
+
+void CDenormalizedDatabase::QueueNormalize(const char *column, RelationType relation, const char *type)
+{
+  std::string strSQL = PrepareSQL("SELECT MIN(id%s), MAX(id%s) FROM %s", m_table, m_table, m_table);
+  if (!m_pDS->query(strSQL))
+    return;
+  bool bEmpty = (m_pDS->eof() || m_pDS->fv(1).get_isNull());
+  int minId = bEmpty ? 0 : m_pDS->fv(0).get_asInt();
+  int maxId = bEmpty ? 0 : m_pDS->fv(1).get_asInt();
+  m_pDS->close();
+
+  // Objects added from now on are written with the relation in place
+  if (bEmpty)
+    return;
+
+  // The items of the existing objects are added right away, so they can be
+  // looked up, browsed and counted before the job has linked the objects
+  if (relation != RELATION_INDEX)
+  {
+    std::map<std::string, int> items; // value -> idItem
+    strSQL = PrepareSQL("SELECT content FROM %s", m_table);
+    if (m_pDS->query_cursor(strSQL))
+    {
+      while (!m_pDS->eof())
+      {
+        CVariant object;
+        ParseContent(m_pDS->fv(0).get_asString(), object);
+        std::vector<const CVariant*> values = GetFieldValues(object[column], relation == RELATION_MANY_TO_MANY);
+        for (std::vector<const CVariant*>::const_iterator it = values.begin(); it != values.end(); ++it)
+        {
+          std::string value = PrepareVariant(**it, type);
+          if (!value.empty() && value != "''")
+            items[value] = -1;
+        }
+        m_pDS->next();
+      }
+      m_pDS->close();
+    }
+    AddOneToManyItems(*m_pDB, *m_pDS, m_sqlite, column, type, items);
+  }
+
+  CSingleLock lock(m_pendingSection);
+  Pending pending;
+  pending.serial = ++m_normalizeSerial;
+  pending.lastId = minId - 1;
+  pending.maxId = maxId;
+  lock.Leave();
+
+  strSQL = PrepareSQL("DELETE FROM %s WHERE relation='%s'", MakeNormalizeTableName(m_table).c_str(), column);
+  m_pDS->exec(strSQL);
+  strSQL = PrepareSQL(
+    "INSERT INTO %s (relation, kind, sqltype, serial, lastid, maxid) "
+    "VALUES ('%s', %i, '%s', %i, %i, %i)",
+    MakeNormalizeTableName(m_table).c_str(), column, (int)relation, type, pending.serial, pending.lastId, pending.maxId
+  );
+  m_pDS->exec(strSQL);
+
+  CLog::Log(LOGDEBUG, "%s - Normalizing %s.%s in the background", __FUNCTION__, m_table, column);
+
+  lock.Enter();
+  m_pending[column] = pending;
+
+  // Otherwise the job is started when the relation's tables are committed
+  if (m_pDB->in_transaction())
+    m_bNormalizeQueued = true;
+  else
+    StartNormalize();
+}
+
+void CDenormalizedDatabase::DequeueNormalize(const char *column)
+{
+  CSingleLock lock(m_pendingSection);
+  m_pending.erase(column);
+  lock.Leave();
+
+  // The job reads its chunks from the queue, so it won't touch the relation again
+  std::string strSQL = PrepareSQL("DELETE FROM %s WHERE relation='%s'", MakeNormalizeTableName(m_table).c_str(), column);
+  m_pDS->exec(strSQL);
+}
+
+void CDenormalizedDatabase::StartNormalize()
+{
+  CSingleLock lock(m_pendingSection);
+  if (m_normalizeJob)
+  {
+    // The running job may have looked at the queue already
+    m_bNormalizeQueued = true;
+    return;
+  }
+
+  const DatabaseSettings *settings = GetConnectionSettings();
+  if (settings == NULL)
+    return;
+
+  m_bNormalizeQueued = false;
+  m_normalizeProgress = 0;
+  m_normalizeTotal = 0;
+  m_normalizeJob = CJobManager::GetInstance().AddJob(new CNormalizeJob(m_table, *settings), this, CJob::PRIORITY_LOW_PAUSABLE);
+}
+
+void CDenormalizedDatabase::OnJobProgress(unsigned int jobID, unsigned int progress, unsigned int total, const CJob *job)
+{
+  const CNormalizeJob *normalizeJob = static_cast<const CNormalizeJob*>(job);
+
+  CSingleLock lock(m_pendingSection);
+  std::map<std::string, Pending>::iterator it = m_pending.find(normalizeJob->m_relation);
+
+  // Ignore chunks of a relation that has been dropped and added again since
+  if (it != m_pending.end() && it->second.serial == normalizeJob->m_serial)
+  {
+    if (normalizeJob->m_lastId < 0)
+      m_pending.erase(it);
+    else
+      it->second.lastId = normalizeJob->m_lastId;
+  }
+  m_normalizeProgress = progress;
+  m_normalizeTotal = total;
+}
+
+void CDenormalizedDatabase::OnJobComplete(unsigned int jobID, bool success, CJob *job)
+{
+  CSingleLock lock(m_pendingSection);
+  m_normalizeJob = 0;
+
+  // On failure the queue is left for the next commit or connect
+  if (!success)
+    return;
+
+  if (m_bNormalizeQueued)
+  {
+    const CNormalizeJob *normalizeJob = static_cast<const CNormalizeJob*>(job);
+    m_bNormalizeQueued = false;
+    m_normalizeJob = CJobManager::GetInstance().AddJob(new CNormalizeJob(normalizeJob->m_table, normalizeJob->m_settings),
+                                                       this, CJob::PRIORITY_LOW_PAUSABLE);
+  }
+  else
+  {
+    // The job only completes once the queue is empty
+    m_pending.clear();
+  }
+}
+
+bool CDenormalizedDatabase::GetNormalizeProgress(unsigned int &progress, unsigned int &total)
+{
+  CSingleLock lock(m_pendingSection);
+  progress = m_normalizeProgress;
+  total = m_normalizeTotal;
+  return !m_pending.empty();
+}
+
+std::string CDenormalizedDatabase::GetPendingRange(const std::vector<std::string> &columns)
+{
+  std::string range;
+
+  CSingleLock lock(m_pendingSection);
+  for (std::vector<std::string>::const_iterator it = columns.begin(); it != columns.end(); ++it)
+  {
+    std::map<std::string, Pending>::const_iterator pending = m_pending.find(*it);
+    if (pending == m_pending.end())
+      continue;
+
+    if (!range.empty())
+      range += " OR ";
+    range += PrepareSQL("(%s.id%s>%i AND %s.id%s<=%i)", m_table, m_table, pending->second.lastId,
+                        m_table, m_table, pending->second.maxId);
+  }
+  return range.empty() ? range : "(" + range + ")";
+}
+
+void CDenormalizedDatabase::GetPendingObjects(const std::string &range, const std::map<std::string, std::string> &values,
+                                              std::vector<std::pair<int, CVariant> > &objects)
+{
+  std::string strSQL = PrepareSQL("SELECT id%s, content FROM %s WHERE ", m_table, m_table) + range;
+  if (!m_pDS->query_cursor(strSQL))
+    return;
+
+  while (!m_pDS->eof())
+  {
+    CVariant object;
+    ParseContent(m_pDS->fv(1).get_asString(), object);
+
+    bool bMatch = true;
+    for (std::map<std::string, std::string>::const_iterator it = values.begin(); it != values.end() && bMatch; ++it)
+      bMatch = HasValue(object, it->first, it->second);
+
+    if (bMatch)
+    {
+      objects.push_back(std::make_pair(m_pDS->fv(0).get_asInt(), CVariant()));
+      objects.back().second.swap(object);
+    }
+    m_pDS->next();
+  }
+  m_pDS->close();
+}
+
+void CDenormalizedDatabase::LookupPendingItems(const std::string &column, const std::string &range,
+                                               const std::map<std::string, std::string> &values, std::set<int> &idItems)
+{
+  std::vector<std::pair<int, CVariant> > objects;
+  GetPendingObjects(range, values, objects);
+
+  std::string type = GetType(column);
+  bool isManyToMany = (std::find(m_multiLinks.begin(), m_multiLinks.end(), column) != m_multiLinks.end());
+
+  std::map<std::string, int> items; // value -> idItem
+  for (std::vector<std::pair<int, CVariant> >::const_iterator it = objects.begin(); it != objects.end(); ++it)
+  {
+    const CVariant &object = it->second;
+    std::vector<const CVariant*> fieldValues = GetFieldValues(object[column], isManyToMany);
+    for (std::vector<const CVariant*>::const_iterator it2 = fieldValues.begin(); it2 != fieldValues.end(); ++it2)
+    {
+      std::string value = PrepareVariant(**it2, type);
+      if (!value.empty() && value != "''")
+        items[value] = -1;
+    }
+  }
+  if (items.empty())
+    return;
+
+  LookupOneToManyItems(*m_pDB, *m_pDS, m_sqlite, column, type, items);
+
+  for (std::map<std::string, int>::const_iterator it = items.begin(); it != items.end(); ++it)
+  {
+    if (it->second >= 0)
+      idItems.insert(it->second);
+  }
+}
+
+void CDenormalizedDatabase::GetPendingOrphans(const std::string &column, int idObject, std::set<int> &orphans)
+{
+  std::string range = GetPendingRange(std::vector<std::string>(1, column));
+  if (range.empty())
+    return;
+
+  std::vector<std::pair<int, CVariant> > objects;
+  GetPendingObjects(range, std::map<std::string, std::string>(), objects);
+
+  std::string type = GetType(column);
+  bool isManyToMany = (std::find(m_multiLinks.begin(), m_multiLinks.end(), column) != m_multiLinks.end());
+
+  std::map<std::string, int> own, others; // value -> idItem
+  for (std::vector<std::pair<int, CVariant> >::const_iterator it = objects.begin(); it != objects.end(); ++it)
+  {
+    std::vector<const CVariant*> fieldValues = GetFieldValues(it->second[column], isManyToMany);
+    for (std::vector<const CVariant*>::const_iterator it2 = fieldValues.begin(); it2 != fieldValues.end(); ++it2)
+    {
+      std::string value = PrepareVariant(**it2, type);
+      if (!value.empty() && value != "''")
+        (it->first == idObject ? own : others)[value] = -1;
+    }
+  }
+  LookupOneToManyItems(*m_pDB, *m_pDS, m_sqlite, column, type, own);
+  LookupOneToManyItems(*m_pDB, *m_pDS, m_sqlite, column, type, others);
+
+  // The object's own items, unless a normalized object refers to them as well
+  std::string table = isManyToMany ? MakeLinkTableName(m_table, column) : std::string(m_table);
+  for (std::map<std::string, int>::const_iterator it = own.begin(); it != own.end(); ++it)
+  {
+    if (it->second < 0 || orphans.find(it->second) != orphans.end())
+      continue;
+
+    std::string strSQL = PrepareSQL("SELECT COUNT(*) FROM %s WHERE id%s=%i AND id%s<>%i",
+                                    table.c_str(), column.c_str(), it->second, m_table, idObject);
+    if (m_pDS->query(strSQL))
+    {
+      if (m_pDS->num_rows() != 0 && m_pDS->fv(0).get_asInt() == 0)
+        orphans.insert(it->second);
+      m_pDS->close();
+    }
+  }
+
+  for (std::map<std::string, int>::const_iterator it = others.begin(); it != others.end(); ++it)
+    orphans.erase(it->second);
+}
+
+bool CDenormalizedDatabase::GetPredicateValues(const std::map<std::string, int> &predicates, std::map<std::string, std::string> &values)
+{
+  for (std::map<std::string, int>::const_iterator it = predicates.begin(); it != predicates.end(); ++it)
+  {
+    // Other columns are ignored by the queries as well
+    if (std::find(m_singleLinks.begin(), m_singleLinks.end(), it->first) == m_singleLinks.end() &&
+        std::find(m_multiLinks.begin(), m_multiLinks.end(), it->first) == m_multiLinks.end())
+      continue;
+
+    CVariant value;
+    if (!GetItemByID(it->first, it->second, value))
+      return false;
+    values[it->first] = PrepareVariant(value, GetType(it->first));
+  }
+  return true;
+}
+
+bool CDenormalizedDatabase::HasValue(const CVariant &object, const std::string &column, const std::string &value)
+{
+  std::string type = GetType(column);
+  bool isManyToMany = (std::find(m_multiLinks.begin(), m_multiLinks.end(), column) != m_multiLinks.end());
+
+  std::vector<const CVariant*> fieldValues = GetFieldValues(object[column], isManyToMany);
+  for (std::vector<const CVariant*>::const_iterator it = fieldValues.begin(); it != fieldValues.end(); ++it)
+  {
+    std::string fieldValue = PrepareVariant(**it, type);
+    if (fieldValue == value)
+      return true;
+    // MySQL compares text case insensitively
+    if (!m_sqlite && IsText(type) && StringUtils::EqualsNoCase(fieldValue, value))
+      return true;
   }
   return false;
 }
+
+int CDenormalizedDatabase::FindObjectByIndex(const std::string &column, const CVariant &value, CVariant &object)
+{
+  // Look up the column type
+  std::vector<Item>::const_iterator it = std::find(m_indices.begin(), m_indices.end(), column);
+  if (it == m_indices.end())
+    return -1;
+  std::string sqlValue = PrepareVariant(value, it->type);
+
+  std::string range = GetPendingRange(std::vector<std::string>(1, column));
+
+  std::string strSQL = PrepareSQL("SELECT id%s, content FROM %s WHERE %s=", m_table, m_table, column.c_str()) + sqlValue;
+  if (!range.empty())
+    strSQL += " AND NOT " + range;
+
+  int idObject = -1;
+  if (m_pDS->query(strSQL))
+  {
+    if (m_pDS->num_rows() != 0)
+    {
+      idObject = m_pDS->fv(0).get_asInt();
+      ParseContent(m_pDS->fv(1).get_asString(), object);
+    }
+    m_pDS->close();
+  }
+
+  if (idObject < 0 && !range.empty())
+  {
+    std::map<std::string, std::string> values;
+    values[column] = sqlValue;
+    std::vector<std::pair<int, CVariant> > objects;
+    GetPendingObjects(range, values, objects);
+    if (!objects.empty())
+    {
+      idObject = objects[0].first;
+      object.swap(objects[0].second);
+    }
+  }
+  return idObject;
+}
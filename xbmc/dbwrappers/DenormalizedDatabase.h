@@ -21,10 +21,13 @@
 
 #include "Database.h"
 #include "dataset.h"
+#include "threads/CriticalSection.h"
+#include "utils/Job.h"
 
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 
 class ISerializable;
 class IDeserializable;
@@ -53,17 +56,35 @@ class CFileItemList;
  *
  * DropManyToMany("director");
  *
+ * When a relationship is added to a table that already holds objects, the
+ * existing objects are normalized by a background job, in chunks of object
+ * IDs. Its progress is kept in the database, so an interrupted job resumes on
+ * the next connect. The items of the new relationship are added right away, the
+ * job only links the objects to them. Until the job reaches an object, queries
+ * involving the new relationship fall back to the object's serialized content.
+ *
  * Developer's guide: subclasses can do direct database reads, but all write/delete
  * calls must be abstracted within this class to ensure database integrity.
  */
-class CDenormalizedDatabase : public CDatabase
+class CDenormalizedDatabase : public CDatabase, public IJobCallback
 {
 public:
+  /*!
+   * Encoding of the serialized objects in the content column. Rows are read
+   * back in whatever encoding they were written in, so the format can be
+   * changed without converting an existing database.
+   */
+  enum ContentFormat
+  {
+    CONTENT_FORMAT_JSON,
+    CONTENT_FORMAT_BINARY, // CBinaryVariant, base64 encoded
+  };
+
   /*!
    * The parameter here becomes the name of the main table.
    */
-  CDenormalizedDatabase(const char *predominantObject);
-  virtual ~CDenormalizedDatabase() = default;
+  CDenormalizedDatabase(const char *predominantObject, ContentFormat format = CONTENT_FORMAT_BINARY);
+  virtual ~CDenormalizedDatabase();
 
   const char *Describe() const { return m_table; }
 
@@ -74,6 +95,16 @@ public:
    */
   int AddObject(const ISerializable *obj, bool bUpdate = true);
 
+  /*!
+   * Bulk version of AddObject(). All objects are written in one transaction,
+   * one-to-many and many-to-many values shared between objects are looked up
+   * once and rows are added with multi-row INSERTs. Objects in the batch are
+   * assumed to be distinct from each other.
+   * @param ids Receives the database ID of each object, -1 on failure
+   * @return false if the transaction was rolled back
+   */
+  bool AddObjects(const std::vector<const ISerializable*> &objects, std::vector<int> &ids, bool bUpdate = true);
+
   bool GetObjectByID(int idObject, IDeserializable *obj);
   bool GetObjectByIndex(const std::string &column, const CVariant &value, IDeserializable *obj);
 
@@ -106,6 +137,22 @@ public:
   bool DeleteObjectByID(int idObject, bool deleteOrphans = true);
   bool DeleteObjectByIndex(const std::string &column, const CVariant &value, bool deleteOrphans = true);
 
+  /*!
+   * @param progress Objects normalized by the running job so far
+   * @param total Objects the running job has to normalize, including progress
+   * @return true while relationships are still being normalized
+   */
+  bool GetNormalizeProgress(unsigned int &progress, unsigned int &total);
+
+  /*!
+   * Starts the normalizer if a relationship was added during the transaction.
+   */
+  virtual bool CommitTransaction() override;
+
+  // implementation of IJobCallback
+  virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job) override;
+  virtual void OnJobProgress(unsigned int jobID, unsigned int progress, unsigned int total, const CJob *job) override;
+
 protected:
   /*!
    * Set up the tables using the relations declared in the subclass's constructor.
@@ -113,6 +160,11 @@ protected:
   virtual void CreateTables() override;
   virtual void CreateAnalytics() override;
 
+  /*!
+   * Resume normalizing relationships left unfinished by a previous session.
+   */
+  virtual void OnConnected() override;
+
   /*!
    * idObject is set to ID of object if it exists, and untouched if it doesn't
    * exist. Must return false if IsValid(object) returns false. If the object's
@@ -139,6 +191,7 @@ protected:
   static std::string MakeLinkTableName(const std::string &primary, const std::string &secondary);
   static std::string MakeUniqueIndexName(const std::string &primary, const std::string &secondary, int ord);
   static std::string MakeUniqueIndexClause(const std::string &primary, const std::string &secondary, int ord);
+  static std::string MakeNormalizeTableName(const std::string &primary);
 
   /*!
    * Helper functions used to unpolymorphize CVariants based on SQL column datatype.
@@ -156,6 +209,12 @@ protected:
    * @return "''" if CVariant string is empty
    */
   std::string PrepareVariant(const CVariant &value, const std::string &type);
+  static std::string PrepareVariant(dbiplus::Database &db, const CVariant &value, const std::string &type);
+
+  /*!
+   * Serialize an object for the content column, in the database's content format.
+   */
+  std::string WriteContent(const CVariant &object) const;
 
   /*!
    * Call this before the other Declare*() functions.
@@ -192,6 +251,24 @@ protected:
   int AddOneToManyItem(const std::string &parent, const std::string &type, const CVariant &var);
   void AddLink(const std::string &item, int idObject, int idItem);
 
+  /*!
+   * Batch counterparts of AddOneToManyItem() used by AddObjects() and the
+   * normalizer, which runs on a connection of its own.
+   * @param values SQL value (as returned by PrepareVariant()) -> ID, filled in
+   * for every value, adding the missing ones to the parent table
+   * @throw dbiplus::DbErrors
+   */
+  static void AddOneToManyItems(dbiplus::Database &db, dbiplus::Dataset &ds, bool sqlite,
+                                const std::string &parent, const std::string &type, std::map<std::string, int> &values);
+  static void LookupOneToManyItems(dbiplus::Database &db, dbiplus::Dataset &ds, bool sqlite,
+                                   const std::string &parent, const std::string &type, std::map<std::string, int> &values);
+
+  /*!
+   * Execute "insert" followed by the comma separated rows, in batches.
+   * @throw dbiplus::DbErrors
+   */
+  static void InsertRows(dbiplus::Dataset &ds, const std::string &insert, const std::vector<std::string> &rows);
+
   std::string GetType(const std::string &column);
 
 private:
@@ -216,6 +293,68 @@ private:
   void DropOneToManyInternal(const char *column, bool tempDrop = false);
   void DropManyToManyInternal(const char *column, bool tempDrop = false);
 
+  enum RelationType
+  {
+    RELATION_INDEX,
+    RELATION_ONE_TO_MANY,
+    RELATION_MANY_TO_MANY,
+  };
+
+  class CNormalizeJob;
+
+  /*!
+   * Record that the objects currently in the main table need column to be
+   * filled in, and start the normalizer once outside of a transaction.
+   * @throw dbiplus::DbErrors
+   */
+  void QueueNormalize(const char *column, RelationType relation, const char *type);
+  void DequeueNormalize(const char *column);
+  void StartNormalize();
+
+  /*!
+   * Query fallback while normalizing.
+   * @return SQL condition matching the objects that may not be normalized yet
+   * for any of columns, empty if there are none
+   */
+  std::string GetPendingRange(const std::vector<std::string> &columns);
+
+  /*!
+   * Deserialize the objects in range and keep those matching all values.
+   * @param values column -> SQL value (as returned by PrepareVariant())
+   * @throw dbiplus::DbErrors
+   */
+  void GetPendingObjects(const std::string &range, const std::map<std::string, std::string> &values,
+                         std::vector<std::pair<int, CVariant> > &objects);
+
+  /*!
+   * Look up the items of column referenced by the matching objects in range.
+   * @throw dbiplus::DbErrors
+   */
+  void LookupPendingItems(const std::string &column, const std::string &range,
+                          const std::map<std::string, std::string> &values, std::set<int> &idItems);
+
+  /*!
+   * Objects that haven't been normalized yet lack their links. Add the items
+   * of column idObject references if it's one of them and remove the items
+   * the others reference from orphans.
+   * @throw dbiplus::DbErrors
+   */
+  void GetPendingOrphans(const std::string &column, int idObject, std::set<int> &orphans);
+
+  /*!
+   * Turn 1:N and N:N predicates (item -> ID) into SQL values.
+   * @return false if an item doesn't exist, nothing can match then
+   */
+  bool GetPredicateValues(const std::map<std::string, int> &predicates, std::map<std::string, std::string> &values);
+
+  bool HasValue(const CVariant &object, const std::string &column, const std::string &value);
+
+  /*!
+   * @return ID of the object with the indexed value, -1 if not found
+   * @throw dbiplus::DbErrors
+   */
+  int FindObjectByIndex(const std::string &column, const CVariant &value, CVariant &object);
+
   /*!
    * A column (object property)
    */
@@ -240,6 +379,28 @@ private:
   // Predominant table name
   const char *m_table;
 
+  ContentFormat m_contentFormat;
+
   // Whether we can begin declaring relations or not (for the implementer's safety)
   bool m_bBegin;
+
+  /*!
+   * Objects with lastId < ID <= maxId haven't been normalized yet. Objects
+   * added after the relation are written in full, so maxId is fixed.
+   */
+  struct Pending
+  {
+    int serial; // tells a relation apart from an earlier one of the same name
+    int lastId;
+    int maxId;
+  };
+
+  // Shared with the normalizer's callbacks
+  CCriticalSection m_pendingSection;
+  std::map<std::string, Pending> m_pending; // column -> progress
+  unsigned int m_normalizeJob;
+  int m_normalizeSerial;
+  bool m_bNormalizeQueued; // start the normalizer on commit or once the running job completes
+  unsigned int m_normalizeProgress;
+  unsigned int m_normalizeTotal;
 };
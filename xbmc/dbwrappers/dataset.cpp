@@ -82,6 +82,69 @@ std::string Database::prepare(const char *format, ...)
   return result;
 }
 
+std::string Database::bind_params(const std::string &sql, const sql_record &params)
+{
+  std::string result;
+  result.reserve(sql.size() + params.size() * 8);
+
+  unsigned int param = 0;
+  char quote = 0;
+  for (std::string::const_iterator i = sql.begin(); i != sql.end(); ++i)
+  {
+    if (quote)
+    {
+      if (*i == quote)
+        quote = 0;
+    }
+    else if (*i == '\'' || *i == '"' || *i == '`')
+      quote = *i;
+    else if (*i == '?')
+    {
+      if (param >= params.size())
+        throw DbErrors("Missing value for parameter %u of: %s", param + 1, sql.c_str());
+
+      const field_value &value = params[param++];
+      if (value.get_isNull())
+      {
+        result += "NULL";
+        continue;
+      }
+
+      switch (value.get_fType())
+      {
+      case ft_Boolean:
+        result += value.get_asBool() ? "1" : "0";
+        break;
+      case ft_Short:
+      case ft_UShort:
+      case ft_Int:
+      case ft_UInt:
+      case ft_Int64:
+        result += value.get_asString();
+        break;
+      case ft_Float:
+      case ft_Double:
+      {
+        char number[32];
+        snprintf(number, sizeof(number), "%.15g", value.get_asDouble());
+        result += number;
+        break;
+      }
+      default:
+        result += prepare("'%s'", value.get_asString().c_str());
+        break;
+      }
+      continue;
+    }
+    result += *i;
+  }
+
+  if (param != params.size())
+    throw DbErrors("Unused values for parameters of: %s", sql.c_str());
+
+  return result;
+}
+
 //************* Dataset implementation ***************
 
 Dataset::Dataset():
@@ -93,6 +156,7 @@ Dataset::Dataset():
   frecno = 0;
   fbof = feof = true;
   autocommit = true;
+  forward_only = false;
   fieldIndexMapID = ~0;
 
   fields_object = new Fields();
@@ -111,6 +175,7 @@ Dataset::Dataset(Database *newDb):
   frecno = 0;
   fbof = feof = true;
   autocommit = true;
+  forward_only = false;
   fieldIndexMapID = ~0;
 
   fields_object = new Fields();
@@ -207,6 +272,7 @@ void Dataset::close(void) {
   frecno = 0;
   fbof = feof = true;
   active = false;
+  forward_only = false;
 
   fieldIndexMap_Entries.clear();
   fieldIndexMap_Sorter.clear();
@@ -222,6 +288,17 @@ bool Dataset::seek(int pos) {
 }
 
 
+int Dataset::exec_prepared(const std::string &sql, const sql_record &params) {
+  if (db == NULL) throw DbErrors("No Database Connection");
+  return exec(db->bind_params(sql, params));
+}
+
+bool Dataset::query_prepared(const std::string &sql, const sql_record &params) {
+  if (db == NULL) throw DbErrors("No Database Connection");
+  return query(db->bind_params(sql, params));
+}
+
+
 void Dataset::refresh() {
   int row = frecno;
   if ((row != 0) && active) {
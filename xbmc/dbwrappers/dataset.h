@@ -165,6 +165,14 @@ public:
 
   virtual bool in_transaction() {return false;};
 
+  /*! \brief Substitute the '?' placeholders of a SQL statement with escaped values.
+   Used by datasets without native parameter binding.
+   \param sql - SQL statement with '?' placeholders outside of quoted literals.
+   \param params - values for the placeholders, in order of appearance.
+   \return the statement with all placeholders substituted.
+   */
+  std::string bind_params(const std::string &sql, const sql_record &params);
+
 };
 
 
@@ -211,6 +219,7 @@ protected:
   ParamList plist;              // Paramlist for locate
   bool fbof, feof;
   bool autocommit;		// for transactions
+  bool forward_only;		// Is Query a forward-only cursor?
 
 
 /* Variables to store SQL statements */
@@ -308,6 +317,17 @@ public:
   virtual const void* getExecRes()=0;
 /* as open, but with our query exec Sql */
   virtual bool query(const std::string &sql) = 0;
+/* as exec, but with the '?' placeholders of sql bound to params */
+  virtual int  exec_prepared(const std::string &sql, const sql_record &params);
+/* as query, but with the '?' placeholders of sql bound to params */
+  virtual bool query_prepared(const std::string &sql, const sql_record &params);
+/* as query, but opens a forward-only cursor: rows are fetched one at a time
+   into a single reused record while stepping with next(), so num_rows()
+   only counts the rows fetched so far and seeking is not possible.
+   Datasets without cursor support fall back to a regular query. */
+  virtual bool query_cursor(const std::string &sql) { return query(sql); }
+/* Check whether the current query is a forward-only cursor */
+  bool is_forward_only(void) const { return forward_only; }
 /* Close SQL Query*/
   virtual void close();
 /* This function looks for field Field_name with value equal Field_value
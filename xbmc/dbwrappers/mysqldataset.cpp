@@ -22,6 +22,7 @@
 #include <string>
 #include <set>
 #include <algorithm>
+#include <cstring>
 
 #include "utils/log.h"
 #include "system.h" // for GetLastError()
@@ -40,6 +41,8 @@
 #define MYSQL_OK          0
 #define ER_BAD_DB_ERROR   1049
 
+#define STATEMENT_CACHE_SIZE 32  // Maximum number of cached prepared statements per connection
+
 namespace dbiplus {
 
 //************* MysqlDatabase implementation ***************
@@ -253,6 +256,7 @@ int MysqlDatabase::connect(bool create_new) {
 }
 
 void MysqlDatabase::disconnect(void) {
+  clear_statements();
   if (conn != NULL)
   {
     mysql_close(conn);
@@ -456,6 +460,47 @@ int MysqlDatabase::query_with_reconnect(const char* query) {
   return result;
 }
 
+MYSQL_STMT *MysqlDatabase::get_statement(const std::string &sql) {
+  if (!active) throw DbErrors("No Database Connection");
+
+  std::map<std::string, StatementList::iterator>::iterator it = statement_index.find(sql);
+  if (it != statement_index.end())
+  {
+    // move to the front of the least recently used list
+    statements.splice(statements.begin(), statements, it->second);
+    return it->second->second;
+  }
+
+  MYSQL_STMT *stmt = mysql_stmt_init(conn);
+  if (stmt == NULL)
+    throw DbErrors("Can't allocate statement: %s", sql.c_str());
+  if (mysql_stmt_prepare(stmt, sql.c_str(), sql.size()) != MYSQL_OK)
+  {
+    setErr(mysql_stmt_errno(stmt), sql.c_str());
+    mysql_stmt_close(stmt);
+    throw DbErrors(getErrorMsg());
+  }
+
+  statements.push_front(std::make_pair(sql, stmt));
+  statement_index[sql] = statements.begin();
+
+  if (statements.size() > STATEMENT_CACHE_SIZE)
+  {
+    mysql_stmt_close(statements.back().second);
+    statement_index.erase(statements.back().first);
+    statements.pop_back();
+  }
+
+  return stmt;
+}
+
+void MysqlDatabase::clear_statements() {
+  for (StatementList::iterator it = statements.begin(); it != statements.end(); ++it)
+    mysql_stmt_close(it->second);
+  statements.clear();
+  statement_index.clear();
+}
+
 long MysqlDatabase::nextid(const char* sname) {
   CLog::Log(LOGDEBUG,"MysqlDatabase::nextid for %s",sname);
   if (!active) return DB_UNEXPECTED_RESULT;
@@ -1352,6 +1397,8 @@ char *MysqlDatabase::mysql_vmprintf(const char *zFormat, va_list ap) {
 MysqlDataset::MysqlDataset():Dataset() {
   haveError = false;
   db = NULL;
+  cursor_res = NULL;
+  cursor_rows = 0;
   errmsg = NULL;
   autorefresh = false;
 }
@@ -1359,11 +1406,14 @@ MysqlDataset::MysqlDataset():Dataset() {
 MysqlDataset::MysqlDataset(MysqlDatabase *newDb):Dataset(newDb) {
   haveError = false;
   db = newDb;
+  cursor_res = NULL;
+  cursor_rows = 0;
   errmsg = NULL;
   autorefresh = false;
 }
 
 MysqlDataset::~MysqlDataset() {
+   if (cursor_res) mysql_free_result(cursor_res);
    if (errmsg) free(errmsg);
  }
 
@@ -1538,6 +1588,76 @@ int MysqlDataset::exec(const std::string &sql) {
   }
 }
 
+int MysqlDataset::exec_prepared(const std::string &sql, const sql_record &params) {
+  if (!handle()) throw DbErrors("No Database Connection");
+  exec_res.clear();
+
+  MysqlDatabase *mysqldb = static_cast<MysqlDatabase*>(db);
+  MYSQL_STMT *stmt = mysqldb->get_statement(sql);
+  if (mysql_stmt_param_count(stmt) != params.size())
+    throw DbErrors("Parameter count mismatch: %s", sql.c_str());
+
+  // the bound buffers have to stay valid until the statement is executed
+  std::vector<MYSQL_BIND> binds(params.size());
+  std::vector<std::string> strings(params.size());
+  std::vector<long long> integers(params.size());
+  std::vector<double> doubles(params.size());
+  for (unsigned int i = 0; i < params.size(); i++)
+  {
+    const field_value &v = params[i];
+    MYSQL_BIND &bind = binds[i];
+    memset(&bind, 0, sizeof(bind));
+    if (v.get_isNull())
+    {
+      bind.buffer_type = MYSQL_TYPE_NULL;
+      continue;
+    }
+
+    switch (v.get_fType())
+    {
+      case ft_Boolean:
+      case ft_Short:
+      case ft_UShort:
+      case ft_Int:
+      case ft_UInt:
+      case ft_Int64:
+        integers[i] = v.get_asInt64();
+        bind.buffer_type = MYSQL_TYPE_LONGLONG;
+        bind.buffer = &integers[i];
+        break;
+      case ft_Float:
+      case ft_Double:
+        doubles[i] = v.get_asDouble();
+        bind.buffer_type = MYSQL_TYPE_DOUBLE;
+        bind.buffer = &doubles[i];
+        break;
+      default:
+        strings[i] = v.get_asString();
+        bind.buffer_type = MYSQL_TYPE_STRING;
+        bind.buffer = const_cast<char*>(strings[i].data());
+        bind.buffer_length = strings[i].size();
+        break;
+    }
+  }
+
+  if ((!binds.empty() && mysql_stmt_bind_param(stmt, &binds[0]) != MYSQL_OK) ||
+      mysql_stmt_execute(stmt) != MYSQL_OK)
+  {
+    int err = mysql_stmt_errno(stmt);
+    if (err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST)
+    {
+      // prepared statements don't survive a reconnect, so go through the
+      // text protocol which takes care of reconnecting
+      mysqldb->clear_statements();
+      return Dataset::exec_prepared(sql, params);
+    }
+    db->setErr(err, sql.c_str());
+    throw DbErrors(db->getErrorMsg());
+  }
+
+  return MYSQL_OK;
+}
+
 int MysqlDataset::exec() {
    return exec(sql);
 }
@@ -1546,6 +1666,61 @@ const void* MysqlDataset::getExecRes() {
   return &exec_res;
 }
 
+static void fill_record(MYSQL_ROW row, const MYSQL_FIELD *fields, sql_record &rec)
+{
+  const unsigned int numColumns = rec.size();
+  for (unsigned int i = 0; i < numColumns; i++)
+  {
+    field_value &v = rec[i];
+    v.set_isNull(false);
+    switch (fields[i].type)
+    {
+      case MYSQL_TYPE_LONGLONG:
+      case MYSQL_TYPE_DECIMAL:
+      case MYSQL_TYPE_NEWDECIMAL:
+      case MYSQL_TYPE_TINY:
+      case MYSQL_TYPE_SHORT:
+      case MYSQL_TYPE_INT24:
+      case MYSQL_TYPE_LONG:
+        if (row[i] != NULL)
+        {
+          v.set_asInt(atoi(row[i]));
+        }
+        else
+        {
+          v.set_asInt(0);
+        }
+        break;
+      case MYSQL_TYPE_FLOAT:
+      case MYSQL_TYPE_DOUBLE:
+        if (row[i] != NULL)
+        {
+          v.set_asDouble(atof(row[i]));
+        }
+        else
+        {
+          v.set_asDouble(0);
+        }
+        break;
+      case MYSQL_TYPE_STRING:
+      case MYSQL_TYPE_VAR_STRING:
+      case MYSQL_TYPE_VARCHAR:
+      case MYSQL_TYPE_TINY_BLOB:
+      case MYSQL_TYPE_MEDIUM_BLOB:
+      case MYSQL_TYPE_LONG_BLOB:
+      case MYSQL_TYPE_BLOB:
+        v.set_asString(row[i] != NULL ? (const char *)row[i] : "");
+        break;
+      case MYSQL_TYPE_NULL:
+      default:
+        CLog::Log(LOGDEBUG,"MYSQL: Unknown field type: %u", fields[i].type);
+        v.set_asString("");
+        v.set_isNull();
+        break;
+    }
+  }
+}
+
 bool MysqlDataset::query(const std::string &query) {
   if(!handle()) throw DbErrors("No Database Connection");
   std::string qry = query;
@@ -1585,57 +1760,7 @@ bool MysqlDataset::query(const std::string &query) {
   { // have a row of data
     sql_record *res = new sql_record;
     res->resize(numColumns);
-    for (unsigned int i = 0; i < numColumns; i++)
-    {
-      field_value &v = res->at(i);
-      switch (fields[i].type)
-      {
-        case MYSQL_TYPE_LONGLONG:
-        case MYSQL_TYPE_DECIMAL:
-        case MYSQL_TYPE_NEWDECIMAL:
-        case MYSQL_TYPE_TINY:
-        case MYSQL_TYPE_SHORT:
-        case MYSQL_TYPE_INT24:
-        case MYSQL_TYPE_LONG:
-          if (row[i] != NULL)
-          {
-            v.set_asInt(atoi(row[i]));
-          }
-          else
-          {
-            v.set_asInt(0);
-          }
-          break;
-        case MYSQL_TYPE_FLOAT:
-        case MYSQL_TYPE_DOUBLE:
-          if (row[i] != NULL)
-          {
-            v.set_asDouble(atof(row[i]));
-          }
-          else
-          {
-            v.set_asDouble(0);
-          }
-          break;
-        case MYSQL_TYPE_STRING:
-        case MYSQL_TYPE_VAR_STRING:
-        case MYSQL_TYPE_VARCHAR:
-          if (row[i] != NULL) v.set_asString((const char *)row[i] );
-          break;
-        case MYSQL_TYPE_TINY_BLOB:
-        case MYSQL_TYPE_MEDIUM_BLOB:
-        case MYSQL_TYPE_LONG_BLOB:
-        case MYSQL_TYPE_BLOB:
-          if (row[i] != NULL) v.set_asString((const char *)row[i]);
-          break;
-        case MYSQL_TYPE_NULL:
-        default:
-          CLog::Log(LOGDEBUG,"MYSQL: Unknown field type: %u", fields[i].type);
-          v.set_asString("");
-          v.set_isNull();
-          break;
-      }
-    }
+    fill_record(row, fields, *res);
     result.records.push_back(res);
   }
   mysql_free_result(stmt);
@@ -1645,6 +1770,69 @@ bool MysqlDataset::query(const std::string &query) {
   return true;
 }
 
+bool MysqlDataset::query_cursor(const std::string &query) {
+  if(!handle()) throw DbErrors("No Database Connection");
+  std::string qry = query;
+  if (qry.find("select") == std::string::npos && qry.find("SELECT") == std::string::npos)
+    throw DbErrors("MUST be select SQL!");
+
+  close();
+
+  size_t loc;
+
+  // mysql doesn't understand CAST(foo as integer) => change to CAST(foo as signed integer)
+  while ((loc = ci_find(qry, "as integer)")) != std::string::npos)
+    qry = qry.insert(loc + 3, "signed ");
+
+  if ( static_cast<MysqlDatabase*>(db)->setErr(static_cast<MysqlDatabase*>(db)->query_with_reconnect(qry.c_str()), qry.c_str()) != MYSQL_OK )
+    throw DbErrors(db->getErrorMsg());
+
+  // The raw rows are still transferred in one go, as callers commonly issue
+  // further queries on the same connection while stepping through the
+  // cursor, which mysql_use_result() does not allow. Only the conversion into
+  // field values is done lazily into a single reused record.
+  cursor_res = mysql_store_result(handle());
+  if (cursor_res == NULL)
+    throw DbErrors("Missing result set!");
+
+  // column headers
+  const unsigned int numColumns = mysql_num_fields(cursor_res);
+  MYSQL_FIELD *fields = mysql_fetch_fields(cursor_res);
+  result.record_header.resize(numColumns);
+  for (unsigned int i = 0; i < numColumns; i++)
+    result.record_header[i].name = fields[i].name;
+
+  // a single record is reused for every row stepped through
+  result.records.push_back(new sql_record(numColumns));
+
+  active = true;
+  forward_only = true;
+  ds_state = dsSelect;
+  frecno = 0;
+  fbof = feof = !fetch_cursor_row();
+  if (!feof)
+    fill_fields();
+  return true;
+}
+
+bool MysqlDataset::fetch_cursor_row() {
+  if (!cursor_res)
+    return false;
+
+  MYSQL_ROW row = mysql_fetch_row(cursor_res);
+  if (row)
+  {
+    fill_record(row, mysql_fetch_fields(cursor_res), *result.records[0]);
+    cursor_rows++;
+    return true;
+  }
+
+  // exhausted, release the result right away
+  mysql_free_result(cursor_res);
+  cursor_res = NULL;
+  return false;
+}
+
 void MysqlDataset::open(const std::string &sql) {
    set_select_sql(sql);
    open();
@@ -1662,6 +1850,12 @@ void MysqlDataset::open() {
 }
 
 void MysqlDataset::close() {
+  if (cursor_res)
+  {
+    mysql_free_result(cursor_res);
+    cursor_res = NULL;
+  }
+  cursor_rows = 0;
   Dataset::close();
   result.clear();
   edit_object->clear();
@@ -1681,6 +1875,8 @@ void MysqlDataset::cancel() {
 }
 
 int MysqlDataset::num_rows() {
+  if (forward_only)
+    return cursor_rows;
   return result.records.size();
 }
 
@@ -1693,21 +1889,40 @@ bool MysqlDataset::bof() {
 }
 
 void MysqlDataset::first() {
+  if (forward_only)
+  {
+    if (cursor_rows > 1)
+      throw DbErrors("Can't rewind a forward-only dataset");
+    return;
+  }
   Dataset::first();
   this->fill_fields();
 }
 
 void MysqlDataset::last() {
+  if (forward_only) throw DbErrors("Can't seek in a forward-only dataset");
   Dataset::last();
   fill_fields();
 }
 
 void MysqlDataset::prev(void) {
+  if (forward_only) throw DbErrors("Can't seek in a forward-only dataset");
   Dataset::prev();
   fill_fields();
 }
 
 void MysqlDataset::next(void) {
+  if (forward_only)
+  {
+    if (ds_state == dsSelect && !feof)
+    {
+      fbof = false;
+      feof = !fetch_cursor_row();
+      if (!feof)
+        fill_fields();
+    }
+    return;
+  }
   Dataset::next();
   if (!eof())
       fill_fields();
@@ -1727,6 +1942,7 @@ void MysqlDataset::free_row(void)
 }
 
 bool MysqlDataset::seek(int pos) {
+  if (forward_only) throw DbErrors("Can't seek in a forward-only dataset");
   if (ds_state == dsSelect)
   {
     Dataset::seek(pos);
@@ -37,6 +37,11 @@ protected:
   bool _in_transaction;
   int last_err;
 
+/* prepared statements keyed by their SQL, most recently used first */
+  typedef std::list<std::pair<std::string, MYSQL_STMT*> > StatementList;
+  StatementList statements;
+  std::map<std::string, StatementList::iterator> statement_index;
+
 
 public:
 /* default constructor */
@@ -86,6 +91,11 @@ public:
   int query_with_reconnect(const char* query);
   void configure_connection();
 
+/* func. returns the cached prepared statement for sql, preparing it if needed */
+  MYSQL_STMT *get_statement(const std::string &sql);
+/* func. closes all cached prepared statements */
+  void clear_statements();
+
 private:
 
   typedef struct StrAccum StrAccum;
@@ -112,6 +122,13 @@ class MysqlDataset : public Dataset {
 protected:
   MYSQL* handle();
 
+/* result of an open forward-only cursor */
+  MYSQL_RES *cursor_res;
+/* number of rows fetched through the cursor */
+  int cursor_rows;
+/* fetches the next cursor row into the reused record, returns false when exhausted */
+  bool fetch_cursor_row();
+
 /* Makes direct queries to database */
   virtual void make_query(StringList &_sql);
 /* Makes direct inserts into database */
@@ -146,9 +163,12 @@ or insert() operations default = false) */
 /* func. executes a query without results to return */
   virtual int  exec ();
   virtual int  exec (const std::string &sql);
+  virtual int  exec_prepared(const std::string &sql, const sql_record &params);
   virtual const void* getExecRes();
 /* as open, but with our query exec Sql */
   virtual bool query(const std::string &query);
+/* as query, but converts the fetched rows lazily on next() */
+  virtual bool query_cursor(const std::string &query);
 /* func. closes a query */
   virtual void close(void);
 /* Cancel changes, made in insert or edit states of dataset */
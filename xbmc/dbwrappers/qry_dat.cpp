@@ -35,6 +35,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <utility>
 
 #ifndef __GNUC__
 #pragma warning (disable:4800)
@@ -48,73 +50,117 @@ field_value::field_value()
 {
   field_type = ft_String;
   is_null = false;
+  str_on_heap = false;
+  local_length = 0;
+  local_str[0] = '\0';
 }
 
-field_value::field_value(const char *s):
-  str_value(s)
+field_value::field_value(const char *s)
 {
   field_type = ft_String;
   is_null = false;
+  str_on_heap = false;
+  set_asString(s);
 }
   
+field_value::field_value(const std::string &s)
+{
+  field_type = ft_String;
+  is_null = false;
+  str_on_heap = false;
+  set_asString(s);
+}
+
 field_value::field_value(const bool b) {
   bool_value = b; 
   field_type = ft_Boolean;
   is_null = false;
+  str_on_heap = false;
 }
 
 field_value::field_value(const char c) {
   char_value = c; 
   field_type = ft_Char;
   is_null = false;
+  str_on_heap = false;
 }
   
 field_value::field_value(const short s) {
   short_value = s; 
   field_type = ft_Short;
   is_null = false;
+  str_on_heap = false;
 }
   
 field_value::field_value(const unsigned short us) {
   ushort_value = us; 
   field_type = ft_UShort;
   is_null = false;
+  str_on_heap = false;
 }
   
 field_value::field_value(const int i) {
   int_value = i; 
   field_type = ft_Int;
   is_null = false;
+  str_on_heap = false;
 }
   
 field_value::field_value(const unsigned int ui) {
   uint_value = ui; 
   field_type = ft_UInt;
   is_null = false;
+  str_on_heap = false;
 }
   
 field_value::field_value(const float f) {
   float_value = f; 
   field_type = ft_Float;
   is_null = false;
+  str_on_heap = false;
 }
   
 field_value::field_value(const double d) {
   double_value = d; 
   field_type = ft_Double;
   is_null = false;
+  str_on_heap = false;
 }
   
 field_value::field_value(const int64_t i) {
   int64_value = i; 
   field_type = ft_Int64;
   is_null = false;
+  str_on_heap = false;
 }
 
 field_value::field_value (const field_value & fv) {
+  field_type = ft_String;
+  str_on_heap = false;
+  init_from(fv);
+}
+
+field_value::field_value (field_value && fv) {
+  str_on_heap = false;
+  *this = std::move(fv);
+}
+
+field_value::~field_value(){
+  release_string();
+}
+
+void field_value::release_string() {
+  if (str_on_heap)
+  {
+    delete[] heap_str.data;
+    str_on_heap = false;
+  }
+}
+
+void field_value::init_from(const field_value & fv) {
   switch (fv.get_fType()) {
     case ft_String: {
-      set_asString(fv.get_asString());
+      set_asString(fv.string_data(), fv.string_length());
       break;
     }
     case ft_Boolean:{
@@ -154,24 +200,21 @@ field_value::field_value (const field_value & fv) {
       break;
     }
     default:
+      release_string();
+      object_value = fv.object_value;
+      field_type = fv.field_type;
       break;
   }
   is_null = fv.get_isNull();
 }
 
 
-//empty destructor
-field_value::~field_value(){
-
-  }
-
-  
 //Conversations functions
 std::string field_value::get_asString() const {
     std::string tmp;
     switch (field_type) {
     case ft_String: {
-      tmp = str_value;
+      tmp.assign(string_data(), string_length());
       return tmp;
     }
     case ft_Boolean:{
@@ -228,7 +271,8 @@ std::string field_value::get_asString() const {
 bool field_value::get_asBool() const {
     switch (field_type) {
     case ft_String: {
-      if (str_value == "True" || str_value == "true" || str_value == "1")
+      const char *str = string_data();
+      if (strcmp(str, "True") == 0 || strcmp(str, "true") == 0 || strcmp(str, "1") == 0)
           return true;
       else
 	return false;
@@ -272,7 +316,7 @@ bool field_value::get_asBool() const {
 char field_value::get_asChar() const {
   switch (field_type) {
     case ft_String: {
-      return str_value[0];
+      return string_data()[0];
     }
     case ft_Boolean:{
       if (bool_value) 
@@ -327,7 +371,7 @@ char field_value::get_asChar() const {
 short field_value::get_asShort() const {
     switch (field_type) {
     case ft_String: {
-      return (short)atoi(str_value.c_str());
+      return (short)atoi(string_data());
     }
     case ft_Boolean:{
       return (short)bool_value;
@@ -365,7 +409,7 @@ short field_value::get_asShort() const {
 unsigned short field_value::get_asUShort() const {
     switch (field_type) {
     case ft_String: {
-      return (unsigned short)atoi(str_value.c_str());
+      return (unsigned short)atoi(string_data());
     }
     case ft_Boolean:{
       return (unsigned short)bool_value;
@@ -402,7 +446,7 @@ unsigned short field_value::get_asUShort() const {
 int field_value::get_asInt() const {
     switch (field_type) {
     case ft_String: {
-      return (int)atoi(str_value.c_str());
+      return (int)atoi(string_data());
     }
     case ft_Boolean:{
       return (int)bool_value;
@@ -439,7 +483,7 @@ int field_value::get_asInt() const {
 unsigned int field_value::get_asUInt() const {
     switch (field_type) {
     case ft_String: {
-      return (unsigned int)atoi(str_value.c_str());
+      return (unsigned int)atoi(string_data());
     }
     case ft_Boolean:{
       return (unsigned int)bool_value;
@@ -476,7 +520,7 @@ unsigned int field_value::get_asUInt() const {
 float field_value::get_asFloat() const {
     switch (field_type) {
     case ft_String: {
-      return (float)atof(str_value.c_str());
+      return (float)atof(string_data());
     }
     case ft_Boolean:{
       return (float)bool_value;
@@ -513,7 +557,7 @@ float field_value::get_asFloat() const {
 double field_value::get_asDouble() const {
     switch (field_type) {
     case ft_String: {
-      return atof(str_value.c_str());
+      return atof(string_data());
     }
     case ft_Boolean:{
       return (double)bool_value;
@@ -550,7 +594,7 @@ double field_value::get_asDouble() const {
 int64_t field_value::get_asInt64() const {
     switch (field_type) {
     case ft_String: {
-      return _atoi64(str_value.c_str());
+      return _atoi64(string_data());
     }
     case ft_Boolean:{
       return (int64_t)bool_value;
@@ -587,112 +631,112 @@ int64_t field_value::get_asInt64() const {
 
 field_value& field_value::operator= (const field_value & fv) {
   if ( this == &fv ) return *this;
-  
-  is_null = fv.get_isNull();
+  init_from(fv);
+  return *this;
+}
 
-  switch (fv.get_fType()) {
-    case ft_String: {
-      set_asString(fv.get_asString());
-      return *this;
-      break;
-    }
-    case ft_Boolean:{
-      set_asBool(fv.get_asBool());
-      return *this;
-      break;     
-    }
-    case ft_Char: {
-      set_asChar(fv.get_asChar());
-      return *this;
-      break;
-    }
-    case ft_Short: {
-      set_asShort(fv.get_asShort());
-      return *this;
-      break;
-    }
-    case ft_UShort: {
-      set_asUShort(fv.get_asUShort());
-      return *this;
-      break;
-    }
-    case ft_Int: {
-      set_asInt(fv.get_asInt());
-      return *this;
-      break;
-    }
-    case ft_UInt: {
-      set_asUInt(fv.get_asUInt());
-      return *this;
-      break;
-    }
-    case ft_Float: {
-      set_asFloat(fv.get_asFloat());
-      return *this;
-      break;
-    }
-    case ft_Double: {
-      set_asDouble(fv.get_asDouble());
-      return *this;
-      break;
-    }
-    case ft_Int64: {
-      set_asInt64(fv.get_asInt64());
-      return *this;
-      break;
-    }
-    default:
-      return *this;
-    }
+field_value& field_value::operator= (field_value && fv) {
+  if ( this == &fv ) return *this;
+  release_string();
+  field_type = fv.field_type;
+  is_null = fv.is_null;
+  str_on_heap = fv.str_on_heap;
+  local_length = fv.local_length;
+  // the union is plain data, so this hands over a heap buffer as well
+  memcpy(local_str, fv.local_str, LOCAL_STRING_SIZE);
+  fv.str_on_heap = false;
+  fv.field_type = ft_String;
+  fv.local_length = 0;
+  fv.local_str[0] = '\0';
+  return *this;
 }
 
 
 
 //Set functions
 void field_value::set_asString(const char *s) {
-  str_value = s;
-  field_type = ft_String;}
+  set_asString(s, strlen(s));}
 
 void field_value::set_asString(const std::string & s) {
-  str_value = s;
-  field_type = ft_String;}
+  set_asString(s.c_str(), s.size());}
+
+void field_value::set_asString(const char *s, size_t len) {
+  field_type = ft_String;
+  if (str_on_heap && len < heap_str.capacity)
+  {
+    // keep the buffer we already have, even for short strings
+    memmove(heap_str.data, s, len);
+    heap_str.data[len] = '\0';
+    heap_str.length = (uint32_t)len;
+  }
+  else if (len < LOCAL_STRING_SIZE)
+  {
+    memmove(local_str, s, len);
+    local_str[len] = '\0';
+    local_length = (uint8_t)len;
+  }
+  else
+  {
+    // grow by at least half so that a reused value settles quickly
+    uint32_t capacity = (uint32_t)len + 1;
+    if (str_on_heap && capacity < heap_str.capacity + heap_str.capacity / 2)
+      capacity = heap_str.capacity + heap_str.capacity / 2;
+    char *data = new char[capacity];
+    memcpy(data, s, len);
+    data[len] = '\0';
+    release_string();
+    heap_str.data = data;
+    heap_str.length = (uint32_t)len;
+    heap_str.capacity = capacity;
+    str_on_heap = true;
+  }
+}
   
 void field_value::set_asBool(const bool b) {
+  release_string();
   bool_value = b; 
   field_type = ft_Boolean;}
   
 void field_value::set_asChar(const char c) {
+  release_string();
   char_value = c; 
   field_type = ft_Char;}
   
 void field_value::set_asShort(const short s) {
+  release_string();
   short_value = s; 
   field_type = ft_Short;}
   
 void field_value::set_asUShort(const unsigned short us) {
+  release_string();
   ushort_value = us; 
   field_type = ft_UShort;
 }
 
 void field_value::set_asInt(const int i) {
+  release_string();
   int_value = i; 
   field_type = ft_Int;
 }
   
 void field_value::set_asUInt(const unsigned int ui) {
-  int_value = ui; 
+  release_string();
+  uint_value = ui; 
   field_type = ft_UInt;
 }
   
 void field_value::set_asFloat(const float f) {
+  release_string();
   float_value = f; 
   field_type = ft_Float;}
   
 void field_value::set_asDouble(const double d) {
+  release_string();
   double_value = d; 
   field_type = ft_Double;}
 
 void field_value::set_asInt64(const int64_t i) {
+  release_string();
   int64_value = i; 
   field_type = ft_Int64;}
   
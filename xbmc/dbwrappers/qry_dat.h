@@ -57,8 +57,17 @@ enum fType {
 
 class field_value {
 private:
-  fType field_type;
-  std::string str_value;
+  /* Strings up to LOCAL_STRING_SIZE - 1 characters are stored inline, longer
+     ones in a heap buffer that is kept and reused while the value stays a
+     string, so refilling a record (e.g. in cursor mode) does not allocate. */
+  enum { LOCAL_STRING_SIZE = 16 };
+
+  struct heap_string {
+    char *data;
+    uint32_t length;
+    uint32_t capacity;
+  };
+
   union {
     bool   bool_value;
     char   char_value;
@@ -70,9 +79,19 @@ private:
     double double_value;
     int64_t int64_value;
     void   *object_value;
+    heap_string heap_str;
+    char   local_str[LOCAL_STRING_SIZE];
   } ;
 
+  fType field_type;
   bool is_null;
+  bool str_on_heap;
+  uint8_t local_length;
+
+  const char *string_data() const { return str_on_heap ? heap_str.data : local_str; }
+  size_t string_length() const { return str_on_heap ? heap_str.length : local_length; }
+  void release_string();
+  void init_from(const field_value &fv);
 
 public:
   field_value();
@@ -86,9 +105,13 @@ public:
   field_value(const float f);
   field_value(const double d);
   field_value(const int64_t i);
+  field_value(const std::string &s);
   field_value(const field_value & fv);
+  field_value(field_value && fv);
   ~field_value();
 
+  static field_value null_value() { field_value fv; fv.set_isNull(); return fv; }
+
   fType get_fType() const {return field_type;}
   bool get_isNull() const {return is_null;}
   std::string get_asString() const;
@@ -123,6 +146,7 @@ public:
   field_value& operator= (const int64_t i)
     {set_asInt64(i); return *this;}
   field_value& operator= (const field_value & fv);
+  field_value& operator= (field_value && fv);
   
   //class ostream;
   friend std::ostream& operator<< (std::ostream& os, const field_value &fv)
@@ -174,9 +198,10 @@ public:
   }
   }
 
-  void set_isNull(){is_null=true;}
+  void set_isNull(bool null = true){is_null=null;}
   void set_asString(const char *s);
   void set_asString(const std::string & s);
+  void set_asString(const char *s, size_t len);
   void set_asBool(const bool b);
   void set_asChar(const char c);
   void set_asShort(const short s);
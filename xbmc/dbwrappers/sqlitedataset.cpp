@@ -38,6 +38,8 @@
 #include "linux/XTimeUtils.h"
 #endif
 
+#define STATEMENT_CACHE_SIZE 32  // Maximum number of cached prepared statements per connection
+
 namespace dbiplus {
 //************* Callback function ***************************
 
@@ -77,6 +79,79 @@ int callback(void* res_ptr,int ncol, char** result,char** cols)
   return 0;  
 }
 
+static void fill_record(sqlite3_stmt *stmt, sql_record &rec)
+{
+  const unsigned int numColumns = rec.size();
+  for (unsigned int i = 0; i < numColumns; i++)
+  {
+    field_value &v = rec[i];
+    v.set_isNull(false);
+    switch (sqlite3_column_type(stmt, i))
+    {
+    case SQLITE_INTEGER:
+      v.set_asInt64(sqlite3_column_int64(stmt, i));
+      break;
+    case SQLITE_FLOAT:
+      v.set_asDouble(sqlite3_column_double(stmt, i));
+      break;
+    case SQLITE_TEXT:
+    case SQLITE_BLOB:
+    {
+      // sqlite3_column_bytes() must follow sqlite3_column_text() to get the text length
+      const char *text = (const char *)sqlite3_column_text(stmt, i);
+      v.set_asString(text, sqlite3_column_bytes(stmt, i));
+      break;
+    }
+    case SQLITE_NULL:
+    default:
+      v.set_asString("");
+      v.set_isNull();
+      break;
+    }
+  }
+}
+
+static int bind_record(sqlite3_stmt *stmt, const sql_record &params)
+{
+  if (sqlite3_bind_parameter_count(stmt) != (int)params.size())
+    return SQLITE_RANGE;
+
+  for (unsigned int i = 0; i < params.size(); i++)
+  {
+    const field_value &v = params[i];
+    int rc;
+    if (v.get_isNull())
+      rc = sqlite3_bind_null(stmt, i + 1);
+    else
+    {
+      switch (v.get_fType())
+      {
+      case ft_Boolean:
+      case ft_Short:
+      case ft_UShort:
+      case ft_Int:
+      case ft_UInt:
+      case ft_Int64:
+        rc = sqlite3_bind_int64(stmt, i + 1, v.get_asInt64());
+        break;
+      case ft_Float:
+      case ft_Double:
+        rc = sqlite3_bind_double(stmt, i + 1, v.get_asDouble());
+        break;
+      default:
+      {
+        const std::string str = v.get_asString();
+        rc = sqlite3_bind_text(stmt, i + 1, str.c_str(), str.size(), SQLITE_TRANSIENT);
+        break;
+      }
+      }
+    }
+    if (rc != SQLITE_OK)
+      return rc;
+  }
+  return SQLITE_OK;
+}
+
 static int busy_callback(void*, int busyCount)
 {
   Sleep(100);
@@ -257,6 +332,7 @@ bool SqliteDatabase::exists(void)
 
 void SqliteDatabase::disconnect(void) {
   if (active == false) return;
+  clear_statements();
   sqlite3_close(conn);
   active = false;
 }
@@ -412,6 +488,46 @@ void SqliteDatabase::rollback_transaction() {
 }
 
 
+// methods for prepared statements
+// ---------------------------------------------
+sqlite3_stmt *SqliteDatabase::get_statement(const std::string &sql) {
+  if (!active) throw DbErrors("No Database Connection");
+
+  std::map<std::string, StatementList::iterator>::iterator it = statement_index.find(sql);
+  if (it != statement_index.end())
+  {
+    // move to the front of the least recently used list
+    statements.splice(statements.begin(), statements, it->second);
+    return it->second->second;
+  }
+
+  sqlite3_stmt *stmt = NULL;
+  if (setErr(sqlite3_prepare_v2(conn, sql.c_str(), -1, &stmt, NULL), sql.c_str()) != SQLITE_OK)
+    throw DbErrors(getErrorMsg());
+  if (stmt == NULL)
+    throw DbErrors("Empty statement: %s", sql.c_str());
+
+  statements.push_front(std::make_pair(sql, stmt));
+  statement_index[sql] = statements.begin();
+
+  if (statements.size() > STATEMENT_CACHE_SIZE)
+  {
+    sqlite3_finalize(statements.back().second);
+    statement_index.erase(statements.back().first);
+    statements.pop_back();
+  }
+
+  return stmt;
+}
+
+void SqliteDatabase::clear_statements() {
+  for (StatementList::iterator it = statements.begin(); it != statements.end(); ++it)
+    sqlite3_finalize(it->second);
+  statements.clear();
+  statement_index.clear();
+}
+
+
 // methods for formatting
 // ---------------------------------------------
 std::string SqliteDatabase::vprepare(const char *format, va_list args)
@@ -449,6 +565,8 @@ std::string SqliteDatabase::vprepare(const char *format, va_list args)
 SqliteDataset::SqliteDataset():Dataset() {
   haveError = false;
   db = NULL;
+  cursor_stmt = NULL;
+  cursor_rows = 0;
   errmsg = NULL;
   autorefresh = false;
 }
@@ -457,11 +575,14 @@ SqliteDataset::SqliteDataset():Dataset() {
 SqliteDataset::SqliteDataset(SqliteDatabase *newDb):Dataset(newDb) {
   haveError = false;
   db = newDb;
+  cursor_stmt = NULL;
+  cursor_rows = 0;
   errmsg = NULL;
   autorefresh = false;
 }
 
  SqliteDataset::~SqliteDataset(){
+   if (cursor_stmt) sqlite3_finalize(cursor_stmt);
    if (errmsg) sqlite3_free(errmsg);
  }
 
@@ -627,6 +748,26 @@ int SqliteDataset::exec(const std::string &sql) {
     }
 }
 
+int SqliteDataset::exec_prepared(const std::string &sql, const sql_record &params) {
+  if (!handle()) throw DbErrors("No Database Connection");
+  exec_res.clear();
+
+  sqlite3_stmt *stmt = static_cast<SqliteDatabase*>(db)->get_statement(sql);
+  int res = bind_record(stmt, params);
+  if (res == SQLITE_OK)
+  {
+    res = sqlite3_step(stmt);
+    if (res == SQLITE_DONE || res == SQLITE_ROW)
+      res = SQLITE_OK;
+  }
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  if (db->setErr(res, sql.c_str()) != SQLITE_OK)
+    throw DbErrors(db->getErrorMsg());
+  return res;
+}
+
 int SqliteDataset::exec() {
   return exec(sql);
 }
@@ -650,6 +791,49 @@ bool SqliteDataset::query(const std::string &query) {
   if (db->setErr(sqlite3_prepare_v2(handle(),query.c_str(),-1,&stmt, NULL),query.c_str()) != SQLITE_OK)
     throw DbErrors(db->getErrorMsg());
 
+  read_result(stmt);
+  if (db->setErr(sqlite3_finalize(stmt),query.c_str()) == SQLITE_OK)
+  {
+    active = true;
+    ds_state = dsSelect;
+    this->first();
+    return true;
+  }
+  else
+  {
+    throw DbErrors(db->getErrorMsg());
+  }  
+}
+
+bool SqliteDataset::query_prepared(const std::string &query, const sql_record &params) {
+  if(!handle()) throw DbErrors("No Database Connection");
+  if (query.find("select") == std::string::npos && query.find("SELECT") == std::string::npos)
+    throw DbErrors("MUST be select SQL!");
+
+  close();
+
+  sqlite3_stmt *stmt = static_cast<SqliteDatabase*>(db)->get_statement(query);
+  int res = bind_record(stmt, params);
+  if (res == SQLITE_OK)
+  {
+    read_result(stmt);
+    // reset reports any error of the last step
+    res = sqlite3_reset(stmt);
+  }
+  else
+    sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  if (db->setErr(res, query.c_str()) != SQLITE_OK)
+    throw DbErrors(db->getErrorMsg());
+
+  active = true;
+  ds_state = dsSelect;
+  this->first();
+  return true;
+}
+
+void SqliteDataset::read_result(sqlite3_stmt *stmt) {
   // column headers
   const unsigned int numColumns = sqlite3_column_count(stmt);
   result.record_header.resize(numColumns);
@@ -661,43 +845,59 @@ bool SqliteDataset::query(const std::string &query) {
   { // have a row of data
     sql_record *res = new sql_record;
     res->resize(numColumns);
-    for (unsigned int i = 0; i < numColumns; i++)
-    {
-      field_value &v = res->at(i);
-      switch (sqlite3_column_type(stmt, i))
-      {
-      case SQLITE_INTEGER:
-        v.set_asInt64(sqlite3_column_int64(stmt, i));
-        break;
-      case SQLITE_FLOAT:
-        v.set_asDouble(sqlite3_column_double(stmt, i));
-        break;
-      case SQLITE_TEXT:
-        v.set_asString((const char *)sqlite3_column_text(stmt, i));
-        break;
-      case SQLITE_BLOB:
-        v.set_asString((const char *)sqlite3_column_text(stmt, i));
-        break;
-      case SQLITE_NULL:
-      default:
-        v.set_asString("");
-        v.set_isNull();
-        break;
-      }
-    }
+    fill_record(stmt, *res);
     result.records.push_back(res);
   }
-  if (db->setErr(sqlite3_finalize(stmt),query.c_str()) == SQLITE_OK)
+}
+
+bool SqliteDataset::query_cursor(const std::string &query) {
+  if(!handle()) throw DbErrors("No Database Connection");
+  if (query.find("select") == std::string::npos && query.find("SELECT") == std::string::npos)
+    throw DbErrors("MUST be select SQL!");
+
+  close();
+
+  if (db->setErr(sqlite3_prepare_v2(handle(),query.c_str(),-1,&cursor_stmt, NULL),query.c_str()) != SQLITE_OK)
+    throw DbErrors(db->getErrorMsg());
+
+  // column headers
+  const unsigned int numColumns = sqlite3_column_count(cursor_stmt);
+  result.record_header.resize(numColumns);
+  for (unsigned int i = 0; i < numColumns; i++)
+    result.record_header[i].name = sqlite3_column_name(cursor_stmt, i);
+
+  // a single record is reused for every row stepped through
+  result.records.push_back(new sql_record(numColumns));
+
+  active = true;
+  forward_only = true;
+  ds_state = dsSelect;
+  frecno = 0;
+  fbof = feof = !fetch_cursor_row();
+  if (!feof)
+    fill_fields();
+  return true;
+}
+
+bool SqliteDataset::fetch_cursor_row() {
+  if (!cursor_stmt)
+    return false;
+
+  int rc = sqlite3_step(cursor_stmt);
+  if (rc == SQLITE_ROW)
   {
-    active = true;
-    ds_state = dsSelect;
-    this->first();
+    fill_record(cursor_stmt, *result.records[0]);
+    cursor_rows++;
     return true;
   }
-  else
-  {
+
+  // exhausted (or failed), release the statement right away
+  std::string query = sqlite3_sql(cursor_stmt);
+  rc = sqlite3_finalize(cursor_stmt);
+  cursor_stmt = NULL;
+  if (db->setErr(rc, query.c_str()) != SQLITE_OK)
     throw DbErrors(db->getErrorMsg());
-  }  
+  return false;
 }
 
 void SqliteDataset::open(const std::string &sql) {
@@ -716,6 +916,12 @@ void SqliteDataset::open() {
 
 
 void SqliteDataset::close() {
+  if (cursor_stmt)
+  {
+    sqlite3_finalize(cursor_stmt);
+    cursor_stmt = NULL;
+  }
+  cursor_rows = 0;
   Dataset::close();
   result.clear();
   edit_object->clear();
@@ -736,6 +942,8 @@ void SqliteDataset::cancel() {
 
 
 int SqliteDataset::num_rows() {
+  if (forward_only)
+    return cursor_rows;
   return result.records.size();
 }
 
@@ -751,21 +959,40 @@ bool SqliteDataset::bof() {
 
 
 void SqliteDataset::first() {
+  if (forward_only)
+  {
+    if (cursor_rows > 1)
+      throw DbErrors("Can't rewind a forward-only dataset");
+    return;
+  }
   Dataset::first();
   this->fill_fields();
 }
 
 void SqliteDataset::last() {
+  if (forward_only) throw DbErrors("Can't seek in a forward-only dataset");
   Dataset::last();
   fill_fields();
 }
 
 void SqliteDataset::prev(void) {
+  if (forward_only) throw DbErrors("Can't seek in a forward-only dataset");
   Dataset::prev();
   fill_fields();
 }
 
 void SqliteDataset::next(void) {
+  if (forward_only)
+  {
+    if (ds_state == dsSelect && !feof)
+    {
+      fbof = false;
+      feof = !fetch_cursor_row();
+      if (!feof)
+        fill_fields();
+    }
+    return;
+  }
   Dataset::next();
   if (!eof()) 
       fill_fields();
@@ -785,6 +1012,7 @@ void SqliteDataset::free_row(void)
 }
 
 bool SqliteDataset::seek(int pos) {
+  if (forward_only) throw DbErrors("Can't seek in a forward-only dataset");
   if (ds_state == dsSelect) {
     Dataset::seek(pos);
     fill_fields();
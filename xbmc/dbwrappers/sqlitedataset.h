@@ -45,6 +45,11 @@ protected:
   bool _in_transaction;
   int last_err;
 
+/* prepared statements keyed by their SQL, most recently used first */
+  typedef std::list<std::pair<std::string, sqlite3_stmt*> > StatementList;
+  StatementList statements;
+  std::map<std::string, StatementList::iterator> statement_index;
+
 public:
 /* default constructor */
   SqliteDatabase();
@@ -96,6 +101,11 @@ public:
 
   bool in_transaction() {return _in_transaction;}; 	
 
+/* func. returns the cached prepared statement for sql, preparing it if needed */
+  sqlite3_stmt *get_statement(const std::string &sql);
+/* func. finalizes all cached prepared statements */
+  void clear_statements();
+
 };
 
 
@@ -110,6 +120,15 @@ class SqliteDataset : public Dataset {
 protected:
   sqlite3* handle();
 
+/* statement of an open forward-only cursor */
+  sqlite3_stmt *cursor_stmt;
+/* number of rows fetched through the cursor */
+  int cursor_rows;
+/* steps the cursor into the reused record, returns false when exhausted */
+  bool fetch_cursor_row();
+/* reads the column headers and all rows of stmt into the result set */
+  void read_result(sqlite3_stmt *stmt);
+
 /* Makes direct queries to database */
   virtual void make_query(StringList &_sql);
 /* Makes direct inserts into database */
@@ -145,9 +164,13 @@ or insert() operations default = false) */
 /* func. executes a query without results to return */
   virtual int  exec ();
   virtual int  exec (const std::string &sql);
+  virtual int  exec_prepared(const std::string &sql, const sql_record &params);
   virtual const void* getExecRes();
 /* as open, but with our query exec Sql */
   virtual bool query(const std::string &query);
+  virtual bool query_prepared(const std::string &query, const sql_record &params);
+/* as query, but steps sqlite3_step lazily on next() */
+  virtual bool query_cursor(const std::string &query);
 /* func. closes a query */
   virtual void close(void);
 /* Cancel changes, made in insert or edit states of dataset */
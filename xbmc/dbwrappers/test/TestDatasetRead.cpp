@@ -0,0 +1,212 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "dbwrappers/qry_dat.h"
+#include "dbwrappers/sqlitedataset.h"
+#include "filesystem/File.h"
+#include "test/TestUtils.h"
+#include "utils/Stopwatch.h"
+#include "utils/URIUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace dbiplus;
+
+#define BENCHMARK_ROWS 100000
+
+TEST(TestFieldValue, Size)
+{
+  // the type tag and flags share the padding of the inline string buffer
+  EXPECT_LE(sizeof(field_value), 24u);
+}
+
+TEST(TestFieldValue, Strings)
+{
+  const std::string shortString("short");
+  const std::string longString("a string that does not fit the inline buffer");
+
+  field_value a(shortString);
+  EXPECT_EQ(ft_String, a.get_fType());
+  EXPECT_EQ(shortString, a.get_asString());
+
+  field_value b(longString);
+  EXPECT_EQ(longString, b.get_asString());
+
+  // reusing a heap buffer for a shorter value
+  b.set_asString(shortString);
+  EXPECT_EQ(shortString, b.get_asString());
+  b.set_asString(longString + longString);
+  EXPECT_EQ(longString + longString, b.get_asString());
+
+  field_value c(b);
+  EXPECT_EQ(b.get_asString(), c.get_asString());
+  c = a;
+  EXPECT_EQ(shortString, c.get_asString());
+  c = b;
+  EXPECT_EQ(b.get_asString(), c.get_asString());
+
+  field_value d(std::move(c));
+  EXPECT_EQ(b.get_asString(), d.get_asString());
+  EXPECT_EQ("", c.get_asString());
+
+  // embedded nulls survive a copy
+  const std::string binary("a\0b", 3);
+  field_value e(binary);
+  EXPECT_EQ(binary, field_value(e).get_asString());
+}
+
+TEST(TestFieldValue, Conversions)
+{
+  field_value v("42");
+  EXPECT_EQ(42, v.get_asInt());
+  EXPECT_EQ(42, v.get_asInt64());
+  EXPECT_DOUBLE_EQ(42.0, v.get_asDouble());
+  EXPECT_FALSE(v.get_asBool());
+
+  v.set_asString("true");
+  EXPECT_TRUE(v.get_asBool());
+
+  v.set_asString("a long string that ends up on the heap");
+  v.set_asInt64(1234567890123LL);
+  EXPECT_EQ(ft_Int64, v.get_fType());
+  EXPECT_EQ("1234567890123", v.get_asString());
+
+  v.set_asDouble(2.5);
+  EXPECT_EQ(2, v.get_asInt());
+
+  field_value n = field_value::null_value();
+  EXPECT_TRUE(n.get_isNull());
+  field_value m(n);
+  EXPECT_TRUE(m.get_isNull());
+}
+
+class TestDatasetRead : public testing::Test
+{
+protected:
+  TestDatasetRead()
+  {
+    m_tempFile = XBMC_CREATETEMPFILE(".db");
+    m_tempFile->Close();
+
+    m_db.reset(new SqliteDatabase());
+    m_db->setHostName(CXBMCTestUtils::Instance().TempFileDirectory(m_tempFile).c_str());
+    m_db->setDatabase(URIUtils::GetFileName(XBMC_TEMPFILEPATH(m_tempFile)).c_str());
+    m_db->connect(true);
+  }
+
+  ~TestDatasetRead()
+  {
+    m_db->disconnect();
+    XBMC_DELETETEMPFILE(m_tempFile);
+  }
+
+  /*! \brief Fill a table shaped like a trimmed down movie_view */
+  void CreateMovies(int rows)
+  {
+    std::unique_ptr<Dataset> ds(m_db->CreateDataset());
+    ds->exec("CREATE TABLE movie (idMovie INTEGER PRIMARY KEY, c00 TEXT, c01 TEXT, c05 REAL, "
+             "c07 TEXT, strPath TEXT, playCount INTEGER, lastPlayed TEXT)");
+    m_db->start_transaction();
+    for (int i = 0; i < rows; i++)
+    {
+      ds->exec_prepared("INSERT INTO movie VALUES (NULL, ?, ?, ?, ?, ?, ?, ?)",
+                        { "Movie " + std::to_string(i),
+                          "A plot outline that is long enough to be kept outside of the inline buffer",
+                          7.5,
+                          std::to_string(1950 + i % 70),
+                          "/storage/movies/" + std::to_string(i) + "/",
+                          i % 3 == 0 ? field_value::null_value() : field_value(i % 5),
+                          "2016-01-01 12:00:00" });
+    }
+    m_db->commit_transaction();
+  }
+
+  /*! \brief Approximate memory held by one record of the result set */
+  static size_t RecordBytes(const sql_record &record)
+  {
+    size_t bytes = sizeof(sql_record) + record.capacity() * sizeof(field_value);
+    for (const auto &field : record)
+    {
+      if (field.get_fType() == ft_String)
+      {
+        size_t length = field.get_asString().size();
+        if (length >= 16)
+          bytes += length + 1;
+      }
+    }
+    return bytes;
+  }
+
+  XFILE::CFile *m_tempFile;
+  std::unique_ptr<SqliteDatabase> m_db;
+};
+
+// Reads BENCHMARK_ROWS movies buffered and through a cursor. Run with
+// --gtest_also_run_disabled_tests.
+TEST_F(TestDatasetRead, DISABLED_Benchmark)
+{
+  CreateMovies(BENCHMARK_ROWS);
+
+  std::unique_ptr<Dataset> ds(m_db->CreateDataset());
+  CStopWatch timer;
+
+  timer.StartZero();
+  ASSERT_TRUE(ds->query("SELECT * FROM movie"));
+  ASSERT_EQ(BENCHMARK_ROWS, ds->num_rows());
+  int64_t sum = 0;
+  while (!ds->eof())
+  {
+    const sql_record *record = ds->get_sql_record();
+    sum += record->at(0).get_asInt() + record->at(6).get_asInt();
+    ds->next();
+  }
+  float elapsed = timer.GetElapsedSeconds();
+  EXPECT_GT(sum, 0);
+
+  size_t bytes = 0;
+  for (ds->first(); !ds->eof(); ds->next())
+    bytes += RecordBytes(*ds->get_sql_record());
+  ds->close();
+
+  std::cout << "query: " << (int)(BENCHMARK_ROWS / elapsed) << " rows/sec, "
+            << bytes / BENCHMARK_ROWS << " bytes/row" << std::endl;
+
+  timer.StartZero();
+  ASSERT_TRUE(ds->query_cursor("SELECT * FROM movie"));
+  int rows = 0;
+  while (!ds->eof())
+  {
+    const sql_record *record = ds->get_sql_record();
+    sum -= record->at(0).get_asInt() + record->at(6).get_asInt();
+    rows++;
+    ds->next();
+  }
+  elapsed = timer.GetElapsedSeconds();
+  ds->close();
+  EXPECT_EQ(BENCHMARK_ROWS, rows);
+  EXPECT_EQ(0, sum);
+
+  std::cout << "cursor: " << (int)(BENCHMARK_ROWS / elapsed) << " rows/sec" << std::endl;
+}
@@ -25,15 +25,19 @@
 #include "filesystem/Directory.h"
 #include "profiles/ProfilesManager.h"
 #include "settings/AdvancedSettings.h"
-#include "settings/Settings.h"
 #include "utils/IDeserializable.h"
 #include "utils/ISerializable.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
 #include "utils/Variant.h"
-#include "utils/Vector.h"
-#include "music/MusicDatabase.h"
+#include "linux/XTimeUtils.h"
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <set>
 #include <vector>
 #include <string>
 
@@ -43,6 +47,12 @@
 #define MYSQLUSER "root"
 #define MYSQLPASS "xbmc"
 
+// Number of gnomes imported by the AddObject() vs AddObjects() benchmark
+#define BENCHMARK_GNOMES 50000
+
+// Number of gnomes normalized in the background, several chunks worth
+#define NORMALIZE_GNOMES 2000
+
 using namespace XFILE;
 using namespace std;
 
@@ -127,24 +137,20 @@ public:
 
   virtual ~CGnomeDatabase() = default;
 
-  virtual int GetMinVersion() const override { return 1; }
+  virtual int GetSchemaVersion() const override { return 1; }
   virtual const char *GetBaseDBName() const override { return "MyGnomes"; }
 
-  virtual bool CreateTables() override
+  // Connect to the versioned database (MyGnomes1), creating it if it doesn't exist
+  bool Create(const DatabaseSettings &dbs)
   {
-    try
-    {
-      BeginTransaction();
-      if (!CDenormalizedDatabase::CreateTables())
-        return false;
-      CommitTransaction();
-      return true;
-    }
-    catch (dbiplus::DbErrors)
+    DatabaseSettings settings = dbs;
+    if (settings.type.empty())
     {
-      RollbackTransaction();
+      settings.type = "sqlite3";
+      settings.host = CSpecialProtocol::TranslatePath(CProfilesManager::GetInstance().GetDatabaseFolder());
     }
-    return false;
+    m_sqlite = (settings.type == "sqlite3");
+    return Connect(StringUtils::Format("%s%d", GetBaseDBName(), GetSchemaVersion()), settings, true);
   }
 
   /* Gnome uniqueness is quantified by their name and garden. */
@@ -159,7 +165,7 @@ public:
     if (!IsValid(object))
       return false;
 
-    CStdString strSQL = PrepareSQL(
+    std::string strSQL = PrepareSQL(
       "SELECT idGnome "
       "FROM gnome JOIN garden ON garden.idgarden=gnome.idgarden "
       "WHERE name='%s' AND garden='%s'",
@@ -194,7 +200,7 @@ public:
   {
     try
     {
-      auto_ptr<dbiplus::Dataset> pDS(m_pDB->CreateDataset());
+      std::unique_ptr<dbiplus::Dataset> pDS(m_pDB->CreateDataset());
       if (pDS->query("SELECT idGnome FROM Gnome"))
         while (!pDS->eof())
         { DeleteObjectByID(pDS->fv(0).get_asInt()); pDS->next(); }
@@ -207,46 +213,106 @@ public:
     }
   }
 
+  // Empty the tables in one go, DeleteObjectByID() looks for orphans one object at a time
+  void TruncateGnomeDatabase()
+  {
+    m_pDS->exec("DELETE FROM gnomelinkplacestraveled");
+    m_pDS->exec("DELETE FROM gnome");
+    m_pDS->exec("DELETE FROM garden");
+    m_pDS->exec("DELETE FROM placestraveled");
+  }
+
   void DropGnomeDatabase()
   {
     assert(!m_sqlite);
     m_pDS->exec("DROP DATABASE IF EXISTS MyGnomes1");
   }
 
+  // Tables and indices of the database, without the ones the engine adds itself
+  bool GetAllTables(vector<string> &tableList)
+  {
+    return GetNames(m_sqlite ? "SELECT name FROM sqlite_master WHERE type='table'" :
+                               "SELECT table_name FROM information_schema.tables WHERE table_schema=DATABASE()", tableList);
+  }
+
+  bool GetAllIndices(vector<string> &indexList)
+  {
+    return GetNames(m_sqlite ? "SELECT name FROM sqlite_master WHERE type='index'" :
+                               "SELECT DISTINCT index_name FROM information_schema.statistics "
+                               "WHERE table_schema=DATABASE() AND index_name<>'PRIMARY'", indexList);
+  }
+
   // Remap to public
-  virtual bool Update(const DatabaseSettings &dbs) override { return CDatabase::Update(dbs); }
-  virtual bool GetAllTables(vector<CStdString> &tableList) override { return CDatabase::GetAllTables(tableList); }
-  virtual bool GetAllIndices(vector<CStdString> &indexList) override { return CDatabase::GetAllIndices(indexList); }
-  virtual void AddIndex(const char *column, const char *type) override { CDenormalizedDatabase::AddIndex(column, type); }
-  virtual void AddOneToMany(const char *column, const char *type, bool index) override { CDenormalizedDatabase::AddOneToMany(column, type, index); }
-  virtual void AddManyToMany(const char *column, const char *type, bool index) override { CDenormalizedDatabase::AddManyToMany(column, type, index); }
-  virtual void DropIndex(const char *column) override { CDenormalizedDatabase::DropIndex(column); }
-  virtual void DropOneToMany(const char *column) override { CDenormalizedDatabase::DropOneToMany(column); }
-  virtual void DropManyToMany(const char *column) override { CDenormalizedDatabase::DropManyToMany(column); }
+  using CDenormalizedDatabase::AddIndex;
+  using CDenormalizedDatabase::AddOneToMany;
+  using CDenormalizedDatabase::AddManyToMany;
+  using CDenormalizedDatabase::DropIndex;
+  using CDenormalizedDatabase::DropOneToMany;
+  using CDenormalizedDatabase::DropManyToMany;
+
+private:
+  bool GetNames(const char *query, vector<string> &names)
+  {
+    try
+    {
+      if (!m_pDS->query(query))
+        return false;
+      while (!m_pDS->eof())
+      {
+        string name = m_pDS->fv(0).get_asString();
+        if (!StringUtils::StartsWith(name, "sqlite_"))
+          names.push_back(name);
+        m_pDS->next();
+      }
+      m_pDS->close();
+      return true;
+    }
+    catch (...)
+    {
+      return false;
+    }
+  }
 };
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // Test procedures
 void runTests(CGnomeDatabase &db);
-bool has(const vector<CStdString> &haystack, const CStdString &needle)
+bool has(const vector<string> &haystack, const string &needle)
 {
   return find(haystack.begin(), haystack.end(), needle) != haystack.end();
 }
 
+set<string> labels(CFileItemList &items)
+{
+  set<string> result;
+  for (int i = 0; i < items.Size(); i++)
+    result.insert(items[i]->GetLabel());
+  return result;
+}
+
+// Wait for the background job to normalize the relations added so far
+void waitForNormalize(CGnomeDatabase &db)
+{
+  unsigned int progress, total;
+  for (int i = 0; i < 3000 && db.GetNormalizeProgress(progress, total); i++)
+    Sleep(10);
+  ASSERT_FALSE(db.GetNormalizeProgress(progress, total));
+}
+
 TEST(TestDenormalizedDatabase, DenormalizedDatabaseSQLite)
 {
   // Create the Database folder if it wasn't done in the setup process
-  if (!CDirectory::Exists(CProfilesManager::Get().GetDatabaseFolder()))
-    CDirectory::Create(CProfilesManager::Get().GetDatabaseFolder());
+  if (!CDirectory::Exists(CProfilesManager::GetInstance().GetDatabaseFolder()))
+    CDirectory::Create(CProfilesManager::GetInstance().GetDatabaseFolder());
 
   // Calling Update creates the database if it doesn't exist
   CGnomeDatabase db;
-  EXPECT_TRUE(db.Update(DatabaseSettings()));
+  EXPECT_TRUE(db.Create(DatabaseSettings()));
 
   EXPECT_NO_FATAL_FAILURE(runTests(db));
 
-  CDirectory::Remove(CProfilesManager::Get().GetDatabaseFolder());
+  CDirectory::Remove(CProfilesManager::GetInstance().GetDatabaseFolder());
 }
 
 TEST(TestDenormalizedDatabase, DenormalizedDatabaseMySQL)
@@ -262,7 +328,7 @@ TEST(TestDenormalizedDatabase, DenormalizedDatabaseMySQL)
   CGnomeDatabase db;
 
   // Only test MySQL if we have a valid connection
-  if (!db.Update(dbs))
+  if (!db.Create(dbs))
   {
     cout << "Can't connect to MySQL, skipping tests. Fix params in TestDenormalizedDatabase.cpp" << endl;
     return;
@@ -273,22 +339,181 @@ TEST(TestDenormalizedDatabase, DenormalizedDatabaseMySQL)
   EXPECT_NO_THROW(db.DropGnomeDatabase());
 }
 
+// Compares AddObject() and AddObjects() on BENCHMARK_GNOMES gnomes. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestDenormalizedDatabase, DISABLED_AddObjectsBenchmark)
+{
+  if (!CDirectory::Exists(CProfilesManager::GetInstance().GetDatabaseFolder()))
+    CDirectory::Create(CProfilesManager::GetInstance().GetDatabaseFolder());
+
+  CGnomeDatabase db;
+  ASSERT_TRUE(db.Create(DatabaseSettings()));
+  ASSERT_TRUE(db.ClearGnomeDatabase());
+
+  // Few gardens and places shared by many gnomes, like genres or studios
+  vector<CLawnGnome> gnomes;
+  for (int i = 0; i < BENCHMARK_GNOMES; i++)
+  {
+    CLawnGnome gnome(StringUtils::Format("Gnome %d", i), StringUtils::Format("Garden %d", i % 100), i % 10);
+    gnome.TravelTo(StringUtils::Format("Place %d", i % 250));
+    gnome.TravelTo(StringUtils::Format("Place %d", i % 7));
+    gnomes.push_back(gnome);
+  }
+
+  CStopWatch timer;
+  timer.StartZero();
+  db.BeginTransaction();
+  for (vector<CLawnGnome>::const_iterator it = gnomes.begin(); it != gnomes.end(); it++)
+    db.AddObject(&*it);
+  db.CommitTransaction();
+  float single = timer.GetElapsedSeconds();
+  EXPECT_EQ(db.Count(), BENCHMARK_GNOMES);
+  db.TruncateGnomeDatabase();
+
+  vector<const ISerializable*> objects;
+  for (vector<CLawnGnome>::const_iterator it = gnomes.begin(); it != gnomes.end(); it++)
+    objects.push_back(&*it);
+  vector<int> ids;
+
+  timer.StartZero();
+  EXPECT_TRUE(db.AddObjects(objects, ids));
+  float bulk = timer.GetElapsedSeconds();
+  EXPECT_EQ(db.Count(), BENCHMARK_GNOMES);
+  EXPECT_EQ(db.Count("garden"), 100);
+  EXPECT_EQ(db.Count("placestraveled"), 250);
+  EXPECT_EQ(ids.size(), gnomes.size());
+  EXPECT_TRUE(find(ids.begin(), ids.end(), -1) == ids.end());
+
+  CLawnGnome gnome;
+  EXPECT_TRUE(db.GetObjectByID(ids.back(), &gnome));
+  EXPECT_EQ(gnome.m_name, gnomes.back().m_name);
+  EXPECT_EQ(gnome.m_placesTraveled.size(), 2);
+
+  cout << "AddObject: " << (int)(BENCHMARK_GNOMES / single) << " objects/sec, "
+       << "AddObjects: " << (int)(BENCHMARK_GNOMES / bulk) << " objects/sec" << endl;
+
+  db.TruncateGnomeDatabase();
+  CDirectory::Remove(CProfilesManager::GetInstance().GetDatabaseFolder());
+}
+
+TEST(TestDenormalizedDatabase, ReadsDuringNormalize)
+{
+  if (!CDirectory::Exists(CProfilesManager::GetInstance().GetDatabaseFolder()))
+    CDirectory::Create(CProfilesManager::GetInstance().GetDatabaseFolder());
+
+  CGnomeDatabase db;
+  ASSERT_TRUE(db.Create(DatabaseSettings()));
+  ASSERT_TRUE(db.ClearGnomeDatabase());
+
+  vector<CLawnGnome> gnomes;
+  map<string, set<string> > gardenGnomes; // garden -> names of its gnomes
+  map<string, set<string> > gardenPlaces; // garden -> places its gnomes traveled to
+  for (int i = 0; i < NORMALIZE_GNOMES; i++)
+  {
+    CLawnGnome gnome(StringUtils::Format("Gnome %d", i), StringUtils::Format("Garden %d", i % 10), i % 10);
+    gnome.TravelTo(StringUtils::Format("Place %d", i % 13));
+    gnomes.push_back(gnome);
+    gardenGnomes[gnome.m_gardenName].insert(gnome.m_name);
+    gardenPlaces[gnome.m_gardenName].insert(gnome.m_placesTraveled[0]);
+  }
+
+  // A gnome no other gnome shares anything with
+  CLawnGnome lonely("Lonely", "Lonely Garden", 0);
+  lonely.TravelTo("Nowhere");
+  gnomes.push_back(lonely);
+
+  vector<const ISerializable*> objects;
+  for (vector<CLawnGnome>::const_iterator it = gnomes.begin(); it != gnomes.end(); it++)
+    objects.push_back(&*it);
+  vector<int> ids;
+  ASSERT_TRUE(db.AddObjects(objects, ids));
+
+  // Re-adding the relations leaves every gnome to the normalizer, which is
+  // started when the transaction is committed
+  EXPECT_NO_THROW(db.DropManyToMany("placestraveled"));
+  EXPECT_NO_THROW(db.DropOneToMany("garden"));
+  db.BeginTransaction();
+  EXPECT_NO_THROW(db.AddOneToMany("garden", "VARCHAR(512)", true));
+  EXPECT_NO_THROW(db.AddManyToMany("placestraveled", "TEXT", false));
+
+  // The items exist before the gnomes have been linked to them
+  int idGarden = -1;
+  CFileItemList items;
+  EXPECT_TRUE(db.GetItemID("garden", "Garden 1", idGarden));
+  EXPECT_TRUE(db.GetItemNav("garden", items, ""));
+  EXPECT_EQ(items.Size(), gardenGnomes.size() + 1);
+  EXPECT_EQ(db.Count("garden"), gardenGnomes.size() + 1);
+  EXPECT_EQ(db.Count("placestraveled"), 14);
+  items.Clear();
+  EXPECT_TRUE(db.GetObjectsNav(items));
+  EXPECT_EQ(items.Size(), NORMALIZE_GNOMES + 1);
+
+  // Gnomes added now are linked right away. Deleting one must keep the items
+  // it shares with gnomes that aren't linked yet.
+  CLawnGnome late("Late", "Garden 1", 0);
+  late.TravelTo("Place 1");
+  int idLate = db.AddObject(&late);
+  EXPECT_NE(idLate, -1);
+  EXPECT_TRUE(db.DeleteObjectByID(idLate));
+
+  // Deleting a gnome that isn't linked yet must delete the items only it has
+  EXPECT_TRUE(db.DeleteObjectByID(ids.back()));
+  EXPECT_FALSE(db.GetItemID("garden", "Lonely Garden", idGarden));
+  EXPECT_EQ(db.Count("garden"), gardenGnomes.size());
+  EXPECT_EQ(db.Count("placestraveled"), 13);
+  db.CommitTransaction();
+
+  // While the job works through the gnomes, every garden leads to all of its
+  // gnomes and places, whether they have been normalized or not
+  unsigned int progress, total;
+  bool normalizing = true;
+  for (int i = 0; i < 3000 && normalizing; i++)
+  {
+    normalizing = db.GetNormalizeProgress(progress, total);
+
+    EXPECT_EQ(db.Count("garden"), gardenGnomes.size());
+    EXPECT_EQ(db.Count("placestraveled"), 13);
+
+    for (map<string, set<string> >::const_iterator it = gardenGnomes.begin(); it != gardenGnomes.end(); ++it)
+    {
+      ASSERT_TRUE(db.GetItemID("garden", it->first, idGarden));
+      map<string, int> predicates;
+      predicates["garden"] = idGarden;
+
+      CFileItemList gardenItems, placeItems;
+      EXPECT_TRUE(db.GetObjectsNav(gardenItems, predicates));
+      EXPECT_EQ(labels(gardenItems), it->second);
+
+      EXPECT_TRUE(db.GetItemNav("placestraveled", placeItems, "", predicates));
+      EXPECT_EQ(labels(placeItems), gardenPlaces[it->first]);
+    }
+    Sleep(1);
+  }
+  EXPECT_FALSE(normalizing);
+  EXPECT_EQ(db.Count("garden"), gardenGnomes.size());
+  EXPECT_EQ(db.Count("placestraveled"), 13);
+
+  EXPECT_TRUE(db.ClearGnomeDatabase());
+  CDirectory::Remove(CProfilesManager::GetInstance().GetDatabaseFolder());
+}
+
 void runTests(CGnomeDatabase &db)
 {
   ASSERT_TRUE(db.IsOpen());
   
   // Test database tables post-creation
-  vector<CStdString> tables;
+  vector<string> tables;
   EXPECT_TRUE(db.GetAllTables(tables));
-  EXPECT_EQ(tables.size(), 5);
+  EXPECT_EQ(tables.size(), 6);
   EXPECT_TRUE(has(tables, "version"));
+  EXPECT_TRUE(has(tables, "gnomenormalize"));
   EXPECT_TRUE(has(tables, "gnome"));
   EXPECT_TRUE(has(tables, "garden"));
   EXPECT_TRUE(has(tables, "placestraveled"));
   EXPECT_TRUE(has(tables, "gnomelinkplacestraveled"));
 
   // Test database indices post-creation
-  vector<CStdString> indices;
+  vector<string> indices;
   EXPECT_TRUE(db.GetAllIndices(indices));
   EXPECT_EQ(indices.size(), 8);
   EXPECT_TRUE(has(indices, "idx_gnome_name"));
@@ -434,13 +659,13 @@ void runTests(CGnomeDatabase &db)
 
   // Test item navigation with constraints
   CFileItemList gardensOnlyLisbon;
-  map<string, long> conditionLisbon;
+  map<string, int> conditionLisbon;
   conditionLisbon["placestraveled"] = idLisbon;
   EXPECT_TRUE(db.GetItemNav("garden", gardensOnlyLisbon, "", conditionLisbon));
   EXPECT_EQ(gardensOnlyLisbon.Size(), 2);
   // NOTE: This assumes that these gardens were added in a certain order
-  CStdString garden1 = gardensOnlyLisbon[0]->GetLabel(),
-             garden2 = gardensOnlyLisbon[1]->GetLabel();
+  string garden1 = gardensOnlyLisbon[0]->GetLabel(),
+         garden2 = gardensOnlyLisbon[1]->GetLabel();
   EXPECT_TRUE(garden1 == "Ikea Garden" || garden1 == "Noodlepushin Garden");
   EXPECT_TRUE(garden2 == "Ikea Garden" || garden2 == "Noodlepushin Garden");
   EXPECT_TRUE(garden1 != garden2);
@@ -448,7 +673,7 @@ void runTests(CGnomeDatabase &db)
   int idNoodlepushin = -1;
   EXPECT_TRUE(db.GetItemID("garden", "Noodlepushin Garden", idNoodlepushin));
   EXPECT_NE(idNoodlepushin, -1);
-  map<string, long> conditionLisbonAndNoodlepushin = conditionLisbon;
+  map<string, int> conditionLisbonAndNoodlepushin = conditionLisbon;
   conditionLisbonAndNoodlepushin["garden"] = idNoodlepushin;
   gardensOnlyLisbon.Clear();
   EXPECT_TRUE(db.GetItemNav("garden", gardensOnlyLisbon, "", conditionLisbonAndNoodlepushin));
@@ -463,7 +688,7 @@ void runTests(CGnomeDatabase &db)
   EXPECT_TRUE(db.GetObjectsNav(objects, conditionLisbon));
   EXPECT_EQ(objects.Size(), 3);
   objects.Clear();
-  map<string, long> conditionLisbonAndIkea = conditionLisbon;
+  map<string, int> conditionLisbonAndIkea = conditionLisbon;
   conditionLisbonAndIkea["garden"] = idIkea;
   EXPECT_TRUE(db.GetObjectsNav(objects, conditionLisbonAndIkea));
   EXPECT_EQ(objects.Size(), 2);
@@ -484,31 +709,31 @@ void runTests(CGnomeDatabase &db)
 
   // Test removing relations
   CFileItemList temp2;
-  vector<CStdString> fewerTables, fewerIndices;
+  vector<string> fewerTables, fewerIndices;
   EXPECT_NO_THROW(db.DropManyToMany("placestraveled"));
   EXPECT_EQ(db.Count("placestraveled"), 0);
   EXPECT_FALSE(db.GetItemNav("placestraveled", temp2, ""));
   EXPECT_TRUE(db.GetAllTables(fewerTables));
-  EXPECT_EQ(fewerTables.size(), 3);
+  EXPECT_EQ(fewerTables.size(), 4);
   EXPECT_TRUE(db.GetAllIndices(fewerIndices));
   EXPECT_EQ(fewerIndices.size(), 4);
 
-  vector<CStdString> fewererTables, fewererIndices;
+  vector<string> fewererTables, fewererIndices;
   EXPECT_NO_THROW(db.DropIndex("littlegnomefriends"));
   EXPECT_TRUE(db.GetAllTables(fewererTables));
-  EXPECT_EQ(fewererTables.size(), 3);
+  EXPECT_EQ(fewererTables.size(), 4);
   EXPECT_TRUE(db.GetAllIndices(fewererIndices));
   EXPECT_EQ(fewererIndices.size(), 3);
 
   CFileItemList temp3;
-  vector<CStdString> fewestTables, fewestIndices;
+  vector<string> fewestTables, fewestIndices;
   EXPECT_NO_THROW(db.DropOneToMany("garden"));
   EXPECT_EQ(db.Count("garden"), 0);
   EXPECT_FALSE(db.GetItemNav("garden", temp3, ""));
-  EXPECT_TRUE(db.GetAllTables(fewerTables));
-  EXPECT_EQ(fewerTables.size(), 2);
-  EXPECT_TRUE(db.GetAllIndices(fewerIndices));
-  EXPECT_EQ(fewerIndices.size(), 1);
+  EXPECT_TRUE(db.GetAllTables(fewestTables));
+  EXPECT_EQ(fewestTables.size(), 3);
+  EXPECT_TRUE(db.GetAllIndices(fewestIndices));
+  EXPECT_EQ(fewestIndices.size(), 1);
 
   EXPECT_THROW(db.DropManyToMany("placestraveled"), dbiplus::DbErrors);
   EXPECT_THROW(db.DropIndex("littlegnomefriends"), dbiplus::DbErrors);
@@ -516,28 +741,30 @@ void runTests(CGnomeDatabase &db)
 
   // Test adding relations
   CLawnGnome Gnome3;
-  vector<CStdString> moreTables, moreIndices;
+  vector<string> moreTables, moreIndices;
   EXPECT_NO_THROW(db.AddIndex("littlegnomefriends", "INTEGER"));
   EXPECT_TRUE(db.GetAllTables(moreTables));
-  EXPECT_EQ(moreTables.size(), 2);
+  EXPECT_EQ(moreTables.size(), 3);
   EXPECT_TRUE(db.GetAllIndices(moreIndices));
   EXPECT_EQ(moreIndices.size(), 2);
   EXPECT_TRUE(db.GetObjectByIndex("littlegnomefriends", 1, &Gnome3));
   EXPECT_NE(Gnome3.m_name, "");
 
-  vector<CStdString> evenMoreTables, evenMoreIndices;
+  vector<string> evenMoreTables, evenMoreIndices;
   EXPECT_NO_THROW(db.AddOneToMany("garden", "VARCHAR(512)", true));
+  ASSERT_NO_FATAL_FAILURE(waitForNormalize(db));
   EXPECT_EQ(db.Count("garden"), 4); // Montague Garden, Ikea Garden, Noodlepushin Garden, RussiaIsCold Garden
   EXPECT_TRUE(db.GetAllTables(evenMoreTables));
-  EXPECT_EQ(evenMoreTables.size(), 3);
+  EXPECT_EQ(evenMoreTables.size(), 4);
   EXPECT_TRUE(db.GetAllIndices(evenMoreIndices));
   EXPECT_EQ(evenMoreIndices.size(), 4);
 
-  vector<CStdString> mostTables, mostIndices;
+  vector<string> mostTables, mostIndices;
   EXPECT_NO_THROW(db.AddManyToMany("placestraveled", "TEXT", false));
+  ASSERT_NO_FATAL_FAILURE(waitForNormalize(db));
   EXPECT_EQ(db.Count("placestraveled"), 8); // Venice, Zurich, Tokyo, Lisbon, Belize, Monte Carlo, Georgia, Bangledash
   EXPECT_TRUE(db.GetAllTables(mostTables));
-  EXPECT_EQ(mostTables.size(), 5);
+  EXPECT_EQ(mostTables.size(), 6);
   EXPECT_TRUE(db.GetAllIndices(mostIndices));
   EXPECT_EQ(mostIndices.size(), 8);
 
@@ -545,7 +772,13 @@ void runTests(CGnomeDatabase &db)
   EXPECT_NO_THROW(db.AddOneToMany("garden", "VARCHAR(512)", true));
   EXPECT_NO_THROW(db.AddManyToMany("placestraveled", "TEXT", false));
 
-  // Do a nav operation to verify that the correct data was restored
+  // Do a nav operation to verify that the correct data was restored, the
+  // items have new IDs now
+  EXPECT_TRUE(db.GetItemID("placestraveled", "Lisbon", idLisbon));
+  EXPECT_TRUE(db.GetItemID("garden", "Noodlepushin Garden", idNoodlepushin));
+  conditionLisbonAndNoodlepushin["placestraveled"] = idLisbon;
+  conditionLisbonAndNoodlepushin["garden"] = idNoodlepushin;
+  gardensOnlyLisbon.Clear();
   EXPECT_TRUE(db.GetItemNav("garden", gardensOnlyLisbon, "", conditionLisbonAndNoodlepushin));
   EXPECT_EQ(gardensOnlyLisbon.Size(), 1);
   EXPECT_TRUE(gardensOnlyLisbon[0]->GetLabel() == "Noodlepushin Garden");
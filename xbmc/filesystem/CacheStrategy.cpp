@@ -407,6 +407,11 @@ bool CDoubleCache::IsCachedPosition(int64_t iFilePosition)
   return m_pCache->IsCachedPosition(iFilePosition) || (m_pCacheOld && m_pCacheOld->IsCachedPosition(iFilePosition));
 }
 
+int64_t CDoubleCache::SkipCachedData()
+{
+  return m_pCache->SkipCachedData();
+}
+
 CCacheStrategy *CDoubleCache::CreateNew()
 {
   return new CDoubleCache(m_pCache->CreateNew());
@@ -67,6 +67,27 @@ public:
   virtual int64_t CachedDataEndPos() = 0;
   virtual bool IsCachedPosition(int64_t iFilePosition) = 0;
 
+  /*!
+   \brief Move the write position behind data which is already cached
+   \return The new write position, the source has to continue there
+   */
+  virtual int64_t SkipCachedData() { return CachedDataEndPos(); }
+
+  /*!
+   \brief Reserve a range ahead of the write position to be read by another source
+   \param iMaxPosition position the range must not reach beyond, e.g. the end of the file
+   \param iPosition set to the start of the range
+   \param iSize set to the size of the range
+   \return Whether a range was reserved. It has to be handed back with WritePrefetched().
+   */
+  virtual bool ReservePrefetch(int64_t iMaxPosition, int64_t& iPosition, size_t& iSize) { return false; }
+
+  /*!
+   \brief Store the data read for a range of ReservePrefetch()
+   \param iSize number of bytes read, may be less than reserved or 0 on errors
+   */
+  virtual void WritePrefetched(int64_t iPosition, const char *pBuffer, size_t iSize) { }
+
   virtual CCacheStrategy *CreateNew() = 0;
 
   CEvent m_space;
@@ -134,6 +155,8 @@ public:
   virtual int64_t CachedDataEndPos();
   virtual bool IsCachedPosition(int64_t iFilePosition);
 
+  virtual int64_t SkipCachedData();
+
   virtual CCacheStrategy *CreateNew();
 
 protected:
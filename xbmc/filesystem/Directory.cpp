@@ -25,6 +25,7 @@
 #include "commons/Exception.h"
 #include "FileItem.h"
 #include "DirectoryCache.h"
+#include "DirectoryIndex.h"
 #include "settings/Settings.h"
 #include "utils/log.h"
 #include "utils/Job.h"
@@ -154,8 +155,15 @@ bool CDirectory::GetDirectory(const CURL& url, CFileItemList &items, const CHint
       return false;
 
     // check our cache for this path
+    int64_t indexTime = 0;
     if (g_directoryCache.GetDirectory(realURL.Get(), items, (hints.flags & DIR_FLAG_READ_CACHE) == DIR_FLAG_READ_CACHE))
       items.SetURL(url);
+    else if (!(hints.flags & DIR_FLAG_BYPASS_CACHE) && CDirectoryIndex::GetInstance().Lookup(realURL, hints.flags, items, indexTime))
+    {
+      // unchanged since it was listed the last time
+      items.SetURL(url);
+      g_directoryCache.SetDirectory(realURL.Get(), items, pDirectory->GetCacheType(url));
+    }
     else
     {
       // need to clear the cache (in case the directory fetch fails)
@@ -200,7 +208,10 @@ bool CDirectory::GetDirectory(const CURL& url, CFileItemList &items, const CHint
 
       // cache the directory, if necessary
       if (!(hints.flags & DIR_FLAG_BYPASS_CACHE))
+      {
         g_directoryCache.SetDirectory(realURL.Get(), items, pDirectory->GetCacheType(url));
+        CDirectoryIndex::GetInstance().Store(realURL, hints.flags, items, indexTime);
+      }
     }
 
     // now filter for allowed files
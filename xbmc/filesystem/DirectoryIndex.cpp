@@ -0,0 +1,592 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DirectoryIndex.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <stdexcept>
+#include <vector>
+#include <time.h>
+
+#ifdef HAVE_INOTIFY
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Directory.h"
+#include "File.h"
+#include "FileItem.h"
+#include "SpecialProtocol.h"
+#include "URL.h"
+#include "XBDateTime.h"
+#include "settings/AdvancedSettings.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/Archive.h"
+#include "utils/JobManager.h"
+#include "utils/Crc32.h"
+#include "utils/log.h"
+#include "utils/md5.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+
+#define DIRECTORY_INDEX_FOLDER  "special://profile/directoryindex/"
+#define DIRECTORY_INDEX_VERSION 1
+
+// maximum number of directories kept in memory, the least recently used ones are
+// dropped beyond it and checked against their index file again when listed
+#define DIRECTORY_INDEX_MAX_ENTRIES 10000
+
+// maximum number of listings waiting to be written to the index
+#define DIRECTORY_INDEX_MAX_STORES 256
+
+// maximum number of local directories watched for changes
+#define DIRECTORY_INDEX_MAX_WATCHES 4096
+
+// time the modification time of an unwatched directory is trusted after it was checked
+#define DIRECTORY_INDEX_VALIDATED_MS 10000
+
+// listings which weren't stored for this long are removed from the index of a profile when it's loaded
+#define DIRECTORY_INDEX_MAX_AGE_DAYS 30
+
+// maximum number of listings kept in the index of a profile
+#define DIRECTORY_INDEX_MAX_FILES 20000
+
+using namespace XFILE;
+
+CDirectoryIndex& CDirectoryIndex::GetInstance()
+{
+  static CDirectoryIndex directoryIndex;
+  return directoryIndex;
+}
+
+CDirectoryIndex::CDirectoryIndex()
+  : CThread("DirectoryIndex")
+  , m_storing(false)
+  , m_writeInvalidated(false)
+  , m_inotify(-1)
+{ }
+
+CDirectoryIndex::~CDirectoryIndex()
+{
+  StopThread();
+#ifdef HAVE_INOTIFY
+  if (m_inotify >= 0)
+    close(m_inotify);
+#endif
+}
+
+bool CDirectoryIndex::Lookup(const CURL& url, int flags, CFileItemList& items, int64_t& mtime)
+{
+  mtime = 0;
+  if (!g_advancedSettings.m_useDirectoryIndex || !IsIndexable(url))
+    return false;
+
+  if (!GetDirectoryTime(url, mtime))
+  {
+    mtime = 0;
+    return false;
+  }
+
+  std::string path(url.Get());
+  URIUtils::AddSlashAtEnd(path);
+
+  CSingleLock lock(m_critical);
+  if (CheckProfile())
+  {
+    std::string folder(m_folder);
+    lock.Leave();
+    Prune(folder);
+    lock.Enter();
+  }
+  std::string indexFile(GetIndexFile(path));
+
+  // any change in a watched directory drops its entry, so one which is still
+  // there has been watched since it was stored
+  bool known = false;
+  bool watched = false;
+  SEntry entry;
+  std::map<std::string, SEntry>::iterator it = m_entries.find(path);
+  if (it != m_entries.end() && it->second.mtime > 0)
+  {
+    entry = it->second;
+    known = true;
+    watched = entry.watch >= 0;
+  }
+
+  // otherwise start watching before the listing is checked, so changes made
+  // meanwhile aren't missed
+  if (!watched)
+    BeginListing(url, path);
+
+  // a listing without file info can't be used if it's asked for
+  bool valid = false;
+  std::map<std::string, SStore>::const_iterator store = m_stores.find(indexFile);
+  if (store != m_stores.end())
+  {
+    // not written yet
+    valid = store->second.mtime == mtime && (store->second.fileInfo || (flags & DIR_FLAG_NO_FILE_INFO));
+    if (valid)
+    {
+      items.Clear();
+      items.Copy(*store->second.items);
+      entry.mtime = mtime;
+      entry.size = items.Size();
+      entry.hash = GetHash(items);
+      entry.fileInfo = store->second.fileInfo;
+    }
+  }
+  else if (!known || (entry.mtime == mtime && (entry.fileInfo || (flags & DIR_FLAG_NO_FILE_INFO))))
+  {
+    lock.Leave();
+
+    SEntry stored;
+    valid = LoadEntry(indexFile, path, stored, &items) &&
+            stored.mtime == mtime && (stored.fileInfo || (flags & DIR_FLAG_NO_FILE_INFO));
+    if (valid)
+      entry = stored;
+
+    lock.Enter();
+  }
+
+  // the entry is gone if the directory changed meanwhile
+  it = m_entries.find(path);
+  if (valid && it != m_entries.end())
+  {
+    entry.watch = it->second.watch;
+    entry.validated = XbmcThreads::SystemClockMillis();
+    it->second = entry;
+    return true;
+  }
+
+  items.Clear();
+  BeginListing(url, path);
+  return false;
+}
+
+void CDirectoryIndex::Store(const CURL& url, int flags, CFileItemList& items, int64_t mtime)
+{
+  if (mtime <= 0 || !g_advancedSettings.m_useDirectoryIndex || !IsIndexable(url))
+    return;
+
+  // changes within the resolution of the modification time can't be detected
+  if (mtime >= (int64_t)time(NULL) - 2)
+    return;
+
+  std::string path(url.Get());
+  URIUtils::AddSlashAtEnd(path);
+
+  CSingleLock lock(m_critical);
+  CheckProfile();
+  if (m_entries.find(path) == m_entries.end())
+    return;
+
+  // the writer can't keep up, this listing isn't worth the memory
+  std::string indexFile(GetIndexFile(path));
+  if (m_stores.size() >= DIRECTORY_INDEX_MAX_STORES && m_stores.find(indexFile) == m_stores.end())
+    return;
+
+  SStore &store = m_stores[indexFile];
+  store.url = url.Get();
+  store.path = path;
+  store.mtime = mtime;
+  store.fileInfo = !(flags & DIR_FLAG_NO_FILE_INFO);
+  store.items.reset(new CFileItemList);
+  store.items->Copy(items);
+
+  if (!m_storing)
+  {
+    m_storing = true;
+    CJobManager::GetInstance().Submit([this]() { WriteStores(); });
+  }
+}
+
+void CDirectoryIndex::Invalidate(const std::string& path)
+{
+  std::string directory(path);
+  URIUtils::AddSlashAtEnd(directory);
+
+  CSingleLock lock(m_critical);
+  CheckProfile();
+  RemoveEntry(directory);
+}
+
+bool CDirectoryIndex::GetModificationTime(const std::string& path, int64_t& mtime)
+{
+  std::string directory(path);
+  URIUtils::AddSlashAtEnd(directory);
+
+  CSingleLock lock(m_critical);
+  std::map<std::string, SEntry>::const_iterator it = m_entries.find(directory);
+  if (it == m_entries.end() || it->second.mtime <= 0)
+    return false;
+
+  // watched directories are invalidated as soon as they change
+  if (it->second.watch < 0 && XbmcThreads::SystemClockMillis() - it->second.validated > DIRECTORY_INDEX_VALIDATED_MS)
+    return false;
+
+  mtime = it->second.mtime;
+  return true;
+}
+
+void CDirectoryIndex::WriteStores()
+{
+  CSingleLock lock(m_critical);
+  while (!m_stores.empty())
+  {
+    std::string indexFile(m_stores.begin()->first);
+    SStore store(m_stores.begin()->second);
+    m_stores.erase(m_stores.begin());
+    m_writing = indexFile;
+    m_writeInvalidated = false;
+    lock.Leave();
+
+    SEntry entry;
+    entry.mtime = store.mtime;
+    entry.size = store.items->Size();
+    entry.hash = GetHash(*store.items);
+    entry.fileInfo = store.fileInfo;
+    entry.validated = XbmcThreads::SystemClockMillis();
+    entry.watch = -1;
+
+    // the directory changed while it was listed
+    bool written = false;
+    int64_t current;
+    CFile file;
+    if (GetDirectoryTime(CURL(store.url), current) && current == store.mtime &&
+        file.OpenForWrite(indexFile, true))
+    {
+      CArchive ar(&file, CArchive::store);
+      ar << (int)DIRECTORY_INDEX_VERSION;
+      ar << store.path;
+      ar << entry.mtime;
+      ar << entry.size;
+      ar << entry.hash;
+      ar << entry.fileInfo;
+      ar << *store.items;
+      ar.Close();
+      file.Close();
+      written = true;
+    }
+
+    lock.Enter();
+    m_writing.clear();
+    if (!written)
+      continue;
+
+    if (m_writeInvalidated)
+    {
+      // invalidated while it was written
+      CFile::Delete(indexFile);
+      continue;
+    }
+
+    std::map<std::string, SEntry>::iterator it = m_entries.find(store.path);
+    if (it != m_entries.end() && it->second.mtime <= 0 && indexFile == GetIndexFile(store.path))
+    {
+      entry.watch = it->second.watch;
+      it->second = entry;
+    }
+  }
+  m_storing = false;
+}
+
+void CDirectoryIndex::Process()
+{
+#ifdef HAVE_INOTIFY
+  char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  while (!m_bStop)
+  {
+    struct pollfd fds;
+    fds.fd = m_inotify;
+    fds.events = POLLIN;
+    fds.revents = 0;
+    if (poll(&fds, 1, 500) <= 0)
+      continue;
+
+    ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+    if (length <= 0)
+      continue;
+
+    CSingleLock lock(m_critical);
+    const struct inotify_event *event;
+    for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len)
+    {
+      event = (const struct inotify_event *)ptr;
+
+      // events were lost, nothing watched can be trusted anymore
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        CLog::Log(LOGDEBUG, "CDirectoryIndex: inotify queue overflow, dropping watched directories");
+        std::map<int, std::string> watches(m_watches);
+        for (std::map<int, std::string>::const_iterator watch = watches.begin(); watch != watches.end(); ++watch)
+          RemoveEntry(watch->second);
+        continue;
+      }
+
+      std::map<int, std::string>::iterator watch = m_watches.find(event->wd);
+      if (watch == m_watches.end())
+        continue;
+
+      if (event->mask & IN_IGNORED)
+      {
+        // the directory is gone, so is the watch
+        std::string path(watch->second);
+        m_watches.erase(watch);
+        std::map<std::string, SEntry>::iterator it = m_entries.find(path);
+        if (it != m_entries.end())
+          it->second.watch = -1;
+        RemoveEntry(path);
+        continue;
+      }
+
+      std::string path(watch->second);
+      RemoveEntry(path);
+    }
+  }
+#endif
+}
+
+bool CDirectoryIndex::IsIndexable(const CURL& url)
+{
+  return IsLocal(url) || url.IsProtocol("smb") || url.IsProtocol("nfs");
+}
+
+bool CDirectoryIndex::IsLocal(const CURL& url)
+{
+  return url.GetProtocol().empty() && !url.Get().empty();
+}
+
+bool CDirectoryIndex::GetDirectoryTime(const CURL& url, int64_t& mtime)
+{
+  struct __stat64 buffer;
+  if (CFile::Stat(url, &buffer) != 0)
+    return false;
+
+  mtime = buffer.st_mtime ? buffer.st_mtime : buffer.st_ctime;
+  return mtime > 0;
+}
+
+std::string CDirectoryIndex::GetIndexFile(const std::string& path) const
+{
+  return URIUtils::AddFileToFolder(m_folder, StringUtils::Format("%08x.idx", Crc32::Compute(path)));
+}
+
+std::string CDirectoryIndex::GetHash(const CFileItemList& items)
+{
+  XBMC::XBMC_MD5 md5state;
+  for (int i = 0; i < items.Size(); ++i)
+  {
+    const CFileItemPtr item = items[i];
+    md5state.append(item->GetPath());
+    md5state.append((unsigned char *)&item->m_dwSize, sizeof(item->m_dwSize));
+    FILETIME time = item->m_dateTime;
+    md5state.append((unsigned char *)&time, sizeof(FILETIME));
+  }
+  return md5state.getDigest();
+}
+
+bool CDirectoryIndex::LoadEntry(const std::string& indexFile, const std::string& path, SEntry& entry, CFileItemList* items)
+{
+  CFile file;
+  if (!file.Open(indexFile))
+    return false;
+
+  try
+  {
+    CArchive ar(&file, CArchive::load);
+    int version;
+    ar >> version;
+    if (version != DIRECTORY_INDEX_VERSION)
+      return false;
+
+    // another directory with the same crc
+    std::string storedPath;
+    ar >> storedPath;
+    if (storedPath != path)
+      return false;
+
+    ar >> entry.mtime;
+    ar >> entry.size;
+    ar >> entry.hash;
+    ar >> entry.fileInfo;
+    if (items)
+    {
+      ar >> *items;
+      if (items->Size() != entry.size)
+        return false;
+    }
+    return true;
+  }
+  catch (std::out_of_range &ex)
+  {
+    CLog::Log(LOGERROR, "CDirectoryIndex: corrupt index file %s", indexFile.c_str());
+  }
+
+  return false;
+}
+
+void CDirectoryIndex::Prune(const std::string& folder)
+{
+  CFileItemList items;
+  if (!CDirectory::GetDirectory(folder, items, ".idx", DIR_FLAG_NO_FILE_DIRS | DIR_FLAG_BYPASS_CACHE))
+    return;
+
+  // keep the most recently stored listings
+  items.Sort(SortByDate, SortOrderDescending);
+  CDateTime oldest = CDateTime::GetCurrentDateTime() - CDateTimeSpan(DIRECTORY_INDEX_MAX_AGE_DAYS, 0, 0, 0);
+  for (int i = 0; i < items.Size(); ++i)
+  {
+    if (i >= DIRECTORY_INDEX_MAX_FILES || items[i]->m_dateTime < oldest)
+      CFile::Delete(items[i]->GetPath());
+  }
+}
+
+void CDirectoryIndex::RemoveEntry(const std::string& path)
+{
+  std::string indexFile(GetIndexFile(path));
+  m_stores.erase(indexFile);
+  if (indexFile == m_writing)
+    m_writeInvalidated = true;
+  CFile::Delete(indexFile);
+
+  std::map<std::string, SEntry>::iterator it = m_entries.find(path);
+  if (it == m_entries.end())
+    return;
+
+  Unwatch(it->second);
+  m_entries.erase(it);
+}
+
+void CDirectoryIndex::Unwatch(SEntry& entry)
+{
+#ifdef HAVE_INOTIFY
+  if (entry.watch >= 0)
+  {
+    inotify_rm_watch(m_inotify, entry.watch);
+    m_watches.erase(entry.watch);
+  }
+#endif
+  entry.watch = -1;
+}
+
+/*!
+ Dropping an entry keeps its index file, the listing is served from it again
+ as long as the modification time of the directory matches.
+ */
+void CDirectoryIndex::EvictEntries()
+{
+  std::vector<std::pair<unsigned int, std::string> > entries;
+  entries.reserve(m_entries.size());
+  for (std::map<std::string, SEntry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    entries.push_back(std::make_pair(it->second.validated, it->first));
+
+  // a quarter at once, so this isn't done for every new directory
+  size_t count = entries.size() / 4 + 1;
+  std::nth_element(entries.begin(), entries.begin() + count - 1, entries.end());
+  for (size_t i = 0; i < count; ++i)
+  {
+    std::map<std::string, SEntry>::iterator it = m_entries.find(entries[i].second);
+    Unwatch(it->second);
+    m_entries.erase(it);
+  }
+}
+
+void CDirectoryIndex::Watch(const CURL& url, SEntry& entry)
+{
+#ifdef HAVE_INOTIFY
+  if (!IsLocal(url) || m_watches.size() >= DIRECTORY_INDEX_MAX_WATCHES)
+    return;
+
+  if (m_inotify < 0)
+  {
+    m_inotify = inotify_init();
+    if (m_inotify < 0)
+    {
+      CLog::Log(LOGWARNING, "CDirectoryIndex: failed to initialize inotify (%d)", errno);
+      return;
+    }
+    Create();
+  }
+
+  int watch = inotify_add_watch(m_inotify, url.Get().c_str(),
+                                IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+  if (watch < 0)
+    return;
+
+  std::string path(url.Get());
+  URIUtils::AddSlashAtEnd(path);
+  m_watches[watch] = path;
+  entry.watch = watch;
+#endif
+}
+
+void CDirectoryIndex::BeginListing(const CURL& url, const std::string& path)
+{
+  std::map<std::string, SEntry>::iterator it = m_entries.find(path);
+  if (it != m_entries.end())
+  {
+    it->second.mtime = 0;
+    it->second.validated = XbmcThreads::SystemClockMillis();
+    return;
+  }
+
+  if (m_entries.size() >= DIRECTORY_INDEX_MAX_ENTRIES)
+    EvictEntries();
+
+  // Invalidate() drops this entry
+  SEntry &pending = m_entries[path];
+  pending.mtime = 0;
+  pending.size = 0;
+  pending.fileInfo = false;
+  pending.validated = XbmcThreads::SystemClockMillis();
+  pending.watch = -1;
+  Watch(url, pending);
+}
+
+void CDirectoryIndex::ResetWatches()
+{
+#ifdef HAVE_INOTIFY
+  for (std::map<int, std::string>::const_iterator watch = m_watches.begin(); watch != m_watches.end(); ++watch)
+    inotify_rm_watch(m_inotify, watch->first);
+#endif
+  m_watches.clear();
+}
+
+/*!
+ Each profile has its own index, forget about the entries of the previous one
+ after switching. Listings which changed in the meantime are caught by their
+ modification time. Listings still waiting to be written go to the index of
+ the profile they were stored in.
+ */
+bool CDirectoryIndex::CheckProfile()
+{
+  std::string folder(CSpecialProtocol::TranslatePath(DIRECTORY_INDEX_FOLDER));
+  if (folder == m_folder)
+    return false;
+
+  ResetWatches();
+  m_entries.clear();
+  m_folder = folder;
+  return true;
+}
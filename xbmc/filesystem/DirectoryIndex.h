@@ -0,0 +1,140 @@
+#pragma once
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "threads/CriticalSection.h"
+#include "threads/Thread.h"
+
+class CFileItemList;
+class CURL;
+
+namespace XFILE
+{
+  /*!
+   \brief Persistent index of directory listings
+
+   Listings of local, SMB and NFS directories are stored in the profile
+   (special://profile/directoryindex/) together with the modification time of
+   the directory, the number of entries and a hash of them. As long as the
+   modification time of a directory doesn't change, its listing is served from
+   the index instead of listing the directory again.
+
+   Serving a listing costs a single stat() of the directory. Its modification
+   time only changes when entries are added, removed or renamed, so files
+   modified in place aren't noticed in listings of network shares, the same way
+   the fast hash of the library scanners doesn't notice them. Local directories
+   are watched with inotify (if available) while they are indexed, which
+   invalidates their listings on any change.
+
+   Listings are written to the index by a job, until then they are served from
+   memory. The most recently used directories are kept in memory, and listings
+   which weren't stored for a while are pruned when a profile is loaded.
+   */
+  class CDirectoryIndex : private CThread
+  {
+  public:
+    static CDirectoryIndex& GetInstance();
+
+    /*!
+     \brief Get the stored listing of a directory if it's still valid
+     \param url the directory, with path substitution applied
+     \param flags the DIR_FLAG_* the directory is going to be listed with
+     \param items [out] the listing
+     \param mtime [out] the current modification time of the directory, to be passed to Store(). 0 if it can't be indexed.
+     \return true if items were filled from the index
+     */
+    bool Lookup(const CURL& url, int flags, CFileItemList& items, int64_t& mtime);
+
+    /*!
+     \brief Store the listing of a directory
+     The listing is copied and written to the index by a job.
+     \param mtime the modification time returned by Lookup() before the directory was listed
+     */
+    void Store(const CURL& url, int flags, CFileItemList& items, int64_t mtime);
+
+    /*!
+     \brief Remove the listing of a directory from the index
+     */
+    void Invalidate(const std::string& path);
+
+    /*!
+     \brief Get the modification time of a directory without accessing it
+     \return true if the directory is indexed and was validated just now or is being watched
+     */
+    bool GetModificationTime(const std::string& path, int64_t& mtime);
+
+  protected:
+    CDirectoryIndex();
+    virtual ~CDirectoryIndex();
+
+    virtual void Process();
+
+  private:
+    struct SEntry
+    {
+      int64_t mtime;           /**< modification time of the directory when it was listed */
+      int size;                /**< number of entries */
+      std::string hash;        /**< hash of the paths, sizes and dates of the entries */
+      bool fileInfo;           /**< listed without DIR_FLAG_NO_FILE_INFO */
+      unsigned int validated;  /**< time the modification time was last checked or the directory listed */
+      int watch;               /**< inotify watch descriptor, -1 if not watched */
+    };
+
+    struct SStore
+    {
+      std::string url;         /**< the directory, with path substitution applied */
+      std::string path;        /**< the directory with a trailing slash */
+      int64_t mtime;           /**< modification time of the directory before it was listed */
+      bool fileInfo;           /**< listed without DIR_FLAG_NO_FILE_INFO */
+      std::shared_ptr<CFileItemList> items;
+    };
+
+    static bool IsIndexable(const CURL& url);
+    static bool IsLocal(const CURL& url);
+    static bool GetDirectoryTime(const CURL& url, int64_t& mtime);
+    static std::string GetHash(const CFileItemList& items);
+    static void Prune(const std::string& folder);
+
+    std::string GetIndexFile(const std::string& path) const;
+    bool LoadEntry(const std::string& indexFile, const std::string& path, SEntry& entry, CFileItemList* items);
+    void WriteStores();
+    void RemoveEntry(const std::string& path);
+    void EvictEntries();
+    void BeginListing(const CURL& url, const std::string& path);
+    void Watch(const CURL& url, SEntry& entry);
+    void Unwatch(SEntry& entry);
+    void ResetWatches();
+    bool CheckProfile();
+
+    std::map<std::string, SEntry> m_entries;
+    std::map<std::string, SStore> m_stores;  /**< listings waiting to be written, by index file */
+    bool m_storing;             /**< a job is writing m_stores */
+    std::string m_writing;      /**< index file being written */
+    bool m_writeInvalidated;    /**< the directory of m_writing was invalidated meanwhile */
+    std::map<int, std::string> m_watches;
+    std::string m_folder;       /**< index folder of the profile the entries belong to */
+    int m_inotify;
+    CCriticalSection m_critical;
+  };
+}
@@ -25,6 +25,7 @@
 #include "URL.h"
 
 #include "CircularCache.h"
+#include "SegmentedCache.h"
 #include "threads/SingleLock.h"
 #include "utils/log.h"
 #include "settings/AdvancedSettings.h"
@@ -33,7 +34,6 @@
 #include "linux/ConvUtils.h" //GetLastError()
 #endif
 
-#include <cassert>
 #include <algorithm>
 #include <memory>
 
@@ -90,6 +90,99 @@ private:
   int64_t  m_size;
 };
 
+/*!
+ \brief Reads blocks ahead of the cache thread using a connection of its own
+
+ The connection is opened once there is something to read ahead. Whenever
+ nothing is, the prefetcher sleeps until the cache thread or the reader moved
+ on (CFileCache::WakePrefetchers()).
+ */
+class CFileCache::CPrefetcher : public CThread
+{
+public:
+  explicit CPrefetcher(CFileCache &owner)
+    : CThread("FileCachePrefetch")
+    , m_owner(owner)
+    , m_opened(false)
+  {
+  }
+
+protected:
+  virtual void Process()
+  {
+    std::unique_ptr<char[]> buffer;
+    size_t bufferSize = 0;
+
+    while (true)
+    {
+      // reset before checking, so a wake up meanwhile isn't lost
+      m_owner.m_prefetchEvent.Reset();
+      if (m_bStop)
+        break;
+
+      int64_t position;
+      size_t size;
+      if (!m_owner.ReservePrefetch(position, size))
+      {
+        m_owner.m_prefetchEvent.Wait();
+        continue;
+      }
+
+      // there may be more for the other prefetchers
+      m_owner.m_prefetchEvent.Set();
+
+      if (!m_opened && !OpenSource())
+      {
+        m_owner.m_pCache->WritePrefetched(position, NULL, 0);
+        break;
+      }
+
+      if (size > bufferSize)
+      {
+        buffer.reset(new char[size]);
+        bufferSize = size;
+      }
+
+      // a short read only ends the cached range early, the cache thread takes over from there
+      size_t total = 0;
+      if (m_source.Seek(position, SEEK_SET) == position)
+      {
+        while (total < size && !m_bStop)
+        {
+          ssize_t read = m_source.Read(buffer.get() + total, size - total);
+          if (read <= 0)
+            break;
+          total += read;
+        }
+      }
+
+      m_owner.m_pCache->WritePrefetched(position, buffer.get(), total);
+      m_owner.m_prefetchBytes += total;
+    }
+
+    m_source.Close();
+  }
+
+private:
+  bool OpenSource()
+  {
+    if (!m_source.Open(m_owner.m_sourcePath, READ_NO_CACHE | READ_TRUNCATED | READ_CHUNKED))
+    {
+      CLog::Log(LOGERROR, "CFileCache::CPrefetcher - failed to open source <%s>", CURL::GetRedacted(m_owner.m_sourcePath).c_str());
+      return false;
+    }
+
+    bool retry = false;
+    m_source.IoControl(IOCTRL_SET_RETRY, &retry);
+    m_opened = true;
+    return true;
+  }
+
+  CFileCache &m_owner;
+  CFile m_source;
+  bool m_opened;
+};
+
 
 CFileCache::CFileCache(const unsigned int flags)
   : CThread("FileCache")
@@ -106,6 +199,13 @@ CFileCache::CFileCache(const unsigned int flags)
   , m_forwardCacheSize(0)
   , m_fileSize(0)
   , m_flags(flags)
+  , m_readHits(0)
+  , m_readMisses(0)
+  , m_seekHits(0)
+  , m_seekMisses(0)
+  , m_prefetchBytes(0)
+  , m_prefetchEvent(true)
+  , m_prefetching(false)
 {
 }
 
@@ -116,6 +216,13 @@ CFileCache::CFileCache(CCacheStrategy *pCache, bool bDeleteCache /* = true */)
   , m_writeRate(0)
   , m_writeRateActual(0)
   , m_forwardCacheSize(0)
+  , m_readHits(0)
+  , m_readMisses(0)
+  , m_seekHits(0)
+  , m_seekMisses(0)
+  , m_prefetchBytes(0)
+  , m_prefetchEvent(true)
+  , m_prefetching(false)
 {
   m_pCache = pCache;
   m_bDeleteCache = bDeleteCache;
@@ -201,20 +308,28 @@ bool CFileCache::Open(const CURL& url)
       size_t back = cacheSize / 4;
       size_t front = cacheSize - back;
       
-      if (m_flags & READ_MULTI_STREAM)
+      if (g_advancedSettings.m_cacheSegmented && m_seekPossible > 0)
       {
-        // READ_MULTI_STREAM requires double buffering, so use half the amount of memory for each buffer
-        front /= 2;
-        back /= 2;
+        // keeps the data of all streams of READ_MULTI_STREAM as well
+        m_pCache = new CSegmentedCache(front, back);
       }
-      m_pCache = new CCircularCache(front, back);
-      m_forwardCacheSize = front;
-    }
+      else
+      {
+        if (m_flags & READ_MULTI_STREAM)
+        {
+          // READ_MULTI_STREAM requires double buffering, so use half the amount of memory for each buffer
+          front /= 2;
+          back /= 2;
+        }
+        m_pCache = new CCircularCache(front, back);
 
-    if (m_flags & READ_MULTI_STREAM)
-    {
-      // If READ_MULTI_STREAM flag is set: Double buffering is required
-      m_pCache = new CDoubleCache(m_pCache);
+        if (m_flags & READ_MULTI_STREAM)
+        {
+          // If READ_MULTI_STREAM flag is set: Double buffering is required
+          m_pCache = new CDoubleCache(m_pCache);
+        }
+      }
+      m_forwardCacheSize = front;
     }
   }
 
@@ -232,9 +347,31 @@ bool CFileCache::Open(const CURL& url)
   m_writeRateActual = 0;
   m_seekEvent.Reset();
   m_seekEnded.Reset();
+  m_readHits = 0;
+  m_readMisses = 0;
+  m_seekHits = 0;
+  m_seekMisses = 0;
+  m_prefetchBytes = 0;
+
+  // read ahead with additional connections, only the segmented cache keeps
+  // those blocks. Not worth it for files the cache thread reads completely
+  // ahead on its own, unless they are streamed.
+  m_prefetching = g_advancedSettings.m_cachePrefetchThreads > 0 && m_seekPossible > 0 &&
+                  dynamic_cast<CSegmentedCache*>(m_pCache) &&
+                  ((m_flags & READ_AUDIO_VIDEO) || m_fileSize > m_forwardCacheSize);
+  m_prefetchEvent.Reset();
 
   CThread::Create(false);
 
+  if (m_prefetching)
+  {
+    for (unsigned int i = 0; i < g_advancedSettings.m_cachePrefetchThreads; i++)
+    {
+      m_prefetchers.push_back(std::unique_ptr<CPrefetcher>(new CPrefetcher(*this)));
+      m_prefetchers.back()->Create(false);
+    }
+  }
+
   return true;
 }
 
@@ -284,8 +421,15 @@ void CFileCache::Process()
       {
         const bool bCompleteReset = m_pCache->Reset(m_seekPos, false);
         m_readPos = m_seekPos;
-        m_writePos = m_pCache->CachedDataEndPos();
-        assert(m_writePos == cacheMaxPos);
+        m_writePos = m_pCache->SkipCachedData();
+        WakePrefetchers();
+        // blocks read ahead by the prefetch threads may have completed in the meantime
+        if (m_writePos != cacheMaxPos && !cacheReachEOF && m_source.Seek(m_writePos, SEEK_SET) != m_writePos)
+        {
+          CLog::Log(LOGERROR,"CFileCache::Process - Error %d seeking to %" PRId64, (int)GetLastError(), m_writePos);
+          m_seekEnded.Set();
+          break;
+        }
         average.Reset(m_writePos, bCompleteReset); // Can only recalculate new average from scratch after a full reset (empty cache)
         limiter.Reset(m_writePos);
         m_nSeekResult = m_seekPos;
@@ -313,6 +457,23 @@ void CFileCache::Process()
       }
     }
 
+    // continue behind data which is cached already, e.g. read by the prefetch threads
+    if (m_seekPossible > 0 && !cacheReachEOF)
+    {
+      int64_t cacheEndPos = m_pCache->SkipCachedData();
+      if (cacheEndPos != m_writePos)
+      {
+        if (m_source.Seek(cacheEndPos, SEEK_SET) != cacheEndPos)
+        {
+          CLog::Log(LOGERROR,"CFileCache::Process - Error %d seeking to %" PRId64, (int)GetLastError(), cacheEndPos);
+          break;
+        }
+        m_writePos = cacheEndPos;
+        average.Reset(m_writePos, false);
+        limiter.Reset(m_writePos);
+      }
+    }
+
     size_t maxWrite = m_pCache->GetMaxWriteSize(m_chunkSize);
 
     /* Only read from source if there's enough write space in the cache
@@ -407,6 +568,7 @@ void CFileCache::Process()
     }
 
     m_writePos += iTotalWrite;
+    WakePrefetchers();
 
     // under estimate write rate by a second, to
     // avoid uncertainty at start of caching
@@ -445,6 +607,7 @@ ssize_t CFileCache::Read(void* lpBuf, size_t uiBufSize)
     return -1;
   }
   int64_t iRc;
+  bool waited = false;
 
   if (uiBufSize > SSIZE_MAX)
     uiBufSize = SSIZE_MAX;
@@ -454,12 +617,19 @@ retry:
   iRc = m_pCache->ReadFromCache((char *)lpBuf, (size_t)uiBufSize);
   if (iRc > 0)
   {
+    if (!waited)
+      m_readHits++;
     m_readPos += iRc;
+    WakePrefetchers();
     return (int)iRc;
   }
 
   if (iRc == CACHE_RC_WOULD_BLOCK)
   {
+    if (!waited)
+      m_readMisses++;
+    waited = true;
+
     // just wait for some data to show up
     iRc = m_pCache->WaitForData(1, 10000);
     if (iRc > 0)
@@ -502,45 +672,66 @@ int64_t CFileCache::Seek(int64_t iFilePosition, int iWhence)
   if (iTarget == m_readPos)
     return m_readPos;
 
-  if ((m_nSeekResult = m_pCache->Seek(iTarget)) != iTarget)
+  const bool cached = (m_nSeekResult = m_pCache->Seek(iTarget)) == iTarget;
+  if (cached)
   {
+    m_seekHits++;
+
+    /* the data may belong to another range than the one the cache thread
+     * is filling, it has to continue behind the new position then */
+    if (m_seekPossible == 0 || m_pCache->CachedDataEndPosIfSeekTo(iTarget) == m_pCache->CachedDataEndPos())
+    {
+      m_readPos = iTarget;
+      return m_nSeekResult;
+    }
+
+    m_seekPos = iTarget;
+  }
+  else
+  {
+    m_seekMisses++;
+
     if (m_seekPossible == 0)
       return m_nSeekResult;
 
     /* never request closer to end than 2k, speeds up tag reading */
     m_seekPos = std::min(iTarget, std::max((int64_t)0, m_fileSize - m_chunkSize));
+  }
 
-    m_seekEvent.Set();
-    if (!m_seekEnded.Wait())
-    {
-      CLog::Log(LOGWARNING,"%s - seek to %" PRId64" failed.", __FUNCTION__, m_seekPos);
-      return -1;
-    }
+  m_seekEvent.Set();
+  if (!m_seekEnded.Wait())
+  {
+    CLog::Log(LOGWARNING,"%s - seek to %" PRId64" failed.", __FUNCTION__, m_seekPos);
+    return -1;
+  }
 
-    /* wait for any remaining data */
-    if(m_seekPos < iTarget)
+  /* wait for any remaining data */
+  if(m_seekPos < iTarget)
+  {
+    CLog::Log(LOGDEBUG,"%s - waiting for position %" PRId64".", __FUNCTION__, iTarget);
+    if(m_pCache->WaitForData((unsigned)(iTarget - m_seekPos), 10000) < iTarget - m_seekPos)
     {
-      CLog::Log(LOGDEBUG,"%s - waiting for position %" PRId64".", __FUNCTION__, iTarget);
-      if(m_pCache->WaitForData((unsigned)(iTarget - m_seekPos), 10000) < iTarget - m_seekPos)
-      {
-        CLog::Log(LOGWARNING,"%s - failed to get remaining data", __FUNCTION__);
-        return -1;
-      }
-      m_pCache->Seek(iTarget);
+      CLog::Log(LOGWARNING,"%s - failed to get remaining data", __FUNCTION__);
+      return -1;
     }
-    m_readPos = iTarget;
-    m_seekEvent.Reset();
+    m_pCache->Seek(iTarget);
   }
-  else
-    m_readPos = iTarget;
+  m_readPos = iTarget;
+  m_seekEvent.Reset();
 
-  return m_nSeekResult;
+  return cached ? iTarget : m_nSeekResult;
 }
 
 void CFileCache::Close()
 {
   StopThread();
 
+  for (std::vector<std::unique_ptr<CPrefetcher> >::iterator prefetcher = m_prefetchers.begin(); prefetcher != m_prefetchers.end(); ++prefetcher)
+    (*prefetcher)->StopThread(false);
+  m_prefetchEvent.Set();
+  m_prefetchers.clear();
+  m_prefetching = false;
+
   CSingleLock lock(m_sync);
   if (m_pCache)
     m_pCache->Close();
@@ -566,6 +757,26 @@ void CFileCache::StopThread(bool bWait /*= true*/)
   CThread::StopThread(bWait);
 }
 
+void CFileCache::WakePrefetchers()
+{
+  if (m_prefetching)
+    m_prefetchEvent.Set();
+}
+
+bool CFileCache::ReservePrefetch(int64_t& position, size_t& size)
+{
+  int64_t maxPosition = m_fileSize;
+  if (maxPosition <= 0)
+    return false;
+
+  // don't read further ahead than the cache thread is allowed to
+  unsigned writeRate = m_writeRate;
+  if (writeRate > 0)
+    maxPosition = std::min(maxPosition, m_readPos + (int64_t)(writeRate * g_advancedSettings.m_cacheReadFactor));
+
+  return m_pCache->ReservePrefetch(maxPosition, position, size);
+}
+
 std::string CFileCache::GetContent()
 {
   if (!m_source.GetImplementation())
@@ -595,9 +806,21 @@ int CFileCache::IoControl(EIoControl request, void* param)
     return 0;
   }
 
+  if (request == IOCTRL_CACHE_STATS)
+  {
+    SCacheStats* stats = (SCacheStats*)param;
+    stats->readHits      = m_readHits;
+    stats->readMisses    = m_readMisses;
+    stats->seekHits      = m_seekHits;
+    stats->seekMisses    = m_seekMisses;
+    stats->prefetchBytes = m_prefetchBytes;
+    return 0;
+  }
+
   if (request == IOCTRL_CACHE_SETRATE)
   {
     m_writeRate = *(unsigned*)param;
+    WakePrefetchers();
     return 0;
   }
 
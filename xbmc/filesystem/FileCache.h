@@ -25,6 +25,8 @@
 #include "File.h"
 #include "threads/Thread.h"
 #include <atomic>
+#include <memory>
+#include <vector>
 
 namespace XFILE
 {
@@ -63,6 +65,11 @@ namespace XFILE
     virtual std::string GetContentCharset(void);
 
   private:
+    class CPrefetcher;
+
+    bool ReservePrefetch(int64_t& position, size_t& size);
+    void WakePrefetchers();
+
     CCacheStrategy *m_pCache;
     bool      m_bDeleteCache;
     int        m_seekPossible;
@@ -81,6 +88,14 @@ namespace XFILE
     std::atomic<int64_t> m_fileSize;
     unsigned int m_flags;
     CCriticalSection m_sync;
+    std::vector<std::unique_ptr<CPrefetcher> > m_prefetchers;
+    std::atomic<uint64_t> m_readHits;
+    std::atomic<uint64_t> m_readMisses;
+    std::atomic<uint64_t> m_seekHits;
+    std::atomic<uint64_t> m_seekMisses;
+    std::atomic<uint64_t> m_prefetchBytes;
+    CEvent m_prefetchEvent;  /**< set when there may be more to read ahead, or to stop the prefetchers */
+    bool m_prefetching;      /**< prefetchers are running, only changed while the cache thread isn't */
   };
 
 }
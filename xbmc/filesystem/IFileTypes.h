@@ -66,6 +66,21 @@ struct SCacheStatus
   float    level;    /**< cache level (0.0 - 1.0) */
 };
 
+struct SCacheStats
+{
+  uint64_t readHits;      /**< reads served by the cache right away */
+  uint64_t readMisses;    /**< reads which had to wait for the source */
+  uint64_t seekHits;      /**< seeks to data which was already cached */
+  uint64_t seekMisses;    /**< seeks which required a seek on the source */
+  uint64_t prefetchBytes; /**< number of bytes read ahead by additional readers of the source */
+};
+
+struct SFileMapping
+{
+  const uint8_t* data; /**< read only view of the file, valid until it's closed */
+  int64_t size;        /**< number of bytes mapped, the file may have grown since */
+};
+
 typedef enum {
   IOCTRL_NATIVE        = 1,  /**< SNativeIoControl structure, containing what should be passed to native ioctrl */
   IOCTRL_SEEK_POSSIBLE = 2,  /**< return 0 if known not to work, 1 if it should work */
@@ -73,6 +88,8 @@ typedef enum {
   IOCTRL_CACHE_SETRATE = 4,  /**< unsigned int with speed limit for caching in bytes per second */
   IOCTRL_SET_CACHE     = 8,  /**< CFileCache */
   IOCTRL_SET_RETRY     = 16, /**< Enable/disable retry within the protocol handler (if supported) */
+  IOCTRL_CACHE_STATS   = 32, /**< SCacheStats structure */
+  IOCTRL_FILE_MAPPING  = 64, /**< SFileMapping structure, only supported by memory mapped files */
 } EIoControl;
 
 enum CURLOPTIONTYPE
@@ -0,0 +1,455 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SegmentedCache.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+
+using namespace XFILE;
+
+CSegmentedCache::CSegmentedCache(size_t front, size_t back, size_t blockSize /* = DefaultBlockSize */)
+ : CCacheStrategy()
+ , m_front(front)
+ , m_back(back)
+ , m_blockSize(blockSize)
+ , m_maxBlocks((front + back) / blockSize)
+ , m_cur(0)
+ , m_write(0)
+ , m_allocated(0)
+{
+  // the blocks between reader and writer can't be dropped, leave room for
+  // the front buffer, the partially read and written blocks and some history
+  m_maxBlocks = std::max(m_maxBlocks, front / blockSize + 3);
+}
+
+CSegmentedCache::~CSegmentedCache()
+{
+  Close();
+}
+
+int CSegmentedCache::Open()
+{
+  CSingleLock lock(m_sync);
+  m_cur = 0;
+  m_write = 0;
+  return CACHE_RC_OK;
+}
+
+void CSegmentedCache::Close()
+{
+  CSingleLock lock(m_sync);
+  for (BlockMap::iterator block = m_blocks.begin(); block != m_blocks.end(); ++block)
+    delete[] block->second.data;
+  for (std::vector<uint8_t*>::iterator data = m_free.begin(); data != m_free.end(); ++data)
+    delete[] *data;
+
+  m_blocks.clear();
+  m_lru.clear();
+  m_free.clear();
+  m_allocated = 0;
+}
+
+size_t CSegmentedCache::GetMaxWriteSize(const size_t& iRequestSize)
+{
+  CSingleLock lock(m_sync);
+
+  // the data is being read by someone else
+  SBlock *block = GetBlock(m_write / m_blockSize);
+  if (block && block->pending)
+    return 0;
+
+  // only write data the reader is going to need
+  if (!IsReaderAtWriter())
+    return 0;
+
+  int64_t front = m_write - m_cur;
+  if (front >= (int64_t)m_front)
+    return 0;
+
+  size_t limit = m_blockSize - (size_t)(m_write % m_blockSize);
+  if (front > 0)
+    limit = std::min(limit, m_front - (size_t)front);
+
+  return std::min(iRequestSize, limit);
+}
+
+/**
+ * Writes to the block of the current write position, so
+ * multiple calls may be needed to write all data.
+ *
+ * Data which is already cached is overwritten, it's the same.
+ */
+int CSegmentedCache::WriteToCache(const char *buf, size_t len)
+{
+  CSingleLock lock(m_sync);
+
+  int64_t index = m_write / m_blockSize;
+  size_t offset = (size_t)(m_write % m_blockSize);
+
+  SBlock *block = GetBlock(index);
+  if (!block)
+  {
+    block = AddBlock(index);
+    if (!block)
+      return 0;
+  }
+
+  if (block->pending)
+    return 0;
+
+  // blocks are always filled from their start
+  if (offset > block->filled)
+    return CACHE_RC_ERROR;
+
+  len = std::min(len, m_blockSize - offset);
+  if (len == 0)
+    return 0;
+
+  memcpy(block->data + offset, buf, len);
+  block->filled = std::max(block->filled, offset + len);
+  m_write += len;
+  Touch(*block);
+
+  m_written.Set();
+
+  return len;
+}
+
+int CSegmentedCache::ReadFromCache(char *buf, size_t len)
+{
+  CSingleLock lock(m_sync);
+
+  size_t offset = (size_t)(m_cur % m_blockSize);
+  SBlock *block = GetBlock(m_cur / m_blockSize);
+  if (!block || block->pending || offset >= block->filled)
+  {
+    if (IsEndOfInput())
+      return 0;
+    else
+      return CACHE_RC_WOULD_BLOCK;
+  }
+
+  len = std::min(len, block->filled - offset);
+  if (len == 0)
+    return 0;
+
+  memcpy(buf, block->data + offset, len);
+  m_cur += len;
+  Touch(*block);
+
+  m_space.Set();
+
+  return len;
+}
+
+int64_t CSegmentedCache::WaitForData(unsigned int minimum, unsigned int millis)
+{
+  CSingleLock lock(m_sync);
+  int64_t avail = std::max(GetRangeEnd(m_cur) - m_cur, (int64_t)0);
+
+  if (millis == 0 || IsEndOfInput())
+    return avail;
+
+  if (minimum > m_front)
+    minimum = m_front;
+
+  XbmcThreads::EndTime endtime(millis);
+  while (!IsEndOfInput() && avail < minimum && !endtime.IsTimePast())
+  {
+    lock.Leave();
+    m_written.WaitMSec(50); // may miss the deadline. shouldn't be a problem.
+    lock.Enter();
+    avail = std::max(GetRangeEnd(m_cur) - m_cur, (int64_t)0);
+  }
+
+  return avail;
+}
+
+int64_t CSegmentedCache::Seek(int64_t pos)
+{
+  CSingleLock lock(m_sync);
+
+  // if seek is a bit over what we have, try to wait a few seconds for the data to be available.
+  // we try to avoid a (heavy) seek on the source
+  if (pos >= m_write && pos < m_write + 100000 && IsReaderAtWriter())
+  {
+    m_cur = m_write;
+    lock.Leave();
+    WaitForData((size_t)(pos - m_cur), 5000);
+    lock.Enter();
+  }
+
+  if (IsCached(pos))
+  {
+    m_cur = pos;
+    return pos;
+  }
+
+  return CACHE_RC_ERROR;
+}
+
+bool CSegmentedCache::Reset(int64_t pos, bool clearAnyway)
+{
+  CSingleLock lock(m_sync);
+
+  if (clearAnyway)
+  {
+    for (BlockMap::iterator block = m_blocks.begin(); block != m_blocks.end(); )
+    {
+      if (block->second.pending)
+        ++block;
+      else
+        RemoveBlock(block++);
+    }
+  }
+
+  bool cached = IsCached(pos);
+  m_cur = pos;
+  m_write = GetResumePosition(pos);
+
+  return !cached;
+}
+
+int64_t CSegmentedCache::CachedDataEndPosIfSeekTo(int64_t iFilePosition)
+{
+  CSingleLock lock(m_sync);
+  return GetResumePosition(iFilePosition);
+}
+
+int64_t CSegmentedCache::CachedDataEndPos()
+{
+  CSingleLock lock(m_sync);
+  return GetResumePosition(m_write);
+}
+
+bool CSegmentedCache::IsCachedPosition(int64_t iFilePosition)
+{
+  CSingleLock lock(m_sync);
+  return IsCached(iFilePosition);
+}
+
+int64_t CSegmentedCache::SkipCachedData()
+{
+  CSingleLock lock(m_sync);
+  m_write = GetResumePosition(m_write);
+  return m_write;
+}
+
+bool CSegmentedCache::ReservePrefetch(int64_t iMaxPosition, int64_t& iPosition, size_t& iSize)
+{
+  CSingleLock lock(m_sync);
+
+  if (!IsReaderAtWriter())
+    return false;
+
+  // the block being written belongs to the writer
+  int64_t limit = std::min(iMaxPosition, m_cur + (int64_t)m_front);
+  for (int64_t index = m_write / m_blockSize + 1; index * (int64_t)m_blockSize < limit; index++)
+  {
+    if (GetBlock(index))
+      continue;
+
+    SBlock *block = AddBlock(index);
+    if (!block)
+      return false;
+
+    block->pending = true;
+    iPosition = index * m_blockSize;
+    iSize = (size_t)std::min((int64_t)m_blockSize, iMaxPosition - iPosition);
+    return true;
+  }
+
+  return false;
+}
+
+void CSegmentedCache::WritePrefetched(int64_t iPosition, const char *pBuffer, size_t iSize)
+{
+  CSingleLock lock(m_sync);
+
+  BlockMap::iterator block = m_blocks.find(iPosition / m_blockSize);
+  if (block == m_blocks.end() || !block->second.pending)
+    return;
+
+  block->second.pending = false;
+  if (iSize == 0)
+  {
+    RemoveBlock(block);
+    return;
+  }
+
+  block->second.filled = std::min(iSize, m_blockSize);
+  memcpy(block->second.data, pBuffer, block->second.filled);
+  Touch(block->second);
+
+  m_written.Set();
+}
+
+CCacheStrategy *CSegmentedCache::CreateNew()
+{
+  return new CSegmentedCache(m_front, m_back, m_blockSize);
+}
+
+size_t CSegmentedCache::GetRangeCount()
+{
+  CSingleLock lock(m_sync);
+
+  size_t ranges = 0;
+  bool open = false;
+  int64_t next = -1;
+  for (BlockMap::const_iterator block = m_blocks.begin(); block != m_blocks.end(); ++block)
+  {
+    if (block->second.pending || block->second.filled == 0)
+    {
+      open = false;
+      continue;
+    }
+
+    if (!open || block->first != next)
+      ranges++;
+
+    open = block->second.filled == m_blockSize;
+    next = block->first + 1;
+  }
+
+  return ranges;
+}
+
+CSegmentedCache::SBlock* CSegmentedCache::GetBlock(int64_t index)
+{
+  BlockMap::iterator block = m_blocks.find(index);
+  if (block == m_blocks.end())
+    return NULL;
+  return &block->second;
+}
+
+CSegmentedCache::SBlock* CSegmentedCache::AddBlock(int64_t index)
+{
+  uint8_t *data = NULL;
+  if (!m_free.empty())
+  {
+    data = m_free.back();
+    m_free.pop_back();
+  }
+  else if (m_allocated < m_maxBlocks)
+  {
+    data = new uint8_t[m_blockSize];
+    m_allocated++;
+  }
+  else
+  {
+    // drop the least recently used block the reader doesn't need right now
+    for (std::list<int64_t>::reverse_iterator lru = m_lru.rbegin(); lru != m_lru.rend(); ++lru)
+    {
+      BlockMap::iterator block = m_blocks.find(*lru);
+      if (block->second.pending || IsProtected(block->first))
+        continue;
+
+      data = block->second.data;
+      m_lru.erase(block->second.lru);
+      m_blocks.erase(block);
+      break;
+    }
+
+    if (!data)
+      return NULL;
+  }
+
+  SBlock &block = m_blocks[index];
+  block.data = data;
+  block.filled = 0;
+  block.pending = false;
+  block.lru = m_lru.insert(m_lru.begin(), index);
+  return &block;
+}
+
+void CSegmentedCache::RemoveBlock(BlockMap::iterator block)
+{
+  m_lru.erase(block->second.lru);
+  m_free.push_back(block->second.data);
+  m_blocks.erase(block);
+}
+
+void CSegmentedCache::Touch(SBlock &block)
+{
+  m_lru.splice(m_lru.begin(), m_lru, block.lru);
+}
+
+bool CSegmentedCache::IsProtected(int64_t index) const
+{
+  int64_t first = std::min(m_cur, m_write) / m_blockSize;
+  int64_t last = std::max(m_cur, m_write) / m_blockSize;
+  return index >= first && index <= last;
+}
+
+/**
+ * Returns the end of the data cached contiguously from pos on
+ * or -1 if pos itself isn't cached.
+ */
+int64_t CSegmentedCache::GetRangeEnd(int64_t pos)
+{
+  int64_t index = pos / m_blockSize;
+  SBlock *block = GetBlock(index);
+  if (!block || block->pending || (size_t)(pos % m_blockSize) >= block->filled)
+    return -1;
+
+  int64_t end = index * m_blockSize + block->filled;
+  while (block->filled == m_blockSize)
+  {
+    block = GetBlock(++index);
+    if (!block || block->pending)
+      break;
+    end += block->filled;
+  }
+
+  return end;
+}
+
+/**
+ * Returns the position the source has to be read from so pos becomes
+ * available, blocks are always filled from their start.
+ */
+int64_t CSegmentedCache::GetResumePosition(int64_t pos)
+{
+  int64_t end = GetRangeEnd(pos);
+  if (end >= 0)
+    return end;
+
+  int64_t start = pos - pos % m_blockSize;
+  SBlock *block = GetBlock(pos / m_blockSize);
+  if (block && !block->pending)
+    return start + block->filled;
+
+  return start;
+}
+
+bool CSegmentedCache::IsCached(int64_t pos)
+{
+  return pos == m_write || GetRangeEnd(pos) >= 0;
+}
+
+bool CSegmentedCache::IsReaderAtWriter()
+{
+  return GetResumePosition(m_cur) == GetResumePosition(m_write);
+}
@@ -0,0 +1,112 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "CacheStrategy.h"
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
+
+namespace XFILE {
+
+/*!
+ \brief Memory cache keeping several disjoint ranges of a file
+
+ The file is cached in blocks of a fixed size. Seeking outside of the range
+ being read doesn't discard anything, blocks are only dropped when the memory
+ is needed for new data, least recently used first. Blocks ahead of the write
+ position can be filled by other readers of the source (see ReservePrefetch()).
+
+ Every block holds the data from its start up to the number of bytes filled,
+ so a range ends at the first block which is missing or not completely filled.
+ */
+class CSegmentedCache : public CCacheStrategy
+{
+public:
+  static const size_t DefaultBlockSize = 256 * 1024;
+
+  CSegmentedCache(size_t front, size_t back, size_t blockSize = DefaultBlockSize);
+  virtual ~CSegmentedCache();
+
+  virtual int Open();
+  virtual void Close();
+
+  virtual size_t GetMaxWriteSize(const size_t& iRequestSize);
+  virtual int WriteToCache(const char *buf, size_t len);
+  virtual int ReadFromCache(char *buf, size_t len);
+  virtual int64_t WaitForData(unsigned int minimum, unsigned int iMillis);
+
+  virtual int64_t Seek(int64_t pos);
+  virtual bool Reset(int64_t pos, bool clearAnyway=true);
+
+  virtual int64_t CachedDataEndPosIfSeekTo(int64_t iFilePosition);
+  virtual int64_t CachedDataEndPos();
+  virtual bool IsCachedPosition(int64_t iFilePosition);
+
+  virtual int64_t SkipCachedData();
+  virtual bool ReservePrefetch(int64_t iMaxPosition, int64_t& iPosition, size_t& iSize);
+  virtual void WritePrefetched(int64_t iPosition, const char *pBuffer, size_t iSize);
+
+  virtual CCacheStrategy *CreateNew();
+
+  /*!
+   \brief Number of disjoint ranges currently cached
+   */
+  size_t GetRangeCount();
+
+protected:
+  struct SBlock
+  {
+    uint8_t *data;
+    size_t filled;                       /**< bytes valid from the start of the block */
+    bool pending;                        /**< reserved by ReservePrefetch(), not readable yet */
+    std::list<int64_t>::iterator lru;
+  };
+  typedef std::map<int64_t, SBlock> BlockMap;
+
+  SBlock* GetBlock(int64_t index);
+  SBlock* AddBlock(int64_t index);
+  void RemoveBlock(BlockMap::iterator block);
+  void Touch(SBlock &block);
+  bool IsProtected(int64_t index) const;
+  int64_t GetRangeEnd(int64_t pos);
+  int64_t GetResumePosition(int64_t pos);
+  bool IsCached(int64_t pos);
+  bool IsReaderAtWriter();
+
+  size_t            m_front;      /**< maximum amount of data ahead of the read position */
+  size_t            m_back;
+  size_t            m_blockSize;
+  size_t            m_maxBlocks;
+  int64_t           m_cur;        /**< current reading index in file */
+  int64_t           m_write;      /**< index in file the next write goes to */
+  BlockMap          m_blocks;
+  std::list<int64_t> m_lru;       /**< block indexes, most recently used first */
+  std::vector<uint8_t*> m_free;   /**< buffers of dropped blocks */
+  size_t            m_allocated;
+  CCriticalSection  m_sync;
+  CEvent            m_written;
+};
+
+} // namespace XFILE
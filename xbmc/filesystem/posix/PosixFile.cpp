@@ -25,24 +25,38 @@
 #include "URL.h"
 #include "utils/log.h"
 #include "filesystem/File.h"
+#include "settings/AdvancedSettings.h"
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string>
+#include <string.h>
 #include <assert.h>
 #include <limits.h>
 #include <algorithm>
 #include <sys/ioctl.h>
 #include <errno.h>
+#if defined(TARGET_LINUX) || defined(TARGET_ANDROID)
+#include <sys/vfs.h>
+#elif defined(TARGET_DARWIN) || defined(TARGET_FREEBSD)
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
+
+// amount of data the kernel is asked to read ahead of a mapped file position
+#define MAPPING_READAHEAD (4 * 1024 * 1024)
 
 using namespace XFILE;
 
 CPosixFile::CPosixFile() :
-  m_fd(-1), m_filePos(-1), m_lastDropPos(-1), m_allowWrite(false)
+  m_fd(-1), m_filePos(-1), m_lastDropPos(-1), m_allowWrite(false),
+  m_mapping(NULL), m_mappingSize(0), m_adviseEnd(0)
 { }
 
 CPosixFile::~CPosixFile()
 {
+  UnmapFile();
   if (m_fd >= 0)
     close(m_fd);
 }
@@ -57,6 +71,51 @@ static std::string getFilename(const CURL& url)
   return filename;
 }
 
+// local helper, true if the file is on a filesystem backed by a local disk or
+// memory. Mapped files on network, FUSE and removable filesystems raise SIGBUS
+// on I/O errors, those are read with read() instead.
+static bool isOnLocalDisk(int fd)
+{
+#if defined(TARGET_LINUX) || defined(TARGET_ANDROID)
+  static const unsigned long localTypes[] = {
+    0xEF53,      // ext2, ext3, ext4
+    0x58465342,  // xfs
+    0x9123683E,  // btrfs
+    0xF2F52010,  // f2fs
+    0x52654973,  // reiserfs
+    0x3153464A,  // jfs
+    0x2FC12FC1,  // zfs
+    0x01021994   // tmpfs, in memory
+  };
+
+  struct statfs fs;
+  if (fstatfs(fd, &fs) != 0)
+    return false;
+
+  for (size_t i = 0; i < sizeof(localTypes) / sizeof(localTypes[0]); i++)
+  {
+    if ((unsigned long)fs.f_type == localTypes[i])
+      return true;
+  }
+  return false;
+#elif defined(TARGET_DARWIN) || defined(TARGET_FREEBSD)
+  static const char* localTypes[] = { "apfs", "hfs", "ufs", "zfs" };
+
+  struct statfs fs;
+  if (fstatfs(fd, &fs) != 0 || !(fs.f_flags & MNT_LOCAL))
+    return false;
+
+  for (size_t i = 0; i < sizeof(localTypes) / sizeof(localTypes[0]); i++)
+  {
+    if (strcmp(fs.f_fstypename, localTypes[i]) == 0)
+      return true;
+  }
+  return false;
+#else
+  return false;
+#endif
+}
+
 
 bool CPosixFile::Open(const CURL& url)
 {
@@ -69,6 +128,8 @@ bool CPosixFile::Open(const CURL& url)
   
   m_fd = open(filename.c_str(), O_RDONLY, S_IRUSR | S_IRGRP | S_IROTH);
   m_filePos = 0;
+  if (m_fd != -1)
+    MapFile();
   
   return m_fd != -1;
 }
@@ -96,6 +157,7 @@ void CPosixFile::Close()
 {
   if (m_fd >= 0)
   {
+    UnmapFile();
     close(m_fd);
     m_fd = -1;
     m_filePos = -1;
@@ -116,6 +178,28 @@ ssize_t CPosixFile::Read(void* lpBuf, size_t uiBufSize)
 
   if (uiBufSize > SSIZE_MAX)
     uiBufSize = SSIZE_MAX;
+
+  if (m_mapping)
+  {
+    ssize_t res;
+    if (m_filePos < m_mappingSize)
+    {
+      res = (ssize_t)std::min<int64_t>(uiBufSize, m_mappingSize - m_filePos);
+      memcpy(lpBuf, m_mapping + m_filePos, res);
+    }
+    else
+    {
+      // the file has grown since it was mapped
+      res = pread(m_fd, lpBuf, uiBufSize, m_filePos);
+      if (res < 0)
+        return -1;
+    }
+
+    m_filePos += res;
+    AdviseMapping();
+    DropCache();
+    return res;
+  }
   
   const ssize_t res = read(m_fd, lpBuf, uiBufSize);
   if (res < 0)
@@ -127,21 +211,7 @@ ssize_t CPosixFile::Read(void* lpBuf, size_t uiBufSize)
   if (m_filePos >= 0)
   {
     m_filePos += res; // if m_filePos was known - update it
-#if defined(HAVE_POSIX_FADVISE)
-    // Drop the cache between then last drop and 16 MB behind where we
-    // are now, to make sure the file doesn't displace everything else.
-    // However, never throw out the first 16 MB of the file, as it might
-    // be the header etc., and never ask the OS to drop in chunks of
-    // less than 1 MB.
-    const int64_t end_drop = m_filePos - 16 * 1024 * 1024;
-    if (end_drop >= 17 * 1024 * 1024)
-    {
-      const int64_t start_drop = std::max<int64_t>(m_lastDropPos, 16 * 1024 * 1024);
-      if (end_drop - start_drop >= 1 * 1024 * 1024 &&
-          posix_fadvise(m_fd, start_drop, end_drop - start_drop, POSIX_FADV_DONTNEED) == 0)
-        m_lastDropPos = end_drop;
-    }
-#endif
+    DropCache();
   }
 
   return res;
@@ -176,6 +246,38 @@ int64_t CPosixFile::Seek(int64_t iFilePosition, int iWhence /* = SEEK_SET*/)
 {
   if (m_fd < 0)
     return -1;
+
+  if (m_mapping)
+  {
+    // the position is only tracked here, reads don't use the file offset
+    int64_t target;
+    switch (iWhence)
+    {
+    case SEEK_SET:
+      target = iFilePosition;
+      break;
+    case SEEK_CUR:
+      target = m_filePos + iFilePosition;
+      break;
+    case SEEK_END:
+    {
+      const int64_t length = GetLength();
+      if (length < 0)
+        return -1;
+      target = length + iFilePosition;
+      break;
+    }
+    default:
+      return -1;
+    }
+
+    if (target < 0)
+      return -1;
+
+    m_filePos = target;
+    AdviseMapping();
+    return m_filePos;
+  }
   
 #ifdef TARGET_ANDROID
   //! @todo properly support with detection in configure
@@ -278,10 +380,119 @@ int CPosixFile::IoControl(EIoControl request, void* param)
         return 0; // size of file is 1 byte or more and seeking not possible
     }
   }
+  else if (request == IOCTRL_FILE_MAPPING)
+  {
+    if (!param || !m_mapping)
+      return -1;
+    SFileMapping* mapping = (SFileMapping*)param;
+    mapping->data = m_mapping;
+    mapping->size = m_mappingSize;
+    return 0;
+  }
   
   return -1;
 }
 
+/*!
+ Maps files on local disks opened for reading which are at least
+ advancedsettings' cache/mmapminsize bytes big, saving a copy from the page
+ cache into the kernel's read buffer and a syscall per read. Only done on
+ 64 bit systems, where address space isn't an issue.
+
+ \note if another process truncates the file while it's mapped, accessing the
+ missing pages raises SIGBUS. Files which are being written by ourselves,
+ like the cache of CSimpleFileCache, are opened before they have grown to the
+ minimum size and aren't mapped. Filesystems where I/O errors are to be
+ expected (network shares, FUSE, FAT formatted removable media) aren't mapped
+ at all.
+ */
+void CPosixFile::MapFile()
+{
+  if (sizeof(void*) < 8 || g_advancedSettings.m_mmapMinSize == 0)
+    return;
+
+  struct stat64 st;
+  if (fstat64(m_fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < (int64_t)g_advancedSettings.m_mmapMinSize)
+    return;
+
+  if (!isOnLocalDisk(m_fd))
+    return;
+
+  void* mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED)
+  {
+    CLog::LogF(LOGDEBUG, "Failed to map file, reading it instead (error %d)", errno);
+    return;
+  }
+
+  madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+  m_mapping = (uint8_t*)mapping;
+  m_mappingSize = st.st_size;
+  m_adviseEnd = 0;
+  AdviseMapping();
+}
+
+void CPosixFile::UnmapFile()
+{
+  if (!m_mapping)
+    return;
+
+  munmap(m_mapping, (size_t)m_mappingSize);
+  m_mapping = NULL;
+  m_mappingSize = 0;
+  m_adviseEnd = 0;
+}
+
+/*!
+ Asks the kernel to read the range ahead of the position again once half of
+ the previously advised range is used up or the position moved out of it.
+ */
+void CPosixFile::AdviseMapping()
+{
+  if (m_filePos >= m_mappingSize)
+    return;
+
+  if (m_filePos + MAPPING_READAHEAD / 2 <= m_adviseEnd && m_filePos >= m_adviseEnd - MAPPING_READAHEAD)
+    return;
+
+  static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+  const int64_t start = m_filePos - m_filePos % pageSize;
+  const int64_t end = std::min<int64_t>(m_filePos + MAPPING_READAHEAD, m_mappingSize);
+  if (madvise(m_mapping + start, (size_t)(end - start), MADV_WILLNEED) == 0)
+    m_adviseEnd = end;
+}
+
+void CPosixFile::DropCache()
+{
+#if defined(HAVE_POSIX_FADVISE)
+  // Drop the cache between then last drop and 16 MB behind where we
+  // are now, to make sure the file doesn't displace everything else.
+  // However, never throw out the first 16 MB of the file, as it might
+  // be the header etc., and never ask the OS to drop in chunks of
+  // less than 1 MB.
+  const int64_t end_drop = m_filePos - 16 * 1024 * 1024;
+  if (end_drop >= 17 * 1024 * 1024)
+  {
+    const int64_t start_drop = std::max<int64_t>(m_lastDropPos, 16 * 1024 * 1024);
+    if (end_drop - start_drop >= 1 * 1024 * 1024)
+    {
+      // pages still mapped by us can't be dropped from the page cache
+      if (m_mapping)
+      {
+        static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+        const int64_t start_page = (start_drop + pageSize - 1) / pageSize * pageSize;
+        const int64_t end_page = std::min(end_drop, m_mappingSize) / pageSize * pageSize;
+        if (end_page > start_page)
+          madvise(m_mapping + start_page, (size_t)(end_page - start_page), MADV_DONTNEED);
+      }
+
+      if (posix_fadvise(m_fd, start_drop, end_drop - start_drop, POSIX_FADV_DONTNEED) == 0)
+        m_lastDropPos = end_drop;
+    }
+  }
+#endif
+}
+
 
 bool CPosixFile::Delete(const CURL& url)
 {
@@ -50,10 +50,18 @@ namespace XFILE
     virtual int Stat(struct __stat64* buffer);
 
   protected:
+    void MapFile();
+    void UnmapFile();
+    void AdviseMapping();
+    void DropCache();
+
     int     m_fd;
     int64_t m_filePos;
     int64_t m_lastDropPos;
     bool    m_allowWrite;
+    uint8_t* m_mapping;     /**< read only mapping of the file, NULL if it's read with read() */
+    int64_t m_mappingSize;
+    int64_t m_adviseEnd;    /**< end of the range the kernel was told we'll need soon */
   };
   
 }
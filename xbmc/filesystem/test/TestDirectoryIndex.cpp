@@ -0,0 +1,203 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if defined(TARGET_POSIX)
+
+#include "FileItem.h"
+#include "URL.h"
+#include "filesystem/Directory.h"
+#include "filesystem/DirectoryIndex.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <time.h>
+#include <utime.h>
+
+using namespace XFILE;
+
+class TestDirectoryIndex : public testing::Test
+{
+protected:
+  TestDirectoryIndex()
+  {
+    m_root = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestDirectoryIndex");
+    m_media = URIUtils::AddFileToFolder(m_root, "media/");
+    m_oldProfile = CSpecialProtocol::TranslatePath("special://profile/");
+
+    std::string profile = URIUtils::AddFileToFolder(m_root, "profile/");
+    CDirectory::Create(profile);
+    CSpecialProtocol::SetProfilePath(profile);
+    CDirectory::Create("special://profile/directoryindex");
+    CDirectory::Create(m_media);
+
+    for (int i = 0; i < 10; i++)
+    {
+      CFile file;
+      file.OpenForWrite(URIUtils::AddFileToFolder(m_media, StringUtils::Format("file%i.mkv", i)), true);
+      file.Write("data", 4);
+      file.Close();
+    }
+
+    // make the directory old enough to be indexed
+    struct utimbuf times;
+    times.actime = times.modtime = time(NULL) - 60;
+    utime(m_media.c_str(), &times);
+  }
+
+  virtual ~TestDirectoryIndex()
+  {
+    CDirectoryIndex::GetInstance().Invalidate(m_media);
+    CSpecialProtocol::SetProfilePath(m_oldProfile);
+    CDirectory::RemoveRecursive(m_root);
+  }
+
+  // forgets the entries and watches of the profile
+  void ReloadProfile()
+  {
+    std::string profile = CSpecialProtocol::TranslatePath("special://profile/");
+    CSpecialProtocol::SetProfilePath(URIUtils::AddFileToFolder(m_root, "other/"));
+    CFileItemList items;
+    int64_t mtime;
+    CDirectoryIndex::GetInstance().Lookup(CURL(m_root), DIR_FLAG_DEFAULTS, items, mtime);
+    CSpecialProtocol::SetProfilePath(profile);
+  }
+
+  std::string m_root;
+  std::string m_media;
+  std::string m_oldProfile;
+};
+
+TEST_F(TestDirectoryIndex, StoresListing)
+{
+  CDirectoryIndex &index = CDirectoryIndex::GetInstance();
+  CURL url(m_media);
+
+  CFileItemList items;
+  int64_t mtime;
+  EXPECT_FALSE(index.Lookup(url, DIR_FLAG_DEFAULTS, items, mtime));
+  EXPECT_GT(mtime, 0);
+
+  ASSERT_TRUE(CDirectory::GetDirectory(url, items, "", DIR_FLAG_BYPASS_CACHE));
+  ASSERT_EQ(10, items.Size());
+  index.Store(url, DIR_FLAG_DEFAULTS, items, mtime);
+
+  CFileItemList indexed;
+  int64_t indexedTime;
+  ASSERT_TRUE(index.Lookup(url, DIR_FLAG_DEFAULTS, indexed, indexedTime));
+  EXPECT_EQ(mtime, indexedTime);
+  ASSERT_EQ(items.Size(), indexed.Size());
+  for (int i = 0; i < items.Size(); i++)
+  {
+    EXPECT_EQ(items[i]->GetPath(), indexed[i]->GetPath());
+    EXPECT_EQ(items[i]->m_dwSize, indexed[i]->m_dwSize);
+  }
+
+  int64_t directoryTime;
+  EXPECT_TRUE(index.GetModificationTime(m_media, directoryTime));
+  EXPECT_EQ(mtime, directoryTime);
+
+  index.Invalidate(m_media);
+  EXPECT_FALSE(index.GetModificationTime(m_media, directoryTime));
+  EXPECT_FALSE(index.Lookup(url, DIR_FLAG_DEFAULTS, indexed, indexedTime));
+}
+
+TEST_F(TestDirectoryIndex, DetectsChanges)
+{
+  CDirectoryIndex &index = CDirectoryIndex::GetInstance();
+  CURL url(m_media);
+
+  CFileItemList items;
+  int64_t mtime;
+  EXPECT_FALSE(index.Lookup(url, DIR_FLAG_NO_FILE_INFO, items, mtime));
+  ASSERT_TRUE(CDirectory::GetDirectory(url, items, "", DIR_FLAG_BYPASS_CACHE | DIR_FLAG_NO_FILE_INFO));
+  index.Store(url, DIR_FLAG_NO_FILE_INFO, items, mtime);
+
+  // a listing without file info doesn't do if it's needed
+  CFileItemList indexed;
+  int64_t indexedTime;
+  EXPECT_TRUE(index.Lookup(url, DIR_FLAG_NO_FILE_INFO, indexed, indexedTime));
+  EXPECT_FALSE(index.Lookup(url, DIR_FLAG_DEFAULTS, indexed, indexedTime));
+  EXPECT_EQ(0, indexed.Size());
+
+  // a new file changes the modification time of the directory
+  ASSERT_TRUE(CDirectory::GetDirectory(url, items, "", DIR_FLAG_BYPASS_CACHE));
+  index.Store(url, DIR_FLAG_DEFAULTS, items, indexedTime);
+  CFile file;
+  ASSERT_TRUE(file.OpenForWrite(URIUtils::AddFileToFolder(m_media, "new.mkv"), true));
+  file.Close();
+  EXPECT_FALSE(index.Lookup(url, DIR_FLAG_DEFAULTS, indexed, indexedTime));
+  EXPECT_NE(mtime, indexedTime);
+}
+
+TEST_F(TestDirectoryIndex, ServesUnwatchedListing)
+{
+  CDirectoryIndex &index = CDirectoryIndex::GetInstance();
+  CURL url(m_media);
+
+  CFileItemList items;
+  int64_t mtime;
+  EXPECT_FALSE(index.Lookup(url, DIR_FLAG_DEFAULTS, items, mtime));
+  ASSERT_TRUE(CDirectory::GetDirectory(url, items, "", DIR_FLAG_BYPASS_CACHE));
+  index.Store(url, DIR_FLAG_DEFAULTS, items, mtime);
+
+  // the stored listing is used as long as the directory is unchanged
+  ReloadProfile();
+  CFileItemList indexed;
+  int64_t indexedTime;
+  EXPECT_TRUE(index.Lookup(url, DIR_FLAG_DEFAULTS, indexed, indexedTime));
+  EXPECT_EQ(items.Size(), indexed.Size());
+
+  ReloadProfile();
+  CFile file;
+  ASSERT_TRUE(file.OpenForWrite(URIUtils::AddFileToFolder(m_media, "new.mkv"), true));
+  file.Close();
+  EXPECT_FALSE(index.Lookup(url, DIR_FLAG_DEFAULTS, indexed, indexedTime));
+  EXPECT_NE(mtime, indexedTime);
+}
+
+TEST_F(TestDirectoryIndex, PrunesIndex)
+{
+  std::string folder = CSpecialProtocol::TranslatePath("special://profile/directoryindex/");
+  std::string old = URIUtils::AddFileToFolder(folder, "00000001.idx");
+  std::string recent = URIUtils::AddFileToFolder(folder, "00000002.idx");
+  CFile file;
+  ASSERT_TRUE(file.OpenForWrite(old, true));
+  file.Close();
+  ASSERT_TRUE(file.OpenForWrite(recent, true));
+  file.Close();
+
+  struct utimbuf times;
+  times.actime = times.modtime = time(NULL) - 60 * 24 * 60 * 60;
+  utime(old.c_str(), &times);
+
+  // listings are pruned when the profile is loaded
+  ReloadProfile();
+  CFileItemList items;
+  int64_t mtime;
+  CDirectoryIndex::GetInstance().Lookup(CURL(m_media), DIR_FLAG_DEFAULTS, items, mtime);
+  EXPECT_FALSE(CFile::Exists(old));
+  EXPECT_TRUE(CFile::Exists(recent));
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if defined(TARGET_POSIX)
+
+#include "URL.h"
+#include "filesystem/File.h"
+#include "filesystem/posix/PosixFile.h"
+#include "settings/AdvancedSettings.h"
+#include "test/TestUtils.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace XFILE;
+
+static char GetByte(int64_t pos)
+{
+  return (char)(pos * 13 + pos / 4093);
+}
+
+class TestPosixFile : public testing::Test
+{
+protected:
+  TestPosixFile()
+  : m_file(NULL)
+  , m_oldMinSize(g_advancedSettings.m_mmapMinSize)
+  { }
+
+  virtual ~TestPosixFile()
+  {
+    g_advancedSettings.m_mmapMinSize = m_oldMinSize;
+    if (m_file)
+      XBMC_DELETETEMPFILE(m_file);
+  }
+
+  std::string CreateFile(int64_t size)
+  {
+    m_file = XBMC_CREATETEMPFILE("");
+    if (!m_file)
+      return "";
+
+    std::vector<char> data(1024 * 1024);
+    for (int64_t pos = 0; pos < size; pos += data.size())
+    {
+      size_t length = (size_t)std::min<int64_t>(data.size(), size - pos);
+      for (size_t i = 0; i < length; i++)
+        data[i] = GetByte(pos + i);
+      if (m_file->Write(&data[0], length) != (ssize_t)length)
+        return "";
+    }
+    m_file->Close();
+    return XBMC_TEMPFILEPATH(m_file);
+  }
+
+  CFile *m_file;
+  unsigned int m_oldMinSize;
+};
+
+TEST_F(TestPosixFile, MappedRead)
+{
+  const int64_t size = 3 * 1024 * 1024 + 123;
+  std::string path = CreateFile(size);
+  ASSERT_FALSE(path.empty());
+
+  g_advancedSettings.m_mmapMinSize = 1024 * 1024;
+  CPosixFile file;
+  ASSERT_TRUE(file.Open(CURL(path)));
+
+  SFileMapping mapping;
+  if (sizeof(void*) < 8)
+  {
+    EXPECT_EQ(-1, file.IoControl(IOCTRL_FILE_MAPPING, &mapping));
+    return;
+  }
+  ASSERT_EQ(0, file.IoControl(IOCTRL_FILE_MAPPING, &mapping));
+  EXPECT_EQ(size, mapping.size);
+  EXPECT_EQ(GetByte(1000), (char)mapping.data[1000]);
+
+  char buffer[1000];
+  EXPECT_EQ(2000000, file.Seek(2000000, SEEK_SET));
+  ASSERT_EQ((ssize_t)sizeof(buffer), file.Read(buffer, sizeof(buffer)));
+  for (size_t i = 0; i < sizeof(buffer); i++)
+    ASSERT_EQ(GetByte(2000000 + i), buffer[i]);
+  EXPECT_EQ(2001000, file.GetPosition());
+  EXPECT_EQ(2000500, file.Seek(-500, SEEK_CUR));
+
+  // reads stop at the end of the file
+  EXPECT_EQ(size - 100, file.Seek(-100, SEEK_END));
+  EXPECT_EQ(100, file.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(GetByte(size - 1), buffer[99]);
+  EXPECT_EQ(0, file.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(-1, file.Seek(-1, SEEK_SET));
+  EXPECT_EQ(1, file.IoControl(IOCTRL_SEEK_POSSIBLE, NULL));
+  file.Close();
+}
+
+TEST_F(TestPosixFile, SmallFilesAreRead)
+{
+  std::string path = CreateFile(1000);
+  ASSERT_FALSE(path.empty());
+
+  g_advancedSettings.m_mmapMinSize = 1024 * 1024;
+  CPosixFile file;
+  ASSERT_TRUE(file.Open(CURL(path)));
+
+  SFileMapping mapping;
+  EXPECT_EQ(-1, file.IoControl(IOCTRL_FILE_MAPPING, &mapping));
+
+  char buffer[100];
+  EXPECT_EQ(900, file.Seek(900, SEEK_SET));
+  ASSERT_EQ(100, file.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(GetByte(999), buffer[99]);
+  file.Close();
+}
+
+static void RunReadBenchmark(const std::string &path, int64_t size, unsigned int minSize, const char *name)
+{
+  g_advancedSettings.m_mmapMinSize = minSize;
+
+  CFile file;
+  ASSERT_TRUE(file.Open(path));
+
+  CStopWatch timer;
+  timer.StartZero();
+
+  // chunk size used by the demuxers' avio buffer
+  std::vector<char> buffer(32768);
+  int64_t total = 0;
+  for (int pass = 0; pass < 4; pass++)
+  {
+    ASSERT_EQ(0, file.Seek(0, SEEK_SET));
+    ssize_t read;
+    while ((read = file.Read(&buffer[0], buffer.size())) > 0)
+    {
+      ASSERT_EQ(GetByte(total % size), buffer[0]);
+      total += read;
+    }
+  }
+
+  float elapsed = timer.GetElapsedSeconds();
+  EXPECT_EQ(4 * size, total);
+  std::cout << name << ": " << total / elapsed / (1024 * 1024) << " MB/s" << std::endl;
+  file.Close();
+}
+
+// Reads a 64MB file with plain reads and mapped. Run with
+// --gtest_also_run_disabled_tests.
+TEST_F(TestPosixFile, DISABLED_Benchmark)
+{
+  const int64_t size = 64 * 1024 * 1024;
+  std::string path = CreateFile(size);
+  ASSERT_FALSE(path.empty());
+
+  RunReadBenchmark(path, size, 0, "read");
+  RunReadBenchmark(path, size, 1024 * 1024, "mapped");
+}
+
+#endif
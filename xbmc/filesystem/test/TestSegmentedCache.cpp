@@ -0,0 +1,232 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "URL.h"
+#include "filesystem/CircularCache.h"
+#include "filesystem/File.h"
+#include "filesystem/FileCache.h"
+#include "filesystem/SegmentedCache.h"
+#include "test/TestUtils.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace XFILE;
+
+#define BLOCK_SIZE (64 * 1024)
+
+static char GetByte(int64_t pos)
+{
+  return (char)(pos * 7 + pos / 4099);
+}
+
+static void Write(CCacheStrategy &cache, int64_t pos, size_t size)
+{
+  std::vector<char> data(size);
+  for (size_t i = 0; i < size; i++)
+    data[i] = GetByte(pos + i);
+
+  size_t written = 0;
+  while (written < size)
+  {
+    size_t length = cache.GetMaxWriteSize(size - written);
+    ASSERT_GT(length, 0u);
+    int result = cache.WriteToCache(&data[written], length);
+    ASSERT_GT(result, 0);
+    written += result;
+  }
+}
+
+static void Verify(CCacheStrategy &cache, int64_t pos, size_t size)
+{
+  ASSERT_EQ(pos, cache.Seek(pos));
+
+  std::vector<char> data(size);
+  size_t read = 0;
+  while (read < size)
+  {
+    int result = cache.ReadFromCache(&data[read], size - read);
+    ASSERT_GT(result, 0);
+    read += result;
+  }
+
+  for (size_t i = 0; i < size; i++)
+    ASSERT_EQ(GetByte(pos + i), data[i]) << "at " << pos + i;
+}
+
+TEST(TestSegmentedCache, ReadWrite)
+{
+  CSegmentedCache cache(16 * BLOCK_SIZE, 4 * BLOCK_SIZE, BLOCK_SIZE);
+  ASSERT_EQ(CACHE_RC_OK, cache.Open());
+  cache.Reset(0);
+
+  Write(cache, 0, 5 * BLOCK_SIZE + 100);
+  EXPECT_EQ(5 * BLOCK_SIZE + 100, cache.CachedDataEndPos());
+  Verify(cache, 0, 5 * BLOCK_SIZE + 100);
+  EXPECT_EQ(CACHE_RC_WOULD_BLOCK, cache.ReadFromCache(NULL, 1));
+
+  cache.EndOfInput();
+  EXPECT_EQ(0, cache.ReadFromCache(NULL, 1));
+}
+
+TEST(TestSegmentedCache, KeepsRanges)
+{
+  CSegmentedCache cache(16 * BLOCK_SIZE, 4 * BLOCK_SIZE, BLOCK_SIZE);
+  ASSERT_EQ(CACHE_RC_OK, cache.Open());
+  cache.Reset(0);
+  Write(cache, 0, 3 * BLOCK_SIZE);
+
+  // e.g. the index at the end of the file, writing starts at the block boundary
+  const int64_t end = 1000 * BLOCK_SIZE;
+  EXPECT_EQ(end, cache.CachedDataEndPosIfSeekTo(end + 10));
+  EXPECT_TRUE(cache.Reset(end + 10, false));
+  Write(cache, end, 2 * BLOCK_SIZE);
+  Verify(cache, end + 10, 1000);
+  EXPECT_EQ(2u, cache.GetRangeCount());
+
+  // back to the start, nothing was dropped
+  EXPECT_TRUE(cache.IsCachedPosition(100));
+  EXPECT_EQ(3 * BLOCK_SIZE, cache.CachedDataEndPosIfSeekTo(100));
+  EXPECT_FALSE(cache.Reset(100, false));
+  EXPECT_EQ(3 * BLOCK_SIZE, cache.CachedDataEndPos());
+  Verify(cache, 100, 3 * BLOCK_SIZE - 100);
+}
+
+TEST(TestSegmentedCache, DropsLeastRecentlyUsed)
+{
+  // room for 8 blocks
+  CSegmentedCache cache(4 * BLOCK_SIZE, 4 * BLOCK_SIZE, BLOCK_SIZE);
+  ASSERT_EQ(CACHE_RC_OK, cache.Open());
+
+  for (int64_t range = 0; range < 4; range++)
+  {
+    cache.Reset(range * 100 * BLOCK_SIZE, false);
+    Write(cache, range * 100 * BLOCK_SIZE, 2 * BLOCK_SIZE);
+  }
+  EXPECT_EQ(4u, cache.GetRangeCount());
+
+  // use the first range again, the second one is the oldest now
+  Verify(cache, 0, 2 * BLOCK_SIZE);
+
+  cache.Reset(1000 * BLOCK_SIZE, false);
+  Write(cache, 1000 * BLOCK_SIZE, 2 * BLOCK_SIZE);
+  EXPECT_EQ(4u, cache.GetRangeCount());
+  EXPECT_TRUE(cache.IsCachedPosition(0));
+  EXPECT_FALSE(cache.IsCachedPosition(100 * BLOCK_SIZE));
+  EXPECT_TRUE(cache.IsCachedPosition(200 * BLOCK_SIZE));
+}
+
+TEST(TestSegmentedCache, Prefetch)
+{
+  CSegmentedCache cache(16 * BLOCK_SIZE, 4 * BLOCK_SIZE, BLOCK_SIZE);
+  ASSERT_EQ(CACHE_RC_OK, cache.Open());
+  cache.Reset(0);
+
+  // the block being written isn't handed out
+  int64_t position;
+  size_t size;
+  ASSERT_TRUE(cache.ReservePrefetch(3 * BLOCK_SIZE - 10, position, size));
+  EXPECT_EQ(BLOCK_SIZE, position);
+  EXPECT_EQ((size_t)BLOCK_SIZE, size);
+  ASSERT_TRUE(cache.ReservePrefetch(3 * BLOCK_SIZE - 10, position, size));
+  EXPECT_EQ(2 * BLOCK_SIZE, position);
+  EXPECT_EQ((size_t)BLOCK_SIZE - 10, size);
+  EXPECT_FALSE(cache.ReservePrefetch(3 * BLOCK_SIZE - 10, position, size));
+
+  std::vector<char> data(BLOCK_SIZE);
+  for (size_t i = 0; i < BLOCK_SIZE; i++)
+    data[i] = GetByte(BLOCK_SIZE + i);
+  cache.WritePrefetched(BLOCK_SIZE, &data[0], BLOCK_SIZE);
+
+  // a failed read releases the block again
+  cache.WritePrefetched(2 * BLOCK_SIZE, NULL, 0);
+  EXPECT_FALSE(cache.IsCachedPosition(2 * BLOCK_SIZE + 1));
+
+  Write(cache, 0, BLOCK_SIZE);
+  EXPECT_EQ(2 * BLOCK_SIZE, cache.CachedDataEndPos());
+  EXPECT_EQ(2 * BLOCK_SIZE, cache.SkipCachedData());
+  Verify(cache, 0, 2 * BLOCK_SIZE);
+}
+
+static void RunFileCacheBenchmark(const std::string &path, int64_t size, CCacheStrategy *strategy, const char *name)
+{
+  CFileCache file(strategy);
+  ASSERT_TRUE(file.Open(CURL(path)));
+
+  CStopWatch timer;
+  timer.StartZero();
+
+  // a demuxer reading audio and video which are far apart, checking the index at the end every now and then
+  const int64_t second = size / 2;
+  const int64_t index = size - 512 * 1024;
+  std::vector<char> buffer(32 * 1024);
+  int64_t positions[2] = { 0, second };
+  for (int i = 0; i < 1000; i++)
+  {
+    int64_t &position = positions[i % 2];
+    if (i % 200 == 0)
+    {
+      ASSERT_EQ(index, file.Seek(index, SEEK_SET));
+      ASSERT_GT(file.Read(&buffer[0], buffer.size()), 0);
+    }
+
+    ASSERT_EQ(position, file.Seek(position, SEEK_SET));
+    ssize_t read = file.Read(&buffer[0], buffer.size());
+    ASSERT_GT(read, 0);
+    for (ssize_t j = 0; j < read; j += 997)
+      ASSERT_EQ(GetByte(position + j), buffer[j]);
+    position += read;
+  }
+
+  SCacheStats stats;
+  ASSERT_EQ(0, file.IoControl(IOCTRL_CACHE_STATS, &stats));
+  std::cout << name << ": " << timer.GetElapsedMilliseconds() << " ms, "
+            << stats.seekHits << " seek hits, " << stats.seekMisses << " seek misses, "
+            << stats.readHits << " read hits, " << stats.readMisses << " read misses, "
+            << stats.prefetchBytes << " bytes prefetched" << std::endl;
+  file.Close();
+}
+
+// Seeks between interleaved reads of a 64MB file through the circular and the
+// segmented cache. Run with --gtest_also_run_disabled_tests.
+TEST(TestSegmentedCache, DISABLED_Benchmark)
+{
+  const int64_t size = 64 * 1024 * 1024;
+
+  XFILE::CFile *file = XBMC_CREATETEMPFILE("");
+  ASSERT_TRUE(file != NULL);
+  std::vector<char> data(1024 * 1024);
+  for (int64_t pos = 0; pos < size; pos += data.size())
+  {
+    for (size_t i = 0; i < data.size(); i++)
+      data[i] = GetByte(pos + i);
+    ASSERT_EQ((ssize_t)data.size(), file->Write(&data[0], data.size()));
+  }
+  file->Close();
+  std::string path = XBMC_TEMPFILEPATH(file);
+
+  RunFileCacheBenchmark(path, size, new CCircularCache(15 * 1024 * 1024, 5 * 1024 * 1024), "circular");
+  RunFileCacheBenchmark(path, size, new CSegmentedCache(15 * 1024 * 1024, 5 * 1024 * 1024), "segmented");
+
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
@@ -22,6 +22,7 @@
 
 #include <utility>
 
+#include "GUITextLayoutCache.h"
 #include "addons/Skin.h"
 #include "filesystem/SpecialProtocol.h"
 #include "utils/log.h"
@@ -43,6 +44,8 @@ CGUIColorManager::~CGUIColorManager(void)
 void CGUIColorManager::Clear()
 {
   m_colors.clear();
+  // cached layouts have the named colors resolved already
+  CGUITextLayoutCache::GetInstance().Clear();
 }
 
 // load the color file in
@@ -0,0 +1,78 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GUIFontAtlas.h"
+
+CGUIFontAtlas::CGUIFontAtlas()
+{
+  Reset(0, 0, 0);
+}
+
+void CGUIFontAtlas::Reset(unsigned int width, unsigned int maxHeight, unsigned int spacing)
+{
+  m_shelves.clear();
+  m_width = width;
+  m_maxHeight = maxHeight;
+  m_spacing = spacing;
+  m_height = 0;
+  m_area = 0;
+}
+
+bool CGUIFontAtlas::Allocate(unsigned int width, unsigned int height, unsigned int &x, unsigned int &y)
+{
+  width += m_spacing;
+  height += m_spacing;
+  if (width > m_width)
+    return false;
+
+  // the shortest shelf with room left for the glyph
+  Shelf *best = NULL;
+  for (std::vector<Shelf>::iterator shelf = m_shelves.begin(); shelf != m_shelves.end(); ++shelf)
+  {
+    if (shelf->height >= height && shelf->x + width <= m_width &&
+        (!best || shelf->height < best->height))
+      best = &*shelf;
+  }
+
+  // rather open a new shelf than waste more than a quarter of the old one
+  bool canOpen = m_height + height <= m_maxHeight;
+  if (!best || (canOpen && (best->height - height) * 4 > best->height))
+  {
+    if (!canOpen)
+      return false;
+    Shelf shelf = { m_height, height, 0 };
+    m_shelves.push_back(shelf);
+    m_height += height;
+    best = &m_shelves.back();
+  }
+
+  x = best->x;
+  y = best->y;
+  best->x += width;
+  m_area += width * height;
+  return true;
+}
+
+float CGUIFontAtlas::GetUsage() const
+{
+  if (m_height == 0)
+    return 0.0f;
+  return (float)m_area / ((uint64_t)m_width * m_height);
+}
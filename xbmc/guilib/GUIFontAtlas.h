@@ -0,0 +1,94 @@
+/*!
+\file GUIFontAtlas.h
+\brief
+*/
+
+#ifndef CGUILIB_GUIFONTATLAS_H
+#define CGUILIB_GUIFONTATLAS_H
+#pragma once
+
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <vector>
+
+/*!
+ \ingroup textures
+ \brief Places glyph bitmaps in a font texture using shelf packing
+
+ The texture is split into horizontal shelves which are filled from left to
+ right. A glyph goes onto the shelf which fits it best and a new shelf of the
+ glyph's height is opened below the others if the best one would waste too
+ much room. Unlike lines of the full cell height, lower case letters and
+ punctuation don't reserve room for ascenders and descenders they don't have.
+
+ Only the layout is kept here, the texture itself is owned by the font and
+ has to be at least GetHeight() pixels high.
+ */
+class CGUIFontAtlas
+{
+public:
+  CGUIFontAtlas();
+
+  /*!
+   \brief Drop all glyphs and start over
+   \param width width of the texture
+   \param maxHeight the texture can't grow any higher than this
+   \param spacing empty pixels kept to the right of and below each glyph
+   */
+  void Reset(unsigned int width, unsigned int maxHeight, unsigned int spacing);
+
+  /*!
+   \brief Find room for a glyph
+   \param x [out] left edge of the glyph in the texture
+   \param y [out] top edge of the glyph in the texture
+   \return false if the texture can't hold the glyph anymore
+   */
+  bool Allocate(unsigned int width, unsigned int height, unsigned int &x, unsigned int &y);
+
+  /*!
+   \brief The height the texture needs to have to hold all glyphs
+   */
+  unsigned int GetHeight() const { return m_height; }
+  unsigned int GetWidth() const { return m_width; }
+
+  /*!
+   \brief The part of the used texture area covered by glyphs, including their spacing
+   */
+  float GetUsage() const;
+
+private:
+  struct Shelf
+  {
+    unsigned int y;
+    unsigned int height;
+    unsigned int x;          ///< start of the free part of the shelf
+  };
+
+  std::vector<Shelf> m_shelves;
+  unsigned int m_width;
+  unsigned int m_maxHeight;
+  unsigned int m_spacing;
+  unsigned int m_height;
+  uint64_t m_area;           ///< covered by glyphs
+};
+
+#endif
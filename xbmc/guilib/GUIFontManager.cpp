@@ -24,6 +24,7 @@
 #include "addons/Skin.h"
 #include "GUIFontTTF.h"
 #include "GUIFont.h"
+#include "GUITextLayoutCache.h"
 #include "utils/XMLUtils.h"
 #include "GUIControlFactory.h"
 #include "filesystem/Directory.h"
@@ -235,6 +236,9 @@ void GUIFontManager::ReloadTTFFonts(void)
 
     font->SetFont(pFontFile);
   }
+
+  // text was measured with the old sizes
+  CGUITextLayoutCache::GetInstance().Clear();
 }
 
 void GUIFontManager::Unload(const std::string& strFontName)
@@ -243,6 +247,8 @@ void GUIFontManager::Unload(const std::string& strFontName)
   {
     if (StringUtils::EqualsNoCase((*iFont)->GetFontName(), strFontName))
     {
+      // layouts are keyed by the font, a new one may end up at the same address
+      CGUITextLayoutCache::GetInstance().Clear();
       delete (*iFont);
       m_vecFonts.erase(iFont);
       return;
@@ -333,6 +339,7 @@ void GUIFontManager::Clear()
   m_vecFonts.clear();
   m_vecFontFiles.clear();
   m_vecFontInfo.clear();
+  CGUITextLayoutCache::GetInstance().Clear();
 }
 
 void GUIFontManager::LoadFonts(const std::string& fontSet)
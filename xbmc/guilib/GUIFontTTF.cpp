@@ -35,6 +35,10 @@
 #include <memory>
 #include <queue>
 
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // stuff for freetype
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -171,7 +175,6 @@ CGUIFontTTFBase::CGUIFontTTFBase(const std::string& strFileName) : m_staticCache
   m_originX = m_originY = 0.0f;
   m_cellBaseLine = m_cellHeight = 0;
   m_numChars = 0;
-  m_posX = m_posY = 0;
   m_textureHeight = m_textureWidth = 0;
   m_textureScaleX = m_textureScaleY = 0.0;
   m_ellipsesWidth = m_height = 0.0f;
@@ -210,9 +213,8 @@ void CGUIFontTTFBase::ClearCharacterCache()
   memset(m_charquick, 0, sizeof(m_charquick));
   m_numChars = 0;
   m_maxChars = CHAR_CHUNK;
-  // set the posX and posY so that our texture will be created on first character write.
-  m_posX = m_textureWidth;
-  m_posY = -(int)GetTextureLineHeight();
+  // our texture will be created on first character write.
+  m_atlas.Reset(m_textureWidth, g_Windowing.GetMaxTextureSize(), spacing_between_characters_in_texture);
   m_textureHeight = 0;
 }
 
@@ -225,8 +227,7 @@ void CGUIFontTTFBase::Clear()
   m_char = NULL;
   m_maxChars = 0;
   m_numChars = 0;
-  m_posX = 0;
-  m_posY = 0;
+  m_atlas.Reset(0, 0, 0);
   m_nestedBeginCount = 0;
 
   if (m_face)
@@ -238,6 +239,7 @@ void CGUIFontTTFBase::Clear()
 
   m_vertexTrans.clear();
   m_vertex.clear();
+  m_glyphs.clear();
 
   m_strFileName.clear();
   m_fontFileInMemory.clear();
@@ -320,9 +322,8 @@ bool CGUIFontTTFBase::Load(const std::string& strFilename, float height, float a
     m_textureWidth = g_Windowing.GetMaxTextureSize();
   m_textureScaleX = 1.0f / m_textureWidth;
 
-  // set the posX and posY so that our texture will be created on first character write.
-  m_posX = m_textureWidth;
-  m_posY = -(int)GetTextureLineHeight();
+  // our texture will be created on first character write.
+  m_atlas.Reset(m_textureWidth, g_Windowing.GetMaxTextureSize(), spacing_between_characters_in_texture);
 
   // cache the ellipses width
   Character *ellipse = GetCharacter(L'.');
@@ -468,6 +469,7 @@ void CGUIFontTTFBase::DrawTextInternal(float x, float y, const vecColors &colors
     }
     cursorX = 0;
 
+    m_glyphs.clear();
     for (vecText::const_iterator pos = text.begin(); pos != text.end(); ++pos)
     {
       // If starting text on a new line, determine justification effects
@@ -498,7 +500,8 @@ void CGUIFontTTFBase::DrawTextInternal(float x, float y, const vecColors &colors
 
           for (int i = 0; i < 3; i++)
           {
-            RenderCharacter(startX + cursorX, startY, period, color, !scrolling, *tempVertices);
+            Glyph glyph = { startX + cursorX, startY, *period, color };
+            m_glyphs.push_back(glyph);
             cursorX += period->advance;
           }
           break;
@@ -507,7 +510,8 @@ void CGUIFontTTFBase::DrawTextInternal(float x, float y, const vecColors &colors
       else if (maxPixelWidth > 0 && cursorX > maxPixelWidth)
         break;  // exceeded max allowed width - stop rendering
 
-      RenderCharacter(startX + cursorX, startY, ch, color, !scrolling, *tempVertices);
+      Glyph glyph = { startX + cursorX, startY, *ch, color };
+      m_glyphs.push_back(glyph);
       if ( alignment & XBFONT_JUSTIFIED )
       {
         if ((*pos & 0xffff) == L' ')
@@ -519,6 +523,8 @@ void CGUIFontTTFBase::DrawTextInternal(float x, float y, const vecColors &colors
         cursorX += ch->advance;
       characters.pop();
     }
+    RenderCharacters(m_glyphs, !scrolling, *tempVertices);
+
     if (hardwareClipping)
     {
       CVertexBuffer &vertexBuffer = m_dynamicCache.Lookup(dynamicPos,
@@ -597,11 +603,6 @@ float CGUIFontTTFBase::GetLineHeight(float lineSpacing) const
 
 const unsigned int CGUIFontTTFBase::spacing_between_characters_in_texture = 1;
 
-unsigned int CGUIFontTTFBase::GetTextureLineHeight() const
-{
-  return m_cellHeight + spacing_between_characters_in_texture;
-}
-
 CGUIFontTTFBase::Character* CGUIFontTTFBase::GetCharacter(character_t chr)
 {
   wchar_t letter = (wchar_t)(chr & 0xffff);
@@ -726,42 +727,29 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   FT_Bitmap bitmap = bitGlyph->bitmap;
   bool isEmptyGlyph = (bitmap.width == 0 || bitmap.rows == 0);
 
+  unsigned int x = 0, y = 0;
   if (!isEmptyGlyph)
   {
-    if (bitGlyph->left < 0)
-      m_posX += -bitGlyph->left;
-
-    // check we have enough room for the character.
-    // cast-fest is here to avoid warnings due to freeetype version differences (signedness of width).
-    if (static_cast<int>(m_posX + bitGlyph->left + bitmap.width) > static_cast<int>(m_textureWidth))
-    { // no space - gotta drop to the next line (which means creating a new texture and copying it across)
-      m_posX = 0;
-      m_posY += GetTextureLineHeight();
-      if (bitGlyph->left < 0)
-        m_posX += -bitGlyph->left;
-
-      if(m_posY + GetTextureLineHeight() >= m_textureHeight)
-      {
-        // create the new larger texture
-        unsigned int newHeight = m_posY + GetTextureLineHeight();
-        // check for max height
-        if (newHeight > g_Windowing.GetMaxTextureSize())
-        {
-          CLog::Log(LOGDEBUG, "%s: New cache texture is too large (%u > %u pixels long)", __FUNCTION__, newHeight, g_Windowing.GetMaxTextureSize());
-          FT_Done_Glyph(glyph);
-          return false;
-        }
+    if (!m_atlas.Allocate(bitmap.width, bitmap.rows, x, y))
+    {
+      CLog::Log(LOGDEBUG, "%s: No room left in the cache texture (%u x %u pixels)", __FUNCTION__, m_atlas.GetWidth(), m_atlas.GetHeight());
+      FT_Done_Glyph(glyph);
+      return false;
+    }
 
-        CBaseTexture* newTexture = NULL;
-        newTexture = ReallocTexture(newHeight);
-        if(newTexture == NULL)
-        {
-          FT_Done_Glyph(glyph);
-          CLog::Log(LOGDEBUG, "%s: Failed to allocate new texture of height %u", __FUNCTION__, newHeight);
-          return false;
-        }
-        m_texture = newTexture;
+    if (m_atlas.GetHeight() > m_textureHeight)
+    {
+      // create the new larger texture
+      unsigned int newHeight = m_atlas.GetHeight();
+      CBaseTexture* newTexture = NULL;
+      newTexture = ReallocTexture(newHeight);
+      if(newTexture == NULL)
+      {
+        FT_Done_Glyph(glyph);
+        CLog::Log(LOGDEBUG, "%s: Failed to allocate new texture of height %u", __FUNCTION__, newHeight);
+        return false;
       }
+      m_texture = newTexture;
     }
 
     if(m_texture == NULL)
@@ -775,8 +763,8 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   ch->letterAndStyle = (style << 16) | letter;
   ch->offsetX = (short)bitGlyph->left;
   ch->offsetY = (short)m_cellBaseLine - bitGlyph->top;
-  ch->left = isEmptyGlyph ? 0 : ((float)m_posX + ch->offsetX);
-  ch->top = isEmptyGlyph ? 0 : ((float)m_posY + ch->offsetY);
+  ch->left = (float)x;
+  ch->top = (float)y;
   ch->right = ch->left + bitmap.width;
   ch->bottom = ch->top + bitmap.rows;
   ch->advance = (float)MathUtils::round_int( (float)m_face->glyph->advance.x / 64 );
@@ -785,13 +773,9 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   if (!isEmptyGlyph)
   {
     // ensure our rect will stay inside the texture (it *should* but we need to be certain)
-    unsigned int x1 = std::max(m_posX + ch->offsetX, 0);
-    unsigned int y1 = std::max(m_posY + ch->offsetY, 0);
-    unsigned int x2 = std::min(x1 + bitmap.width, m_textureWidth);
-    unsigned int y2 = std::min(y1 + bitmap.rows, m_textureHeight);
-    CopyCharToTexture(bitGlyph, x1, y1, x2, y2);
-  
-    m_posX += spacing_between_characters_in_texture + (unsigned short)std::max(ch->right - ch->left + ch->offsetX, ch->advance);
+    unsigned int x2 = std::min(x + bitmap.width, m_textureWidth);
+    unsigned int y2 = std::min(y + bitmap.rows, m_textureHeight);
+    CopyCharToTexture(bitGlyph, x, y, x2, y2);
   }
   m_numChars++;
 
@@ -801,152 +785,211 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   return true;
 }
 
-void CGUIFontTTFBase::RenderCharacter(float posX, float posY, const Character *ch, color_t color, bool roundX, std::vector<SVertex> &vertices)
+void CGUIFontTTFBase::RenderCharacters(const std::vector<Glyph> &glyphs, bool roundX, std::vector<SVertex> &vertices)
 {
-  // actual image width isn't same as the character width as that is
-  // just baseline width and height should include the descent
-  const float width = ch->right - ch->left;
-  const float height = ch->bottom - ch->top;
-  
-  // return early if nothing to render
-  if (width == 0 || height == 0)
+  if (glyphs.empty())
     return;
 
-  // posX and posY are relative to our origin, and the textcell is offset
-  // from our (posX, posY).  Plus, these are unscaled quantities compared to the underlying GUI resolution
-  CRect vertex((posX + ch->offsetX) * g_graphicsContext.GetGUIScaleX(),
-               (posY + ch->offsetY) * g_graphicsContext.GetGUIScaleY(),
-               (posX + ch->offsetX + width) * g_graphicsContext.GetGUIScaleX(),
-               (posY + ch->offsetY + height) * g_graphicsContext.GetGUIScaleY());
-  vertex += CPoint(m_originX, m_originY);
-  CRect texture(ch->left, ch->top, ch->right, ch->bottom);
-  if (!g_Windowing.ScissorsCanEffectClipping())
-    g_graphicsContext.ClipRect(vertex, texture);
-
-  // transform our positions - note, no scaling due to GUI calibration/resolution occurs
-  float x[4], y[4], z[4];
-
-  x[0] = g_graphicsContext.ScaleFinalXCoord(vertex.x1, vertex.y1);
-  x[1] = g_graphicsContext.ScaleFinalXCoord(vertex.x2, vertex.y1);
-  x[2] = g_graphicsContext.ScaleFinalXCoord(vertex.x2, vertex.y2);
-  x[3] = g_graphicsContext.ScaleFinalXCoord(vertex.x1, vertex.y2);
-
-  if (roundX)
-  {
-    // We only round the "left" side of the character, and then use the direction of rounding to
-    // move the "right" side of the character.  This ensures that a constant width is kept when rendering
-    // the same letter at the same size at different places of the screen, avoiding the problem
-    // of the "left" side rounding one way while the "right" side rounds the other way, thus getting
-    // altering the width of thin characters substantially.  This only really works for positive
-    // coordinates (due to the direction of truncation for negatives) but this is the only case that
-    // really interests us anyway.
-    float rx0 = (float)MathUtils::round_int(x[0]);
-    float rx3 = (float)MathUtils::round_int(x[3]);
-    x[1] = (float)MathUtils::truncate_int(x[1]);
-    x[2] = (float)MathUtils::truncate_int(x[2]);
-    if (x[0] > 0.0f && rx0 > x[0])
-      x[1] += 1;
-    else if (x[0] < 0.0f && rx0 < x[0])
-      x[1] -= 1;
-    if (x[3] > 0.0f && rx3 > x[3])
-      x[2] += 1;
-    else if (x[3] < 0.0f && rx3 < x[3])
-      x[2] -= 1;
-    x[0] = rx0;
-    x[3] = rx3;
-  }
+  VertexParams params;
+  params.transform = g_graphicsContext.GetGUIMatrix();
+  params.scaleX = g_graphicsContext.GetGUIScaleX();
+  params.scaleY = g_graphicsContext.GetGUIScaleY();
+  params.originX = m_originX;
+  params.originY = m_originY;
+  params.textureScaleX = m_textureScaleX;
+  params.textureScaleY = m_textureScaleY;
+  params.roundX = roundX;
+  params.clip = !g_Windowing.ScissorsCanEffectClipping();
+  params.limitedColor = g_Windowing.UseLimitedColor();
+
+  BuildVertices(&glyphs[0], glyphs.size(), params, vertices);
+  m_color = glyphs.back().color;
+}
 
-  y[0] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalYCoord(vertex.x1, vertex.y1));
-  y[1] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalYCoord(vertex.x2, vertex.y1));
-  y[2] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalYCoord(vertex.x2, vertex.y2));
-  y[3] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalYCoord(vertex.x1, vertex.y2));
-
-  z[0] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalZCoord(vertex.x1, vertex.y1));
-  z[1] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalZCoord(vertex.x2, vertex.y1));
-  z[2] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalZCoord(vertex.x2, vertex.y2));
-  z[3] = (float)MathUtils::round_int(g_graphicsContext.ScaleFinalZCoord(vertex.x1, vertex.y2));
-
-  // tex coords converted to 0..1 range
-  float tl = texture.x1 * m_textureScaleX;
-  float tr = texture.x2 * m_textureScaleX;
-  float tt = texture.y1 * m_textureScaleY;
-  float tb = texture.y2 * m_textureScaleY;
-
-  vertices.resize(vertices.size() + 4);
-  SVertex* v = &vertices[vertices.size() - 4];
-  m_color = color;
-
-#ifndef HAS_DX
-  unsigned char r = GET_R(color)
-              , g = GET_G(color)
-              , b = GET_B(color)
-              , a = GET_A(color);
-
-  if(g_Windowing.UseLimitedColor())
-  {
-    r = (235 - 16) * r / 255;
-    g = (235 - 16) * g / 255;
-    b = (235 - 16) * b / 255;
-  }
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+// MathUtils::round_int() of four values at once
+static inline __m128 RoundFloats(__m128 values)
+{
+  const __m128 positive = _mm_cmpgt_ps(values, _mm_setzero_ps());
+  const __m128 offset = _mm_or_ps(_mm_and_ps(positive, _mm_set1_ps(0.5f)),
+                                  _mm_andnot_ps(positive, _mm_set1_ps(-0.4999999f)));
+  return _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(values, offset)));
+}
 #endif
 
-  for(int i = 0; i < 4; i++)
+void CGUIFontTTFBase::BuildVertices(const Glyph *glyphs, size_t count, const VertexParams &params, std::vector<SVertex> &vertices)
+{
+  if (count == 0)
+    return;
+
+  // make room for all glyphs at once, the ones without pixels are trimmed at the end
+  size_t first = vertices.size();
+  vertices.resize(first + 4 * count);
+  SVertex *v = &vertices[first];
+
+  const TransformMatrix &m = params.transform;
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+  const __m128 m00 = _mm_set1_ps(m.m[0][0]), m01 = _mm_set1_ps(m.m[0][1]), m03 = _mm_set1_ps(m.m[0][3]);
+  const __m128 m10 = _mm_set1_ps(m.m[1][0]), m11 = _mm_set1_ps(m.m[1][1]), m13 = _mm_set1_ps(m.m[1][3]);
+  const __m128 m20 = _mm_set1_ps(m.m[2][0]), m21 = _mm_set1_ps(m.m[2][1]), m23 = _mm_set1_ps(m.m[2][3]);
+#endif
+
+  for (const Glyph *glyph = glyphs; glyph != glyphs + count; ++glyph)
   {
+    const Character &ch = glyph->ch;
+
+    // actual image width isn't same as the character width as that is
+    // just baseline width and height should include the descent
+    const float width = ch.right - ch.left;
+    const float height = ch.bottom - ch.top;
+
+    // skip if nothing to render
+    if (width == 0 || height == 0)
+      continue;
+
+    // posX and posY are relative to our origin, and the textcell is offset
+    // from our (posX, posY).  Plus, these are unscaled quantities compared to the underlying GUI resolution
+    CRect vertex((glyph->posX + ch.offsetX) * params.scaleX,
+                 (glyph->posY + ch.offsetY) * params.scaleY,
+                 (glyph->posX + ch.offsetX + width) * params.scaleX,
+                 (glyph->posY + ch.offsetY + height) * params.scaleY);
+    vertex += CPoint(params.originX, params.originY);
+    CRect texture(ch.left, ch.top, ch.right, ch.bottom);
+    if (params.clip)
+      g_graphicsContext.ClipRect(vertex, texture);
+
+    // transform our positions - note, no scaling due to GUI calibration/resolution occurs
+    // corners are top left, top right, bottom right, bottom left
+    float x[4], y[4], z[4];
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+    const __m128 vx = _mm_setr_ps(vertex.x1, vertex.x2, vertex.x2, vertex.x1);
+    const __m128 vy = _mm_setr_ps(vertex.y1, vertex.y1, vertex.y2, vertex.y2);
+    _mm_storeu_ps(x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, vx), _mm_mul_ps(m01, vy)), m03));
+    _mm_storeu_ps(y, RoundFloats(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, vx), _mm_mul_ps(m11, vy)), m13)));
+    _mm_storeu_ps(z, RoundFloats(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, vx), _mm_mul_ps(m21, vy)), m23)));
+#else
+    x[0] = m.TransformXCoord(vertex.x1, vertex.y1, 0);
+    x[1] = m.TransformXCoord(vertex.x2, vertex.y1, 0);
+    x[2] = m.TransformXCoord(vertex.x2, vertex.y2, 0);
+    x[3] = m.TransformXCoord(vertex.x1, vertex.y2, 0);
+
+    y[0] = (float)MathUtils::round_int(m.TransformYCoord(vertex.x1, vertex.y1, 0));
+    y[1] = (float)MathUtils::round_int(m.TransformYCoord(vertex.x2, vertex.y1, 0));
+    y[2] = (float)MathUtils::round_int(m.TransformYCoord(vertex.x2, vertex.y2, 0));
+    y[3] = (float)MathUtils::round_int(m.TransformYCoord(vertex.x1, vertex.y2, 0));
+
+    z[0] = (float)MathUtils::round_int(m.TransformZCoord(vertex.x1, vertex.y1, 0));
+    z[1] = (float)MathUtils::round_int(m.TransformZCoord(vertex.x2, vertex.y1, 0));
+    z[2] = (float)MathUtils::round_int(m.TransformZCoord(vertex.x2, vertex.y2, 0));
+    z[3] = (float)MathUtils::round_int(m.TransformZCoord(vertex.x1, vertex.y2, 0));
+#endif
+
+    if (params.roundX)
+    {
+      // We only round the "left" side of the character, and then use the direction of rounding to
+      // move the "right" side of the character.  This ensures that a constant width is kept when rendering
+      // the same letter at the same size at different places of the screen, avoiding the problem
+      // of the "left" side rounding one way while the "right" side rounds the other way, thus getting
+      // altering the width of thin characters substantially.  This only really works for positive
+      // coordinates (due to the direction of truncation for negatives) but this is the only case that
+      // really interests us anyway.
+      float rx0 = (float)MathUtils::round_int(x[0]);
+      float rx3 = (float)MathUtils::round_int(x[3]);
+      x[1] = (float)MathUtils::truncate_int(x[1]);
+      x[2] = (float)MathUtils::truncate_int(x[2]);
+      if (x[0] > 0.0f && rx0 > x[0])
+        x[1] += 1;
+      else if (x[0] < 0.0f && rx0 < x[0])
+        x[1] -= 1;
+      if (x[3] > 0.0f && rx3 > x[3])
+        x[2] += 1;
+      else if (x[3] < 0.0f && rx3 < x[3])
+        x[2] -= 1;
+      x[0] = rx0;
+      x[3] = rx3;
+    }
+
+    // tex coords converted to 0..1 range
+    float tl = texture.x1 * params.textureScaleX;
+    float tr = texture.x2 * params.textureScaleX;
+    float tt = texture.y1 * params.textureScaleY;
+    float tb = texture.y2 * params.textureScaleY;
+
+    color_t color = glyph->color;
 #ifdef HAS_DX
-    CD3DHelper::XMStoreColor(&v[i].col, color);
+    CD3DHelper::XMStoreColor(&v[0].col, color);
+    v[1].col = v[2].col = v[3].col = v[0].col;
 #else
-    v[i].r = r;
-    v[i].g = g;
-    v[i].b = b;
-    v[i].a = a;
+    unsigned char r = GET_R(color)
+                , g = GET_G(color)
+                , b = GET_B(color)
+                , a = GET_A(color);
+
+    if (params.limitedColor)
+    {
+      r = (235 - 16) * r / 255;
+      g = (235 - 16) * g / 255;
+      b = (235 - 16) * b / 255;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+      v[i].r = r;
+      v[i].g = g;
+      v[i].b = b;
+      v[i].a = a;
+    }
 #endif
-  }
 
 #if defined(HAS_GL) || defined(HAS_DX)
-  for(int i = 0; i < 4; i++)
-  {
-    v[i].x = x[i];
-    v[i].y = y[i];
-    v[i].z = z[i];
-  }
+    for (int i = 0; i < 4; i++)
+    {
+      v[i].x = x[i];
+      v[i].y = y[i];
+      v[i].z = z[i];
+    }
 
-  v[0].u = tl;
-  v[0].v = tt;
+    v[0].u = tl;
+    v[0].v = tt;
 
-  v[1].u = tr;
-  v[1].v = tt;
+    v[1].u = tr;
+    v[1].v = tt;
 
-  v[2].u = tr;
-  v[2].v = tb;
+    v[2].u = tr;
+    v[2].v = tb;
 
-  v[3].u = tl;
-  v[3].v = tb;
+    v[3].u = tl;
+    v[3].v = tb;
 #else
-  // GLES uses triangle strips, not quads, so have to rearrange the vertex order
-  v[0].u = tl;
-  v[0].v = tt;
-  v[0].x = x[0];
-  v[0].y = y[0];
-  v[0].z = z[0];
-
-  v[1].u = tl;
-  v[1].v = tb;
-  v[1].x = x[3];
-  v[1].y = y[3];
-  v[1].z = z[3];
-
-  v[2].u = tr;
-  v[2].v = tt;
-  v[2].x = x[1];
-  v[2].y = y[1];
-  v[2].z = z[1];
-
-  v[3].u = tr;
-  v[3].v = tb;
-  v[3].x = x[2];
-  v[3].y = y[2];
-  v[3].z = z[2];
+    // GLES uses triangle strips, not quads, so have to rearrange the vertex order
+    v[0].u = tl;
+    v[0].v = tt;
+    v[0].x = x[0];
+    v[0].y = y[0];
+    v[0].z = z[0];
+
+    v[1].u = tl;
+    v[1].v = tb;
+    v[1].x = x[3];
+    v[1].y = y[3];
+    v[1].z = z[3];
+
+    v[2].u = tr;
+    v[2].v = tt;
+    v[2].x = x[1];
+    v[2].y = y[1];
+    v[2].z = z[1];
+
+    v[3].u = tr;
+    v[3].v = tb;
+    v[3].x = x[2];
+    v[3].y = y[2];
+    v[3].z = z[2];
 #endif
+    v += 4;
+  }
+
+  vertices.resize(v - &vertices[0]);
 }
 
 // Oblique code - original taken from freetype2 (ftsynth.c)
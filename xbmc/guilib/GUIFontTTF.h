@@ -33,6 +33,8 @@
 
 #include "utils/auto_buffer.h"
 #include "Geometry.h"
+#include "GUIFontAtlas.h"
+#include "TransformMatrix.h"
 
 #ifdef HAS_DX
 #include "DirectXMath.h"
@@ -131,9 +133,31 @@ protected:
   // Stuff for pre-rendering for speed
   inline Character *GetCharacter(character_t letter);
   bool CacheCharacter(wchar_t letter, uint32_t style, Character *ch);
-  void RenderCharacter(float posX, float posY, const Character *ch, color_t color, bool roundX, std::vector<SVertex> &vertices);
   void ClearCharacterCache();
 
+  // a character placed on a line, relative to the origin
+  struct Glyph
+  {
+    float posX, posY;
+    Character ch;
+    color_t color;
+  };
+
+  // everything the vertices depend on besides the glyphs, looked up once per string
+  struct VertexParams
+  {
+    TransformMatrix transform;
+    float scaleX, scaleY;
+    float originX, originY;
+    float textureScaleX, textureScaleY;
+    bool roundX;
+    bool clip;                           // clip in software, glyphs are cut at the clip region
+    bool limitedColor;
+  };
+
+  void RenderCharacters(const std::vector<Glyph> &glyphs, bool roundX, std::vector<SVertex> &vertices);
+  static void BuildVertices(const Glyph *glyphs, size_t count, const VertexParams &params, std::vector<SVertex> &vertices);
+
   virtual CBaseTexture* ReallocTexture(unsigned int& newHeight) = 0;
   virtual bool CopyCharToTexture(FT_BitmapGlyph bitGlyph, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2) = 0;
   virtual void DeleteHardwareTexture() = 0;
@@ -146,13 +170,8 @@ protected:
 
   unsigned int m_textureWidth;       // width of our texture
   unsigned int m_textureHeight;      // height of our texture
-  int m_posX;                        // current position in the texture
-  int m_posY;
+  CGUIFontAtlas m_atlas;             // where the characters are in the texture
 
-  /*! \brief the height of each line in the texture.
-   Accounts for spacing between lines to avoid characters overlapping.
-   */
-  unsigned int GetTextureLineHeight() const;
   static const unsigned int spacing_between_characters_in_texture;
 
   color_t m_color;
@@ -189,6 +208,7 @@ protected:
   };
   std::vector<CTranslatedVertices> m_vertexTrans;
   std::vector<SVertex> m_vertex;
+  std::vector<Glyph> m_glyphs;       // of the string being laid out, kept to avoid reallocating
 
   float    m_textureScaleX;
   float    m_textureScaleY;
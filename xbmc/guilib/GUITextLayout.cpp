@@ -19,9 +19,11 @@
  */
 
 #include "GUITextLayout.h"
+#include "GUITextLayoutCache.h"
 #include "GUIFont.h"
 #include "GUIControl.h"
 #include "GUIColorManager.h"
+#include "GraphicContext.h"
 #include "utils/CharsetConverter.h"
 #include "utils/StringUtils.h"
 
@@ -219,9 +221,7 @@ bool CGUITextLayout::Update(const std::string &text, float maxWidth, bool forceU
 
   m_lastUtf8Text = text;
   m_lastUpdateW = false;
-  std::wstring utf16;
-  g_charsetConverter.utf8ToW(text, utf16, false);
-  UpdateCommon(utf16, maxWidth, forceLTRReadingOrder);
+  UpdateCached(&text, NULL, maxWidth, forceLTRReadingOrder);
   return true;
 }
 
@@ -232,10 +232,62 @@ bool CGUITextLayout::UpdateW(const std::wstring &text, float maxWidth /*= 0*/, b
 
   m_lastText = text;
   m_lastUpdateW = true;
-  UpdateCommon(text, maxWidth, forceLTRReadingOrder);
+  UpdateCached(NULL, &text, maxWidth, forceLTRReadingOrder);
   return true;
 }
 
+void CGUITextLayout::UpdateCached(const std::string *utf8, const std::wstring *utf16, float maxWidth, bool forceLTRReadingOrder)
+{
+  // the layout only depends on these, so the same text laid out by any other
+  // control with the same font and size can be reused
+  CGUITextLayoutCache &cache = CGUITextLayoutCache::GetInstance();
+  CGUITextLayoutCache::SKey key;
+  if (m_font)
+  {
+    key.wide = utf16 != NULL;
+    if (utf8)
+      key.text = *utf8;
+    else
+      key.textW = *utf16;
+    key.font = m_font;
+    key.textColor = m_textColor;
+    key.maxWidth = (m_wrap && maxWidth > 0) ? maxWidth : 0;
+    key.maxHeight = m_maxHeight;
+    key.scaleX = g_graphicsContext.GetGUIScaleX();
+    key.scaleY = g_graphicsContext.GetGUIScaleY();
+    key.forceLTR = forceLTRReadingOrder;
+
+    CGUITextLayoutCache::LayoutPtr layout = cache.Get(key);
+    if (layout)
+    {
+      m_lines = layout->lines;
+      m_colors = layout->colors;
+      m_textWidth = layout->width;
+      m_textHeight = layout->height;
+      return;
+    }
+  }
+
+  if (utf8)
+  {
+    std::wstring converted;
+    g_charsetConverter.utf8ToW(*utf8, converted, false);
+    UpdateCommon(converted, maxWidth, forceLTRReadingOrder);
+  }
+  else
+    UpdateCommon(*utf16, maxWidth, forceLTRReadingOrder);
+
+  if (m_font)
+  {
+    std::shared_ptr<CGUITextLayoutCache::SLayout> layout(new CGUITextLayoutCache::SLayout);
+    layout->lines = m_lines;
+    layout->colors = m_colors;
+    layout->width = m_textWidth;
+    layout->height = m_textHeight;
+    cache.Add(key, layout);
+  }
+}
+
 void CGUITextLayout::UpdateCommon(const std::wstring &text, float maxWidth, bool forceLTRReadingOrder)
 {
   // parse the text for style information
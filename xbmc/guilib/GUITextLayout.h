@@ -118,6 +118,9 @@ protected:
   static std::wstring BidiFlip(const std::wstring &text, bool forceLTRReadingOrder);
   void CalcTextExtent();
   void UpdateCommon(const std::wstring &text, float maxWidth, bool forceLTRReadingOrder);
+  /*! \brief Lay out the given utf8 or utf16 text, reusing the layout from CGUITextLayoutCache if possible
+   */
+  void UpdateCached(const std::string *utf8, const std::wstring *utf16, float maxWidth, bool forceLTRReadingOrder);
   
   /*! \brief Returns the text, utf8 encoded
    \return utf8 text
@@ -0,0 +1,139 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GUITextLayoutCache.h"
+#include "threads/SingleLock.h"
+
+#include <functional>
+
+static inline void HashCombine(size_t &seed, size_t value)
+{
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+size_t CGUITextLayoutCache::SKey::Hash() const
+{
+  size_t hash = wide ? std::hash<std::wstring>()(textW) : std::hash<std::string>()(text);
+  HashCombine(hash, std::hash<const CGUIFont*>()(font));
+  HashCombine(hash, textColor);
+  HashCombine(hash, std::hash<float>()(maxWidth));
+  HashCombine(hash, std::hash<float>()(maxHeight));
+  HashCombine(hash, std::hash<float>()(scaleX));
+  HashCombine(hash, std::hash<float>()(scaleY));
+  HashCombine(hash, forceLTR);
+  return hash;
+}
+
+bool CGUITextLayoutCache::SKey::operator==(const SKey &right) const
+{
+  return font == right.font && textColor == right.textColor && maxWidth == right.maxWidth && maxHeight == right.maxHeight &&
+         scaleX == right.scaleX && scaleY == right.scaleY && forceLTR == right.forceLTR &&
+         wide == right.wide && (wide ? textW == right.textW : text == right.text);
+}
+
+CGUITextLayoutCache::CGUITextLayoutCache(size_t maxEntries)
+  : m_maxEntries(maxEntries)
+  , m_hits(0)
+  , m_misses(0)
+{
+}
+
+CGUITextLayoutCache& CGUITextLayoutCache::GetInstance()
+{
+  static CGUITextLayoutCache cache;
+  return cache;
+}
+
+CGUITextLayoutCache::EntryList::iterator CGUITextLayoutCache::Find(const SKey &key, size_t hash)
+{
+  auto range = m_index.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (it->second->key == key)
+      return it->second;
+  }
+  return m_entries.end();
+}
+
+CGUITextLayoutCache::LayoutPtr CGUITextLayoutCache::Get(const SKey &key)
+{
+  size_t hash = key.Hash();
+
+  CSingleLock lock(m_critical);
+  EntryList::iterator entry = Find(key, hash);
+  if (entry == m_entries.end())
+  {
+    m_misses++;
+    return LayoutPtr();
+  }
+
+  m_hits++;
+  m_entries.splice(m_entries.begin(), m_entries, entry);
+  return entry->layout;
+}
+
+void CGUITextLayoutCache::Add(const SKey &key, const LayoutPtr &layout)
+{
+  size_t hash = key.Hash();
+
+  CSingleLock lock(m_critical);
+  EntryList::iterator entry = Find(key, hash);
+  if (entry != m_entries.end())
+  {
+    entry->layout = layout;
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    return;
+  }
+
+  SEntry newEntry = { key, hash, layout };
+  m_entries.push_front(newEntry);
+  m_index.insert(std::make_pair(hash, m_entries.begin()));
+
+  while (m_entries.size() > m_maxEntries)
+  {
+    EntryList::iterator last = --m_entries.end();
+    auto range = m_index.equal_range(last->hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (it->second == last)
+      {
+        m_index.erase(it);
+        break;
+      }
+    }
+    m_entries.erase(last);
+  }
+}
+
+void CGUITextLayoutCache::Clear()
+{
+  CSingleLock lock(m_critical);
+  m_index.clear();
+  m_entries.clear();
+}
+
+void CGUITextLayoutCache::GetStats(unsigned int &hits, unsigned int &misses, unsigned int &entries)
+{
+  CSingleLock lock(m_critical);
+  hits = m_hits;
+  misses = m_misses;
+  entries = m_entries.size();
+  m_hits = m_misses = 0;
+}
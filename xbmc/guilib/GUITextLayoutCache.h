@@ -0,0 +1,113 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GUITextLayout.h"
+#include "threads/CriticalSection.h"
+
+/*!
+ \ingroup textures
+ \brief Layouts of recently used texts, shared by all text layouts
+
+ Laying out a text means converting it to UTF-32, parsing the formatting
+ tags and measuring it for wrapping, which for a long plot is far more work
+ than rendering it. The same texts show up over and over though: every
+ time a list item is focused again, in the info dialog of an item, when
+ going back to a window. Layouts are kept here by their text and everything
+ else they depend on, least recently used ones are dropped first.
+
+ Entries refer to fonts by pointer, so the cache has to be cleared whenever
+ fonts are unloaded or reloaded (see GUIFontManager) and whenever the
+ named colors change.
+ */
+class CGUITextLayoutCache
+{
+public:
+  //! everything a layout depends on
+  struct SKey
+  {
+    SKey() : font(NULL), textColor(0), maxWidth(0), maxHeight(0), scaleX(0), scaleY(0), forceLTR(false), wide(false) {}
+
+    size_t Hash() const;
+    bool operator==(const SKey &right) const;
+
+    std::string text;                ///< the text if it was given as UTF-8
+    std::wstring textW;              ///< the text if it was given as wide string
+    const CGUIFont *font;
+    color_t textColor;
+    float maxWidth;                  ///< 0 if the text isn't wrapped
+    float maxHeight;
+    float scaleX, scaleY;            ///< GUI scale the text was measured at
+    bool forceLTR;
+    bool wide;
+  };
+
+  struct SLayout
+  {
+    std::vector<CGUIString> lines;
+    vecColors colors;
+    float width;
+    float height;
+  };
+  typedef std::shared_ptr<const SLayout> LayoutPtr;
+
+  explicit CGUITextLayoutCache(size_t maxEntries = 512);
+
+  static CGUITextLayoutCache& GetInstance();
+
+  /*!
+   \brief Get the layout of a text if it's cached
+   \return the layout, empty if it isn't cached
+   */
+  LayoutPtr Get(const SKey &key);
+
+  void Add(const SKey &key, const LayoutPtr &layout);
+  void Clear();
+
+  /*!
+   \brief Get the number of lookups answered from the cache and the ones which weren't since the last call
+   */
+  void GetStats(unsigned int &hits, unsigned int &misses, unsigned int &entries);
+
+private:
+  struct SEntry
+  {
+    SKey key;
+    size_t hash;
+    LayoutPtr layout;
+  };
+  typedef std::list<SEntry> EntryList;
+
+  EntryList::iterator Find(const SKey &key, size_t hash);
+
+  EntryList m_entries;                                       ///< most recently used first
+  std::unordered_multimap<size_t, EntryList::iterator> m_index;  ///< entries by hash of their key
+  size_t m_maxEntries;
+  unsigned int m_hits;
+  unsigned int m_misses;
+  CCriticalSection m_critical;
+};
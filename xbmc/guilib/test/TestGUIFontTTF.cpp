@@ -0,0 +1,258 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "guilib/GUIFontAtlas.h"
+#include "guilib/GUIFontTTF.h"
+#include "utils/MathUtils.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <iostream>
+
+TEST(TestGUIFontAtlas, Allocate)
+{
+  CGUIFontAtlas atlas;
+  atlas.Reset(64, 32, 1);
+
+  // spacing is kept to the right and below
+  unsigned int x, y;
+  EXPECT_TRUE(atlas.Allocate(10, 10, x, y));
+  EXPECT_EQ(0u, x);
+  EXPECT_EQ(0u, y);
+  EXPECT_EQ(11u, atlas.GetHeight());
+  EXPECT_TRUE(atlas.Allocate(10, 9, x, y));
+  EXPECT_EQ(11u, x);
+  EXPECT_EQ(0u, y);
+
+  // too much room wasted on the first shelf
+  EXPECT_TRUE(atlas.Allocate(10, 4, x, y));
+  EXPECT_EQ(0u, x);
+  EXPECT_EQ(11u, y);
+  EXPECT_EQ(16u, atlas.GetHeight());
+
+  // wider than the texture, or higher than what's left
+  EXPECT_FALSE(atlas.Allocate(64, 4, x, y));
+  EXPECT_FALSE(atlas.Allocate(10, 20, x, y));
+
+  // a full shelf moves on to the next one which fits
+  for (int i = 0; i < 3; i++)
+    EXPECT_TRUE(atlas.Allocate(10, 10, x, y));
+  EXPECT_TRUE(atlas.Allocate(10, 10, x, y));
+  EXPECT_EQ(0u, x);
+  EXPECT_EQ(16u, y);
+  EXPECT_EQ(27u, atlas.GetHeight());
+}
+
+TEST(TestGUIFontAtlas, NoOverlap)
+{
+  struct Rect { unsigned int x, y, w, h; };
+  std::vector<Rect> rects;
+
+  CGUIFontAtlas atlas;
+  atlas.Reset(256, 1024, 1);
+  for (unsigned int i = 0; i < 500; i++)
+  {
+    Rect rect = { 0, 0, 3 + (i * 7) % 17, 5 + (i * 13) % 23 };
+    ASSERT_TRUE(atlas.Allocate(rect.w, rect.h, rect.x, rect.y));
+    EXPECT_LE(rect.x + rect.w, 256u);
+    EXPECT_LE(rect.y + rect.h, atlas.GetHeight());
+    for (std::vector<Rect>::const_iterator it = rects.begin(); it != rects.end(); ++it)
+    {
+      bool apart = rect.x >= it->x + it->w || it->x >= rect.x + rect.w ||
+                   rect.y >= it->y + it->h || it->y >= rect.y + rect.h;
+      ASSERT_TRUE(apart) << "glyph " << i << " overlaps";
+    }
+    rects.push_back(rect);
+  }
+}
+
+/*
+ The glyphs of a latin font at 40 pixels: most lower case letters have no
+ ascender or descender, so they need much less room than a full line.
+ */
+TEST(TestGUIFontAtlas, Usage)
+{
+  const unsigned int cellHeight = 48;
+  const unsigned int width = 1024;
+
+  CGUIFontAtlas atlas;
+  atlas.Reset(width, 4096, 1);
+  unsigned int lineX = 0, lineY = 0;
+  for (int i = 0; i < 190; i++)
+  {
+    unsigned int glyphWidth = 14 + i % 11;
+    unsigned int glyphHeight = (i % 3 == 0) ? 30 : (i % 5 == 0 ? 38 : 21);
+    unsigned int x, y;
+    ASSERT_TRUE(atlas.Allocate(glyphWidth, glyphHeight, x, y));
+
+    // what lines of the cell height would have used
+    if (lineX + glyphWidth + 1 > width)
+    {
+      lineX = 0;
+      lineY += cellHeight + 1;
+    }
+    lineX += glyphWidth + 1;
+  }
+  lineY += cellHeight + 1;
+
+  std::cout << "atlas height " << atlas.GetHeight() << " (" << atlas.GetUsage() * 100 << "% used), "
+            << "lines of the cell height " << lineY << std::endl;
+  EXPECT_LT(atlas.GetHeight(), lineY);
+  EXPECT_GT(atlas.GetUsage(), 0.7f);
+}
+
+class CTestFont : public CGUIFontTTFBase
+{
+public:
+  CTestFont() : CGUIFontTTFBase("") {}
+
+  using CGUIFontTTFBase::Character;
+  using CGUIFontTTFBase::Glyph;
+  using CGUIFontTTFBase::VertexParams;
+  using CGUIFontTTFBase::BuildVertices;
+
+private:
+  virtual CBaseTexture* ReallocTexture(unsigned int& newHeight) { return NULL; }
+  virtual bool CopyCharToTexture(FT_BitmapGlyph bitGlyph, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2) { return false; }
+  virtual void DeleteHardwareTexture() {}
+  virtual bool FirstBegin() { return false; }
+  virtual void LastEnd() {}
+};
+
+static CTestFont::VertexParams GetParams()
+{
+  CTestFont::VertexParams params;
+  params.transform = TransformMatrix::CreateTranslation(12.3f, 45.6f, 0.25f) * TransformMatrix::CreateScaler(1.5f, 1.5f);
+  params.scaleX = params.scaleY = 1.0f;
+  params.originX = 100.0f;
+  params.originY = 200.0f;
+  params.textureScaleX = params.textureScaleY = 1.0f / 512;
+  params.roundX = false;
+  params.clip = false;
+  params.limitedColor = false;
+  return params;
+}
+
+TEST(TestGUIFontTTF, BuildVertices)
+{
+  CTestFont::Glyph glyphs[2];
+  CTestFont::Character ch = { 1, 3, 20.0f, 40.0f, 30.0f, 52.0f, 11.0f, 'a' };
+  CTestFont::Character space = { 0, 0, 0.0f, 0.0f, 0.0f, 0.0f, 5.0f, ' ' };
+  glyphs[0].posX = 0.7f;
+  glyphs[0].posY = 0.0f;
+  glyphs[0].ch = space;
+  glyphs[0].color = 0xff102030;
+  glyphs[1] = glyphs[0];
+  glyphs[1].posX = 5.7f;
+  glyphs[1].ch = ch;
+
+  CTestFont::VertexParams params = GetParams();
+  std::vector<SVertex> vertices;
+  CTestFont::BuildVertices(glyphs, 2, params, vertices);
+
+  // nothing for the space
+  ASSERT_EQ(4u, vertices.size());
+  float x1 = 1e9f, x2 = -1e9f, y1 = 1e9f, y2 = -1e9f, u1 = 1e9f, v2 = -1e9f;
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    x1 = std::min(x1, vertices[i].x);
+    x2 = std::max(x2, vertices[i].x);
+    y1 = std::min(y1, vertices[i].y);
+    y2 = std::max(y2, vertices[i].y);
+    u1 = std::min(u1, vertices[i].u);
+    v2 = std::max(v2, vertices[i].v);
+    EXPECT_EQ(0.0f, vertices[i].z);
+#ifndef HAS_DX
+    EXPECT_EQ(0x10, vertices[i].r);
+    EXPECT_EQ(0xff, vertices[i].a);
+#endif
+  }
+  const TransformMatrix &m = params.transform;
+  EXPECT_FLOAT_EQ(m.TransformXCoord(100.0f + 6.7f, 0, 0), x1);
+  EXPECT_FLOAT_EQ(m.TransformXCoord(100.0f + 16.7f, 0, 0), x2);
+  EXPECT_EQ((float)MathUtils::round_int(m.TransformYCoord(0, 203.0f, 0)), y1);
+  EXPECT_EQ((float)MathUtils::round_int(m.TransformYCoord(0, 215.0f, 0)), y2);
+  EXPECT_FLOAT_EQ(20.0f / 512, u1);
+  EXPECT_FLOAT_EQ(52.0f / 512, v2);
+
+  // rounding keeps the width of the glyph
+  params.roundX = true;
+  vertices.clear();
+  CTestFont::BuildVertices(glyphs, 2, params, vertices);
+  x1 = 1e9f, x2 = -1e9f;
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    x1 = std::min(x1, vertices[i].x);
+    x2 = std::max(x2, vertices[i].x);
+  }
+  EXPECT_EQ((float)MathUtils::round_int(m.TransformXCoord(106.7f, 0, 0)), x1);
+  EXPECT_EQ(15.0f, x2 - x1);
+}
+
+/*
+ Lays out lines of text with a synthetic font and builds their vertices, the
+ work done for every string which isn't found in the font caches. Run with
+ --gtest_also_run_disabled_tests.
+ */
+TEST(TestGUIFontTTF, DISABLED_VertexBenchmark)
+{
+  std::vector<CTestFont::Character> font;
+  for (int i = 0; i < 95; i++)
+  {
+    short width = 8 + i % 9;
+    CTestFont::Character ch = { (short)(i % 3 - 1), (short)(4 + i % 7), (float)(i % 16) * 32, (float)(i / 16) * 40,
+                                (float)(i % 16) * 32 + width, (float)(i / 16) * 40 + 20 + i % 11, width + 1.0f, (character_t)(32 + i) };
+    if (i == 0)
+      ch.right = ch.left;
+    font.push_back(ch);
+  }
+  std::string text = "The quick brown fox jumps over the lazy dog. Sphinx of black quartz, judge my vow!";
+
+  CTestFont::VertexParams params = GetParams();
+  params.roundX = true;
+  std::vector<CTestFont::Glyph> glyphs;
+  std::vector<SVertex> vertices;
+  const int lines = 20000;
+  size_t total = 0;
+
+  CStopWatch timer;
+  timer.StartZero();
+  for (int line = 0; line < lines; line++)
+  {
+    glyphs.clear();
+    vertices.clear();
+    float cursorX = 0;
+    for (std::string::const_iterator c = text.begin(); c != text.end(); ++c)
+    {
+      CTestFont::Glyph glyph = { cursorX, (float)(line % 50) * 30, font[*c - 32], 0xffffffff };
+      glyphs.push_back(glyph);
+      cursorX += glyph.ch.advance;
+    }
+    CTestFont::BuildVertices(&glyphs[0], glyphs.size(), params, vertices);
+    total += glyphs.size();
+  }
+  float elapsed = timer.GetElapsedSeconds();
+  EXPECT_EQ(4 * (text.size() - std::count(text.begin(), text.end(), ' ')), vertices.size());
+
+  std::cout << total / elapsed / 1000000 << " M glyphs/s laid out and built" << std::endl;
+}
@@ -0,0 +1,237 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guilib/GUIFont.h"
+#include "guilib/GUIFontTTF.h"
+#include "guilib/GUITextLayout.h"
+#include "guilib/GUITextLayoutCache.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <memory>
+
+//! a font with glyphs for printable ascii only, so text can be measured without FreeType
+class CTestLayoutFont : public CGUIFontTTFBase
+{
+public:
+  CTestLayoutFont() : CGUIFontTTFBase("")
+  {
+    m_cellHeight = 20;
+    m_cellBaseLine = 16;
+    m_numChars = m_maxChars = 95;
+    m_char = new Character[m_maxChars];
+    for (int i = 0; i < m_numChars; i++)
+    {
+      short width = 6 + i % 7;
+      Character ch = { 0, 0, 0, 0, (float)width, 20, width + 1.0f, (character_t)(32 + i) };
+      m_char[i] = ch;
+      m_charquick[32 + i] = &m_char[i];
+    }
+  }
+
+private:
+  virtual CBaseTexture* ReallocTexture(unsigned int& newHeight) { return NULL; }
+  virtual bool CopyCharToTexture(FT_BitmapGlyph bitGlyph, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2) { return false; }
+  virtual void DeleteHardwareTexture() {}
+  virtual bool FirstBegin() { return false; }
+  virtual void LastEnd() {}
+};
+
+class CTestLayout : public CGUITextLayout
+{
+public:
+  CTestLayout(CGUIFont *font, bool wrap) : CGUITextLayout(font, wrap) {}
+
+  const std::vector<CGUIString>& GetLines() const { return m_lines; }
+  const vecColors& GetColors() const { return m_colors; }
+};
+
+class TestGUITextLayout : public testing::Test
+{
+protected:
+  TestGUITextLayout()
+    : m_fontFile(new CTestLayoutFont)
+    , m_font(new CGUIFont("test", 0, 0xffffffff, 0, 1.0f, 20.0f, m_fontFile))
+  {
+    CGUITextLayoutCache::GetInstance().Clear();
+    unsigned int hits, misses, entries;
+    CGUITextLayoutCache::GetInstance().GetStats(hits, misses, entries);
+  }
+
+  ~TestGUITextLayout()
+  {
+    CGUITextLayoutCache::GetInstance().Clear();
+    m_font.reset();
+    delete m_fontFile;
+  }
+
+  CTestLayoutFont *m_fontFile;
+  std::unique_ptr<CGUIFont> m_font;
+};
+
+TEST_F(TestGUITextLayout, Cache)
+{
+  CGUITextLayoutCache cache(2);
+  CGUITextLayoutCache::SKey first, second, third;
+  first.text = "first";
+  second.text = "second";
+  third.text = "third";
+  CGUITextLayoutCache::LayoutPtr layout(new CGUITextLayoutCache::SLayout);
+
+  cache.Add(first, layout);
+  cache.Add(second, layout);
+  EXPECT_EQ(layout, cache.Get(first));
+
+  // the least recently used one goes first
+  cache.Add(third, layout);
+  EXPECT_TRUE(cache.Get(first) != NULL);
+  EXPECT_TRUE(cache.Get(second) == NULL);
+  EXPECT_TRUE(cache.Get(third) != NULL);
+
+  // everything the layout depends on is part of the key
+  CGUITextLayoutCache::SKey other = first;
+  other.maxWidth = 100;
+  EXPECT_TRUE(cache.Get(other) == NULL);
+  other = first;
+  other.wide = true;
+  EXPECT_TRUE(cache.Get(other) == NULL);
+
+  unsigned int hits, misses, entries;
+  cache.GetStats(hits, misses, entries);
+  EXPECT_EQ(3u, hits);
+  EXPECT_EQ(3u, misses);
+  EXPECT_EQ(2u, entries);
+
+  cache.Clear();
+  EXPECT_TRUE(cache.Get(first) == NULL);
+}
+
+TEST_F(TestGUITextLayout, SharedBetweenLayouts)
+{
+  const std::string text = "The quick brown fox jumps over the lazy dog. [COLOR red]Sphinx[/COLOR] of black quartz, judge my vow!";
+  CTestLayout first(m_font.get(), true);
+  CTestLayout second(m_font.get(), true);
+  CTestLayout narrow(m_font.get(), true);
+
+  EXPECT_TRUE(first.Update(text, 200));
+  EXPECT_TRUE(second.Update(text, 200));
+  EXPECT_TRUE(narrow.Update(text, 100));
+
+  unsigned int hits, misses, entries;
+  CGUITextLayoutCache::GetInstance().GetStats(hits, misses, entries);
+  EXPECT_EQ(1u, hits);
+  EXPECT_EQ(2u, misses);
+  EXPECT_EQ(2u, entries);
+
+  // a cached layout is the same as the one laid out
+  ASSERT_EQ(first.GetLines().size(), second.GetLines().size());
+  for (size_t i = 0; i < first.GetLines().size(); i++)
+  {
+    EXPECT_EQ(first.GetLines()[i].m_text, second.GetLines()[i].m_text);
+    EXPECT_EQ(first.GetLines()[i].m_carriageReturn, second.GetLines()[i].m_carriageReturn);
+  }
+  EXPECT_EQ(first.GetColors(), second.GetColors());
+  EXPECT_EQ(2u, first.GetColors().size());
+  EXPECT_EQ(first.GetTextWidth(), second.GetTextWidth());
+  EXPECT_GT(first.GetLines().size(), 1u);
+  EXPECT_GT(narrow.GetLines().size(), first.GetLines().size());
+  EXPECT_LE(first.GetTextWidth(), 200);
+}
+
+/*
+ Browsing a list of movies with their plot shown next to it: the focus moves
+ back and forth through the list, so most plots have been shown before. Run with
+ --gtest_also_run_disabled_tests.
+ */
+TEST_F(TestGUITextLayout, DISABLED_PlotBenchmark)
+{
+  static const char *words[] = { "a", "young", "detective", "must", "stop", "the", "ruthless", "gang", "of", "smugglers",
+                                 "before", "they", "destroy", "city", "her", "family", "is", "torn", "apart", "by",
+                                 "secret", "from", "past", "while", "two", "brothers", "set", "out", "on", "journey",
+                                 "across", "country", "to", "find", "their", "missing", "father", "and", "discover", "truth" };
+  const size_t wordCount = sizeof(words) / sizeof(words[0]);
+
+  std::vector<std::string> plots;
+  unsigned int seed = 1;
+  for (int i = 0; i < 300; i++)
+  {
+    std::string plot;
+    int length = 40 + i % 60;
+    for (int j = 0; j < length; j++)
+    {
+      seed = seed * 1103515245 + 12345;
+      if (!plot.empty())
+        plot += (j % 12 == 0) ? ". " : " ";
+      plot += words[(seed >> 16) % wordCount];
+    }
+    plots.push_back(plot + ".");
+  }
+
+  std::vector<size_t> shown;
+  size_t focus = 0;
+  for (int i = 0; i < 20000; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    unsigned int step = (seed >> 16) % 10;
+    if (step < 6)
+      focus = (focus + 1) % plots.size();
+    else if (step < 9)
+      focus = (focus + plots.size() - 1) % plots.size();
+    else
+      focus = (seed >> 20) % plots.size();
+    shown.push_back(focus);
+  }
+
+  CTestLayout layout(m_font.get(), true);
+  CGUITextLayoutCache &cache = CGUITextLayoutCache::GetInstance();
+  unsigned int hits, misses, entries;
+
+  CStopWatch timer;
+  timer.StartZero();
+  for (size_t i = 0; i < shown.size(); i++)
+  {
+    cache.Clear();
+    layout.Update(plots[shown[i]], 600);
+  }
+  float uncached = timer.GetElapsedSeconds();
+  size_t lines = layout.GetLines().size();
+
+  cache.Clear();
+  cache.GetStats(hits, misses, entries);
+  unsigned int updates = 0;
+  timer.StartZero();
+  for (size_t i = 0; i < shown.size(); i++)
+  {
+    if (layout.Update(plots[shown[i]], 600))
+      updates++;
+  }
+  float cached = timer.GetElapsedSeconds();
+  cache.GetStats(hits, misses, entries);
+
+  EXPECT_EQ(lines, layout.GetLines().size());
+  EXPECT_EQ(updates, hits + misses);
+  EXPECT_GT(hits, misses);
+
+  std::cout << "laid out: " << uncached * 1000000 / shown.size() << " us/plot, "
+            << "cached: " << cached * 1000000 / shown.size() << " us/plot, "
+            << hits * 100 / (hits + misses) << "% hits" << std::endl;
+}
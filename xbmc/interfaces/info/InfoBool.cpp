@@ -23,13 +23,23 @@
 
 namespace INFO
 {
+  std::atomic<unsigned int> InfoBool::m_evaluations(0);
+  std::atomic<unsigned int> InfoBool::m_cacheHits(0);
+
   InfoBool::InfoBool(const std::string &expression, int context)
     : m_value(false),
       m_context(context),
       m_listItemDependent(false),
+      m_dependencies(DEPENDS_FRAME),
       m_expression(expression),
       m_dirty(true)
   {
     StringUtils::ToLower(m_expression);
   }
+
+  void InfoBool::GetCounters(unsigned int &evaluations, unsigned int &cacheHits)
+  {
+    evaluations = m_evaluations.exchange(0, std::memory_order_relaxed);
+    cacheHits = m_cacheHits.exchange(0, std::memory_order_relaxed);
+  }
 }
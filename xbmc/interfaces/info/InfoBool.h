@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <memory>
 
@@ -27,6 +28,22 @@ class CGUIListItem;
 
 namespace INFO
 {
+/*!
+ \ingroup info
+ \brief Sources of information an info bool depends on
+ An info bool is only evaluated again once one of its sources changed.
+ \sa CGUIInfoManager::UpdateCache
+ */
+enum InfoDependency
+{
+  DEPENDS_NOTHING = 0,       ///< constant, or only changed along with a full CGUIInfoManager::ResetCache()
+  DEPENDS_FRAME   = 1 << 0,  ///< not known, evaluated every frame
+  DEPENDS_PLAYER  = 1 << 1,  ///< playing media type, paused and play speed
+  DEPENDS_WINDOW  = 1 << 2,  ///< active window, topmost dialog, next and previous window
+  DEPENDS_TIME    = 1 << 3,  ///< date and minute of the day
+  DEPENDS_SKIN    = 1 << 4   ///< skin settings
+};
+
 /*!
  \ingroup info
  \brief Base class, wrapping boolean conditions and expressions
@@ -38,11 +55,11 @@ public:
   virtual ~InfoBool() {};
 
   /*! \brief Set the info bool dirty.
-   Will cause the info bool to be re-evaluated next call to Get()
+   Will cause the info bool to be re-evaluated next call to Get(). May be called from any thread.
    */
   void SetDirty()
   {
-    m_dirty = true;
+    m_dirty.store(true, std::memory_order_relaxed);
   }
   /*! \brief Get the value of this info bool
    This is called to update (if dirty) and fetch the value of the info bool
@@ -51,12 +68,18 @@ public:
   inline bool Get(const CGUIListItem *item = NULL)
   {
     if (item && m_listItemDependent)
+    {
       Update(item);
-    else if (m_dirty)
+      m_evaluations.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (m_dirty.exchange(false, std::memory_order_relaxed))
     {
+      // cleared before updating so a SetDirty() meanwhile isn't lost
       Update(NULL);
-      m_dirty = false;
+      m_evaluations.fetch_add(1, std::memory_order_relaxed);
     }
+    else
+      m_cacheHits.fetch_add(1, std::memory_order_relaxed);
     return m_value;
   }
 
@@ -73,15 +96,28 @@ public:
 
   const std::string &GetExpression() const { return m_expression; }
   bool ListItemDependent() const { return m_listItemDependent; }
+
+  /*! \brief Get the sources this info bool depends on
+   \return a combination of InfoDependency flags
+   */
+  unsigned int GetDependencies() const { return m_dependencies; }
+
+  /*! \brief Get and reset the number of evaluations and cache hits of all info bools
+   */
+  static void GetCounters(unsigned int &evaluations, unsigned int &cacheHits);
 protected:
 
   bool m_value;                ///< current value
   int m_context;               ///< contextual information to go with the condition
   bool m_listItemDependent;    ///< do not cache if a listitem pointer is given
+  unsigned int m_dependencies; ///< InfoDependency flags of the sources this bool depends on
 
 private:
   std::string  m_expression;   ///< original expression
-  bool         m_dirty;        ///< whether we need an update
+  std::atomic<bool> m_dirty;   ///< whether we need an update
+
+  static std::atomic<unsigned int> m_evaluations;
+  static std::atomic<unsigned int> m_cacheHits;
 };
 
 typedef std::shared_ptr<InfoBool> InfoPtr;
@@ -22,6 +22,7 @@
 #include <stack>
 #include "utils/log.h"
 #include "GUIInfoManager.h"
+#include <algorithm>
 #include <list>
 #include <memory>
 
@@ -31,6 +32,7 @@ InfoSingle::InfoSingle(const std::string &expression, int context)
 : InfoBool(expression, context)
 {
   m_condition = g_infoManager.TranslateSingleString(expression, m_listItemDependent);
+  m_dependencies = g_infoManager.GetDependencies(m_condition);
 }
 
 void InfoSingle::Update(const CGUIListItem *item)
@@ -39,41 +41,66 @@ void InfoSingle::Update(const CGUIListItem *item)
 }
 
 InfoExpression::InfoExpression(const std::string &expression, int context)
+: InfoExpression(expression, context, [](const std::string &operand, int context) { return g_infoManager.Register(operand, context); })
+{
+}
+
+InfoExpression::InfoExpression(const std::string &expression, int context, const RegisterFunc &registerOperand)
 : InfoBool(expression, context)
 {
-  if (!Parse(expression))
+  // collected from the operands
+  m_dependencies = DEPENDS_NOTHING;
+  InfoSubexpressionPtr tree;
+  if (!Parse(expression, registerOperand, tree))
   {
     CLog::Log(LOGERROR, "Error parsing boolean expression %s", expression.c_str());
-    m_expression_tree = std::make_shared<InfoLeaf>(g_infoManager.Register("false", 0), false);
+    tree = std::make_shared<InfoLeaf>(registerOperand("false", 0), false);
   }
+  Compile(tree);
 }
 
 void InfoExpression::Update(const CGUIListItem *item)
 {
-  m_value = m_expression_tree->Evaluate(item);
+  bool value = false;
+  const Instruction *program = m_program.data();
+  const Instruction *end = program + m_program.size();
+  for (const Instruction *pc = program; pc != end; )
+  {
+    value = pc->invert ^ pc->leaf->Get(item);
+    pc = (value == pc->exit) ? program + pc->target : pc + 1;
+  }
+  m_value = value;
 }
 
 /* Expressions are rewritten at parse time into a form which favours the
- * formation of groups of associative nodes. These groups are then reordered at
- * evaluation time such that nodes whose value renders the evaluation of the
- * remainder of the group unnecessary tend to be evaluated first (these are
- * true nodes for OR subexpressions, or false nodes for AND subexpressions).
- * The end effect is to minimise the number of leaf nodes that need to be
- * evaluated in order to determine the value of the expression. The runtime
- * adaptability has the advantage of not being customised for any particular skin.
+ * formation of groups of associative nodes, and then compiled into a flat
+ * program which is evaluated in a single loop without recursion.
  *
  * The modifications to the expression at parse time fall into two groups:
  * 1) Moving logical NOTs so that they are only applied to leaf nodes.
- *    For example, rewriting ![A+B]|C as !A|!B|C allows reordering such that
- *    any of the three leaves can be evaluated first.
+ *    For example, rewriting ![A+B]|C as !A|!B|C so that no instruction
+ *    has to invert the value of a whole group.
  * 2) Combining adjacent AND or OR operations such that each path from the root
  *    to a leaf encounters a strictly alternating pattern of AND and OR
  *    operations. So [A|B]|[C|D+[[E|F]|G] becomes A|B|C|[D+[E|F|G]].
+ *
+ * Every instruction evaluates a leaf. A group evaluates its children in turn
+ * and is left as soon as one of them decides its value (true for OR, false
+ * for AND), so the last instruction of every child but the last one jumps out
+ * of the group on that value. The value of the last leaf evaluated is the
+ * value of the whole expression, so the program needs no stack.
+ * Where a jump lands depends on the groups it leaves: a jump out of the last
+ * child of a group decides that group as well, so it is passed on to the
+ * parent, while one deciding a child the other way just continues with the
+ * next child. Jumps leaving the whole expression land on its end.
+ * Operands used more than once in an expression share a leaf.
  */
 
-bool InfoExpression::InfoLeaf::Evaluate(const CGUIListItem *item)
+void InfoExpression::InfoLeaf::Compile(InfoExpression &expression, std::vector<size_t> &exits) const
 {
-  return m_invert ^ m_info->Get(item);
+  Instruction instruction(expression.AddLeaf(m_info), m_invert);
+  instruction.target = expression.m_program.size() + 1;
+  expression.m_program.push_back(instruction);
 }
 
 InfoExpression::InfoAssociativeGroup::InfoAssociativeGroup(
@@ -96,27 +123,52 @@ void InfoExpression::InfoAssociativeGroup::Merge(std::shared_ptr<InfoAssociative
   m_children.splice(m_children.end(), other->m_children);
 }
 
-bool InfoExpression::InfoAssociativeGroup::Evaluate(const CGUIListItem *item)
+void InfoExpression::InfoAssociativeGroup::Compile(InfoExpression &expression, std::vector<size_t> &exits) const
 {
-  /* Handle either AND or OR by using the relation
-   * A AND B == !(!A OR !B)
-   * to convert ANDs into ORs
-   */
-  std::list<InfoSubexpressionPtr>::iterator last = m_children.end();
-  std::list<InfoSubexpressionPtr>::iterator it = m_children.begin();
-  bool use_and = (m_type == NODE_AND);
-  bool result = use_and ^ (*it)->Evaluate(item);
-  while (!result && ++it != last)
+  bool exit = (m_type == NODE_OR);
+  std::list<InfoSubexpressionPtr>::const_iterator last = --m_children.end();
+  for (std::list<InfoSubexpressionPtr>::const_iterator it = m_children.begin(); it != m_children.end(); ++it)
   {
-    result = use_and ^ (*it)->Evaluate(item);
-    if (result)
+    std::vector<size_t> childExits;
+    (*it)->Compile(expression, childExits);
+    if (it == last)
     {
-      /* Move this child to the head of the list so we evaluate faster next time */
-      m_children.push_front(*it);
-      m_children.erase(it);
+      // the value of the last child is the value of the group
+      exits.insert(exits.end(), childExits.begin(), childExits.end());
+      break;
+    }
+
+    // a child ends with a leaf which isn't a jump out of its own groups yet
+    expression.m_program.back().exit = exit;
+    exits.push_back(expression.m_program.size() - 1);
+    for (std::vector<size_t>::const_iterator childExit = childExits.begin(); childExit != childExits.end(); ++childExit)
+    {
+      if (expression.m_program[*childExit].exit == exit)
+        exits.push_back(*childExit);
+      else
+        expression.m_program[*childExit].target = expression.m_program.size();
     }
   }
-  return use_and ^ result;
+}
+
+void InfoExpression::Compile(const InfoSubexpressionPtr &tree)
+{
+  m_program.clear();
+  m_leaves.clear();
+  std::vector<size_t> exits;
+  tree->Compile(*this, exits);
+  for (std::vector<size_t>::const_iterator it = exits.begin(); it != exits.end(); ++it)
+    m_program[*it].target = m_program.size();
+
+  m_program.shrink_to_fit();
+  m_leaves.shrink_to_fit();
+}
+
+InfoBool *InfoExpression::AddLeaf(const InfoPtr &info)
+{
+  if (std::find(m_leaves.begin(), m_leaves.end(), info) == m_leaves.end())
+    m_leaves.push_back(info);
+  return info.get();
 }
 
 /* Expressions are parsed using the shunting-yard algorithm. Binary operators
@@ -207,7 +259,7 @@ void InfoExpression::OperatorPop(std::stack<operator_t> &operator_stack, bool &i
   }
 }
 
-bool InfoExpression::Parse(const std::string &expression)
+bool InfoExpression::Parse(const std::string &expression, const RegisterFunc &registerOperand, InfoSubexpressionPtr &tree)
 {
   const char *s = expression.c_str();
   std::string operand;
@@ -242,14 +294,15 @@ bool InfoExpression::Parse(const std::string &expression)
       }
       if (!operand.empty())
       {
-        InfoPtr info = g_infoManager.Register(operand, m_context);
+        InfoPtr info = registerOperand(operand, m_context);
         if (!info)
         {
           CLog::Log(LOGERROR, "Bad operand '%s'", operand.c_str());
           return false;
         }
-        /* Propagate any listItem dependency from the operand to the expression */
+        /* Propagate any listItem dependency and the sources from the operand to the expression */
         m_listItemDependent |= info->ListItemDependent();
+        m_dependencies |= info->GetDependencies();
         nodes.push(std::make_shared<InfoLeaf>(info, invert));
         /* Reuse operand string for next operand */
         operand.clear();
@@ -293,19 +346,20 @@ bool InfoExpression::Parse(const std::string &expression)
   }
   if (!operand.empty())
   {
-    InfoPtr info = g_infoManager.Register(operand, m_context);
+    InfoPtr info = registerOperand(operand, m_context);
     if (!info)
     {
       CLog::Log(LOGERROR, "Bad operand '%s'", operand.c_str());
       return false;
     }
-    /* Propagate any listItem dependency from the operand to the expression */
+    /* Propagate any listItem dependency and the sources from the operand to the expression */
     m_listItemDependent |= info->ListItemDependent();
+    m_dependencies |= info->GetDependencies();
     nodes.push(std::make_shared<InfoLeaf>(info, invert));
   }
   while (!operator_stack.empty())
     OperatorPop(operator_stack, invert, nodes);
 
-  m_expression_tree = nodes.top();
+  tree = nodes.top();
   return true;
 }
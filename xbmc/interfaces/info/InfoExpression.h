@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <list>
 #include <stack>
@@ -47,7 +48,15 @@ private:
 class InfoExpression : public InfoBool
 {
 public:
+  /*! \brief Registers an operand of an expression, see CGUIInfoManager::Register()
+   */
+  typedef std::function<InfoPtr(const std::string &operand, int context)> RegisterFunc;
+
   InfoExpression(const std::string &expression, int context);
+
+  /*! \brief Create an expression with the operands registered somewhere else than in g_infoManager
+   */
+  InfoExpression(const std::string &expression, int context, const RegisterFunc &registerOperand);
   virtual ~InfoExpression() {};
 
   virtual void Update(const CGUIListItem *item);
@@ -69,12 +78,26 @@ private:
     NODE_OR,
   } node_type_t;
 
-  // An abstract base class for nodes in the expression tree
+  // A single step of the compiled expression: evaluate a leaf, then continue
+  // at target if the value is exit, or with the next instruction otherwise
+  struct Instruction
+  {
+    Instruction(InfoBool *leaf, bool invert) : leaf(leaf), target(0), invert(invert), exit(false) {};
+    InfoBool *leaf;
+    unsigned int target;
+    bool invert;
+    bool exit;
+  };
+
+  // An abstract base class for nodes in the expression tree, only used while parsing
   class InfoSubexpression
   {
   public:
     virtual ~InfoSubexpression(void) {}; // so we can destruct derived classes using a pointer to their base class
-    virtual bool Evaluate(const CGUIListItem *item) = 0;
+    /*! \brief Appends the subexpression to the program of the expression
+     \param exits [out] instructions jumping out of the subexpression, the value they jump on is its value
+     */
+    virtual void Compile(InfoExpression &expression, std::vector<size_t> &exits) const = 0;
     virtual node_type_t Type() const=0;
   };
 
@@ -85,7 +108,7 @@ private:
   {
   public:
     InfoLeaf(InfoPtr info, bool invert) : m_info(info), m_invert(invert) {};
-    virtual bool Evaluate(const CGUIListItem *item);
+    virtual void Compile(InfoExpression &expression, std::vector<size_t> &exits) const;
     virtual node_type_t Type() const { return NODE_LEAF; };
   private:
     InfoPtr m_info;
@@ -99,7 +122,7 @@ private:
     InfoAssociativeGroup(node_type_t type, const InfoSubexpressionPtr &left, const InfoSubexpressionPtr &right);
     void AddChild(const InfoSubexpressionPtr &child);
     void Merge(std::shared_ptr<InfoAssociativeGroup> other);
-    virtual bool Evaluate(const CGUIListItem *item);
+    virtual void Compile(InfoExpression &expression, std::vector<size_t> &exits) const;
     virtual node_type_t Type() const { return m_type; };
   private:
     node_type_t m_type;
@@ -108,8 +131,12 @@ private:
 
   static operator_t GetOperator(char ch);
   static void OperatorPop(std::stack<operator_t> &operator_stack, bool &invert, std::stack<InfoSubexpressionPtr> &nodes);
-  bool Parse(const std::string &expression);
-  InfoSubexpressionPtr m_expression_tree;
+  bool Parse(const std::string &expression, const RegisterFunc &registerOperand, InfoSubexpressionPtr &tree);
+  void Compile(const InfoSubexpressionPtr &tree);
+  InfoBool *AddLeaf(const InfoPtr &info);
+
+  std::vector<Instruction> m_program;  ///< the expression, evaluated from front to back
+  std::vector<InfoPtr> m_leaves;       ///< distinct operands of the expression, referenced by m_program
 };
 
 };
@@ -0,0 +1,327 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "FileItem.h"
+#include "filesystem/Directory.h"
+#include "interfaces/info/InfoExpression.h"
+#include "test/TestUtils.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/XBMCTinyXML.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <map>
+
+using namespace INFO;
+
+// a leaf with a fixed value, counting how often it's evaluated
+class CTestBool : public InfoBool
+{
+public:
+  CTestBool(const std::string &expression, bool value)
+    : InfoBool(expression, 0), m_updates(0)
+  {
+    m_value = value;
+  }
+  virtual void Update(const CGUIListItem *item) { m_updates++; }
+  void SetValue(bool value) { m_value = value; SetDirty(); }
+  unsigned int m_updates;
+};
+
+class TestInfoExpression : public testing::Test
+{
+protected:
+  InfoPtr Parse(const std::string &expression)
+  {
+    return std::make_shared<InfoExpression>(expression, 0,
+                                            std::bind(&TestInfoExpression::Register, this, std::placeholders::_1));
+  }
+
+  InfoPtr Register(const std::string &operand)
+  {
+    std::string name(operand);
+    StringUtils::Trim(name);
+    std::map<std::string, std::shared_ptr<CTestBool> >::iterator it = m_leaves.find(name);
+    if (it != m_leaves.end())
+      return it->second;
+    std::shared_ptr<CTestBool> leaf(new CTestBool(name, false));
+    m_leaves.insert(std::make_pair(name, leaf));
+    return leaf;
+  }
+
+  CTestBool &Leaf(const std::string &name)
+  {
+    Register(name);
+    return *m_leaves[name];
+  }
+
+  std::map<std::string, std::shared_ptr<CTestBool> > m_leaves;
+};
+
+TEST_F(TestInfoExpression, Evaluate)
+{
+  struct
+  {
+    const char *expression;
+    bool (*expected)(bool a, bool b, bool c, bool d, bool e);
+  } cases[] =
+  {
+    { "a + b", [](bool a, bool b, bool c, bool d, bool e) { return a && b; } },
+    { "a | !b", [](bool a, bool b, bool c, bool d, bool e) { return a || !b; } },
+    { "a + b | c", [](bool a, bool b, bool c, bool d, bool e) { return (a && b) || c; } },
+    { "a | b + c", [](bool a, bool b, bool c, bool d, bool e) { return a || (b && c); } },
+    { "!a + [b | !c] + d", [](bool a, bool b, bool c, bool d, bool e) { return !a && (b || !c) && d; } },
+    { "![a + b] | [c + !d]", [](bool a, bool b, bool c, bool d, bool e) { return !(a && b) || (c && !d); } },
+    { "[a | b] + [c | d] + !a", [](bool a, bool b, bool c, bool d, bool e) { return (a || b) && (c || d) && !a; } },
+    { "[[a | b] + c] | [![d + a] + b]", [](bool a, bool b, bool c, bool d, bool e) { return ((a || b) && c) || (!(d && a) && b); } },
+    { "!![a | [b + [c | ![d]]]]", [](bool a, bool b, bool c, bool d, bool e) { return a || (b && (c || !d)); } },
+    // groups ending with a group, whose jumps decide their parents as well
+    { "[a | [b + c]] + d", [](bool a, bool b, bool c, bool d, bool e) { return (a || (b && c)) && d; } },
+    { "a + [b | [c + d]] | e", [](bool a, bool b, bool c, bool d, bool e) { return (a && (b || (c && d))) || e; } },
+    { "[a + [b | [c + d]]] | [e + a]", [](bool a, bool b, bool c, bool d, bool e) { return (a && (b || (c && d))) || (e && a); } },
+    { "![a | [b + !c]] + [d | e]", [](bool a, bool b, bool c, bool d, bool e) { return !(a || (b && !c)) && (d || e); } },
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+  {
+    InfoPtr expression = Parse(cases[i].expression);
+    for (int values = 0; values < 32; values++)
+    {
+      bool a = values & 1, b = values & 2, c = values & 4, d = values & 8, e = values & 16;
+      Leaf("a").SetValue(a);
+      Leaf("b").SetValue(b);
+      Leaf("c").SetValue(c);
+      Leaf("d").SetValue(d);
+      Leaf("e").SetValue(e);
+      expression->SetDirty();
+      EXPECT_EQ(cases[i].expected(a, b, c, d, e), expression->Get()) << cases[i].expression << " with " << values;
+    }
+  }
+}
+
+TEST_F(TestInfoExpression, ShortCircuit)
+{
+  InfoPtr expression = Parse("a | [b + c] | d");
+  Leaf("a").SetValue(false);
+  Leaf("b").SetValue(false);
+  Leaf("c").SetValue(true);
+  Leaf("d").SetValue(true);
+  EXPECT_TRUE(expression->Get());
+  EXPECT_EQ(1u, Leaf("b").m_updates);
+  EXPECT_EQ(0u, Leaf("c").m_updates);
+  EXPECT_EQ(1u, Leaf("d").m_updates);
+
+  Leaf("a").SetValue(true);
+  Leaf("d").SetDirty();
+  expression->SetDirty();
+  EXPECT_TRUE(expression->Get());
+  EXPECT_EQ(1u, Leaf("d").m_updates);
+}
+
+// collects the conditions of a skin's controls with $EXP[] resolved
+static void GetConditions(const TiXmlElement *element, const std::map<std::string, std::string> &expressions,
+                          std::vector<std::string> &conditions)
+{
+  for (; element; element = element->NextSiblingElement())
+  {
+    std::string condition;
+    const std::string value = element->Value();
+    if ((value == "visible" || value == "enable" || value == "selected" || value == "usealttexture") &&
+        element->FirstChild())
+      condition = element->FirstChild()->ValueStr();
+    else if (element->Attribute("condition"))
+      condition = element->Attribute("condition");
+
+    // resolve $EXP[] the way the skin includes do, give up on parameters of includes
+    for (size_t pos; (pos = condition.find("$EXP[")) != std::string::npos; )
+    {
+      size_t end = condition.find(']', pos);
+      std::map<std::string, std::string>::const_iterator it = expressions.find(condition.substr(pos + 5, end - pos - 5));
+      if (end == std::string::npos || it == expressions.end())
+      {
+        condition.clear();
+        break;
+      }
+      condition.replace(pos, end - pos + 1, "[" + it->second + "]");
+    }
+    if (!condition.empty() && condition.find('$') == std::string::npos)
+      conditions.push_back(condition);
+
+    GetConditions(element->FirstChildElement(), expressions, conditions);
+  }
+}
+
+static void GetSkinConditions(std::vector<std::string> &conditions)
+{
+  CFileItemList files;
+  ASSERT_TRUE(XFILE::CDirectory::GetDirectory(XBMC_REF_FILE_PATH("addons/skin.estuary/xml/"), files, ".xml"));
+
+  std::vector<CXBMCTinyXML> documents(files.Size());
+  std::map<std::string, std::string> expressions;
+  for (int i = 0; i < files.Size(); i++)
+  {
+    ASSERT_TRUE(documents[i].LoadFile(files[i]->GetPath()));
+    for (const TiXmlElement *expression = documents[i].RootElement()->FirstChildElement("expression");
+         expression; expression = expression->NextSiblingElement("expression"))
+    {
+      if (expression->Attribute("name") && expression->FirstChild())
+        expressions[expression->Attribute("name")] = expression->FirstChild()->ValueStr();
+    }
+  }
+
+  for (size_t i = 0; i < documents.size(); i++)
+    GetConditions(documents[i].RootElement(), expressions, conditions);
+  ASSERT_FALSE(conditions.empty());
+}
+
+/*
+ Evaluates a condition by walking it recursively, without any rewriting or
+ short-circuiting: OR of ANDs of (possibly negated) operands or brackets.
+ */
+class CReferenceEvaluator
+{
+public:
+  CReferenceEvaluator(const std::string &condition, const std::map<std::string, std::shared_ptr<CTestBool> > &leaves)
+    : m_condition(condition), m_pos(0), m_leaves(leaves)
+  { }
+
+  bool Evaluate() { return Or(); }
+
+private:
+  bool Or()
+  {
+    bool value = And();
+    while (Accept('|'))
+      value = And() | value;
+    return value;
+  }
+
+  bool And()
+  {
+    bool value = Not();
+    while (Accept('+'))
+      value = Not() & value;
+    return value;
+  }
+
+  bool Not()
+  {
+    if (Accept('!'))
+      return !Not();
+    if (Accept('['))
+    {
+      bool value = Or();
+      Accept(']');
+      return value;
+    }
+
+    size_t end = m_condition.find_first_of("[]!+|", m_pos);
+    std::string operand = m_condition.substr(m_pos, end == std::string::npos ? std::string::npos : end - m_pos);
+    m_pos = end == std::string::npos ? m_condition.size() : end;
+    StringUtils::Trim(operand);
+    std::map<std::string, std::shared_ptr<CTestBool> >::const_iterator it = m_leaves.find(operand);
+    EXPECT_TRUE(it != m_leaves.end()) << operand;
+    return it != m_leaves.end() && it->second->Get();
+  }
+
+  bool Accept(char c)
+  {
+    while (m_pos < m_condition.size() && isspace((unsigned char)m_condition[m_pos]))
+      m_pos++;
+    if (m_pos < m_condition.size() && m_condition[m_pos] == c)
+    {
+      m_pos++;
+      return true;
+    }
+    return false;
+  }
+
+  const std::string &m_condition;
+  size_t m_pos;
+  const std::map<std::string, std::shared_ptr<CTestBool> > &m_leaves;
+};
+
+TEST_F(TestInfoExpression, SkinConditions)
+{
+  std::vector<std::string> conditions;
+  GetSkinConditions(conditions);
+
+  std::vector<InfoPtr> bools;
+  for (size_t i = 0; i < conditions.size(); i++)
+    bools.push_back(Parse(conditions[i]));
+
+  // pseudo random assignments of the operands
+  unsigned int seed = 1;
+  for (int round = 0; round < 64; round++)
+  {
+    for (std::map<std::string, std::shared_ptr<CTestBool> >::iterator it = m_leaves.begin(); it != m_leaves.end(); ++it)
+    {
+      seed = seed * 1103515245 + 12345;
+      it->second->SetValue((seed >> 16) & 1);
+    }
+
+    for (size_t i = 0; i < bools.size(); i++)
+    {
+      bools[i]->SetDirty();
+      EXPECT_EQ(CReferenceEvaluator(conditions[i], m_leaves).Evaluate(), bools[i]->Get()) << conditions[i];
+    }
+  }
+}
+
+/*
+ Evaluates every condition of the Estuary skin over and over with all
+ operands dirty, which is what rendering a frame boils down to when
+ nothing could be cached. Run with --gtest_also_run_disabled_tests.
+ */
+TEST_F(TestInfoExpression, DISABLED_SkinBenchmark)
+{
+  std::vector<std::string> conditions;
+  GetSkinConditions(conditions);
+
+  std::vector<InfoPtr> bools;
+  for (size_t i = 0; i < conditions.size(); i++)
+    bools.push_back(Parse(conditions[i]));
+  int operand = 0;
+  for (std::map<std::string, std::shared_ptr<CTestBool> >::iterator it = m_leaves.begin(); it != m_leaves.end(); ++it)
+    it->second->SetValue(operand++ % 4 == 0);
+
+  const int frames = 2000;
+  unsigned int values = 0;
+  CStopWatch timer;
+  timer.StartZero();
+  for (int frame = 0; frame < frames; frame++)
+  {
+    for (std::map<std::string, std::shared_ptr<CTestBool> >::iterator it = m_leaves.begin(); it != m_leaves.end(); ++it)
+      it->second->SetDirty();
+    for (size_t i = 0; i < bools.size(); i++)
+    {
+      bools[i]->SetDirty();
+      values += bools[i]->Get();
+    }
+  }
+  float elapsed = timer.GetElapsedSeconds();
+  EXPECT_GT(values, 0u);
+
+  std::cout << conditions.size() << " conditions, " << m_leaves.size() << " operands: "
+            << bools.size() * frames / elapsed / 1000000 << " M evaluations/s" << std::endl;
+}
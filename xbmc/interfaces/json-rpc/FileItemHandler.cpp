@@ -19,9 +19,11 @@
  */
 
 #include <map>
+#include <memory>
 #include <string.h>
 
 #include "FileItemHandler.h"
+#include "ResponseStream.h"
 #include "AudioLibrary.h"
 #include "VideoLibrary.h"
 #include "FileOperations.h"
@@ -222,18 +224,6 @@ void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const
     end = items.Size();
   }
 
-  CThumbLoader *thumbLoader = NULL;
-  if (end - start > 0)
-  {
-    if (items.Get(start)->HasVideoInfoTag())
-      thumbLoader = new CVideoThumbLoader();
-    else if (items.Get(start)->HasMusicInfoTag())
-      thumbLoader = new CMusicThumbLoader();
-
-    if (thumbLoader != NULL)
-      thumbLoader->OnLoaderStart();
-  }
-
   std::set<std::string> fields;
   if (parameterObject.isMember("properties") && parameterObject["properties"].isArray())
   {
@@ -241,6 +231,20 @@ void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const
       fields.insert(field->asString());
   }
 
+  // if the transport supports it the items of the method's result are
+  // only serialized while the response is sent
+  CResponseStream *stream = CResponseStream::GetCurrent();
+  if (stream != NULL && stream->IsMethodResult(result) && end - start > 0)
+  {
+    std::unique_ptr<IStreamedResult> streamed(new CStreamedFileItemList(ID, allowFile, resultname, items, start, end, parameterObject, fields));
+    stream->AddResult(resultname, std::move(streamed));
+    return;
+  }
+
+  CThumbLoader *thumbLoader = NULL;
+  if (end - start > 0)
+    thumbLoader = CreateThumbLoader(items.Get(start));
+
   for (int i = start; i < end; i++)
   {
     CFileItemPtr item = items.Get(i);
@@ -250,6 +254,54 @@ void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const
   delete thumbLoader;
 }
 
+CThumbLoader* CFileItemHandler::CreateThumbLoader(const CFileItemPtr &item)
+{
+  CThumbLoader *thumbLoader = NULL;
+  if (item->HasVideoInfoTag())
+    thumbLoader = new CVideoThumbLoader();
+  else if (item->HasMusicInfoTag())
+    thumbLoader = new CMusicThumbLoader();
+
+  if (thumbLoader != NULL)
+    thumbLoader->OnLoaderStart();
+
+  return thumbLoader;
+}
+
+CFileItemHandler::CStreamedFileItemList::CStreamedFileItemList(const char *ID, bool allowFile, const char *resultname, const CFileItemList &items, int start, int end,
+                                                               const CVariant &parameterObject, const std::set<std::string> &fields)
+  : m_ID(ID != NULL ? ID : ""),
+    m_allowFile(allowFile),
+    m_resultname(resultname),
+    m_parameterObject(parameterObject),
+    m_fields(fields),
+    m_next(0)
+{
+  // only the pointers are copied, the caller's list is gone by the time the items are written
+  m_items.reserve(end - start);
+  for (int i = start; i < end; i++)
+    m_items.push_back(items.Get(i));
+
+  m_thumbLoader.reset(CreateThumbLoader(m_items.front()));
+}
+
+CFileItemHandler::CStreamedFileItemList::~CStreamedFileItemList() = default;
+
+bool CFileItemHandler::CStreamedFileItemList::WriteNext(CJSONStreamWriter &writer)
+{
+  if (m_next >= m_items.size())
+    return false;
+
+  CVariant result;
+  HandleFileItem(m_ID.empty() ? NULL : m_ID.c_str(), m_allowFile, m_resultname.c_str(), m_items[m_next], m_parameterObject, m_fields, result, false, m_thumbLoader.get());
+
+  // the item isn't needed anymore once it has been written
+  m_items[m_next++].reset();
+
+  writer.Value(result[m_resultname]);
+  return true;
+}
+
 void CFileItemHandler::HandleFileItem(const char *ID, bool allowFile, const char *resultname, CFileItemPtr item, const CVariant &parameterObject, const CVariant &validFields, CVariant &result, bool append /* = true */, CThumbLoader *thumbLoader /* = NULL */)
 {
   std::set<std::string> fields;
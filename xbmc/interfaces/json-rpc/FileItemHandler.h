@@ -19,11 +19,15 @@
  *
  */
 
+#include <memory>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "JSONRPC.h"
 #include "JSONUtils.h"
 #include "FileItem.h"
+#include "ResponseStream.h"
 
 class CThumbLoader;
 class CVariant;
@@ -41,6 +45,31 @@ namespace JSONRPC
 
     static bool FillFileItemList(const CVariant &parameterObject, CFileItemList &list);
   private:
+    /*!
+     \brief List of items of a result which are serialized while the response is sent
+     */
+    class CStreamedFileItemList : public IStreamedResult
+    {
+    public:
+      CStreamedFileItemList(const char *ID, bool allowFile, const char *resultname, const CFileItemList &items, int start, int end,
+                            const CVariant &parameterObject, const std::set<std::string> &fields);
+      ~CStreamedFileItemList() override;
+
+      // implementation of IStreamedResult
+      bool WriteNext(CJSONStreamWriter &writer) override;
+
+    private:
+      std::string m_ID;
+      bool m_allowFile;
+      std::string m_resultname;
+      std::vector<CFileItemPtr> m_items;
+      CVariant m_parameterObject;
+      std::set<std::string> m_fields;
+      std::unique_ptr<CThumbLoader> m_thumbLoader;
+      size_t m_next;
+    };
+
+    static CThumbLoader* CreateThumbLoader(const CFileItemPtr &item);
     static void Sort(CFileItemList &items, const CVariant& parameterObject);
     static bool GetField(const std::string &field, const CVariant &info, const CFileItemPtr &item, CVariant &result, bool &fetchedArt, CThumbLoader *thumbLoader = NULL);
   };
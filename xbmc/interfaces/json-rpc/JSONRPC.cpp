@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include "JSONRPC.h"
+#include "ResponseStream.h"
 #include "ServiceDescription.h"
 #include "addons/Addon.h"
 #include "addons/IAddon.h"
@@ -235,7 +236,28 @@ JSONRPC_STATUS CJSONRPC::NotifyAll(const std::string &method, ITransportLayer *t
 
 std::string CJSONRPC::MethodCall(const std::string &inputString, ITransportLayer *transport, IClient *client)
 {
-  CVariant inputroot, outputroot, result;
+  CVariant outputroot;
+  std::string str;
+  if (HandleCall(inputString, outputroot, transport, client, NULL))
+    CJSONVariantWriter::Write(outputroot, str, g_advancedSettings.m_jsonOutputCompact);
+
+  return str;
+}
+
+std::unique_ptr<CResponseStream> CJSONRPC::MethodCallStream(const std::string &inputString, ITransportLayer *transport, IClient *client)
+{
+  std::unique_ptr<CResponseStream> stream(new CResponseStream(g_advancedSettings.m_jsonOutputCompact));
+
+  CVariant outputroot;
+  if (HandleCall(inputString, outputroot, transport, client, stream.get()))
+    stream->SetResponse(std::move(outputroot));
+
+  return stream;
+}
+
+bool CJSONRPC::HandleCall(const std::string &inputString, CVariant &outputroot, ITransportLayer *transport, IClient *client, CResponseStream *stream)
+{
+  CVariant inputroot;
   bool hasResponse = false;
 
   if(g_advancedSettings.CanLogComponent(LOGJSONRPC))
@@ -256,7 +278,7 @@ std::string CJSONRPC::MethodCall(const std::string &inputString, ITransportLayer
         for (CVariant::const_iterator_array itr = inputroot.begin_array(); itr != inputroot.end_array(); itr++)
         {
           CVariant response;
-          if (HandleMethodCall(*itr, response, transport, client))
+          if (HandleMethodCall(*itr, response, transport, client, stream))
           {
             outputroot.append(response);
             hasResponse = true;
@@ -265,7 +287,7 @@ std::string CJSONRPC::MethodCall(const std::string &inputString, ITransportLayer
       }
     }
     else
-      hasResponse = HandleMethodCall(inputroot, outputroot, transport, client);
+      hasResponse = HandleMethodCall(inputroot, outputroot, transport, client, stream);
   }
   else
   {
@@ -274,14 +296,10 @@ std::string CJSONRPC::MethodCall(const std::string &inputString, ITransportLayer
     hasResponse = true;
   }
 
-  std::string str;
-  if (hasResponse)
-    CJSONVariantWriter::Write(outputroot, str, g_advancedSettings.m_jsonOutputCompact);
-
-  return str;
+  return hasResponse;
 }
 
-bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client)
+bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client, CResponseStream *stream)
 {
   JSONRPC_STATUS errorCode = OK;
   CVariant result;
@@ -298,7 +316,12 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
     CVariant params;
 
     if ((errorCode = CJSONServiceDescription::CheckCall(methodName.c_str(), request["params"], transport, client, isNotification, method, params)) == OK)
+    {
+      if (stream != NULL)
+        stream->BeginCall(result);
+
       errorCode = method(methodName, transport, client, params, result);
+    }
     else
       result = params;
   }
@@ -313,6 +336,10 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
 
   BuildResponse(request, errorCode, result, response);
 
+  // keeps the streamed results in step with the responses of a batch call
+  if (stream != NULL)
+    stream->EndCall(!isNotification, errorCode == OK);
+
   return !isNotification;
 }
 
@@ -21,6 +21,7 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <stdio.h>
 #include <string>
 
@@ -31,6 +32,8 @@ class CVariant;
 
 namespace JSONRPC
 {
+  class CResponseStream;
+
   /*!
    \ingroup jsonrpc
    \brief JSON RPC handler
@@ -64,6 +67,18 @@ namespace JSONRPC
      */
     static std::string MethodCall(const std::string &inputString, ITransportLayer *transport, IClient *client);
 
+    /*
+     \brief Handles an incoming JSON-RPC request with a streamed response
+     \param inputString received JSON-RPC request
+     \param transport Transport protocol on which the request arrived
+     \param client Client which sent the request
+     \return JSON-RPC response to be read by the transport
+
+     Same as MethodCall() but big results (e.g. lists of items) aren't
+     serialized before the response is read from the returned stream.
+     */
+    static std::unique_ptr<CResponseStream> MethodCallStream(const std::string &inputString, ITransportLayer *transport, IClient *client);
+
     static JSONRPC_STATUS Introspect(const std::string &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSONRPC_STATUS Version(const std::string &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSONRPC_STATUS Permission(const std::string &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
@@ -74,7 +89,8 @@ namespace JSONRPC
   
   private:
     static void setup();
-    static bool HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client);
+    static bool HandleCall(const std::string &inputString, CVariant &outputroot, ITransportLayer *transport, IClient *client, CResponseStream *stream);
+    static bool HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client, CResponseStream *stream);
     static inline bool IsProperJSONRPC(const CVariant& inputroot);
 
     inline static void BuildResponse(const CVariant& request, JSONRPC_STATUS code, const CVariant& result, CVariant& response);
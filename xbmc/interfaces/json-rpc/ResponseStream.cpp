@@ -0,0 +1,261 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ResponseStream.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "threads/ThreadLocal.h"
+
+using namespace JSONRPC;
+
+static XbmcThreads::ThreadLocal<CResponseStream> currentStream;
+
+CResponseStream::CResponseStream(bool compact)
+  : m_writer(*this, compact),
+    m_result(nullptr),
+    m_position(0),
+    m_done(false)
+{ }
+
+CResponseStream::~CResponseStream() = default;
+
+CResponseStream* CResponseStream::GetCurrent()
+{
+  return currentStream.get();
+}
+
+void CResponseStream::AddResult(const std::string &name, std::unique_ptr<IStreamedResult> result)
+{
+  m_pending.push_back(std::make_pair(name, std::move(result)));
+}
+
+bool CResponseStream::IsStreamed() const
+{
+  for (std::vector<StreamedResults>::const_iterator results = m_results.begin(); results != m_results.end(); ++results)
+  {
+    if (!results->empty())
+      return true;
+  }
+
+  return false;
+}
+
+ssize_t CResponseStream::Read(char *buffer, size_t size)
+{
+  // the response is cut off, don't let the rest look like a complete one
+  if (m_writer.HasFailed())
+    return -1;
+
+  while (m_buffer.size() - m_position < size && !m_done)
+  {
+    if (!WriteNext())
+      return -1;
+  }
+
+  size_t length = std::min(size, m_buffer.size() - m_position);
+  memcpy(buffer, m_buffer.c_str() + m_position, length);
+  m_position += length;
+
+  if (m_position == m_buffer.size())
+  {
+    m_buffer.clear();
+    m_position = 0;
+  }
+
+  return length;
+}
+
+bool CResponseStream::ReadAll(std::string &output)
+{
+  if (m_writer.HasFailed())
+    return false;
+
+  while (!m_done)
+  {
+    if (!WriteNext())
+      return false;
+  }
+
+  output = m_buffer.substr(m_position);
+  m_buffer.clear();
+  m_position = 0;
+
+  return true;
+}
+
+void CResponseStream::BeginCall(const CVariant &result)
+{
+  m_result = &result;
+  m_pending.clear();
+  currentStream.set(this);
+}
+
+void CResponseStream::EndCall(bool hasResponse, bool succeeded)
+{
+  currentStream.set(nullptr);
+  m_result = nullptr;
+
+  // results of notifications and failed calls are never written
+  if (!succeeded)
+    m_pending.clear();
+
+  if (hasResponse)
+    m_results.push_back(std::move(m_pending));
+  m_pending.clear();
+}
+
+void CResponseStream::SetResponse(CVariant &&response)
+{
+  if (response.isArray())
+  {
+    m_tokens.push_back(Token(Token::StartArray));
+    for (unsigned int index = 0; index < response.size(); index++)
+      AddResponse(std::move(response[index]), index);
+    m_tokens.push_back(Token(Token::EndArray));
+  }
+  else if (!response.isNull())
+    AddResponse(std::move(response), 0);
+}
+
+void CResponseStream::AddResponse(CVariant &&response, size_t index)
+{
+  if (index >= m_results.size() || m_results[index].empty() || !response.isMember("result") || !response["result"].isObject())
+  {
+    m_tokens.push_back(Token(Token::Value, std::move(response)));
+    return;
+  }
+
+  // {"id":..,"jsonrpc":"2.0","result":{<members and streamed results>}} with
+  // the members in the same order as CJSONVariantWriter writes them
+  StreamedResults &streamed = m_results[index];
+  std::sort(streamed.begin(), streamed.end(),
+            [](const StreamedResults::value_type &a, const StreamedResults::value_type &b) { return a.first < b.first; });
+
+  m_tokens.push_back(Token(Token::StartObject));
+  for (CVariant::iterator_map member = response.begin_map(); member != response.end_map(); ++member)
+  {
+    m_tokens.push_back(Token(Token::Key, CVariant(member->first)));
+    if (member->first != "result")
+    {
+      m_tokens.push_back(Token(Token::Value, std::move(member->second)));
+      continue;
+    }
+
+    m_tokens.push_back(Token(Token::StartObject));
+    StreamedResults::iterator next = streamed.begin();
+    CVariant &result = member->second;
+    for (CVariant::iterator_map value = result.begin_map(); value != result.end_map(); ++value)
+    {
+      for (; next != streamed.end() && next->first <= value->first; ++next)
+        AddStreamed(*next);
+
+      // a streamed result replaces a member of the same name
+      if (next != streamed.begin() && (next - 1)->first == value->first)
+        continue;
+
+      m_tokens.push_back(Token(Token::Key, CVariant(value->first)));
+      m_tokens.push_back(Token(Token::Value, std::move(value->second)));
+    }
+    for (; next != streamed.end(); ++next)
+      AddStreamed(*next);
+    m_tokens.push_back(Token(Token::EndObject));
+  }
+  m_tokens.push_back(Token(Token::EndObject));
+
+  streamed.clear();
+}
+
+void CResponseStream::AddStreamed(StreamedResults::value_type &streamed)
+{
+  m_tokens.push_back(Token(Token::Key, CVariant(streamed.first)));
+  m_tokens.push_back(Token(Token::Streamed));
+  m_tokens.back().result = std::move(streamed.second);
+}
+
+bool CResponseStream::WriteNext()
+{
+  if (m_tokens.empty())
+  {
+    m_done = true;
+    return m_writer.Flush();
+  }
+
+  Token &token = m_tokens.front();
+  switch (token.type)
+  {
+  case Token::StartObject:
+    m_writer.StartObject();
+    break;
+
+  case Token::EndObject:
+    m_writer.EndObject();
+    break;
+
+  case Token::StartArray:
+    m_writer.StartArray();
+    break;
+
+  case Token::EndArray:
+    m_writer.EndArray();
+    break;
+
+  case Token::Key:
+    m_writer.Key(token.value.asString());
+    break;
+
+  case Token::Value:
+    m_writer.Value(token.value);
+    break;
+
+  case Token::Streamed:
+    if (!token.started)
+    {
+      token.started = true;
+      m_writer.StartArray();
+      return !m_writer.HasFailed();
+    }
+
+    // keep the token until all elements have been written
+    if (token.result->WriteNext(m_writer))
+      return !m_writer.HasFailed();
+
+    m_writer.EndArray();
+    break;
+  }
+
+  m_tokens.pop_front();
+
+  if (m_writer.HasFailed())
+  {
+    m_done = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool CResponseStream::Write(const char *data, size_t size)
+{
+  m_buffer.append(data, size);
+  return true;
+}
@@ -0,0 +1,160 @@
+#pragma once
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <sys/types.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils/JSONStreamWriter.h"
+#include "utils/Variant.h"
+
+class TestResponseStream;
+
+namespace JSONRPC
+{
+  /*!
+   \ingroup jsonrpc
+   \brief Array in the result of a JSON-RPC method which is written
+   element by element while the response is being sent
+   */
+  class IStreamedResult
+  {
+  public:
+    virtual ~IStreamedResult() = default;
+
+    /*!
+     \brief Writes the next element of the array
+     \param writer Writer to emit the element into
+     \return False if all elements have been written
+     */
+    virtual bool WriteNext(CJSONStreamWriter &writer) = 0;
+  };
+
+  /*!
+   \ingroup jsonrpc
+   \brief JSON-RPC response which is serialized while it is being read
+
+   While CJSONRPC::MethodCall() executes the requested methods for a
+   CResponseStream, methods can hand over big arrays of their result as
+   IStreamedResult (see GetCurrent()) instead of building them up as a
+   CVariant. Those are only turned into JSON when the response is read,
+   one piece of the requested size at a time.
+   */
+  class CResponseStream : private IJSONStreamSink
+  {
+  public:
+    explicit CResponseStream(bool compact);
+    ~CResponseStream();
+
+    /*!
+     \brief Returns the response stream of the method call executed on the
+     calling thread or NULL if the caller doesn't support streamed results
+     */
+    static CResponseStream* GetCurrent();
+
+    /*!
+     \brief Whether the given value is the result of the method call
+     currently being executed (and not e.g. an object nested in it)
+     */
+    bool IsMethodResult(const CVariant &result) const { return &result == m_result; }
+
+    /*!
+     \brief Adds an array with the given name to the result of the method
+     call currently being executed
+     */
+    void AddResult(const std::string &name, std::unique_ptr<IStreamedResult> result);
+
+    /*!
+     \brief Whether any of the results are written while the response is read
+     */
+    bool IsStreamed() const;
+
+    /*!
+     \brief Reads the next piece of the response
+     \param buffer Buffer to write the response to
+     \param size Size of the buffer
+     \return Number of bytes written, 0 at the end of the response or -1 on error
+     */
+    ssize_t Read(char *buffer, size_t size);
+
+    /*!
+     \brief Reads the (remaining) response at once
+     */
+    bool ReadAll(std::string &output);
+
+  private:
+    friend class CJSONRPC;
+    friend class ::TestResponseStream;
+
+    struct Token
+    {
+      enum Type
+      {
+        StartObject,
+        EndObject,
+        StartArray,
+        EndArray,
+        Key,
+        Value,
+        Streamed
+      };
+
+      Token(Type type) : type(type), started(false) { }
+      Token(Type type, CVariant &&value) : type(type), value(std::move(value)), started(false) { }
+
+      Type type;
+      CVariant value;
+      std::unique_ptr<IStreamedResult> result;
+      bool started;
+    };
+    typedef std::vector<std::pair<std::string, std::unique_ptr<IStreamedResult> > > StreamedResults;
+
+    CResponseStream(const CResponseStream&) = delete;
+    CResponseStream& operator=(const CResponseStream&) = delete;
+
+    // called by CJSONRPC around every method call
+    void BeginCall(const CVariant &result);
+    void EndCall(bool hasResponse, bool succeeded);
+
+    // called by CJSONRPC once all methods have been executed
+    void SetResponse(CVariant &&response);
+
+    void AddResponse(CVariant &&response, size_t index);
+    void AddStreamed(StreamedResults::value_type &streamed);
+    bool WriteNext();
+
+    // implementation of IJSONStreamSink
+    bool Write(const char *data, size_t size) override;
+
+    CJSONStreamWriter m_writer;
+    const CVariant *m_result;
+    std::deque<Token> m_tokens;
+    StreamedResults m_pending;
+    std::vector<StreamedResults> m_results;
+    std::string m_buffer;
+    size_t m_position;
+    bool m_done;
+  };
+}
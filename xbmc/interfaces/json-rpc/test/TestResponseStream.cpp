@@ -0,0 +1,258 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "interfaces/json-rpc/ResponseStream.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/Variant.h"
+
+#include "gtest/gtest.h"
+
+#include <limits>
+
+using namespace JSONRPC;
+
+namespace
+{
+CVariant Element(int index)
+{
+  CVariant element;
+  element["label"] = "item";
+  element["index"] = index;
+  return element;
+}
+
+CVariant Elements(int count)
+{
+  CVariant elements(CVariant::VariantTypeArray);
+  for (int i = 0; i < count; i++)
+    elements.push_back(Element(i));
+  return elements;
+}
+
+// writes Element(0) to Element(count - 1), or NaN in place of the broken one
+class CStreamedElements : public IStreamedResult
+{
+public:
+  explicit CStreamedElements(int count, int broken = -1)
+    : m_count(count),
+      m_broken(broken),
+      m_next(0)
+  { }
+
+  bool WriteNext(CJSONStreamWriter &writer) override
+  {
+    if (m_next >= m_count)
+      return false;
+
+    if (m_next == m_broken)
+      writer.Value(CVariant(std::numeric_limits<double>::quiet_NaN()));
+    else
+      writer.Value(Element(m_next));
+    m_next++;
+    return true;
+  }
+
+private:
+  int m_count;
+  int m_broken;
+  int m_next;
+};
+
+CVariant Response(int id)
+{
+  CVariant response;
+  response["id"] = id;
+  response["jsonrpc"] = "2.0";
+  return response;
+}
+
+std::string ToJson(const CVariant &value)
+{
+  std::string json;
+  EXPECT_TRUE(CJSONVariantWriter::Write(value, json, true));
+  return json;
+}
+}
+
+class TestResponseStream : public testing::Test
+{
+protected:
+  // executes a method call which streams count elements as result "name"
+  static void StreamedCall(CResponseStream &stream, CVariant &result, const std::string &name, int count,
+                           bool hasResponse = true, bool succeeded = true, int broken = -1)
+  {
+    stream.BeginCall(result);
+    EXPECT_EQ(&stream, CResponseStream::GetCurrent());
+    EXPECT_TRUE(stream.IsMethodResult(result));
+    stream.AddResult(name, std::unique_ptr<IStreamedResult>(new CStreamedElements(count, broken)));
+    stream.EndCall(hasResponse, succeeded);
+    EXPECT_EQ(nullptr, CResponseStream::GetCurrent());
+  }
+
+  static void PlainCall(CResponseStream &stream, CVariant &result, bool hasResponse = true, bool succeeded = true)
+  {
+    stream.BeginCall(result);
+    stream.EndCall(hasResponse, succeeded);
+  }
+
+  static void SetResponse(CResponseStream &stream, CVariant response)
+  {
+    stream.SetResponse(std::move(response));
+  }
+};
+
+TEST_F(TestResponseStream, StreamsResultsInKeyOrder)
+{
+  CResponseStream stream(true);
+  CVariant result;
+  result["limits"]["start"] = 0;
+  result["limits"]["total"] = 2000;
+  result["title"] = "directory";
+  StreamedCall(stream, result, "files", 2000);
+  EXPECT_TRUE(stream.IsStreamed());
+
+  CVariant response = Response(1);
+  response["result"] = result;
+  SetResponse(stream, response);
+
+  // the same response built up as a CVariant
+  response["result"]["files"] = Elements(2000);
+
+  std::string output;
+  EXPECT_TRUE(stream.ReadAll(output));
+  EXPECT_EQ(ToJson(response), output);
+}
+
+TEST_F(TestResponseStream, ReadsInPieces)
+{
+  CResponseStream whole(true), pieces(true);
+  CResponseStream *streams[] = { &whole, &pieces };
+  for (size_t i = 0; i < 2; i++)
+  {
+    CVariant result;
+    result["limits"]["total"] = 3000;
+    StreamedCall(*streams[i], result, "items", 3000);
+
+    CVariant response = Response(1);
+    response["result"] = result;
+    SetResponse(*streams[i], response);
+  }
+
+  std::string expected;
+  EXPECT_TRUE(whole.ReadAll(expected));
+
+  std::string output;
+  char buffer[7];
+  ssize_t read;
+  while ((read = pieces.Read(buffer, sizeof(buffer))) > 0)
+  {
+    EXPECT_GE(sizeof(buffer), static_cast<size_t>(read));
+    output.append(buffer, read);
+  }
+
+  EXPECT_EQ(0, read);
+  EXPECT_EQ(0, pieces.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(expected, output);
+}
+
+TEST_F(TestResponseStream, MixesStreamedAndPlainResultsInBatch)
+{
+  CResponseStream stream(true);
+  CVariant responses(CVariant::VariantTypeArray);
+
+  CVariant songs;
+  songs["limits"]["total"] = 100;
+  StreamedCall(stream, songs, "songs", 100);
+  responses.push_back(Response(1));
+  responses[0]["result"] = songs;
+
+  // neither notifications nor failed calls get their streamed results written
+  CVariant notification;
+  StreamedCall(stream, notification, "ignored", 10, false, true);
+
+  CVariant failed;
+  StreamedCall(stream, failed, "ignored", 10, true, false);
+  responses.push_back(Response(2));
+  responses[1]["error"]["code"] = -32602;
+  responses[1]["error"]["message"] = "Invalid params.";
+
+  CVariant plain("OK");
+  PlainCall(stream, plain);
+  responses.push_back(Response(3));
+  responses[2]["result"] = plain;
+
+  CVariant empty(CVariant::VariantTypeObject);
+  StreamedCall(stream, empty, "albums", 5);
+  responses.push_back(Response(4));
+  responses[3]["result"] = empty;
+
+  EXPECT_TRUE(stream.IsStreamed());
+  SetResponse(stream, responses);
+
+  CVariant expected = responses;
+  expected[0]["result"]["songs"] = Elements(100);
+  expected[3]["result"]["albums"] = Elements(5);
+
+  std::string output;
+  EXPECT_TRUE(stream.ReadAll(output));
+  EXPECT_EQ(ToJson(expected), output);
+}
+
+TEST_F(TestResponseStream, PlainResponse)
+{
+  CResponseStream stream(true);
+  CVariant result("OK");
+  PlainCall(stream, result);
+  EXPECT_FALSE(stream.IsStreamed());
+
+  CVariant response = Response(1);
+  response["result"] = result;
+  SetResponse(stream, response);
+
+  std::string output;
+  EXPECT_TRUE(stream.ReadAll(output));
+  EXPECT_EQ(ToJson(response), output);
+}
+
+TEST_F(TestResponseStream, FailsMidStream)
+{
+  CResponseStream stream(true);
+  CVariant result(CVariant::VariantTypeObject);
+  StreamedCall(stream, result, "items", 3000, true, true, 2000);
+
+  CVariant response = Response(1);
+  response["result"] = result;
+  SetResponse(stream, response);
+
+  char buffer[1024];
+  size_t total = 0;
+  ssize_t read;
+  while ((read = stream.Read(buffer, sizeof(buffer))) > 0)
+    total += read;
+
+  // the elements before the broken one have been sent
+  EXPECT_EQ(-1, read);
+  EXPECT_LT(0u, total);
+
+  // the truncated response must never look complete
+  EXPECT_EQ(-1, stream.Read(buffer, sizeof(buffer)));
+  std::string output;
+  EXPECT_FALSE(stream.ReadAll(output));
+}
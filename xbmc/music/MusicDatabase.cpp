@@ -667,49 +667,44 @@ int CMusicDatabase::AddSong(const int idAlbum,
     URIUtils::Split(strPathAndFileName, strPath, strFileName);
     int idPath = AddPath(strPath);
 
+    std::vector<dbiplus::field_value> params;
     if (!strMusicBrainzTrackID.empty())
-      strSQL = PrepareSQL("SELECT * FROM song WHERE idAlbum = %i AND strMusicBrainzTrackID = '%s'",
-                          idAlbum,
-                          strMusicBrainzTrackID.c_str());
+    {
+      strSQL = "SELECT * FROM song WHERE idAlbum = ? AND strMusicBrainzTrackID = ?";
+      params = { idAlbum, strMusicBrainzTrackID };
+    }
     else
-      strSQL = PrepareSQL("SELECT * FROM song WHERE idAlbum=%i AND strFileName='%s' AND strTitle='%s' AND iTrack=%i AND strMusicBrainzTrackID IS NULL",
-                          idAlbum,
-                          strFileName.c_str(),
-                          strTitle.c_str(),
-                          iTrack);
+    {
+      strSQL = "SELECT * FROM song WHERE idAlbum=? AND strFileName=? AND strTitle=? AND iTrack=? AND strMusicBrainzTrackID IS NULL";
+      params = { idAlbum, strFileName, strTitle, iTrack };
+    }
 
-    if (!m_pDS->query(strSQL))
+    if (!m_pDS->query_prepared(strSQL, params))
       return -1;
 
     if (m_pDS->num_rows() == 0)
     {
       m_pDS->close();
-      strSQL=PrepareSQL("INSERT INTO song ("
-                                          "idSong,idAlbum,idPath,strArtists,strGenres,"
-                                          "strTitle,iTrack,iDuration,iYear,strFileName,"
-                                          "strMusicBrainzTrackID,iTimesPlayed,iStartOffset,"
-                                          "iEndOffset,lastplayed,rating,userrating,votes,comment,mood"
-                        ") values (NULL, %i, %i, '%s', '%s', '%s', %i, %i, %i, '%s'",
-                    idAlbum,
-                    idPath,
-                    artistString.c_str(),
-                    StringUtils::Join(genres, g_advancedSettings.m_musicItemSeparator).c_str(),
-                    strTitle.c_str(),
-                    iTrack, iDuration, iYear,
-                    strFileName.c_str());
-
-      if (strMusicBrainzTrackID.empty())
-        strSQL += PrepareSQL(",NULL");
-      else
-        strSQL += PrepareSQL(",'%s'", strMusicBrainzTrackID.c_str());
-
-      if (dtLastPlayed.IsValid())
-        strSQL += PrepareSQL(",%i,%i,%i,'%s', %.1f, %i, %i, '%s','%s')",
-                      iTimesPlayed, iStartOffset, iEndOffset, dtLastPlayed.GetAsDBDateTime().c_str(), rating, userrating, votes, strComment.c_str(), strMood.c_str());
-      else
-        strSQL += PrepareSQL(",%i,%i,%i,NULL, %.1f, %i, %i,'%s', '%s')",
-                      iTimesPlayed, iStartOffset, iEndOffset, rating, userrating, votes, strComment.c_str(), strMood.c_str());
-      m_pDS->exec(strSQL);
+      strSQL = "INSERT INTO song ("
+                 "idSong,idAlbum,idPath,strArtists,strGenres,"
+                 "strTitle,iTrack,iDuration,iYear,strFileName,"
+                 "strMusicBrainzTrackID,iTimesPlayed,iStartOffset,"
+                 "iEndOffset,lastplayed,rating,userrating,votes,comment,mood"
+               ") values (NULL, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+      params = { idAlbum,
+                 idPath,
+                 artistString,
+                 StringUtils::Join(genres, g_advancedSettings.m_musicItemSeparator),
+                 strTitle,
+                 iTrack, iDuration, iYear,
+                 strFileName,
+                 strMusicBrainzTrackID.empty() ? dbiplus::field_value::null_value() : dbiplus::field_value(strMusicBrainzTrackID),
+                 iTimesPlayed, iStartOffset, iEndOffset,
+                 dtLastPlayed.IsValid() ? dbiplus::field_value(dtLastPlayed.GetAsDBDateTime()) : dbiplus::field_value::null_value(),
+                 StringUtils::Format("%.1f", rating), // keep the one decimal rounding of the old literal
+                 userrating, votes,
+                 strComment, strMood };
+      m_pDS->exec_prepared(strSQL, params);
       idSong = (int)m_pDS->lastinsertid();
     }
     else
@@ -4287,9 +4282,20 @@ bool CMusicDatabase::GetSongsFullByWhere(const std::string &baseDir, const Filte
     else
       strSQL = "SELECT songview.* FROM songview " + strSQLExtra;
 
+    // Avoid sorting with limits when have join with songartistview 
+    // Limit when SortByNone already applied in SQL, 
+    // apply sort later to fileitems list rather than dataset
+    sorting = sortDescription;
+    if (artistData && sortDescription.sortBy != SortByNone)
+      sorting.sortBy = SortByNone;
+
+    // Without any sorting of the dataset the rows are stepped through on a
+    // forward-only cursor rather than materializing the whole result set
+    bool forwardOnly = sorting.sortBy == SortByNone;
+
     CLog::Log(LOGDEBUG, "%s query = %s", __FUNCTION__, strSQL.c_str());
     // run query
-    if (!m_pDS->query(strSQL))
+    if (!(forwardOnly ? m_pDS->query_cursor(strSQL) : m_pDS->query(strSQL)))
       return false;
 
     int iRowsFound = m_pDS->num_rows();
@@ -4303,15 +4309,12 @@ bool CMusicDatabase::GetSongsFullByWhere(const std::string &baseDir, const Filte
     items.SetProperty("total", total);
 
     DatabaseResults results;
-    results.reserve(iRowsFound);
-    // Avoid sorting with limits when have join with songartistview 
-    // Limit when SortByNone already applied in SQL, 
-    // apply sort later to fileitems list rather than dataset
-    sorting = sortDescription;
-    if (artistData && sortDescription.sortBy != SortByNone)
-      sorting.sortBy = SortByNone;
-    if (!SortUtils::SortFromDataset(sorting, MediaTypeSong, m_pDS, results))
-      return false;
+    if (!forwardOnly)
+    {
+      results.reserve(iRowsFound);
+      if (!SortUtils::SortFromDataset(sorting, MediaTypeSong, m_pDS, results))
+        return false;
+    }
 
     // Get songs from returned rows. If join songartistview then there is a row for every artist
     items.Reserve(total);
@@ -4320,11 +4323,11 @@ bool CMusicDatabase::GetSongsFullByWhere(const std::string &baseDir, const Filte
     VECARTISTCREDITS artistCredits;
     const dbiplus::query_data &data = m_pDS->get_result_set().records;
     int count = 0;
-    for (const auto &i : results)
+    for (size_t i = 0; forwardOnly ? !m_pDS->eof() : i < results.size(); forwardOnly ? m_pDS->next() : (void)++i)
     {
-      unsigned int targetRow = (unsigned int)i.at(FieldRow).asInteger();
-      const dbiplus::sql_record* const record = data.at(targetRow);
-      
+      const dbiplus::sql_record* const record = forwardOnly ? m_pDS->get_sql_record() :
+        data.at((unsigned int)results[i].at(FieldRow).asInteger());
+
       try
       {
         if (songId != record->at(song_idSong).get_asInt())
@@ -5693,6 +5696,8 @@ bool CMusicDatabase::CommitTransaction()
 {
   if (CDatabase::CommitTransaction())
   { // number of items in the db has likely changed, so reset the infomanager cache
+    if (InBatch())
+      return true;
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MUSIC, GetSongsCount() > 0);
     return true;
   }
@@ -81,6 +81,9 @@ CMusicInfoScanner::CMusicInfoScanner()
   m_itemCount=0;
   m_flags = 0;
   m_bClean = false;
+  m_scanStart = 0;
+  m_lastScanRate = 0;
+  m_filesRead = 0;
 }
 
 CMusicInfoScanner::~CMusicInfoScanner()
@@ -124,6 +127,12 @@ void CMusicInfoScanner::Process()
       // Reset progress vars
       m_currentItem=0;
       m_itemCount=-1;
+      m_filesRead=0;
+      m_scanStart=m_lastScanRate=tick;
+
+      // directories are listed and tags read by workers while this thread adds the songs
+      if (g_advancedSettings.m_musicScannerThreads > 1)
+        m_scanQueue.reset(new CPrefetchQueue<SScannedDirectory>(g_advancedSettings.m_musicScannerThreads));
 
       // Create the thread to count all files to be scanned
       SetPriority( GetMinPriority() );
@@ -185,6 +194,8 @@ void CMusicInfoScanner::Process()
       
       tick = XbmcThreads::SystemClockMillis() - tick;
       CLog::Log(LOGNOTICE, "My Music: Scanning for music info using worker thread, operation took %s", StringUtils::SecondsToTimeString(tick / 1000).c_str());
+      if (tick > 0)
+        CLog::Log(LOGNOTICE, "My Music: Read %i files, %i files per second", m_filesRead, (int)(m_filesRead * 1000LL / tick));
     }
     if (m_scanType == 1) // load album info
     {
@@ -252,6 +263,7 @@ void CMusicInfoScanner::Process()
   {
     CLog::Log(LOGERROR, "MusicInfoScanner: Exception while scanning.");
   }
+  m_scanQueue.reset();
   m_musicDatabase.Close();
   CLog::Log(LOGDEBUG, "%s - Finished scan", __FUNCTION__);
   
@@ -448,6 +460,9 @@ static std::string Prettify(const std::string& strDirectory)
 
 bool CMusicInfoScanner::DoScan(const std::string& strDirectory)
 {
+  if (m_scanQueue)
+    return DoParallelScan(strDirectory);
+
   if (m_handle)
     m_handle->SetText(Prettify(strDirectory));
 
@@ -457,45 +472,169 @@ bool CMusicInfoScanner::DoScan(const std::string& strDirectory)
 
   m_seenPaths.insert(strDirectory);
 
-  // Discard all excluded files defined by m_musicExcludeRegExps
-  const std::vector<std::string> &regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
+  // check whether we need to rescan or not
+  std::string dbHash;
+  bool rescan = (m_flags & SCAN_RESCAN) || !m_musicDatabase.GetPathHash(strDirectory, dbHash);
 
-  if (IsExcluded(strDirectory, regexps))
+  // tags are read by ScanTags() so the progress is updated for every file
+  SScannedDirectory scanned;
+  ScanDirectory(strDirectory, dbHash, rescan, false, scanned);
+  if (scanned.excluded)
     return true;
 
+  AddDirectory(strDirectory, scanned);
+
+  // now scan the subfolders
+  const CFileItemList &items = *scanned.items;
+  for (int i = 0; i < items.Size(); ++i)
+  {
+    CFileItemPtr pItem = items[i];
+
+    if (m_bStop)
+      break;
+    // if we have a directory item (non-playlist) we then recurse into that folder
+    if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList())
+    {
+      std::string strPath=pItem->GetPath();
+      if (!DoScan(strPath))
+      {
+        m_bStop = true;
+      }
+    }
+  }
+
+  return !m_bStop;
+}
+
+bool CMusicInfoScanner::DoParallelScan(const std::string& strDirectory)
+{
+  // directories are queued depth first, but not more than a few per worker so
+  // we don't hold the tags of the whole tree in memory
+  const size_t maxQueued = 4 * g_advancedSettings.m_musicScannerThreads;
+
+  // scraping online may take a long time, keep the database unlocked meanwhile
+  bool batch = !(m_flags & SCAN_ONLINE);
+  if (batch)
+    m_musicDatabase.BeginBatch();
+
+  std::vector<std::string> pending(1, strDirectory);
+  int added = 0;
+  while (!m_bStop)
+  {
+    while (!pending.empty() && m_scanQueue->GetCount() < maxQueued)
+    {
+      std::string path = pending.back();
+      pending.pop_back();
+      if (!m_seenPaths.insert(path).second)
+        continue;
+
+      std::string dbHash;
+      bool rescan = (m_flags & SCAN_RESCAN) || !m_musicDatabase.GetPathHash(path, dbHash);
+      m_scanQueue->Queue(path, std::bind(&CMusicInfoScanner::ScanDirectory, this, path, dbHash, rescan, true, std::placeholders::_1));
+    }
+
+    // don't keep the database locked while waiting for the scans
+    if (batch && !m_scanQueue->IsAnyFinished())
+      m_musicDatabase.CommitBatch();
+
+    std::string path;
+    SScannedDirectory scanned;
+    if (!m_scanQueue->TakeAny(path, scanned))
+      break;
+
+    if (batch && !m_musicDatabase.InBatch())
+      m_musicDatabase.BeginBatch();
+
+    if (m_handle)
+      m_handle->SetText(Prettify(path));
+
+    if (scanned.excluded)
+      continue;
+
+    AddDirectory(path, scanned);
+
+    // push the subfolders backwards so they're queued in order
+    const CFileItemList &items = *scanned.items;
+    for (int i = items.Size() - 1; i >= 0; --i)
+    {
+      CFileItemPtr pItem = items[i];
+      if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList())
+        pending.push_back(pItem->GetPath());
+    }
+
+    if (batch && scanned.changed && ++added % 50 == 0)
+    {
+      m_musicDatabase.CommitBatch();
+      m_musicDatabase.BeginBatch();
+    }
+  }
+
+  if (m_bStop)
+  {
+    m_scanQueue->Cancel();
+    m_scanQueue->Reset();
+  }
+
+  if (batch)
+    m_musicDatabase.CommitBatch();
+
+  return !m_bStop;
+}
+
+void CMusicInfoScanner::ScanDirectory(const std::string& strDirectory, const std::string& dbHash, bool rescan, bool readTags, SScannedDirectory& scanned) const
+{
+  // Discard all excluded files defined by m_musicExcludeRegExps
+  if (IsExcluded(strDirectory, g_advancedSettings.m_audioExcludeFromScanRegExps))
+  {
+    scanned.excluded = true;
+    return;
+  }
+
   // load subfolder
-  CFileItemList items;
+  scanned.items.reset(new CFileItemList);
+  CFileItemList &items = *scanned.items;
   CDirectory::GetDirectory(strDirectory, items, g_advancedSettings.GetMusicExtensions() + "|.jpg|.tbn|.lrc|.cdg");
 
   // sort and get the path hash.  Note that we don't filter .cue sheet items here as we want
   // to detect changes in the .cue sheet as well.  The .cue sheet items only need filtering
   // if we have a changed hash.
   items.Sort(SortByLabel, SortOrderAscending);
-  std::string hash;
-  GetPathHash(items, hash);
+  GetPathHash(items, scanned.hash);
+  scanned.dbHash = dbHash;
+  scanned.changed = rescan || dbHash != scanned.hash;
+  if (!scanned.changed)
+    return;
 
-  // check whether we need to rescan or not
-  std::string dbHash;
-  if ((m_flags & SCAN_RESCAN) || !m_musicDatabase.GetPathHash(strDirectory, dbHash) || dbHash != hash)
+  // filter items in the sub dir (for .cue sheet support)
+  items.FilterCueItems();
+  items.Sort(SortByLabel, SortOrderAscending);
+
+  if (readTags)
+  {
+    ReadTags(items);
+    scanned.tagsRead = true;
+  }
+}
+
+void CMusicInfoScanner::AddDirectory(const std::string& strDirectory, SScannedDirectory& scanned)
+{
+  CFileItemList &items = *scanned.items;
+  if (scanned.changed)
   { // path has changed - rescan
-    if (dbHash.empty())
+    if (scanned.dbHash.empty())
       CLog::Log(LOGDEBUG, "%s Scanning dir '%s' as not in the database", __FUNCTION__, CURL::GetRedacted(strDirectory).c_str());
     else
       CLog::Log(LOGDEBUG, "%s Rescanning dir '%s' due to change", __FUNCTION__, CURL::GetRedacted(strDirectory).c_str());
 
-    // filter items in the sub dir (for .cue sheet support)
-    items.FilterCueItems();
-    items.Sort(SortByLabel, SortOrderAscending);
-
     // and then scan in the new information
-    if (RetrieveMusicInfo(strDirectory, items) > 0)
+    if (RetrieveMusicInfo(strDirectory, items, scanned.tagsRead) > 0)
     {
       if (m_handle)
         OnDirectoryScanned(strDirectory);
     }
 
     // save information about this folder
-    m_musicDatabase.SetPathHash(strDirectory, hash);
+    m_musicDatabase.SetPathHash(strDirectory, scanned.hash);
   }
   else
   { // path is the same - no need to rescan
@@ -510,29 +649,37 @@ bool CMusicInfoScanner::DoScan(const std::string& strDirectory)
       OnDirectoryScanned(strDirectory);
     }
   }
+}
+
+bool CMusicInfoScanner::IsScannable(const CFileItem& item, const std::vector<std::string>& regexps)
+{
+  if (CUtil::ExcludeFileOrFolder(item.GetPath(), regexps))
+    return false;
+
+  return !item.m_bIsFolder && !item.IsPlayList() && !item.IsPicture() && !item.IsLyrics();
+}
+
+void CMusicInfoScanner::ReadTags(CFileItemList& items)
+{
+  const std::vector<std::string> &regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
 
-  // now scan the subfolders
   for (int i = 0; i < items.Size(); ++i)
   {
     CFileItemPtr pItem = items[i];
+    if (!IsScannable(*pItem, regexps))
+      continue;
 
-    if (m_bStop)
-      break;
-    // if we have a directory item (non-playlist) we then recurse into that folder
-    if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList())
+    CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
+    if (!tag.Loaded())
     {
-      std::string strPath=pItem->GetPath();
-      if (!DoScan(strPath))
-      {
-        m_bStop = true;
-      }
+      std::unique_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(*pItem));
+      if (NULL != pLoader.get())
+        pLoader->Load(pItem->GetPath(), tag);
     }
   }
-
-  return !m_bStop;
 }
 
-INFO_RET CMusicInfoScanner::ScanTags(const CFileItemList& items, CFileItemList& scannedItems)
+INFO_RET CMusicInfoScanner::ScanTags(const CFileItemList& items, CFileItemList& scannedItems, bool tagsRead /* = false */)
 {
   std::vector<std::string> regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
 
@@ -543,16 +690,14 @@ INFO_RET CMusicInfoScanner::ScanTags(const CFileItemList& items, CFileItemList&
 
     CFileItemPtr pItem = items[i];
 
-    if (CUtil::ExcludeFileOrFolder(pItem->GetPath(), regexps))
-      continue;
-
-    if (pItem->m_bIsFolder || pItem->IsPlayList() || pItem->IsPicture() || pItem->IsLyrics())
+    if (!IsScannable(*pItem, regexps))
       continue;
 
     m_currentItem++;
+    m_filesRead++;
 
     CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
-    if (!tag.Loaded())
+    if (!tag.Loaded() && !tagsRead)
     {
       std::unique_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(*pItem));
       if (NULL != pLoader.get())
@@ -561,6 +706,7 @@ INFO_RET CMusicInfoScanner::ScanTags(const CFileItemList& items, CFileItemList&
 
     if (m_handle && m_itemCount>0)
       m_handle->SetPercentage(m_currentItem / (float)m_itemCount * 100);
+    UpdateScanRate();
 
     if (!tag.Loaded() && !pItem->HasCueDocument())
     {
@@ -581,6 +727,23 @@ INFO_RET CMusicInfoScanner::ScanTags(const CFileItemList& items, CFileItemList&
   return INFO_ADDED;
 }
 
+void CMusicInfoScanner::UpdateScanRate(bool force /* = false */)
+{
+  if (!m_handle)
+    return;
+
+  unsigned int now = XbmcThreads::SystemClockMillis();
+  if (!force && now - m_lastScanRate < 1000)
+    return;
+  m_lastScanRate = now;
+
+  unsigned int elapsed = now - m_scanStart;
+  if (elapsed >= 1000 && m_filesRead > 0)
+    m_handle->SetTitle(StringUtils::Format(g_localizeStrings.Get(506).c_str(), (int)(m_filesRead * 1000LL / elapsed)));
+  else
+    m_handle->SetTitle(g_localizeStrings.Get(505));
+}
+
 static bool SortSongsByTrack(const CSong& song, const CSong& song2)
 {
   return song.iTrack < song2.iTrack;
@@ -772,7 +935,7 @@ void CMusicInfoScanner::FileItemsToAlbums(CFileItemList& items, VECALBUMS& album
   }
 }
 
-int CMusicInfoScanner::RetrieveMusicInfo(const std::string& strDirectory, CFileItemList& items)
+int CMusicInfoScanner::RetrieveMusicInfo(const std::string& strDirectory, CFileItemList& items, bool tagsRead /* = false */)
 {
   MAPSONGS songsMap;
 
@@ -781,7 +944,7 @@ int CMusicInfoScanner::RetrieveMusicInfo(const std::string& strDirectory, CFileI
     m_needsCleanup = true;
 
   CFileItemList scannedItems;
-  if (ScanTags(items, scannedItems) == INFO_CANCELLED || scannedItems.Size() == 0)
+  if (ScanTags(items, scannedItems, tagsRead) == INFO_CANCELLED || scannedItems.Size() == 0)
     return 0;
 
   VECALBUMS albums;
@@ -886,8 +1049,8 @@ int CMusicInfoScanner::RetrieveMusicInfo(const std::string& strDirectory, CFileI
     numAdded += album->songs.size();
   }
 
-  if (m_handle)
-    m_handle->SetTitle(g_localizeStrings.Get(505));
+  // scraping changes the title
+  UpdateScanRate(true);
 
   return numAdded;
 }
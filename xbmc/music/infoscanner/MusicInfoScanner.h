@@ -18,11 +18,14 @@
  *  <http://www.gnu.org/licenses/>.
  *
  */
+#include <memory>
+
 #include "InfoScanner.h"
 #include "MusicAlbumInfo.h"
 #include "MusicInfoScraper.h"
 #include "music/MusicDatabase.h"
 #include "threads/Thread.h"
+#include "utils/PrefetchQueue.h"
 
 class CAlbum;
 class CArtist;
@@ -169,14 +172,28 @@ public:
 protected:
   virtual void Process() override;
 
+  /*! \brief A directory listed and, if it changed, with its tags read
+   Filled in by ScanDirectory(), possibly on a worker thread.
+   */
+  struct SScannedDirectory
+  {
+    SScannedDirectory() : excluded(false), changed(false), tagsRead(false) {}
+    bool excluded;                         ///< excluded by the settings or a .nomedia file, nothing else is filled in
+    bool changed;                          ///< the hash differs from the database or a rescan was requested
+    bool tagsRead;                         ///< the tags of the items were read already
+    std::string hash;
+    std::string dbHash;
+    std::shared_ptr<CFileItemList> items;
+  };
+
   /*! \brief Scan in the ID3/Ogg/FLAC tags for a bunch of FileItems
    Given a list of FileItems, scan in the tags for those FileItems
    and populate a new FileItemList with the files that were successfully scanned.
    Any files which couldn't be scanned (no/bad tags) are discarded in the process.
    \param items [in] list of FileItems to scan
-   \param scannedItems [in] list to populate with the scannedItems
+   \param tagsRead [in] whether ReadTags() was run on the items already
    */
-  int RetrieveMusicInfo(const std::string& strDirectory, CFileItemList& items);
+  int RetrieveMusicInfo(const std::string& strDirectory, CFileItemList& items, bool tagsRead = false);
 
   /*! \brief Scan in the ID3/Ogg/FLAC tags for a bunch of FileItems
     Given a list of FileItems, scan in the tags for those FileItems
@@ -184,13 +201,47 @@ protected:
    Any files which couldn't be scanned (no/bad tags) are discarded in the process.
    \param items [in] list of FileItems to scan
    \param scannedItems [in] list to populate with the scannedItems
+   \param tagsRead [in] whether ReadTags() was run on the items already, files without tags aren't read again
    */
-  INFO_RET ScanTags(const CFileItemList& items, CFileItemList& scannedItems);
-  int GetPathHash(const CFileItemList &items, std::string &hash);
+  INFO_RET ScanTags(const CFileItemList& items, CFileItemList& scannedItems, bool tagsRead = false);
+  static int GetPathHash(const CFileItemList &items, std::string &hash);
   void GetAlbumArtwork(long id, const CAlbum &artist);
 
+  /*! \brief Read the tags of all songs in a list of FileItems
+   Doesn't touch the database or the scanner state, so it's safe to run on a worker thread.
+   */
+  static void ReadTags(CFileItemList& items);
+
+  /*! \brief Whether the tags of an item should be scanned
+   */
+  static bool IsScannable(const CFileItem& item, const std::vector<std::string>& regexps);
+
+  /*! \brief List a directory and check whether it changed since it was added
+   Doesn't touch the database or the scanner state, so it's safe to run on a worker thread.
+   \param strDirectory [in] the directory to list
+   \param dbHash [in] the hash stored in the database
+   \param rescan [in] scan the directory even if the hash didn't change
+   \param readTags [in] read the tags if the directory changed
+   \param scanned [out] the listing
+   */
+  void ScanDirectory(const std::string& strDirectory, const std::string& dbHash, bool rescan, bool readTags, SScannedDirectory& scanned) const;
+
+  /*! \brief Add the songs of a scanned directory to the database if it changed
+   */
+  void AddDirectory(const std::string& strDirectory, SScannedDirectory& scanned);
+
   bool DoScan(const std::string& strDirectory) override;
 
+  /*! \brief Scan a directory tree with directories listed and tags read by m_scanQueue
+   Songs are added in the order directories finish scanning, in batched transactions.
+   */
+  bool DoParallelScan(const std::string& strDirectory);
+
+  /*! \brief Show the number of files read per second in the progress dialog
+   \param force [in] update even if the last update was less than a second ago
+   */
+  void UpdateScanRate(bool force = false);
+
   virtual void Run() override;
   int CountFiles(const CFileItemList& items, bool recursive);
   int CountFilesRecursively(const std::string& strPath);
@@ -223,5 +274,10 @@ protected:
   std::set<std::string> m_seenPaths;
   int m_flags;
   CThread m_fileCountReader;
+
+  std::unique_ptr<CPrefetchQueue<SScannedDirectory>> m_scanQueue;
+  unsigned int m_scanStart;       ///< time the scan started, for the files read per second
+  unsigned int m_lastScanRate;    ///< time the files read per second were last shown
+  int m_filesRead;
 };
 }
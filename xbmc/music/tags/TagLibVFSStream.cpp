@@ -22,6 +22,8 @@
 #include "filesystem/File.h"
 #include <taglib/tiostream.h>
 
+#include <algorithm>
+
 using namespace XFILE;
 using namespace TagLib;
 using namespace MUSIC_INFO;
@@ -33,10 +35,14 @@ using namespace MUSIC_INFO;
 TagLibVFSStream::TagLibVFSStream(const std::string& strFileName, bool readOnly)
 {
   m_bIsOpen = true;
+  m_mapping.data = NULL;
+  m_mapping.size = 0;
   if (readOnly)
   {
     if (!m_file.Open(strFileName))
       m_bIsOpen = false;
+    else if (m_file.IoControl(IOCTRL_FILE_MAPPING, &m_mapping) != 0)
+      m_mapping.data = NULL;
   }
   else
   {
@@ -68,6 +74,18 @@ FileName TagLibVFSStream::name() const
  */
 ByteVector TagLibVFSStream::readBlock(TagLib::ulong length)
 {
+  if (m_mapping.data)
+  {
+    // build the vector from the mapping, skipping the zero filled buffer and the read
+    const int64_t position = m_file.GetPosition();
+    if (position >= 0 && position < m_mapping.size)
+    {
+      const int64_t available = std::min<int64_t>(length, m_mapping.size - position);
+      if (m_file.Seek(position + available, SEEK_SET) == position + available)
+        return ByteVector(reinterpret_cast<const char*>(m_mapping.data + position), static_cast<TagLib::uint>(available));
+    }
+  }
+
   ByteVector byteVector(static_cast<TagLib::uint>(length));
   ssize_t read = m_file.Read(byteVector.data(), length);
   if (read > 0)
@@ -124,6 +124,7 @@ namespace MUSIC_INFO
   private:
     std::string   m_strFileName;
     XFILE::CFile  m_file;
+    XFILE::SFileMapping m_mapping; /**< set if the file is memory mapped, blocks are copied from it directly */
     bool          m_bIsReadOnly;
     bool          m_bIsOpen;
   };
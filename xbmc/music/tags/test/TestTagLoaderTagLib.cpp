@@ -19,8 +19,18 @@
  */
 
 #include "gtest/gtest.h"
+#include "FileItem.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
 #include "music/tags/TagLoaderTagLib.h"
 #include "music/tags/MusicInfoTag.h"
+#include "utils/PrefetchQueue.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+#include <algorithm>
+#include <iostream>
 #include <taglib/tpropertymap.h>
 #include <taglib/id3v1tag.h>
 #include <taglib/id3v2tag.h>
@@ -227,3 +237,90 @@ TEST(TestTagLoaderTagLib, SplitMBID)
   EXPECT_STREQ(result[0].c_str(), "0383dadf-2a4e-4d10-a46a-e9e041da8eb3");
   EXPECT_STREQ(result[1].c_str(), "53b106e7-0cc6-42cc-ac95-ed8d30a3a98e");
 }
+
+/*
+ Reads the tags of a synthetic local library the way CMusicInfoScanner does:
+ every folder is a job reading all of its tags, the results are taken in the
+ order the folders finish. Reports files per second for 1, 4 and 8 workers.
+ */
+static int ReadLibrary(const std::string &root, int folders, int threads)
+{
+  std::function<void(int&, const std::string&)> readFolder =
+    [](int &loaded, const std::string &path)
+    {
+      CFileItemList items;
+      XFILE::CDirectory::GetDirectory(path, items, ".mp3");
+      CTagLoaderTagLib loader;
+      loaded = 0;
+      for (int i = 0; i < items.Size(); i++)
+      {
+        CMusicInfoTag tag;
+        if (loader.Load(items[i]->GetPath(), tag) && tag.Loaded())
+          loaded++;
+      }
+    };
+
+  int loaded = 0;
+  CPrefetchQueue<int> queue(threads);
+  for (int i = 0; i < folders; i++)
+  {
+    std::string path = URIUtils::AddFileToFolder(root, StringUtils::Format("album%02i/", i));
+    queue.Queue(path, std::bind(readFolder, std::placeholders::_1, path));
+  }
+
+  std::string path;
+  int count;
+  while (queue.TakeAny(path, count))
+    loaded += count;
+  return loaded;
+}
+
+// Times ReadLibrary() over a generated tree of silent mp3s. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestTagLoaderTagLib, DISABLED_ScanBenchmark)
+{
+  const int folders = 20;
+  const int songs = 10;
+
+  // a bit of silence so the file is recognized as MPEG audio
+  std::string frame(417, '\0');
+  frame[0] = '\xff';
+  frame[1] = '\xfb';
+  frame[2] = '\x90';
+  frame[3] = '\x64';
+
+  std::string root = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestTagLoaderTagLib/");
+  for (int i = 0; i < folders; i++)
+  {
+    std::string folder = URIUtils::AddFileToFolder(root, StringUtils::Format("album%02i/", i));
+    ASSERT_TRUE(XFILE::CDirectory::Create(folder));
+    for (int j = 0; j < songs; j++)
+    {
+      ID3v2::Tag id3;
+      id3.setTitle(StringUtils::Format("title %i", j));
+      id3.setArtist("artist");
+      id3.setAlbum(StringUtils::Format("album %i", i));
+      id3.setTrack(j + 1);
+      ByteVector data = id3.render();
+
+      XFILE::CFile file;
+      ASSERT_TRUE(file.OpenForWrite(URIUtils::AddFileToFolder(folder, StringUtils::Format("song%02i.mp3", j)), true));
+      file.Write(data.data(), data.size());
+      for (int k = 0; k < 20; k++)
+        file.Write(frame.c_str(), frame.size());
+      file.Close();
+    }
+  }
+
+  int threads[] = { 1, 4, 8 };
+  for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+  {
+    CStopWatch timer;
+    timer.StartZero();
+    EXPECT_EQ(folders * songs, ReadLibrary(root, folders, threads[i]));
+    float elapsed = timer.GetElapsedSeconds();
+    std::cout << threads[i] << " threads: " << folders * songs / std::max(elapsed, 0.001f) << " files/s" << std::endl;
+  }
+
+  XFILE::CDirectory::RemoveRecursive(root);
+}
@@ -63,6 +63,15 @@
 
 #define HEADER_NEWLINE        "\r\n"
 
+#define STREAM_BLOCK_SIZE     (32 * 1024)
+
+#ifndef MHD_CONTENT_READER_END_OF_STREAM
+#define MHD_CONTENT_READER_END_OF_STREAM -1
+#endif
+#ifndef MHD_CONTENT_READER_END_WITH_ERROR
+#define MHD_CONTENT_READER_END_WITH_ERROR -1
+#endif
+
 typedef struct {
   std::shared_ptr<XFILE::CFile> file;
   CHttpRanges ranges;
@@ -75,6 +84,10 @@ typedef struct {
   uint64_t writePosition;
 } HttpFileDownloadContext;
 
+typedef struct {
+  std::shared_ptr<IHTTPRequestHandler> handler;
+} HttpStreamDownloadContext;
+
 CWebServer::CWebServer()
   : m_port(0),
     m_daemon_ip6(nullptr),
@@ -498,6 +511,10 @@ int CWebServer::HandleRequest(const std::shared_ptr<IHTTPRequestHandler>& handle
       ret = CreateMemoryDownloadResponse(handler, response);
       break;
 
+    case HTTPStreamDownload:
+      ret = CreateStreamDownloadResponse(handler, response);
+      break;
+
     case HTTPError:
       ret = CreateErrorResponse(request.connection, responseDetails.status, request.method, response);
       break;
@@ -882,6 +899,58 @@ int CWebServer::CreateFileDownloadResponse(const std::shared_ptr<IHTTPRequestHan
   return MHD_YES;
 }
 
+int CWebServer::CreateStreamDownloadResponse(const std::shared_ptr<IHTTPRequestHandler>& handler, struct MHD_Response *&response) const
+{
+  const HTTPRequest &request = handler->GetRequest();
+
+  if (request.method == HEAD)
+  {
+    response = create_response(0, nullptr, MHD_NO, MHD_NO);
+    if (response == nullptr)
+    {
+      CLog::Log(LOGERROR, "CWebServer[%hu]: failed to create a HTTP HEAD response for %s", m_port, request.pathUrl.c_str());
+      return MHD_NO;
+    }
+
+    return MHD_YES;
+  }
+
+#if (MHD_VERSION >= 0x00090200)
+  std::unique_ptr<HttpStreamDownloadContext> context(new HttpStreamDownloadContext());
+  context->handler = handler;
+
+  // the length of the content isn't known so it is sent chunked
+  response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, STREAM_BLOCK_SIZE,
+                                                &CWebServer::StreamReaderCallback,
+                                                context.get(),
+                                                &CWebServer::StreamReaderFreeCallback);
+  if (response == nullptr)
+  {
+    CLog::Log(LOGERROR, "CWebServer[%hu]: failed to create a HTTP response for %s to be streamed", m_port, request.pathUrl.c_str());
+    return MHD_NO;
+  }
+
+  context.release(); // ownership was passed to mhd
+
+  return MHD_YES;
+#else
+  // older versions of libmicrohttpd can't send responses of unknown length
+  std::string data;
+  char buffer[STREAM_BLOCK_SIZE];
+  ssize_t read;
+  while ((read = handler->ReadResponseStream(buffer, sizeof(buffer))) > 0)
+    data.append(buffer, read);
+
+  if (read < 0)
+  {
+    CLog::Log(LOGERROR, "CWebServer[%hu]: failed to read the response for %s", m_port, request.pathUrl.c_str());
+    return MHD_NO;
+  }
+
+  return CreateMemoryDownloadResponse(request.connection, data.c_str(), data.size(), false, true, response);
+#endif
+}
+
 int CWebServer::CreateErrorResponse(struct MHD_Connection *connection, int responseType, HTTPMethod method, struct MHD_Response *&response) const
 {
   size_t payloadSize = 0;
@@ -1083,6 +1152,35 @@ void CWebServer::ContentReaderFreeCallback(void *cls)
     CLog::Log(LOGDEBUG, "CWebServer [OUT] done");
 }
 
+#if (MHD_VERSION >= 0x00090200)
+ssize_t CWebServer::StreamReaderCallback(void *cls, uint64_t pos, char *buf, size_t max)
+{
+  HttpStreamDownloadContext *context = (HttpStreamDownloadContext *)cls;
+  if (context == nullptr || context->handler == nullptr)
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+
+  ssize_t res = context->handler->ReadResponseStream(buf, max);
+  if (res < 0)
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  if (res == 0)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+
+  if (g_advancedSettings.CanLogComponent(LOGWEBSERVER))
+    CLog::Log(LOGDEBUG, "CWebServer [OUT] streamed %zd bytes at %" PRIu64, res, pos);
+
+  return res;
+}
+
+void CWebServer::StreamReaderFreeCallback(void *cls)
+{
+  HttpStreamDownloadContext *context = (HttpStreamDownloadContext *)cls;
+  delete context;
+
+  if (g_advancedSettings.CanLogComponent(LOGWEBSERVER))
+    CLog::Log(LOGDEBUG, "CWebServer [OUT] done");
+}
+#endif
+
 // local helper
 static void panicHandlerForMHD(void* unused, const char* file, unsigned int line, const char *reason)
 {
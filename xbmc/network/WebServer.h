@@ -85,6 +85,7 @@ private:
 
   int CreateRedirect(struct MHD_Connection *connection, const std::string &strURL, struct MHD_Response *&response) const;
   int CreateFileDownloadResponse(const std::shared_ptr<IHTTPRequestHandler>& handler, struct MHD_Response *&response) const;
+  int CreateStreamDownloadResponse(const std::shared_ptr<IHTTPRequestHandler>& handler, struct MHD_Response *&response) const;
   int CreateErrorResponse(struct MHD_Connection *connection, int responseType, HTTPMethod method, struct MHD_Response *&response) const;
   int CreateMemoryDownloadResponse(struct MHD_Connection *connection, const void *data, size_t size, bool free, bool copy, struct MHD_Response *&response) const;
 
@@ -106,6 +107,11 @@ private:
 #endif
   static void ContentReaderFreeCallback(void *cls);
 
+#if (MHD_VERSION >= 0x00090200)
+  static ssize_t StreamReaderCallback(void *cls, uint64_t pos, char *buf, size_t max);
+  static void StreamReaderFreeCallback(void *cls);
+#endif
+
 #if (MHD_VERSION >= 0x00040001)
   static int AnswerToConnection (void *cls, struct MHD_Connection *connection,
                         const char *url, const char *method,
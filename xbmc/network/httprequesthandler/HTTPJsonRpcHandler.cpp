@@ -84,10 +84,36 @@ int CHTTPJsonRpcHandler::HandleRequest()
 
   if (isRequest)
   {
-    m_responseData = JSONRPC::CJSONRPC::MethodCall(m_requestData, &m_transportLayer, &client);
-
-    if (!jsonpCallback.empty())
+    if (jsonpCallback.empty())
+    {
+      m_responseStream = JSONRPC::CJSONRPC::MethodCallStream(m_requestData, &m_transportLayer, &client);
+      m_requestData.clear();
+
+      // big results are sent while they are being serialized
+      if (m_responseStream->IsStreamed())
+      {
+        m_response.type = HTTPStreamDownload;
+        m_response.status = MHD_HTTP_OK;
+        m_response.contentType = "application/json";
+
+        return MHD_YES;
+      }
+
+      bool read = m_responseStream->ReadAll(m_responseData);
+      m_responseStream.reset();
+      if (!read)
+      {
+        m_response.type = HTTPError;
+        m_response.status = MHD_HTTP_INTERNAL_SERVER_ERROR;
+
+        return MHD_YES;
+      }
+    }
+    else
+    {
+      m_responseData = JSONRPC::CJSONRPC::MethodCall(m_requestData, &m_transportLayer, &client);
       m_responseData = jsonpCallback + "(" + m_responseData + ");";
+    }
   }
   else if (jsonpCallback.empty())
   {
@@ -122,6 +148,14 @@ int CHTTPJsonRpcHandler::HandleRequest()
   return MHD_YES;
 }
 
+ssize_t CHTTPJsonRpcHandler::ReadResponseStream(char *buffer, size_t size)
+{
+  if (m_responseStream == nullptr)
+    return -1;
+
+  return m_responseStream->Read(buffer, size);
+}
+
 HttpResponseRanges CHTTPJsonRpcHandler::GetResponseData() const
 {
   HttpResponseRanges ranges;
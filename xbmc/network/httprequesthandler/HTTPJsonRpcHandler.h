@@ -19,10 +19,12 @@
  *
  */
 
+#include <memory>
 #include <string>
 
 #include "interfaces/json-rpc/IClient.h"
 #include "interfaces/json-rpc/ITransportLayer.h"
+#include "interfaces/json-rpc/ResponseStream.h"
 #include "network/httprequesthandler/IHTTPRequestHandler.h"
 
 class CHTTPJsonRpcHandler : public IHTTPRequestHandler
@@ -38,6 +40,7 @@ public:
   virtual int HandleRequest();
 
   virtual HttpResponseRanges GetResponseData() const;
+  virtual ssize_t ReadResponseStream(char *buffer, size_t size);
 
   virtual int GetPriority() const { return 5; }
 
@@ -56,6 +59,7 @@ private:
   std::string m_requestData;
   std::string m_responseData;
   CHttpResponseRange m_responseRange;
+  std::unique_ptr<JSONRPC::CResponseStream> m_responseStream;
 
   class CHTTPTransportLayer : public JSONRPC::ITransportLayer
   {
@@ -65,7 +65,10 @@ typedef enum HTTPResponseType
   HTTPMemoryDownloadFreeNoCopy,
   // creates a HTTP response from a buffer by copying followed by freeing the buffer
   // the buffer must have been malloc'ed and not new'ed
-  HTTPMemoryDownloadFreeCopy
+  HTTPMemoryDownloadFreeCopy,
+  // creates a HTTP response of unknown length with the content read from
+  // the request handler while the response is sent
+  HTTPStreamDownload
 } HTTPResponseType;
 
 typedef struct HTTPRequest
@@ -172,6 +175,17 @@ public:
   */
   virtual std::string GetResponseFile() const { return ""; }
 
+  /*!
+   * \brief Reads the next part of the response content.
+   *
+   * \details This is only used if the response type is HTTPStreamDownload.
+   *
+   * \param buffer Buffer to write the content to
+   * \param size Size of the buffer
+   * \return Number of bytes written, 0 at the end of the content or -1 on error.
+   */
+  virtual ssize_t ReadResponseStream(char *buffer, size_t size) { return -1; }
+
   /*!
   * \brief Returns the HTTP request handled by the HTTP request handler.
   */
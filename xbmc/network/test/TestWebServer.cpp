@@ -406,6 +406,60 @@ TEST_F(TestWebServer, CanGetJsonRpcResponse)
   JSONRPC::CJSONRPC::Cleanup();
 }
 
+namespace
+{
+class CTestTransportLayer : public JSONRPC::ITransportLayer
+{
+public:
+  bool PrepareDownload(const char *path, CVariant &details, std::string &protocol) override { return false; }
+  bool Download(const char *path, CVariant &result) override { return false; }
+  int GetCapabilities() override { return JSONRPC::Response; }
+};
+
+class CTestClient : public JSONRPC::IClient
+{
+public:
+  int GetPermissionFlags() override { return JSONRPC::OPERATION_PERMISSION_ALL; }
+  int GetAnnouncementFlags() override { return 0; }
+  bool SetAnnouncementFlags(int flags) override { return false; }
+};
+}
+
+TEST_F(TestWebServer, CanGetStreamedJsonRpcResponse)
+{
+  JSONRPC::CJSONRPC::Initialize();
+
+  std::string directory = StringUtils::Format("{ \"jsonrpc\": \"2.0\", \"method\": \"Files.GetDirectory\", "
+    "\"params\": { \"directory\": %s, \"media\": \"files\", \"properties\": [ \"size\", \"file\" ] }, \"id\": 1 }",
+    StringUtils::Paramify(sourcePath).c_str());
+  std::string batch = "[ " + directory + ", "
+    "{ \"jsonrpc\": \"2.0\", \"method\": \"JSONRPC.Version\", \"id\": 2 }, "
+    "{ \"jsonrpc\": \"2.0\", \"method\": \"Files.GetDirectory\", \"params\": { \"directory\": " +
+    StringUtils::Paramify(URIUtils::AddFileToFolder(sourcePath, "missing/")) + " }, \"id\": 3 } ]";
+
+  CTestTransportLayer transport;
+  CTestClient client;
+  std::string requests[] = { directory, batch };
+  for (size_t i = 0; i < sizeof(requests) / sizeof(requests[0]); i++)
+  {
+    // the listing is streamed over HTTP but must look the same as a response built at once
+    std::string result;
+    CCurlFile curl;
+    curl.SetMimeType("application/json");
+    ASSERT_TRUE(curl.Post(GetUrl(TEST_URL_JSONRPC), requests[i], result));
+    EXPECT_EQ(JSONRPC::CJSONRPC::MethodCall(requests[i], &transport, &client), result);
+    EXPECT_STREQ("application/json", curl.GetHttpHeader().GetMimeType().c_str());
+
+    CVariant resultObj;
+    ASSERT_TRUE(CJSONVariantParser::Parse(result, resultObj));
+    const CVariant &response = resultObj.isArray() ? resultObj[0] : resultObj;
+    ASSERT_TRUE(response["result"]["files"].isArray());
+    EXPECT_EQ(3u, response["result"]["files"].size());
+  }
+
+  JSONRPC::CJSONRPC::Cleanup();
+}
+
 TEST_F(TestWebServer, CanNotHeadNonExistingFile)
 {
   CCurlFile curl;
@@ -361,6 +361,7 @@ void CProfilesManager::CreateProfileFolders()
 
   CDirectory::Create("special://profile/addon_data");
   CDirectory::Create("special://profile/keymaps");
+  CDirectory::Create("special://profile/directoryindex");
 }
 
 const CProfile& CProfilesManager::GetMasterProfile() const
@@ -258,6 +258,7 @@ void CAdvancedSettings::Initialize()
 
   m_playlistAsFolders = true;
   m_detectAsUdf = false;
+  m_useDirectoryIndex = true;
 
   m_fanartRes = 1080;
   m_imageRes = 720;
@@ -281,6 +282,7 @@ void CAdvancedSettings::Initialize()
   m_strMusicLibraryAlbumFormat = "";
   m_prioritiseAPEv2tags = false;
   m_musicItemSeparator = " / ";
+  m_musicScannerThreads = 4;
   m_musicArtistSeparators = { ";", " feat. ", " ft. " };
   m_videoItemSeparator = " / ";
   m_iMusicLibraryDateAdded = 1; // prefer mtime over ctime and current time
@@ -293,6 +295,8 @@ void CAdvancedSettings::Initialize()
   m_bVideoLibraryImportWatchedState = false;
   m_bVideoLibraryImportResumePoint = false;
   m_bVideoScannerIgnoreErrors = false;
+  m_videoScannerThreads = 4;
+  m_sortParallelThreshold = 5000;
   m_iVideoLibraryDateAdded = 1; // prefer mtime over ctime and current time
 
   m_iEpgLingerTime = 60 * 24;           /* keep 24 hours by default */
@@ -362,6 +366,11 @@ void CAdvancedSettings::Initialize()
   // the following setting determines the readRate of a player data
   // as multiply of the default data read rate
   m_cacheReadFactor = 4.0f;
+  // keep several ranges of seekable files and read ahead with additional connections
+  m_cacheSegmented = true;
+  m_cachePrefetchThreads = 2;
+  // local files at least this big are memory mapped for reading, 0 disables it
+  m_mmapMinSize = 1024 * 1024;
 
   m_addonPackageFolderSize = 200;
 
@@ -400,6 +409,7 @@ void CAdvancedSettings::Initialize()
   m_useDisplayControlHWStereo = false;
 
   m_videoAssFixedWorks = false;
+  m_videoDemuxZeroCopy = true;
 
   m_logLevelHint = m_logLevel = LOG_LEVEL_DEBUG;
   m_extraLogEnabled = false;
@@ -540,6 +550,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
   if (pElement)
   {
     XMLUtils::GetBoolean(pElement, "assfixedworks", m_videoAssFixedWorks);
+    XMLUtils::GetBoolean(pElement, "demuxzerocopy", m_videoDemuxZeroCopy);
     XMLUtils::GetString(pElement, "stereoscopicregex3d", m_stereoscopicregex_3d);
     XMLUtils::GetString(pElement, "stereoscopicregexsbs", m_stereoscopicregex_sbs);
     XMLUtils::GetString(pElement, "stereoscopicregextab", m_stereoscopicregex_tab);
@@ -738,6 +749,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
     XMLUtils::GetString(pElement, "albumformat", m_strMusicLibraryAlbumFormat);
     XMLUtils::GetString(pElement, "itemseparator", m_musicItemSeparator);
     XMLUtils::GetInt(pElement, "dateadded", m_iMusicLibraryDateAdded);
+    XMLUtils::GetInt(pElement, "scannerthreads", m_musicScannerThreads, 1, 16);
     //Music artist name separators
     TiXmlElement* separators = pElement->FirstChildElement("artistseparators");
     if (separators)
@@ -771,6 +783,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
   if (pElement)
   {
     XMLUtils::GetBoolean(pElement, "ignoreerrors", m_bVideoScannerIgnoreErrors);
+    XMLUtils::GetInt(pElement, "threads", m_videoScannerThreads, 1, 16);
   }
 
   // Backward-compatibility of ExternalPlayer config
@@ -802,6 +815,9 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
     XMLUtils::GetUInt(pElement, "memorysize", m_cacheMemSize);
     XMLUtils::GetUInt(pElement, "buffermode", m_cacheBufferMode, 0, 4);
     XMLUtils::GetFloat(pElement, "readfactor", m_cacheReadFactor);
+    XMLUtils::GetBoolean(pElement, "segmented", m_cacheSegmented);
+    XMLUtils::GetUInt(pElement, "prefetchthreads", m_cachePrefetchThreads, 0, 8);
+    XMLUtils::GetUInt(pElement, "mmapminsize", m_mmapMinSize);
   }
 
   pElement = pRootElement->FirstChildElement("jsonrpc");
@@ -937,6 +953,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
 
   m_vecTokens.clear();
   CLangInfo::LoadTokens(pRootElement->FirstChild("sorttokens"),m_vecTokens);
+  XMLUtils::GetUInt(pRootElement, "sortparallelthreshold", m_sortParallelThreshold);
 
   //! @todo Should cache path be given in terms of our predefined paths??
   //! Are we even going to have predefined paths??
@@ -1021,6 +1038,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
     m_imageScalingAlgorithm = CPictureScalingAlgorithm::FromString(tmp);
   XMLUtils::GetBoolean(pRootElement, "playlistasfolders", m_playlistAsFolders);
   XMLUtils::GetBoolean(pRootElement, "detectasudf", m_detectAsUdf);
+  XMLUtils::GetBoolean(pRootElement, "directoryindex", m_useDirectoryIndex);
 
   // music thumbs
   TiXmlElement* pThumbs = pRootElement->FirstChildElement("musicthumbs");
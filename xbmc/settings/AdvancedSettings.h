@@ -236,6 +236,7 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
 
     bool m_playlistAsFolders;
     bool m_detectAsUdf;
+    bool m_useDirectoryIndex;
 
     unsigned int m_fanartRes; ///< \brief the maximal resolution to cache fanart at (assumes 16x9)
     unsigned int m_imageRes;  ///< \brief the maximal resolution to cache images at (assumes 16x9)
@@ -260,6 +261,7 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     std::string m_strMusicLibraryAlbumFormat;
     bool m_prioritiseAPEv2tags;
     std::string m_musicItemSeparator;
+    int m_musicScannerThreads;        ///< directories listed and tags read at once, 1 scans sequentially
     std::vector<std::string> m_musicArtistSeparators;
     std::string m_videoItemSeparator;
     std::vector<std::string> m_musicTagsFromFileFilters;
@@ -273,9 +275,11 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     bool m_bVideoLibraryImportResumePoint;
 
     bool m_bVideoScannerIgnoreErrors;
+    int m_videoScannerThreads;        ///< directories listed and items looked up at once, 1 scans sequentially
     int m_iVideoLibraryDateAdded;
 
     std::set<std::string> m_vecTokens;
+    unsigned int m_sortParallelThreshold; ///< items from which on lists are sorted on several threads, 0 never does
 
     int m_iEpgLingerTime;           // minutes
     int m_iEpgUpdateCheckInterval;  // seconds
@@ -346,6 +350,9 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     unsigned int m_cacheMemSize;
     unsigned int m_cacheBufferMode;
     float m_cacheReadFactor;
+    bool m_cacheSegmented;
+    unsigned int m_cachePrefetchThreads;
+    unsigned int m_mmapMinSize;
 
     bool m_jsonOutputCompact;
     unsigned int m_jsonTcpPort;
@@ -384,6 +391,9 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     False to show at the bottom of video (default) */
     bool m_videoAssFixedWorks;
 
+    /*!< @brief whether demuxed packets may reference the buffers of ffmpeg instead of copying them */
+    bool m_videoDemuxZeroCopy;
+
     std::string m_userAgent;
 
   private:
@@ -37,6 +37,7 @@
 #include "interfaces/AnnouncementManager.h"
 #include "addons/BinaryAddonCache.h"
 #include "interfaces/python/XBPython.h"
+#include "utils/JobManager.h"
 #include "pvr/PVRManager.h"
 
 #if defined(TARGET_WINDOWS) || defined(TARGET_WIN10)
@@ -130,6 +131,8 @@ void TestBasicEnvironment::SetUp()
 
 void TestBasicEnvironment::TearDown()
 {
+  // the pooled workers keep running until they're told to stop
+  CJobManager::GetInstance().CancelJobs();
   g_application.m_ServiceManager->DestroyAudioEngine();
   std::string xbmcTempPath = CSpecialProtocol::TranslatePath("special://temp/");
   XFILE::CDirectory::Remove(xbmcTempPath);
@@ -24,23 +24,14 @@ using namespace Actor;
 
 void Message::Release()
 {
-  bool skip;
-  origin->Lock();
-  skip = isSync ? !isSyncFini : false;
-  isSyncFini = true;
-  origin->Unlock();
-
-  if (skip)
+  // the sender and the receiver of a sync message both release it, the last one returns it
+  if (isSync && !isSyncFini.exchange(true))
     return;
 
   // free data buffer
   if (data != buffer)
     delete [] data;
 
-  // delete event in case of sync message
-  if (event)
-    delete event;
-
   origin->ReturnMessage(this);
 }
 
@@ -54,14 +45,11 @@ bool Message::Reply(int sig, void *data /* = NULL*/, int size /* = 0 */)
       return origin->SendOutMessage(sig, data, size);
   }
 
-  origin->Lock();
-
-  if (!isSyncTimeout)
+  if (!replyMessage.load())
   {
     Message *msg = origin->GetMessage();
     msg->signal = sig;
     msg->isOut = !isOut;
-    replyMessage = msg;
     if (data)
     {
       if (size > MSG_INTERNAL_BUFFER_SIZE)
@@ -69,10 +57,14 @@ bool Message::Reply(int sig, void *data /* = NULL*/, int size /* = 0 */)
       else
         msg->data = msg->buffer;
       memcpy(msg->data, data, size);
+      msg->payloadSize = size;
     }
-  }
 
-  origin->Unlock();
+    // the sender may have timed out meanwhile
+    Message *expected = NULL;
+    if (!replyMessage.compare_exchange_strong(expected, msg))
+      msg->Release();
+  }
 
   if (event)
     event->Set();
@@ -80,49 +72,191 @@ bool Message::Reply(int sig, void *data /* = NULL*/, int size /* = 0 */)
   return true;
 }
 
-Protocol::~Protocol()
+MessageQueue::MessageQueue()
+  : m_head(&m_stub), m_tail(&m_stub), m_count(0), m_keptFirst(NULL), m_keptLast(NULL)
 {
-  Message *msg;
-  Purge();
-  while (!freeMessageQueue.empty())
+}
+
+void MessageQueue::Push(Message *msg)
+{
+  // a receiver can't see the message until the previous one links it
+  msg->next.store(NULL, std::memory_order_relaxed);
+  Message *prev = m_head.exchange(msg, std::memory_order_acq_rel);
+  prev->next.store(msg, std::memory_order_release);
+  if (msg != &m_stub)
+    m_count++;
+}
+
+Message *MessageQueue::PopReceived()
+{
+  Message *tail = m_tail;
+  Message *next = tail->next.load(std::memory_order_acquire);
+  if (tail == &m_stub)
   {
-    msg = freeMessageQueue.front();
-    freeMessageQueue.pop();
-    delete msg;
+    if (!next)
+      return NULL;
+    m_tail = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+
+  if (next)
+  {
+    m_tail = next;
+    return tail;
   }
+
+  // a sender swapped the head, but didn't link its message yet
+  if (tail != m_head.load(std::memory_order_acquire))
+    return NULL;
+
+  // the last message can only be taken with another one behind it
+  Push(&m_stub);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next)
+  {
+    m_tail = next;
+    return tail;
+  }
+  return NULL;
 }
 
-Message *Protocol::GetMessage()
+bool MessageQueue::Pop(Message **msg)
 {
-  Message *msg;
+  if (m_count.load(std::memory_order_acquire) <= 0)
+    return false;
 
-  CSingleLock lock(criticalSection);
+  CSingleLock lock(m_receiveSection);
 
-  if (!freeMessageQueue.empty())
+  Message *first = m_keptFirst;
+  if (first)
   {
-    msg = freeMessageQueue.front();
-    freeMessageQueue.pop();
+    m_keptFirst = first->next.load(std::memory_order_relaxed);
+    if (!m_keptFirst)
+      m_keptLast = NULL;
   }
   else
-    msg = new Message();
+    first = PopReceived();
+
+  if (!first)
+    return false;
+
+  m_count--;
+  *msg = first;
+  return true;
+}
+
+void MessageQueue::Purge(int signal)
+{
+  CSingleLock lock(m_receiveSection);
+
+  Message *msg;
+  while ((msg = PopReceived()))
+  {
+    msg->next.store(NULL, std::memory_order_relaxed);
+    if (m_keptLast)
+      m_keptLast->next.store(msg, std::memory_order_relaxed);
+    else
+      m_keptFirst = msg;
+    m_keptLast = msg;
+  }
+
+  Message *kept = m_keptFirst;
+  m_keptFirst = m_keptLast = NULL;
+  while (kept)
+  {
+    msg = kept;
+    kept = msg->next.load(std::memory_order_relaxed);
+    if (msg->signal == signal)
+    {
+      m_count--;
+      msg->Release();
+      continue;
+    }
+
+    msg->next.store(NULL, std::memory_order_relaxed);
+    if (m_keptLast)
+      m_keptLast->next.store(msg, std::memory_order_relaxed);
+    else
+      m_keptFirst = msg;
+    m_keptLast = msg;
+  }
+}
 
+Protocol::~Protocol()
+{
+  Purge();
+  for (int i = 0; i < slabCount; i++)
+    delete [] slabs[i];
+}
+
+Message *Protocol::GetMessage()
+{
+  Message *msg = NULL;
+
+  uint64_t head = freeMessages.load(std::memory_order_acquire);
+  while ((uint32_t)head)
+  {
+    // a message taken meanwhile bumps the tag, so its stale link won't be used
+    uint32_t index = (uint32_t)head - 1;
+    Message *first = &slabs[index / MSG_SLAB_SIZE][index % MSG_SLAB_SIZE];
+    uint64_t next = ((head >> 32) + 1) << 32 | first->nextFree.load(std::memory_order_relaxed);
+    if (freeMessages.compare_exchange_weak(head, next, std::memory_order_acquire))
+    {
+      msg = first;
+      break;
+    }
+  }
+
+  if (!msg)
+    msg = AllocateMessage();
+
+  // nobody else sees the message until it's sent
   msg->isSync = false;
-  msg->isSyncFini = false;
-  msg->isSyncTimeout = false;
-  msg->event = NULL;
+  msg->isSyncFini.store(false, std::memory_order_relaxed);
   msg->data = NULL;
   msg->payloadSize = 0;
-  msg->replyMessage = NULL;
+  msg->replyMessage.store(NULL, std::memory_order_relaxed);
   msg->origin = this;
 
   return msg;
 }
 
+Message *Protocol::AllocateMessage()
+{
+  CSingleLock lock(slabSection);
+
+  // past the slabs messages are allocated one by one, and deleted when returned
+  if (slabCount == MSG_MAX_SLABS)
+    return new Message();
+
+  Message *slab = new Message[MSG_SLAB_SIZE];
+  for (int i = 0; i < MSG_SLAB_SIZE; i++)
+    slab[i].slabIndex = slabCount * MSG_SLAB_SIZE + i + 1;
+  slabs[slabCount++] = slab;
+
+  // keep the first for the caller
+  for (int i = 1; i < MSG_SLAB_SIZE; i++)
+    ReturnMessage(&slab[i]);
+
+  return &slab[0];
+}
+
 void Protocol::ReturnMessage(Message *msg)
 {
-  CSingleLock lock(criticalSection);
+  if (!msg->slabIndex)
+  {
+    delete msg;
+    return;
+  }
 
-  freeMessageQueue.push(msg);
+  uint64_t head = freeMessages.load(std::memory_order_relaxed);
+  uint64_t next;
+  do
+  {
+    msg->nextFree.store((uint32_t)head, std::memory_order_relaxed);
+    next = ((head >> 32) + 1) << 32 | msg->slabIndex;
+  } while (!freeMessages.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
 }
 
 bool Protocol::SendOutMessage(int signal, void *data /* = NULL */, int size /* = 0 */, Message *outMsg /* = NULL */)
@@ -143,11 +277,10 @@ bool Protocol::SendOutMessage(int signal, void *data /* = NULL */, int size /* =
     else
       msg->data = msg->buffer;
     memcpy(msg->data, data, size);
+    msg->payloadSize = size;
   }
 
-  { CSingleLock lock(criticalSection);
-    outMessages.push(msg);
-  }
+  outMessages.Push(msg);
   containerOutEvent->Set();
 
   return true;
@@ -171,11 +304,10 @@ bool Protocol::SendInMessage(int signal, void *data /* = NULL */, int size /* =
     else
       msg->data = msg->buffer;
     memcpy(msg->data, data, size);
+    msg->payloadSize = size;
   }
 
-  { CSingleLock lock(criticalSection);
-    inMessages.push(msg);
-  }
+  inMessages.Push(msg);
   containerInEvent->Set();
 
   return true;
@@ -187,21 +319,16 @@ bool Protocol::SendOutMessageSync(int signal, Message **retMsg, int timeout, voi
   Message *msg = GetMessage();
   msg->isOut = true;
   msg->isSync = true;
-  msg->event = new CEvent;
+  // kept with the message for the next sync one
+  if (!msg->event)
+    msg->event = new CEvent;
   msg->event->Reset();
   SendOutMessage(signal, data, size, msg);
 
   if (!msg->event->WaitMSec(timeout))
   {
-    msg->origin->Lock();
-    if (msg->replyMessage)
-      *retMsg = msg->replyMessage;
-    else
-    {
-      *retMsg = NULL;
-      msg->isSyncTimeout = true;
-    }
-    msg->origin->Unlock();
+    // the receiver drops its reply if it sees the message replying to itself
+    *retMsg = msg->replyMessage.exchange(msg);
   }
   else
     *retMsg = msg->replyMessage;
@@ -216,28 +343,18 @@ bool Protocol::SendOutMessageSync(int signal, Message **retMsg, int timeout, voi
 
 bool Protocol::ReceiveOutMessage(Message **msg)
 {
-  CSingleLock lock(criticalSection);
-
-  if (outMessages.empty() || outDefered)
+  if (outDefered)
     return false;
 
-  *msg = outMessages.front();
-  outMessages.pop();
-
-  return true;
+  return outMessages.Pop(msg);
 }
 
 bool Protocol::ReceiveInMessage(Message **msg)
 {
-  CSingleLock lock(criticalSection);
-
-  if (inMessages.empty() || inDefered)
+  if (inDefered)
     return false;
 
-  *msg = inMessages.front();
-  inMessages.pop();
-
-  return true;
+  return inMessages.Pop(msg);
 }
 
 
@@ -254,44 +371,10 @@ void Protocol::Purge()
 
 void Protocol::PurgeIn(int signal)
 {
-  Message *msg;
-  std::queue<Message*> msgs;
-
-  CSingleLock lock(criticalSection);
-
-  while (!inMessages.empty())
-  {
-    msg = inMessages.front();
-    inMessages.pop();
-    if (msg->signal != signal)
-      msgs.push(msg);
-  }
-  while (!msgs.empty())
-  {
-    msg = msgs.front();
-    msgs.pop();
-    inMessages.push(msg);
-  }
+  inMessages.Purge(signal);
 }
 
 void Protocol::PurgeOut(int signal)
 {
-  Message *msg;
-  std::queue<Message*> msgs;
-
-  CSingleLock lock(criticalSection);
-
-  while (!outMessages.empty())
-  {
-    msg = outMessages.front();
-    outMessages.pop();
-    if (msg->signal != signal)
-      msgs.push(msg);
-  }
-  while (!msgs.empty())
-  {
-    msg = msgs.front();
-    msgs.pop();
-    outMessages.push(msg);
-  }
+  outMessages.Purge(signal);
 }
@@ -21,29 +21,36 @@
 #pragma once
 
 #include "threads/Thread.h"
+#include <atomic>
 #include <queue>
 #include "memory.h"
 
-#define MSG_INTERNAL_BUFFER_SIZE 32
+// payloads up to this size are stored in the message itself
+#define MSG_INTERNAL_BUFFER_SIZE 64
+// messages are allocated in slabs of this many, up to MSG_MAX_SLABS of them
+#define MSG_SLAB_SIZE 32
+#define MSG_MAX_SLABS 64
 
 namespace Actor
 {
 
 class Protocol;
+class MessageQueue;
 
 class Message
 {
   friend class Protocol;
+  friend class MessageQueue;
 public:
   int signal;
   bool isSync;
-  bool isSyncFini;
+  std::atomic<bool> isSyncFini;
   bool isOut;
-  bool isSyncTimeout;
   int payloadSize;
   uint8_t buffer[MSG_INTERNAL_BUFFER_SIZE];
   uint8_t *data;
-  Message *replyMessage;
+  // set to the message itself once a sync message timed out
+  std::atomic<Message*> replyMessage;
   Protocol *origin;
   CEvent *event;
 
@@ -51,14 +58,45 @@ public:
   bool Reply(int sig, void *data = NULL, int size = 0);
 
 private:
-  Message() {isSync = false; data = NULL; event = NULL; replyMessage = NULL;};
+  Message() : isSync(false), isSyncFini(false), data(NULL), replyMessage(NULL), event(NULL), next(NULL), nextFree(0), slabIndex(0) {};
+  ~Message() { delete event; };
+  std::atomic<Message*> next;
+  std::atomic<uint32_t> nextFree;
+  uint32_t slabIndex;
+};
+
+/*!
+ \brief Queue of messages many threads send to and one thread receives from
+
+ Sending never blocks or locks. Receiving takes a lock only if there is a
+ message to receive, as Purge() of the protocol may receive from a different
+ thread than its owner.
+ */
+class MessageQueue
+{
+public:
+  MessageQueue();
+  void Push(Message *msg);
+  bool Pop(Message **msg);
+  void Purge(int signal);
+
+private:
+  Message *PopReceived();
+
+  std::atomic<Message*> m_head;
+  Message *m_tail;
+  Message m_stub;
+  std::atomic<int> m_count;
+  // messages received by Purge(), ahead of those still in the queue
+  Message *m_keptFirst, *m_keptLast;
+  CCriticalSection m_receiveSection;
 };
 
 class Protocol
 {
 public:
   Protocol(std::string name, CEvent* inEvent, CEvent *outEvent)
-    : portName(name), inDefered(false), outDefered(false) {containerInEvent = inEvent; containerOutEvent = outEvent;};
+    : portName(name), inDefered(false), outDefered(false), freeMessages(0), slabCount(0) {containerInEvent = inEvent; containerOutEvent = outEvent;};
   virtual ~Protocol();
   Message *GetMessage();
   void ReturnMessage(Message *msg);
@@ -72,17 +110,19 @@ public:
   void PurgeOut(int signal);
   void DeferIn(bool value) {inDefered = value;};
   void DeferOut(bool value) {outDefered = value;};
-  void Lock() {criticalSection.lock();};
-  void Unlock() {criticalSection.unlock();};
   std::string portName;
 
 protected:
+  Message *AllocateMessage();
   CEvent *containerInEvent, *containerOutEvent;
-  CCriticalSection criticalSection;
-  std::queue<Message*> outMessages;
-  std::queue<Message*> inMessages;
-  std::queue<Message*> freeMessageQueue;
-  bool inDefered, outDefered;
+  MessageQueue outMessages;
+  MessageQueue inMessages;
+  std::atomic<bool> inDefered, outDefered;
+  // free slab messages as a stack of their slab index + 1, tagged against ABA in the upper half
+  std::atomic<uint64_t> freeMessages;
+  Message *slabs[MSG_MAX_SLABS];
+  int slabCount;
+  CCriticalSection slabSection;
 };
 
 }
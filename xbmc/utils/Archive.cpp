@@ -28,6 +28,7 @@
 
 #include "filesystem/File.h"
 #include "IArchivable.h"
+#include "utils/BinaryVariant.h"
 #include "utils/Variant.h"
 #include "utils/log.h"
 
@@ -42,6 +43,9 @@ using namespace XFILE;
 //not very bad, just tiny bad
 #define MAX_STRING_SIZE 100*1024*1024
 
+// Written in place of the variant type for variants encoded with CBinaryVariant
+#define ARCHIVE_VARIANT_BINARY -1
+
 CArchive::CArchive(CFile* pFile, int mode)
 {
   m_pFile = pFile;
@@ -178,45 +182,11 @@ CArchive& CArchive::operator<<(IArchivable& obj)
 
 CArchive& CArchive::operator<<(const CVariant& variant)
 {
-  *this << static_cast<int>(variant.type());
-  switch (variant.type())
-  {
-  case CVariant::VariantTypeInteger:
-    *this << variant.asInteger();
-    break;
-  case CVariant::VariantTypeUnsignedInteger:
-    *this << variant.asUnsignedInteger();
-    break;
-  case CVariant::VariantTypeBoolean:
-    *this << variant.asBoolean();
-    break;
-  case CVariant::VariantTypeString:
-    *this << variant.asString();
-    break;
-  case CVariant::VariantTypeWideString:
-    *this << variant.asWideString();
-    break;
-  case CVariant::VariantTypeDouble:
-    *this << variant.asDouble();
-    break;
-  case CVariant::VariantTypeArray:
-    *this << variant.size();
-    for (auto i = variant.begin_array(); i != variant.end_array(); ++i)
-      *this << *i;
-    break;
-  case CVariant::VariantTypeObject:
-    *this << variant.size();
-    for (auto itr = variant.begin_map(); itr != variant.end_map(); ++itr)
-    {
-      *this << itr->first;
-      *this << itr->second;
-    }
-    break;
-  case CVariant::VariantTypeNull:
-  case CVariant::VariantTypeConstNull:
-  default:
-    break;
-  }
+  std::string binary;
+  CBinaryVariant::Write(variant, binary);
+
+  *this << ARCHIVE_VARIANT_BINARY;
+  *this << binary;
 
   return *this;
 }
@@ -293,6 +263,17 @@ CArchive& CArchive::operator>>(CVariant& variant)
 {
   int type;
   *this >> type;
+
+  if (type == ARCHIVE_VARIANT_BINARY)
+  {
+    std::string binary;
+    *this >> binary;
+    if (!CBinaryVariant::Parse(binary, variant))
+      CLog::Log(LOGERROR, "%s - invalid variant in archive", __FUNCTION__);
+    return *this;
+  }
+
+  // Archives written before variants were stored with CBinaryVariant
   variant = CVariant(static_cast<CVariant::VariantType>(type));
 
   switch (variant.type())
@@ -20,6 +20,8 @@
 
 #include "Base64.h"
 
+#include <vector>
+
 #define PADDING '='
 
 const std::string Base64::m_characters = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -99,12 +101,21 @@ void Base64::Decode(const char* input, unsigned int length, std::string &output)
 
   output.reserve(length - ((length + 2) / 4));
 
+  // Reverse lookup of m_characters, invalid characters decode like find() did
+  static const std::vector<unsigned char> values = []()
+  {
+    std::vector<unsigned char> table(256, 0x3F);
+    for (size_t i = 0; i < m_characters.size(); i++)
+      table[(unsigned char)m_characters[i]] = (unsigned char)i;
+    return table;
+  }();
+
   for (unsigned int i = 0; i < length; i += 4)
   {
-    l = ((((unsigned long) m_characters.find(input[i])) & 0x3F) << 18);
-    l |= (((i + 1) < length) ? ((((unsigned long) m_characters.find(input[i + 1])) & 0x3F) << 12) : 0);
-    l |= (((i + 2) < length) ? ((((unsigned long) m_characters.find(input[i + 2])) & 0x3F) <<  6) : 0);
-    l |= (((i + 3) < length) ? ((((unsigned long) m_characters.find(input[i + 3])) & 0x3F) <<  0) : 0);
+    l = (((unsigned long) values[(unsigned char)input[i]]) << 18);
+    l |= (((i + 1) < length) ? (((unsigned long) values[(unsigned char)input[i + 1]]) << 12) : 0);
+    l |= (((i + 2) < length) ? (((unsigned long) values[(unsigned char)input[i + 2]]) <<  6) : 0);
+    l |= (((i + 3) < length) ? (((unsigned long) values[(unsigned char)input[i + 3]]) <<  0) : 0);
 
     output.push_back((char)((l >> 16) & 0xFF));
     if (i + 2 < length)
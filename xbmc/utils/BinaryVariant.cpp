@@ -0,0 +1,370 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BinaryVariant.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils/Base64.h"
+#include "utils/Variant.h"
+
+// First byte of the encoding. JSON never starts with a byte >= 0x80
+#define BINARY_VARIANT_VERSION 0xB1
+
+// Nesting limit, so corrupt data can't exhaust the stack
+#define BINARY_VARIANT_MAX_DEPTH 128
+
+enum BinaryVariantTag
+{
+  TAG_NULL = 0,
+  TAG_FALSE,
+  TAG_TRUE,
+  TAG_INTEGER,    // zigzag varint
+  TAG_UNSIGNED,   // varint
+  TAG_DOUBLE,     // 8 bytes, little endian
+  TAG_STRING,     // varint length, bytes
+  TAG_WIDESTRING, // varint length, one varint per character
+  TAG_ARRAY,      // varint count, values
+  TAG_OBJECT,     // varint count, (key, value) pairs
+};
+
+namespace
+{
+
+class CWriter
+{
+public:
+  CWriter(std::string &output) : m_output(output) { }
+
+  void WriteVarint(uint64_t value)
+  {
+    while (value >= 0x80)
+    {
+      m_output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    m_output.push_back(static_cast<char>(value));
+  }
+
+  void WriteKey(const std::string &key)
+  {
+    // Known keys are written as (index << 1), new keys as (length << 1 | 1)
+    std::unordered_map<std::string, unsigned int>::const_iterator it = m_keys.find(key);
+    if (it != m_keys.end())
+    {
+      WriteVarint(static_cast<uint64_t>(it->second) << 1);
+      return;
+    }
+
+    unsigned int index = m_keys.size();
+    m_keys.insert(std::make_pair(key, index));
+    WriteVarint((static_cast<uint64_t>(key.size()) << 1) | 1);
+    m_output.append(key);
+  }
+
+  void WriteValue(const CVariant &value)
+  {
+    switch (value.type())
+    {
+    case CVariant::VariantTypeInteger:
+    {
+      int64_t integer = value.asInteger();
+      m_output.push_back(TAG_INTEGER);
+      WriteVarint((static_cast<uint64_t>(integer) << 1) ^ static_cast<uint64_t>(integer >> 63));
+      break;
+    }
+    case CVariant::VariantTypeUnsignedInteger:
+      m_output.push_back(TAG_UNSIGNED);
+      WriteVarint(value.asUnsignedInteger());
+      break;
+    case CVariant::VariantTypeBoolean:
+      m_output.push_back(value.asBoolean() ? TAG_TRUE : TAG_FALSE);
+      break;
+    case CVariant::VariantTypeDouble:
+    {
+      double number = value.asDouble();
+      uint64_t bits;
+      memcpy(&bits, &number, sizeof(bits));
+      m_output.push_back(TAG_DOUBLE);
+      for (unsigned int i = 0; i < 8; i++)
+        m_output.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+      break;
+    }
+    case CVariant::VariantTypeString:
+      m_output.push_back(TAG_STRING);
+      WriteVarint(value.size());
+      m_output.append(value.c_str(), value.size());
+      break;
+    case CVariant::VariantTypeWideString:
+    {
+      std::wstring wstr = value.asWideString();
+      m_output.push_back(TAG_WIDESTRING);
+      WriteVarint(wstr.size());
+      for (std::wstring::const_iterator it = wstr.begin(); it != wstr.end(); ++it)
+        WriteVarint(static_cast<uint32_t>(*it));
+      break;
+    }
+    case CVariant::VariantTypeArray:
+      m_output.push_back(TAG_ARRAY);
+      WriteVarint(value.size());
+      for (CVariant::const_iterator_array it = value.begin_array(); it != value.end_array(); ++it)
+        WriteValue(*it);
+      break;
+    case CVariant::VariantTypeObject:
+      m_output.push_back(TAG_OBJECT);
+      WriteVarint(value.size());
+      for (CVariant::const_iterator_map it = value.begin_map(); it != value.end_map(); ++it)
+      {
+        WriteKey(it->first);
+        WriteValue(it->second);
+      }
+      break;
+    case CVariant::VariantTypeNull:
+    case CVariant::VariantTypeConstNull:
+    default:
+      m_output.push_back(TAG_NULL);
+      break;
+    }
+  }
+
+private:
+  std::string &m_output;
+  std::unordered_map<std::string, unsigned int> m_keys;
+};
+
+class CReader
+{
+public:
+  CReader(const char *data, size_t length) :
+    m_pos(reinterpret_cast<const uint8_t*>(data)),
+    m_end(reinterpret_cast<const uint8_t*>(data) + length),
+    m_depth(0)
+  { }
+
+  bool ReadVarint(uint64_t &value)
+  {
+    value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+      if (m_pos >= m_end)
+        return false;
+      uint8_t byte = *m_pos++;
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  // Collections need at least one byte per element, which bounds the count
+  bool ReadCount(uint64_t &count)
+  {
+    return ReadVarint(count) && count <= static_cast<uint64_t>(m_end - m_pos);
+  }
+
+  bool ReadKey(std::string &key)
+  {
+    uint64_t header;
+    if (!ReadVarint(header))
+      return false;
+
+    if (!(header & 1))
+    {
+      uint64_t index = header >> 1;
+      if (index >= m_keys.size())
+        return false;
+      key.assign(m_keys[index].first, m_keys[index].second);
+      return true;
+    }
+
+    uint64_t length = header >> 1;
+    if (length > static_cast<uint64_t>(m_end - m_pos))
+      return false;
+    const char *str = reinterpret_cast<const char*>(m_pos);
+    m_keys.push_back(std::make_pair(str, static_cast<size_t>(length)));
+    key.assign(str, static_cast<size_t>(length));
+    m_pos += length;
+    return true;
+  }
+
+  bool ReadValue(CVariant &value)
+  {
+    if (m_pos >= m_end)
+      return false;
+
+    uint64_t number;
+    switch (*m_pos++)
+    {
+    case TAG_NULL:
+      value = CVariant(CVariant::VariantTypeNull);
+      return true;
+    case TAG_FALSE:
+      value = false;
+      return true;
+    case TAG_TRUE:
+      value = true;
+      return true;
+    case TAG_INTEGER:
+      if (!ReadVarint(number))
+        return false;
+      value = static_cast<int64_t>((number >> 1) ^ (~(number & 1) + 1));
+      return true;
+    case TAG_UNSIGNED:
+      if (!ReadVarint(number))
+        return false;
+      value = number;
+      return true;
+    case TAG_DOUBLE:
+    {
+      if (m_end - m_pos < 8)
+        return false;
+      uint64_t bits = 0;
+      for (unsigned int i = 0; i < 8; i++)
+        bits |= static_cast<uint64_t>(m_pos[i]) << (i * 8);
+      m_pos += 8;
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      value = d;
+      return true;
+    }
+    case TAG_STRING:
+      if (!ReadVarint(number) || number > static_cast<uint64_t>(m_end - m_pos))
+        return false;
+      value = CVariant(reinterpret_cast<const char*>(m_pos), static_cast<unsigned int>(number));
+      m_pos += number;
+      return true;
+    case TAG_WIDESTRING:
+    {
+      if (!ReadCount(number))
+        return false;
+      std::wstring wstr;
+      wstr.reserve(static_cast<size_t>(number));
+      for (uint64_t i = 0; i < number; i++)
+      {
+        uint64_t c;
+        if (!ReadVarint(c))
+          return false;
+        wstr.push_back(static_cast<wchar_t>(c));
+      }
+      value = std::move(wstr);
+      return true;
+    }
+    case TAG_ARRAY:
+    {
+      if (!ReadCount(number) || ++m_depth > BINARY_VARIANT_MAX_DEPTH)
+        return false;
+      value = CVariant(CVariant::VariantTypeArray);
+      for (uint64_t i = 0; i < number; i++)
+      {
+        value.push_back(CVariant());
+        if (!ReadValue(value[value.size() - 1]))
+          return false;
+      }
+      m_depth--;
+      return true;
+    }
+    case TAG_OBJECT:
+    {
+      if (!ReadCount(number) || ++m_depth > BINARY_VARIANT_MAX_DEPTH)
+        return false;
+      value = CVariant(CVariant::VariantTypeObject);
+      std::string key;
+      for (uint64_t i = 0; i < number; i++)
+      {
+        if (!ReadKey(key) || !ReadValue(value[key]))
+          return false;
+      }
+      m_depth--;
+      return true;
+    }
+    default:
+      return false;
+    }
+  }
+
+  bool AtEnd() const { return m_pos == m_end; }
+
+private:
+  const uint8_t *m_pos;
+  const uint8_t *m_end;
+  unsigned int m_depth;
+  std::vector<std::pair<const char*, size_t> > m_keys; // points into the input
+};
+
+}
+
+bool CBinaryVariant::Write(const CVariant &value, std::string &output)
+{
+  output.clear();
+  output.push_back(static_cast<char>(BINARY_VARIANT_VERSION));
+
+  CWriter writer(output);
+  writer.WriteValue(value);
+
+  return true;
+}
+
+bool CBinaryVariant::WriteBase64(const CVariant &value, std::string &output)
+{
+  std::string binary;
+  if (!Write(value, binary))
+    return false;
+
+  Base64::Encode(binary, output);
+  return true;
+}
+
+bool CBinaryVariant::Parse(const char *data, size_t length, CVariant &value)
+{
+  if (!IsBinary(data, length))
+    return false;
+
+  CReader reader(data + 1, length - 1);
+  if (!reader.ReadValue(value) || !reader.AtEnd())
+  {
+    value = CVariant(CVariant::VariantTypeNull);
+    return false;
+  }
+
+  return true;
+}
+
+bool CBinaryVariant::Parse(const std::string &data, CVariant &value)
+{
+  return Parse(data.c_str(), data.size(), value);
+}
+
+bool CBinaryVariant::ParseBase64(const std::string &data, CVariant &value)
+{
+  std::string binary;
+  Base64::Decode(data, binary);
+
+  return Parse(binary, value);
+}
+
+bool CBinaryVariant::IsBinary(const char *data, size_t length)
+{
+  return data != NULL && length > 0 && static_cast<uint8_t>(data[0]) == BINARY_VARIANT_VERSION;
+}
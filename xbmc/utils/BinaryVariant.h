@@ -0,0 +1,59 @@
+#pragma once
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stddef.h>
+#include <string>
+
+class CVariant;
+
+/*!
+ * \brief Compact binary encoding of a CVariant
+ *
+ * Every value is a one byte type tag followed by its payload. Integers and
+ * lengths are stored as variable length integers, doubles as 8 little endian
+ * bytes. Object keys are interned: the first occurrence of a key is written
+ * inline and later occurrences refer to it by index, so arrays of objects
+ * (cast, streams, ...) only store their member names once.
+ *
+ * The encoding starts with a version byte that can never start a JSON
+ * document, so callers can tell binary and JSON content apart.
+ */
+class CBinaryVariant
+{
+public:
+  CBinaryVariant() = delete;
+
+  static bool Write(const CVariant &value, std::string &output);
+
+  /*!
+   * \brief Write the encoding as base64, for storage in TEXT columns
+   */
+  static bool WriteBase64(const CVariant &value, std::string &output);
+
+  static bool Parse(const char *data, size_t length, CVariant &value);
+  static bool Parse(const std::string &data, CVariant &value);
+  static bool ParseBase64(const std::string &data, CVariant &value);
+
+  /*!
+   * \brief Check if data starts like the output of Write()
+   */
+  static bool IsBinary(const char *data, size_t length);
+};
@@ -66,6 +66,7 @@
 // Defines to help with calls to CPUID
 #define CPUID_INFOTYPE_STANDARD 0x00000001
 #define CPUID_INFOTYPE_EXTENDED 0x80000001
+#define CPUID_INFOTYPE_STRUCTURED_EXTENDED 0x00000007
 
 // Standard Features
 // Bitmasks for the values returned by a call to cpuid with eax=0x00000001
@@ -73,11 +74,18 @@
 #define CPUID_00000001_ECX_SSSE3 (1<<9)
 #define CPUID_00000001_ECX_SSE4  (1<<19)
 #define CPUID_00000001_ECX_SSE42 (1<<20)
+#define CPUID_00000001_ECX_FMA3  (1<<12)
+#define CPUID_00000001_ECX_OSXSAVE (1<<27)
+#define CPUID_00000001_ECX_AVX   (1<<28)
 
 #define CPUID_00000001_EDX_MMX   (1<<23)
 #define CPUID_00000001_EDX_SSE   (1<<25)
 #define CPUID_00000001_EDX_SSE2  (1<<26)
 
+// Structured Extended Features
+// Bitmasks for the values returned by a call to cpuid with eax=0x00000007, ecx=0
+#define CPUID_00000007_EBX_AVX2  (1<<5)
+
 // Extended Features
 // Bitmasks for the values returned by a call to cpuid with eax=0x80000001
 #define CPUID_80000001_EDX_MMX2     (1<<22)
@@ -411,6 +419,12 @@ CCPUInfo::CCPUInfo(void)
               m_cpuFeatures |= CPU_FEATURE_3DNOW;
             else if (0 == strcmp(tok, "3dnowext"))
               m_cpuFeatures |= CPU_FEATURE_3DNOWEXT;
+            else if (0 == strcmp(tok, "avx"))
+              m_cpuFeatures |= CPU_FEATURE_AVX;
+            else if (0 == strcmp(tok, "avx2"))
+              m_cpuFeatures |= CPU_FEATURE_AVX2;
+            else if (0 == strcmp(tok, "fma"))
+              m_cpuFeatures |= CPU_FEATURE_FMA3;
             tok = strtok_r(NULL, " ", &save);
           }
         }
@@ -884,6 +898,21 @@ void CCPUInfo::ReadCPUFeatures()
       m_cpuFeatures |= CPU_FEATURE_SSE4;
     if (CPUInfo[CPUINFO_ECX] & CPUID_00000001_ECX_SSE42)
       m_cpuFeatures |= CPU_FEATURE_SSE42;
+
+    // the ymm registers are only usable if the os saves them on context switches
+    if ((CPUInfo[CPUINFO_ECX] & CPUID_00000001_ECX_OSXSAVE) && (_xgetbv(0) & 0x6) == 0x6)
+    {
+      if (CPUInfo[CPUINFO_ECX] & CPUID_00000001_ECX_AVX)
+        m_cpuFeatures |= CPU_FEATURE_AVX;
+      if (CPUInfo[CPUINFO_ECX] & CPUID_00000001_ECX_FMA3)
+        m_cpuFeatures |= CPU_FEATURE_FMA3;
+      if (MaxStdInfoType >= CPUID_INFOTYPE_STRUCTURED_EXTENDED)
+      {
+        __cpuidex(CPUInfo, CPUID_INFOTYPE_STRUCTURED_EXTENDED, 0);
+        if (CPUInfo[CPUINFO_EBX] & CPUID_00000007_EBX_AVX2)
+          m_cpuFeatures |= CPU_FEATURE_AVX2;
+      }
+    }
   }
 
   __cpuid(CPUInfo, 0x80000000);
@@ -934,9 +963,22 @@ void CCPUInfo::ReadCPUFeatures()
         m_cpuFeatures |= CPU_FEATURE_3DNOW;
       if (strstr(buffer,"3DNOWEXT "))
        m_cpuFeatures |= CPU_FEATURE_3DNOWEXT;
+      if (strstr(buffer,"AVX1.0 "))
+        m_cpuFeatures |= CPU_FEATURE_AVX;
+      if (strstr(buffer,"FMA "))
+        m_cpuFeatures |= CPU_FEATURE_FMA3;
     }
     else
       m_cpuFeatures |= CPU_FEATURE_MMX;
+
+    len = 512 - 1;
+    memset(buffer, 0, sizeof(buffer));
+    if (sysctlbyname("machdep.cpu.leaf7_features", &buffer, &len, NULL, 0) == 0)
+    {
+      strcat(buffer, " ");
+      if (strstr(buffer,"AVX2 "))
+        m_cpuFeatures |= CPU_FEATURE_AVX2;
+    }
   #endif
 #elif defined(LINUX)
 // empty on purpose, the implementation is in the constructor
@@ -950,7 +992,11 @@ void CCPUInfo::ReadCPUFeatures()
 bool CCPUInfo::HasNeon()
 {
   static int has_neon = -1;
-#if defined (TARGET_ANDROID)
+#if defined(__aarch64__)
+  // advanced simd is mandatory on armv8, there's no HWCAP_NEON to look for
+  has_neon = 1;
+
+#elif defined (TARGET_ANDROID)
   if (has_neon == -1)
     has_neon = (CAndroidFeatures::HasNeon()) ? 1 : 0;
 
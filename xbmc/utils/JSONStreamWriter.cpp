@@ -0,0 +1,223 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "JSONStreamWriter.h"
+
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/writer.h>
+
+#include "utils/Variant.h"
+
+namespace
+{
+
+// rapidjson output stream appending to a std::string
+class CBufferStream
+{
+public:
+  typedef char Ch;
+
+  explicit CBufferStream(std::string &buffer) : m_buffer(buffer) { }
+
+  void Put(Ch c) { m_buffer.push_back(c); }
+  void Flush() { }
+
+private:
+  std::string &m_buffer;
+};
+
+template<class TWriter>
+bool InternalWrite(TWriter& writer, const CVariant &value)
+{
+  switch (value.type())
+  {
+  case CVariant::VariantTypeInteger:
+    return writer.Int64(value.asInteger());
+
+  case CVariant::VariantTypeUnsignedInteger:
+    return writer.Uint64(value.asUnsignedInteger());
+
+  case CVariant::VariantTypeDouble:
+    return writer.Double(value.asDouble());
+
+  case CVariant::VariantTypeBoolean:
+    return writer.Bool(value.asBoolean());
+
+  case CVariant::VariantTypeString:
+    return writer.String(value.c_str(), value.size());
+
+  case CVariant::VariantTypeArray:
+    if (!writer.StartArray())
+      return false;
+
+    for (CVariant::const_iterator_array itr = value.begin_array(); itr != value.end_array(); ++itr)
+    {
+      if (!InternalWrite(writer, *itr))
+        return false;
+    }
+
+    return writer.EndArray(value.size());
+
+  case CVariant::VariantTypeObject:
+    if (!writer.StartObject())
+      return false;
+
+    for (CVariant::const_iterator_map itr = value.begin_map(); itr != value.end_map(); ++itr)
+    {
+      if (!writer.Key(itr->first.c_str(), itr->first.size()) ||
+        !InternalWrite(writer, itr->second))
+        return false;
+    }
+
+    return writer.EndObject(value.size());
+
+  case CVariant::VariantTypeConstNull:
+  case CVariant::VariantTypeNull:
+  default:
+    return writer.Null();
+  }
+
+  return false;
+}
+
+}
+
+class CJSONStreamWriter::IWriter
+{
+public:
+  virtual ~IWriter() = default;
+
+  virtual bool StartObject() = 0;
+  virtual bool EndObject() = 0;
+  virtual bool StartArray() = 0;
+  virtual bool EndArray() = 0;
+  virtual bool Key(const std::string &key) = 0;
+  virtual bool Value(const CVariant &value) = 0;
+  virtual bool IsComplete() const = 0;
+
+  std::string m_buffer;
+};
+
+template<class TWriter>
+class CJSONStreamWriter::CWriter : public CJSONStreamWriter::IWriter
+{
+public:
+  CWriter() : m_stream(m_buffer), m_writer(m_stream) { }
+
+  TWriter& GetWriter() { return m_writer; }
+
+  bool StartObject() override { return m_writer.StartObject(); }
+  bool EndObject() override { return m_writer.EndObject(); }
+  bool StartArray() override { return m_writer.StartArray(); }
+  bool EndArray() override { return m_writer.EndArray(); }
+  bool Key(const std::string &key) override { return m_writer.Key(key.c_str(), key.size()); }
+  bool Value(const CVariant &value) override { return InternalWrite(m_writer, value); }
+  bool IsComplete() const override { return m_writer.IsComplete(); }
+
+private:
+  CBufferStream m_stream;
+  TWriter m_writer;
+};
+
+CJSONStreamWriter::CJSONStreamWriter(IJSONStreamSink &sink, bool compact, size_t chunkSize /* = DefaultChunkSize */)
+  : m_sink(sink),
+    m_chunkSize(chunkSize),
+    m_failed(false)
+{
+  if (compact)
+    m_writer.reset(new CWriter<rapidjson::Writer<CBufferStream> >());
+  else
+  {
+    CWriter<rapidjson::PrettyWriter<CBufferStream> > *writer = new CWriter<rapidjson::PrettyWriter<CBufferStream> >();
+    writer->GetWriter().SetIndent('\t', 1);
+    m_writer.reset(writer);
+  }
+}
+
+CJSONStreamWriter::~CJSONStreamWriter() = default;
+
+bool CJSONStreamWriter::StartObject()
+{
+  return !m_failed && Written(m_writer->StartObject());
+}
+
+bool CJSONStreamWriter::EndObject()
+{
+  return !m_failed && Written(m_writer->EndObject());
+}
+
+bool CJSONStreamWriter::StartArray()
+{
+  return !m_failed && Written(m_writer->StartArray());
+}
+
+bool CJSONStreamWriter::EndArray()
+{
+  return !m_failed && Written(m_writer->EndArray());
+}
+
+bool CJSONStreamWriter::Key(const std::string &key)
+{
+  return !m_failed && Written(m_writer->Key(key));
+}
+
+bool CJSONStreamWriter::Value(const CVariant &value)
+{
+  return !m_failed && Written(m_writer->Value(value));
+}
+
+bool CJSONStreamWriter::Flush()
+{
+  if (m_failed)
+    return false;
+
+  if (!m_writer->m_buffer.empty())
+  {
+    if (!m_sink.Write(m_writer->m_buffer.c_str(), m_writer->m_buffer.size()))
+      m_failed = true;
+    m_writer->m_buffer.clear();
+  }
+
+  return !m_failed;
+}
+
+bool CJSONStreamWriter::IsComplete() const
+{
+  return m_writer->IsComplete();
+}
+
+size_t CJSONStreamWriter::GetBufferedSize() const
+{
+  return m_writer->m_buffer.size();
+}
+
+bool CJSONStreamWriter::Written(bool result)
+{
+  if (!result)
+  {
+    m_failed = true;
+    return false;
+  }
+
+  if (m_writer->m_buffer.size() >= m_chunkSize)
+    return Flush();
+
+  return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+
+class CVariant;
+
+/*!
+ * \brief Destination of the output of a CJSONStreamWriter
+ */
+class IJSONStreamSink
+{
+public:
+  virtual ~IJSONStreamSink() = default;
+
+  /*!
+   * \brief Consumes the next chunk of the JSON document
+   *
+   * \return False if the data couldn't be delivered, e.g. because the peer went away
+   */
+  virtual bool Write(const char *data, size_t size) = 0;
+};
+
+/*!
+ * \brief SAX style JSON writer
+ *
+ * Unlike CJSONVariantWriter the document doesn't have to exist as a CVariant
+ * tree. It is written one event at a time and handed to the sink in chunks of
+ * roughly chunkSize bytes, so big arrays can be written element by element
+ * while they are being produced.
+ *
+ * Once writing or delivering output failed every further call fails as well.
+ */
+class CJSONStreamWriter
+{
+public:
+  static const size_t DefaultChunkSize = 16 * 1024;
+
+  CJSONStreamWriter(IJSONStreamSink &sink, bool compact, size_t chunkSize = DefaultChunkSize);
+  ~CJSONStreamWriter();
+
+  bool StartObject();
+  bool EndObject();
+  bool StartArray();
+  bool EndArray();
+  bool Key(const std::string &key);
+
+  /*!
+   * \brief Writes a complete value, e.g. a member of an object or an element of an array
+   */
+  bool Value(const CVariant &value);
+
+  /*!
+   * \brief Hands all buffered output to the sink
+   */
+  bool Flush();
+
+  /*!
+   * \brief Whether a complete JSON document has been written
+   */
+  bool IsComplete() const;
+
+  bool HasFailed() const { return m_failed; }
+
+  /*!
+   * \brief Number of bytes written but not handed to the sink yet
+   */
+  size_t GetBufferedSize() const;
+
+private:
+  class IWriter;
+  template<class TWriter> class CWriter;
+
+  bool Written(bool result);
+
+  IJSONStreamSink &m_sink;
+  std::unique_ptr<IWriter> m_writer;
+  size_t m_chunkSize;
+  bool m_failed;
+};
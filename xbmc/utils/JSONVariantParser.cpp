@@ -160,26 +160,30 @@ bool CJSONVariantParserHandler::EndArray(rapidjson::SizeType elementCount)
 
 void CJSONVariantParserHandler::PushObject(CVariant variant)
 {
+  PARSE_STATUS status;
+  if (variant.isObject())
+    status = PARSE_STATUS::Object;
+  else if (variant.isArray())
+    status = PARSE_STATUS::Array;
+  else
+    status = PARSE_STATUS::Variable;
+
   if (m_status == PARSE_STATUS::Object)
   {
-    (*m_parse[m_parse.size() - 1])[m_key] = variant;
-    m_parse.push_back(&(*m_parse[m_parse.size() - 1])[m_key]);
+    CVariant &member = (*m_parse[m_parse.size() - 1])[std::move(m_key)];
+    member = std::move(variant);
+    m_parse.push_back(&member);
   }
   else if (m_status == PARSE_STATUS::Array)
   {
     CVariant *temp = m_parse[m_parse.size() - 1];
-    temp->push_back(variant);
+    temp->push_back(std::move(variant));
     m_parse.push_back(&(*temp)[temp->size() - 1]);
   }
   else if (m_parse.empty())
-    m_parse.push_back(new CVariant(variant));
+    m_parse.push_back(new CVariant(std::move(variant)));
 
-  if (variant.isObject())
-    m_status = PARSE_STATUS::Object;
-  else if (variant.isArray())
-    m_status = PARSE_STATUS::Array;
-  else
-    m_status = PARSE_STATUS::Variable;
+  m_status = status;
 }
 
 void CJSONVariantParserHandler::PopObject()
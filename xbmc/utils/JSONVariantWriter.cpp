@@ -20,85 +20,41 @@
 
 #include "JSONVariantWriter.h"
 
-#include <rapidjson/prettywriter.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
+#include <limits>
+#include <utility>
 
-#include "utils/Variant.h"
+#include "utils/JSONStreamWriter.h"
 
-template<class TWriter>
-bool InternalWrite(TWriter& writer, const CVariant &value)
+namespace
 {
-  switch (value.type())
-  {
-  case CVariant::VariantTypeInteger:
-    return writer.Int64(value.asInteger());
-
-  case CVariant::VariantTypeUnsignedInteger:
-    return writer.Uint64(value.asUnsignedInteger());
-
-  case CVariant::VariantTypeDouble:
-    return writer.Double(value.asDouble());
-
-  case CVariant::VariantTypeBoolean:
-    return writer.Bool(value.asBoolean());
-
-  case CVariant::VariantTypeString:
-    return writer.String(value.c_str(), value.size());
-
-  case CVariant::VariantTypeArray:
-    if (!writer.StartArray())
-      return false;
-
-    for (CVariant::const_iterator_array itr = value.begin_array(); itr != value.end_array(); ++itr)
-    {
-      if (!InternalWrite(writer, *itr))
-        return false;
-    }
-
-    return writer.EndArray(value.size());
-
-  case CVariant::VariantTypeObject:
-    if (!writer.StartObject())
-      return false;
 
-    for (CVariant::const_iterator_map itr = value.begin_map(); itr != value.end_map(); ++itr)
-    {
-      if (!writer.Key(itr->first.c_str()) ||
-        !InternalWrite(writer, itr->second))
-        return false;
-    }
-
-    return writer.EndObject(value.size());
+class CStringSink : public IJSONStreamSink
+{
+public:
+  explicit CStringSink(std::string &output) : m_output(output) { }
 
-  case CVariant::VariantTypeConstNull:
-  case CVariant::VariantTypeNull:
-  default:
-    return writer.Null();
+  bool Write(const char *data, size_t size) override
+  {
+    m_output.append(data, size);
+    return true;
   }
 
-  return false;
+private:
+  std::string &m_output;
+};
+
 }
 
 bool CJSONVariantWriter::Write(const CVariant &value, std::string& output, bool compact)
 {
-  rapidjson::StringBuffer stringBuffer;
-  if (compact)
-  {
-    rapidjson::Writer<rapidjson::StringBuffer> writer(stringBuffer);
+  std::string json;
+  CStringSink sink(json);
 
-    if (!InternalWrite(writer, value) || !writer.IsComplete())
-      return false;
-  }
-  else
-  {
-    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(stringBuffer);
-    writer.SetIndent('\t', 1);
-
-    if (!InternalWrite(writer, value) || !writer.IsComplete())
-      return false;
-  }
+  // a single chunk, the sink is only written to once the document is complete
+  CJSONStreamWriter writer(sink, compact, std::numeric_limits<size_t>::max());
+  if (!writer.Value(value) || !writer.IsComplete() || !writer.Flush())
+    return false;
 
-  output = stringBuffer.GetString();
+  output = std::move(json);
   return true;
 }
@@ -20,9 +20,11 @@
 
 #include "JobManager.h"
 #include <algorithm>
+#include <cassert>
 #include <functional>
 #include <stdexcept>
 #include "threads/SingleLock.h"
+#include "threads/ThreadLocal.h"
 #include "utils/log.h"
 #ifdef TARGET_POSIX
 #include "linux/XTimeUtils.h"
@@ -37,12 +39,22 @@ bool CJob::ShouldCancel(unsigned int progress, unsigned int total) const
   return false;
 }
 
+static XbmcThreads::ThreadLocal<CJobWorker> currentWorker;
+
 CJobWorker::CJobWorker(CJobManager *manager) : CThread("JobWorker")
 {
   m_jobManager = manager;
+  m_queue = -1;
   Create(true); // start work immediately, and kill ourselves when we're done
 }
 
+CJobWorker::CJobWorker(CJobManager *manager, unsigned int queue) : CThread("JobWorker")
+{
+  m_jobManager = manager;
+  m_queue = queue;
+  Create(); // the job manager stops and deletes us
+}
+
 CJobWorker::~CJobWorker()
 {
   // while we should already be removed from the job manager, if an exception
@@ -56,6 +68,7 @@ CJobWorker::~CJobWorker()
 void CJobWorker::Process()
 {
   SetPriority( GetMinPriority() );
+  currentWorker.set(this);
   while (true)
   {
     // request an item from our manager (this call is blocking)
@@ -144,12 +157,20 @@ bool CJobQueue::AddJob(CJob *job)
 void CJobQueue::QueueNextJob()
 {
   CSingleLock lock(m_section);
-  if (m_jobQueue.size() && m_processing.size() < m_jobsAtOnce)
+  while (m_jobQueue.size() && m_processing.size() < m_jobsAtOnce)
   {
     CJobPointer &job = m_jobQueue.back();
     job.m_id = CJobManager::GetInstance().AddJob(job.m_job, this, m_priority);
+    if (job.m_id == 0)
+    {
+      // the job manager isn't running, the job would never be run nor freed
+      job.FreeJob();
+      m_jobQueue.pop_back();
+      continue;
+    }
     m_processing.push_back(job);
     m_jobQueue.pop_back();
+    break;
   }
 }
 
@@ -180,10 +201,18 @@ CJobManager &CJobManager::GetInstance()
 }
 
 CJobManager::CJobManager()
+  : m_jobCounter(0),
+    m_pauseJobs(false),
+    m_running(true),
+    m_workerCount(DefaultWorkerCount),
+    m_poolStarted(false),
+    m_nextQueue(0),
+    m_poolProcessing(0),
+    m_poolGeneration(0),
+    m_idleWorkers(0)
 {
-  m_jobCounter = 0;
-  m_running = true;
-  m_pauseJobs = false;
+  for (unsigned int i = 0; i < m_workerCount; i++)
+    m_queues.push_back(std::unique_ptr<CWorkerQueue>(new CWorkerQueue()));
 }
 
 void CJobManager::Restart()
@@ -195,22 +224,51 @@ void CJobManager::Restart()
   m_running = true;
 }
 
+void CJobManager::SetWorkerCount(unsigned int workers)
+{
+  CSingleLock lock(m_section);
+
+  if (m_running)
+    throw std::logic_error("CJobManager is running");
+
+  m_workerCount = std::max(workers, 1u);
+  m_queues.clear();
+  for (unsigned int i = 0; i < m_workerCount; i++)
+    m_queues.push_back(std::unique_ptr<CWorkerQueue>(new CWorkerQueue()));
+}
+
 void CJobManager::CancelJobs()
 {
   CSingleLock lock(m_section);
   m_running = false;
 
   // clear any pending jobs
-  for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_DEDICATED; ++priority)
-  {
-    for_each(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), std::mem_fun_ref(&CWorkItem::FreeJob));
-    m_jobQueue[priority].clear();
-  }
+  for_each(m_jobQueue.begin(), m_jobQueue.end(), std::mem_fun_ref(&CWorkItem::FreeJob));
+  m_jobQueue.clear();
+  ClearPoolQueues();
 
   // cancel any callbacks on jobs still processing
   for_each(m_processing.begin(), m_processing.end(), std::mem_fun_ref(&CWorkItem::Cancel));
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+  {
+    CSingleLock currentLock(m_queues[i]->m_currentSection);
+    m_queues[i]->m_current.Cancel();
+  }
+
+  // tell our workers to finish, waiting for the pooled ones outside of our section
+  // as their jobs may still call us
+  Workers pool;
+  pool.swap(m_pool);
+  m_poolStarted = false;
+  lock.Leave();
+  WakePool(true);
+  for (Workers::iterator it = pool.begin(); it != pool.end(); ++it)
+    delete *it;
+  lock.Enter();
+
+  // drop jobs which were added while the pool was shutting down
+  ClearPoolQueues();
 
-  // tell our workers to finish
   while (m_workers.size())
   {
     lock.Leave();
@@ -224,41 +282,97 @@ CJobManager::~CJobManager()
 {
 }
 
+unsigned int CJobManager::NextJobId()
+{
+  // increment the job counter, ensuring 0 (invalid job) is never hit
+  unsigned int id = ++m_jobCounter;
+  if (id == 0)
+    id = ++m_jobCounter;
+  return id;
+}
+
 unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority)
 {
+  // CancelJobs() clears the queues under our section once m_running is reset,
+  // so the job has to be queued under it as well or it could slip in afterwards
   CSingleLock lock(m_section);
 
   if (!m_running)
     return 0;
 
-  // increment the job counter, ensuring 0 (invalid job) is never hit
-  m_jobCounter++;
-  if (m_jobCounter == 0)
-    m_jobCounter++;
+  if (priority == CJob::PRIORITY_DEDICATED)
+  {
+    // create a work item for this job
+    CWorkItem work(job, NextJobId(), priority, callback);
+    m_jobQueue.push_back(work);
+
+    StartWorkers(priority);
+    return work.m_id;
+  }
 
-  // create a work item for this job
-  CWorkItem work(job, m_jobCounter, priority, callback);
-  m_jobQueue[priority].push_back(work);
+  if (!m_poolStarted)
+    StartPool();
+
+  // jobs added by a pooled worker stay on its own queue, all others are spread over the pool
+  unsigned int queue;
+  CJobWorker *worker = currentWorker.get();
+  if (worker && worker->IsPoolWorker())
+    queue = worker->GetQueue();
+  else
+    queue = m_nextQueue++ % m_queues.size();
 
-  StartWorkers(priority);
+  CWorkItem work(job, NextJobId(), priority, callback);
+  {
+    CSingleLock queueLock(m_queues[queue]->m_section);
+    m_queues[queue]->m_jobs[priority].push_back(work);
+  }
+  lock.Leave();
+
+  WakePool(false);
   return work.m_id;
 }
 
 void CJobManager::CancelJob(unsigned int jobID)
 {
-  CSingleLock lock(m_section);
+  // check whether we have this job in one of the queues. Jobs only move from
+  // a queue to a worker while the queue is locked, so the queues have to be
+  // searched before the jobs being processed.
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+  {
+    CWorkerQueue &queue = *m_queues[i];
+    CSingleLock lock(queue.m_section);
+    for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_HIGH; ++priority)
+    {
+      JobQueue::iterator it = find(queue.m_jobs[priority].begin(), queue.m_jobs[priority].end(), jobID);
+      if (it != queue.m_jobs[priority].end())
+      {
+        delete it->m_job;
+        queue.m_jobs[priority].erase(it);
+        return;
+      }
+    }
+  }
 
-  // check whether we have this job in the queue
-  for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_DEDICATED; ++priority)
+  for (unsigned int i = 0; i < m_queues.size(); i++)
   {
-    JobQueue::iterator i = find(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), jobID);
-    if (i != m_jobQueue[priority].end())
+    CWorkerQueue &queue = *m_queues[i];
+    CSingleLock lock(queue.m_currentSection);
+    if (queue.m_busy && queue.m_current == jobID)
     {
-      delete i->m_job;
-      m_jobQueue[priority].erase(i);
+      queue.m_current.Cancel(); // job is in progress, so only thing to do is to remove callback
       return;
     }
   }
+
+  CSingleLock lock(m_section);
+
+  JobQueue::iterator i = find(m_jobQueue.begin(), m_jobQueue.end(), jobID);
+  if (i != m_jobQueue.end())
+  {
+    delete i->m_job;
+    m_jobQueue.erase(i);
+    return;
+  }
   // or if we're processing it
   Processing::iterator it = find(m_processing.begin(), m_processing.end(), jobID);
   if (it != m_processing.end())
@@ -273,8 +387,8 @@ void CJobManager::StartWorkers(CJob::PRIORITY priority)
   if (m_processing.size() >= GetMaxWorkers(priority))
     return;
 
-  // do we have any sleeping threads?
-  if (m_processing.size() < m_workers.size())
+  // do we have any sleeping threads? (jobs still in the queue are about to take them)
+  if (m_processing.size() + m_jobQueue.size() <= m_workers.size())
   {
     m_jobEvent.Set();
     return;
@@ -284,23 +398,108 @@ void CJobManager::StartWorkers(CJob::PRIORITY priority)
   m_workers.push_back(new CJobWorker(this));
 }
 
+void CJobManager::StartPool()
+{
+  CSingleLock lock(m_section);
+
+  if (m_poolStarted || !m_running)
+    return;
+
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+    m_pool.push_back(new CJobWorker(this, i));
+  m_poolStarted = true;
+}
+
+void CJobManager::ClearPoolQueues()
+{
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+  {
+    CWorkerQueue &queue = *m_queues[i];
+    CSingleLock lock(queue.m_section);
+    for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_HIGH; ++priority)
+    {
+      for_each(queue.m_jobs[priority].begin(), queue.m_jobs[priority].end(), std::mem_fun_ref(&CWorkItem::FreeJob));
+      queue.m_jobs[priority].clear();
+    }
+  }
+}
+
+void CJobManager::WakePool(bool all)
+{
+  // idle workers compare the generation before going to sleep, so either they
+  // see the new one or we see them in m_idleWorkers
+  m_poolGeneration++;
+  if (m_idleWorkers == 0)
+    return;
+
+  CSingleLock lock(m_poolSection);
+  if (all)
+    m_poolCondition.notifyAll();
+  else
+    m_poolCondition.notify();
+}
+
 CJob *CJobManager::PopJob()
 {
   CSingleLock lock(m_section);
-  for (int priority = CJob::PRIORITY_DEDICATED; priority >= CJob::PRIORITY_LOW_PAUSABLE; --priority)
+
+  if (m_jobQueue.size() && m_processing.size() < GetMaxWorkers(CJob::PRIORITY_DEDICATED))
+  {
+    // pop the job off the queue
+    CWorkItem job = m_jobQueue.front();
+    m_jobQueue.pop_front();
+
+    // add to the processing vector
+    m_processing.push_back(job);
+    job.m_job->m_callback = this;
+    return job.m_job;
+  }
+  return NULL;
+}
+
+bool CJobManager::ReservePoolWorker(CJob::PRIORITY priority)
+{
+  unsigned int maxWorkers = GetMaxWorkers(priority);
+  unsigned int processing = m_poolProcessing;
+  while (processing < maxWorkers)
+  {
+    if (m_poolProcessing.compare_exchange_weak(processing, processing + 1))
+      return true;
+  }
+  return false;
+}
+
+CJob *CJobManager::PopPoolJob(unsigned int queue)
+{
+  CWorkerQueue &own = *m_queues[queue];
+  for (int priority = CJob::PRIORITY_HIGH; priority >= CJob::PRIORITY_LOW_PAUSABLE; --priority)
   {
     // Check whether we're pausing pausable jobs
     if (priority == CJob::PRIORITY_LOW_PAUSABLE && m_pauseJobs)
       continue;
 
-    if (m_jobQueue[priority].size() && m_processing.size() < GetMaxWorkers(CJob::PRIORITY(priority)))
-    {
-      // pop the job off the queue
-      CWorkItem job = m_jobQueue[priority].front();
-      m_jobQueue[priority].pop_front();
+    if (m_poolProcessing >= GetMaxWorkers(CJob::PRIORITY(priority)))
+      continue;
 
-      // add to the processing vector
-      m_processing.push_back(job);
+    // our own queue first, then steal from the others
+    for (unsigned int i = 0; i < m_queues.size(); i++)
+    {
+      CWorkerQueue &victim = *m_queues[(queue + i) % m_queues.size()];
+      CSingleLock lock(victim.m_section);
+      if (victim.m_jobs[priority].empty())
+        continue;
+
+      // all workers for this priority are busy. Whoever frees one looks for jobs again.
+      if (!ReservePoolWorker(CJob::PRIORITY(priority)))
+        break;
+
+      CWorkItem job = victim.m_jobs[priority].front();
+      victim.m_jobs[priority].pop_front();
+
+      // make it our current job before it leaves the queue for CancelJob()
+      CSingleLock currentLock(own.m_currentSection);
+      own.m_current = job;
+      own.m_busy = true;
       job.m_job->m_callback = this;
       return job.m_job;
     }
@@ -310,23 +509,29 @@ CJob *CJobManager::PopJob()
 
 void CJobManager::PauseJobs()
 {
-  CSingleLock lock(m_section);
   m_pauseJobs = true;
 }
 
 void CJobManager::UnPauseJobs()
 {
-  CSingleLock lock(m_section);
   m_pauseJobs = false;
+  WakePool(true);
 }
 
 bool CJobManager::IsProcessing(const CJob::PRIORITY &priority) const
 {
-  CSingleLock lock(m_section);
-
   if (m_pauseJobs)
     return false;
 
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+  {
+    const CWorkerQueue &queue = *m_queues[i];
+    CSingleLock lock(queue.m_currentSection);
+    if (queue.m_busy && queue.m_current.m_priority == priority)
+      return true;
+  }
+
+  CSingleLock lock(m_section);
   for(Processing::const_iterator it = m_processing.begin(); it < m_processing.end(); ++it)
   {
     if (priority == it->m_priority)
@@ -338,11 +543,19 @@ bool CJobManager::IsProcessing(const CJob::PRIORITY &priority) const
 int CJobManager::IsProcessing(const std::string &type) const
 {
   int jobsMatched = 0;
-  CSingleLock lock(m_section);
 
   if (m_pauseJobs)
     return 0;
 
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+  {
+    const CWorkerQueue &queue = *m_queues[i];
+    CSingleLock lock(queue.m_currentSection);
+    if (queue.m_busy && type == std::string(queue.m_current.m_job->GetType()))
+      jobsMatched++;
+  }
+
+  CSingleLock lock(m_section);
   for(Processing::const_iterator it = m_processing.begin(); it < m_processing.end(); ++it)
   {
     if (type == std::string(it->m_job->GetType()))
@@ -353,6 +566,9 @@ int CJobManager::IsProcessing(const std::string &type) const
 
 CJob *CJobManager::GetNextJob(const CJobWorker *worker)
 {
+  if (worker->IsPoolWorker())
+    return GetNextPoolJob(worker);
+
   CSingleLock lock(m_section);
   while (m_running)
   {
@@ -377,26 +593,99 @@ CJob *CJobManager::GetNextJob(const CJobWorker *worker)
   return NULL;
 }
 
-bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const
+CJob *CJobManager::GetNextPoolJob(const CJobWorker *worker)
 {
-  CSingleLock lock(m_section);
-  // find the job in the processing queue, and check whether it's cancelled (no callback)
-  Processing::const_iterator i = find(m_processing.begin(), m_processing.end(), job);
-  if (i != m_processing.end())
+  while (m_running)
   {
-    CWorkItem item(*i);
-    lock.Leave(); // leave section prior to call
-    if (item.m_callback)
+    unsigned int generation = m_poolGeneration;
+
+    // grab a job off the queues if we have one
+    CJob *job = PopPoolJob(worker->GetQueue());
+    if (job)
+      return job;
+
+    // sleep until jobs are added or unpaused
+    CSingleLock lock(m_poolSection);
+    m_idleWorkers++;
+    if (m_running && generation == m_poolGeneration)
+      m_poolCondition.wait(lock);
+    m_idleWorkers--;
+  }
+  return NULL;
+}
+
+bool CJobManager::FindPoolJob(const CJob *job, CWorkItem &item) const
+{
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+  {
+    const CWorkerQueue &queue = *m_queues[i];
+    CSingleLock lock(queue.m_currentSection);
+    if (queue.m_busy && queue.m_current == job)
     {
-      item.m_callback->OnJobProgress(item.m_id, progress, total, job);
-      return false;
+      item = queue.m_current;
+      return true;
     }
   }
-  return true; // couldn't find the job, or it's been cancelled
+  return false;
+}
+
+bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const
+{
+  CWorkItem item;
+  if (!FindPoolJob(job, item))
+  {
+    CSingleLock lock(m_section);
+    // find the job in the processing queue, and check whether it's cancelled (no callback)
+    Processing::const_iterator i = find(m_processing.begin(), m_processing.end(), job);
+    if (i == m_processing.end())
+      return true; // couldn't find the job
+    item = *i;
+  }
+
+  // called outside of any section
+  if (item.m_callback)
+  {
+    item.m_callback->OnJobProgress(item.m_id, progress, total, job);
+    return false;
+  }
+  return true; // the job has been cancelled
 }
 
 void CJobManager::OnJobComplete(bool success, CJob *job)
 {
+  CJobWorker *worker = currentWorker.get();
+  if (worker && worker->IsPoolWorker())
+  {
+    CWorkerQueue &queue = *m_queues[worker->GetQueue()];
+    CWorkItem item;
+    {
+      CSingleLock lock(queue.m_currentSection);
+      // PopPoolJob() made it our current job and only we clear it, cancelling keeps it
+      assert(queue.m_busy && queue.m_current == job);
+      item = queue.m_current;
+    }
+
+    // tell any listeners we're done with the job, then delete it
+    try
+    {
+      if (item.m_callback)
+        item.m_callback->OnJobComplete(item.m_id, success, item.m_job);
+    }
+    catch (...)
+    {
+      CLog::Log(LOGERROR, "%s error processing job %s", __FUNCTION__, item.m_job->GetType());
+    }
+
+    {
+      CSingleLock lock(queue.m_currentSection);
+      queue.m_busy = false;
+      queue.m_current = CWorkItem();
+    }
+    m_poolProcessing--;
+    item.FreeJob();
+    return;
+  }
+
   CSingleLock lock(m_section);
   // remove the job from the processing queue
   Processing::iterator i = find(m_processing.begin(), m_processing.end(), job);
@@ -432,10 +721,14 @@ void CJobManager::RemoveWorker(const CJobWorker *worker)
     m_workers.erase(i); // workers auto-delete
 }
 
-unsigned int CJobManager::GetMaxWorkers(CJob::PRIORITY priority)
+unsigned int CJobManager::GetMaxWorkers(CJob::PRIORITY priority) const
 {
-  static const unsigned int max_workers = 5;
   if (priority == CJob::PRIORITY_DEDICATED)
     return 10000; // A large number..
-  return max_workers - (CJob::PRIORITY_HIGH - priority);
+
+  // keep workers free for higher priority jobs that may arise
+  unsigned int reserved = CJob::PRIORITY_HIGH - priority;
+  if (m_workerCount <= reserved)
+    return 1;
+  return m_workerCount - reserved;
 }
@@ -19,9 +19,13 @@
  *
  */
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <queue>
 #include <vector>
 #include <string>
+#include "threads/Condition.h"
 #include "threads/CriticalSection.h"
 #include "threads/Thread.h"
 #include "Job.h"
@@ -31,12 +35,26 @@ class CJobManager;
 class CJobWorker : public CThread
 {
 public:
-  CJobWorker(CJobManager *manager);
+  /*!
+   \brief Creates a worker for PRIORITY_DEDICATED jobs which deletes itself once it ran out of work
+   */
+  explicit CJobWorker(CJobManager *manager);
+
+  /*!
+   \brief Creates a worker of the job manager's pool
+   \param queue index of the worker's own job queue
+   */
+  CJobWorker(CJobManager *manager, unsigned int queue);
   virtual ~CJobWorker();
 
   void Process();
+
+  bool IsPoolWorker() const { return m_queue >= 0; }
+  int GetQueue() const { return m_queue; }
+
 private:
   CJobManager  *m_jobManager;
+  int           m_queue;
 };
 
 /*!
@@ -170,6 +188,13 @@ private:
  priority levels.  Lower priority jobs are executed only if there are sufficient
  spare worker threads free to allow for higher priority jobs that may arise.
 
+ Jobs up to PRIORITY_HIGH are run by a fixed pool of workers. Every worker has its
+ own queue, so adding and popping jobs doesn't contend on a single lock: jobs added
+ by a worker go to its own queue, others are spread over the queues round robin.
+ A worker that ran out of jobs of a priority steals them from the queues of the
+ other workers before it looks at lower priorities. PRIORITY_DEDICATED jobs get a
+ worker of their own, started on demand.
+
  \sa CJob and IJobCallback
  */
 class CJobManager
@@ -177,6 +202,13 @@ class CJobManager
   class CWorkItem
   {
   public:
+    CWorkItem()
+    {
+      m_job = NULL;
+      m_id = 0;
+      m_callback = NULL;
+      m_priority = CJob::PRIORITY_LOW;
+    }
     CWorkItem(CJob *job, unsigned int id, CJob::PRIORITY priority, IJobCallback *callback)
     {
       m_job = job;
@@ -297,6 +329,23 @@ public:
    */
   bool IsProcessing(const CJob::PRIORITY &priority) const;
 
+  /*!
+   \brief Sets the number of pooled workers running jobs up to PRIORITY_HIGH
+   Takes effect the next time the pool is started, i.e. with the first job added
+   after construction or Restart().
+   \param workers number of workers, at least 1
+   \throws std::logic_error if the manager is running
+   \sa CancelJobs(), Restart()
+   */
+  void SetWorkerCount(unsigned int workers);
+
+  /*!
+   \brief Number of pooled workers running jobs up to PRIORITY_HIGH
+   */
+  unsigned int GetWorkerCount() const { return m_workerCount; }
+
+  static const unsigned int DefaultWorkerCount = 5;
+
 protected:
   friend class CJobWorker;
   friend class CJob;
@@ -335,27 +384,72 @@ private:
   CJobManager const& operator=(CJobManager const&);
   virtual ~CJobManager();
 
-  /*! \brief Pop a job off the job queue and add to the processing queue ready to process
+  // queue and current job of a pooled worker
+  class CWorkerQueue
+  {
+  public:
+    CWorkerQueue() : m_busy(false) {}
+
+    // guards the queued jobs
+    CCriticalSection m_section;
+    std::deque<CWorkItem> m_jobs[CJob::PRIORITY_HIGH + 1];
+
+    // guards the job being processed. Locked after m_section when both are needed.
+    CCriticalSection m_currentSection;
+    CWorkItem m_current;
+    bool m_busy;
+  };
+
+  /*! \brief Pop a dedicated job off the job queue and add to the processing queue ready to process
    \return the job to process, NULL if no jobs are available
    */
   CJob *PopJob();
 
+  /*! \brief Pop a job off the queue of a pooled worker, or steal it from one of the other queues
+   \param queue index of the worker's own queue
+   \return the job to process, NULL if no jobs are available
+   */
+  CJob *PopPoolJob(unsigned int queue);
+  CJob *GetNextPoolJob(const CJobWorker *worker);
+  bool ReservePoolWorker(CJob::PRIORITY priority);
+  bool FindPoolJob(const CJob *job, CWorkItem &item) const;
+  void StartPool();
+  void WakePool(bool all);
+  void ClearPoolQueues();
+  unsigned int NextJobId();
+
   void StartWorkers(CJob::PRIORITY priority);
   void RemoveWorker(const CJobWorker *worker);
-  static unsigned int GetMaxWorkers(CJob::PRIORITY priority);
+  unsigned int GetMaxWorkers(CJob::PRIORITY priority) const;
 
-  unsigned int m_jobCounter;
+  std::atomic<unsigned int> m_jobCounter;
 
   typedef std::deque<CWorkItem>    JobQueue;
   typedef std::vector<CWorkItem>   Processing;
   typedef std::vector<CJobWorker*> Workers;
 
-  JobQueue   m_jobQueue[CJob::PRIORITY_DEDICATED + 1];
-  bool       m_pauseJobs;
+  std::atomic<bool> m_pauseJobs;
+  std::atomic<bool> m_running;
+
+  // dedicated jobs and their workers
+  JobQueue   m_jobQueue;
   Processing m_processing;
   Workers    m_workers;
 
   CCriticalSection m_section;
   CEvent           m_jobEvent;
-  bool             m_running;
+
+  // worker pool for all other jobs, started on demand
+  unsigned int m_workerCount;
+  std::vector<std::unique_ptr<CWorkerQueue> > m_queues;
+  Workers m_pool;
+  std::atomic<bool> m_poolStarted;
+  std::atomic<unsigned int> m_nextQueue;
+  std::atomic<unsigned int> m_poolProcessing;
+
+  // idle pooled workers sleep until the generation changes
+  std::atomic<unsigned int> m_poolGeneration;
+  std::atomic<unsigned int> m_idleWorkers;
+  CCriticalSection m_poolSection;
+  XbmcThreads::ConditionVariable m_poolCondition;
 };
@@ -0,0 +1,87 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "Parallel.h"
+
+#include <atomic>
+#include <memory>
+
+#include "threads/Event.h"
+#include "utils/JobManager.h"
+
+namespace
+{
+// shared with the jobs, which may only get to run after ParallelFor() returned
+struct SParallelFor
+{
+  SParallelFor(size_t parts, const std::function<void(size_t)> &work)
+    : m_parts(parts), m_work(work), m_next(0), m_done(0), m_finished(true)
+  {
+  }
+
+  // takes parts until there are none left
+  void Run()
+  {
+    size_t part;
+    while ((part = m_next++) < m_parts)
+    {
+      // the caller waits for every part taken, so m_work is still valid here
+      m_work(part);
+      if (++m_done == m_parts)
+        m_finished.Set();
+    }
+  }
+
+  const size_t m_parts;
+  const std::function<void(size_t)> &m_work;
+  std::atomic<size_t> m_next;
+  std::atomic<size_t> m_done;
+  CEvent m_finished;
+};
+}
+
+namespace KODI
+{
+namespace UTILS
+{
+size_t GetParallelism()
+{
+  return CJobManager::GetInstance().GetWorkerCount() + 1;
+}
+
+void ParallelFor(size_t parts, const std::function<void(size_t part)> &work)
+{
+  if (parts <= 1)
+  {
+    if (parts == 1)
+      work(0);
+    return;
+  }
+
+  std::shared_ptr<SParallelFor> state(new SParallelFor(parts, work));
+  size_t jobs = std::min(parts, GetParallelism()) - 1;
+  for (size_t i = 0; i < jobs; i++)
+    CJobManager::GetInstance().Submit([state]() { state->Run(); }, CJob::PRIORITY_HIGH);
+
+  state->Run();
+  state->m_finished.Wait();
+}
+}
+}
@@ -0,0 +1,109 @@
+#pragma once
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+namespace KODI
+{
+namespace UTILS
+{
+/*!
+ \brief Number of parts worth splitting work into: one per pooled worker of the job manager plus the caller
+ */
+size_t GetParallelism();
+
+/*!
+ \brief Runs work(part) for every part in [0, parts) on the job manager's pool and waits for all of them
+
+ The calling thread takes parts as well, so all of them are done even if no
+ worker is free (or the job manager isn't running) and it's safe to call from
+ a job. Parts must not depend on each other.
+ */
+void ParallelFor(size_t parts, const std::function<void(size_t part)> &work);
+
+/*!
+ \brief Calls func for every element in [begin, end), splitting the range over the job manager's pool
+ \sa ParallelFor()
+ */
+template<class TIterator, class TFunc>
+void ParallelForEach(TIterator begin, TIterator end, TFunc func)
+{
+  const size_t count = std::distance(begin, end);
+  const size_t parts = std::min(count, GetParallelism());
+  ParallelFor(parts, [&](size_t part)
+  {
+    std::for_each(begin + count * part / parts, begin + count * (part + 1) / parts, func);
+  });
+}
+
+/*!
+ \brief Sorts [begin, end) by sorting a part of it on each worker of the job manager's pool and merging them
+
+ Parts are merged pairwise in rounds, each round in parallel as well. The
+ result is the same as that of std::stable_sort() with the same comparison.
+ */
+template<class TIterator, class TLess>
+void ParallelSort(TIterator begin, TIterator end, TLess less)
+{
+  typedef typename std::iterator_traits<TIterator>::value_type Value;
+
+  const size_t count = std::distance(begin, end);
+  const size_t parts = std::min(count, GetParallelism());
+  if (parts <= 1)
+  {
+    std::stable_sort(begin, end, less);
+    return;
+  }
+
+  std::vector<size_t> bounds(parts + 1);
+  for (size_t part = 0; part <= parts; part++)
+    bounds[part] = count * part / parts;
+
+  std::vector<Value> source(std::make_move_iterator(begin), std::make_move_iterator(end));
+  std::vector<Value> target(count);
+
+  ParallelFor(parts, [&](size_t part)
+  {
+    std::stable_sort(source.begin() + bounds[part], source.begin() + bounds[part + 1], less);
+  });
+
+  // merge runs of width parts into runs of twice the width until there's a single one
+  for (size_t width = 1; width < parts; width *= 2)
+  {
+    ParallelFor((parts + 2 * width - 1) / (2 * width), [&](size_t pair)
+    {
+      size_t first = bounds[2 * width * pair];
+      size_t middle = bounds[std::min(2 * width * pair + width, parts)];
+      size_t last = bounds[std::min(2 * width * pair + 2 * width, parts)];
+      std::merge(std::make_move_iterator(source.begin() + first), std::make_move_iterator(source.begin() + middle),
+                 std::make_move_iterator(source.begin() + middle), std::make_move_iterator(source.begin() + last),
+                 target.begin() + first, less);
+    });
+    source.swap(target);
+  }
+
+  std::move(source.begin(), source.end(), begin);
+}
+}
+}
@@ -0,0 +1,319 @@
+#pragma once
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
+#include "threads/SingleLock.h"
+#include "utils/JobManager.h"
+
+/*!
+ \brief Runs work for a caller ahead of time on a bounded number of jobs
+
+ Every piece of work is queued under a key and run on the job manager, at most
+ jobsAtOnce of them at the same time and in the order they were queued. The
+ caller picks the results up with Take() in whatever order it needs them,
+ waiting for those which aren't done yet. This lets a single thread keep
+ ownership of everything which isn't thread safe (database, GUI) while the
+ slow parts (listing directories, scraping, reading tags) run in parallel.
+
+ Work is run as PRIORITY_DEDICATED jobs so it can't be starved by the caller
+ itself, which usually is a job waiting for the results.
+
+ \sa CJobQueue
+ */
+template<typename T>
+class CPrefetchQueue : private CJobQueue
+{
+public:
+  typedef std::function<void(T&)> Work;
+
+  explicit CPrefetchQueue(unsigned int jobsAtOnce)
+    : CJobQueue(false, jobsAtOnce, CJob::PRIORITY_DEDICATED)
+    , m_state(new SState)
+  {
+  }
+
+  virtual ~CPrefetchQueue()
+  {
+    Cancel();
+  }
+
+  /*!
+   \brief Queue work to be run as soon as a job is available
+   \param key identifies the result for Take()
+   \param work fills in the result, it must not access anything the caller may change meanwhile
+   \return false if work for this key is queued already or the queue was cancelled
+   */
+  bool Queue(const std::string &key, const Work &work)
+  {
+    ResultPtr result(new SResult);
+    {
+      CSingleLock lock(m_state->critical);
+      if (m_state->cancelled || m_results.find(key) != m_results.end())
+        return false;
+      m_results.insert(std::make_pair(key, result));
+    }
+    AddJob(new CPrefetchJob(m_state, result, work));
+    return true;
+  }
+
+  /*!
+   \brief Whether work for the key was queued and not taken yet
+   */
+  bool IsQueued(const std::string &key) const
+  {
+    CSingleLock lock(m_state->critical);
+    return m_results.find(key) != m_results.end();
+  }
+
+  /*!
+   \brief Whether Take() would return right away for the key, as its work finished or nothing was queued
+   */
+  bool IsFinished(const std::string &key) const
+  {
+    CSingleLock lock(m_state->critical);
+    typename ResultMap::const_iterator it = m_results.find(key);
+    return it == m_results.end() || it->second->finished || it->second->dropped;
+  }
+
+  /*!
+   \brief Get the result of the work queued for a key, waiting for it to finish if needed
+   \return false if nothing was queued for the key, the caller has to do the work itself then
+   */
+  bool Take(const std::string &key, T &value)
+  {
+    ResultPtr result;
+    {
+      CSingleLock lock(m_state->critical);
+      typename ResultMap::iterator it = m_results.find(key);
+      if (it == m_results.end())
+        return false;
+      result = it->second;
+      m_results.erase(it);
+    }
+
+    result->done.Wait();
+    if (!result->finished)
+      return false;
+
+    value = std::move(result->value);
+    return true;
+  }
+
+  /*!
+   \brief Whether TakeAny() would return right away, as some work finished or nothing is queued
+   */
+  bool IsAnyFinished() const
+  {
+    CSingleLock lock(m_state->critical);
+    for (typename ResultMap::const_iterator it = m_results.begin(); it != m_results.end(); ++it)
+    {
+      if (it->second->finished || it->second->dropped)
+        return true;
+    }
+    return m_results.empty();
+  }
+
+  /*!
+   \brief Get the result of any finished work, waiting for one if none is finished yet
+   For callers which don't depend on the order, so results never pile up behind slow work.
+   Work which was dropped without being run is skipped.
+   \param key [out] the key the work was queued under
+   \return false if nothing is queued
+   */
+  bool TakeAny(std::string &key, T &value)
+  {
+    CSingleLock lock(m_state->critical);
+    while (!m_results.empty())
+    {
+      bool dropped = false;
+      for (typename ResultMap::iterator it = m_results.begin(); it != m_results.end(); ++it)
+      {
+        if (it->second->dropped)
+        {
+          m_results.erase(it);
+          dropped = true;
+          break;
+        }
+
+        if (it->second->finished)
+        {
+          ResultPtr result = it->second;
+          key = it->first;
+          m_results.erase(it);
+          lock.Leave();
+
+          value = std::move(result->value);
+          return true;
+        }
+      }
+
+      if (dropped)
+        continue;
+
+      lock.Leave();
+      m_state->finished.Wait();
+      lock.Enter();
+    }
+    return false;
+  }
+
+  /*!
+   \brief Number of results which weren't taken yet, finished or not
+   */
+  size_t GetCount() const
+  {
+    CSingleLock lock(m_state->critical);
+    return m_results.size();
+  }
+
+  /*!
+   \brief Drop all results and work which didn't start yet, waits for the running work to finish
+   Must be called from the thread taking the results.
+   */
+  void Cancel()
+  {
+    CSingleLock lock(m_state->critical);
+    m_state->cancelled = true;
+    lock.Leave();
+
+    CancelJobs();
+
+    lock.Enter();
+    while (m_state->running > 0)
+    {
+      lock.Leave();
+      m_state->idle.WaitMSec(100);
+      lock.Enter();
+    }
+
+    // wake up anyone still waiting for work which won't be run anymore
+    for (typename ResultMap::iterator it = m_results.begin(); it != m_results.end(); ++it)
+      it->second->done.Set();
+    m_results.clear();
+  }
+
+  /*!
+   \brief Accept work again after Cancel()
+   */
+  void Reset()
+  {
+    CSingleLock lock(m_state->critical);
+    m_state->cancelled = false;
+  }
+
+private:
+  struct SResult
+  {
+    SResult() : done(true), finished(false), dropped(false) {}
+    T value;
+    CEvent done;
+    bool finished;
+    bool dropped;                      /**< the job was deleted without running the work */
+  };
+  typedef std::shared_ptr<SResult> ResultPtr;
+  typedef std::map<std::string, ResultPtr> ResultMap;
+
+  //! shared with the jobs, a cancelled job may still be started after the queue is gone
+  struct SState
+  {
+    SState() : running(0), cancelled(false) {}
+    unsigned int running;
+    bool cancelled;
+    CEvent idle;
+    CEvent finished;                   /**< set whenever some work finished or was dropped */
+    CCriticalSection critical;
+  };
+  typedef std::shared_ptr<SState> StatePtr;
+
+  class CPrefetchJob : public CJob
+  {
+  public:
+    CPrefetchJob(const StatePtr &state, const ResultPtr &result, const Work &work)
+      : m_state(state), m_result(result), m_work(work), m_ran(false)
+    {
+    }
+
+    // the job manager and CJobQueue delete jobs they cancel without running them
+    virtual ~CPrefetchJob()
+    {
+      if (!m_ran)
+        Drop();
+    }
+
+    virtual const char *GetType() const { return "prefetch"; }
+
+    // CJobQueue finds the job it's processing by comparing, every piece of work is distinct
+    virtual bool operator==(const CJob* job) const { return job == this; }
+
+    virtual bool DoWork()
+    {
+      if (!BeginWork())
+        return false;
+
+      m_work(m_result->value);
+      EndWork();
+      return true;
+    }
+
+  private:
+    bool BeginWork()
+    {
+      CSingleLock lock(m_state->critical);
+      if (m_state->cancelled)
+        return false;
+      m_state->running++;
+      m_ran = true;
+      return true;
+    }
+
+    void Drop()
+    {
+      CSingleLock lock(m_state->critical);
+      m_result->dropped = true;
+      m_result->done.Set();
+      m_state->finished.Set();
+    }
+
+    void EndWork()
+    {
+      CSingleLock lock(m_state->critical);
+      m_result->finished = true;
+      m_result->done.Set();
+      m_state->finished.Set();
+      if (--m_state->running == 0)
+        m_state->idle.Set();
+    }
+
+    StatePtr m_state;
+    ResultPtr m_result;
+    Work m_work;
+    bool m_ran;
+  };
+
+  StatePtr m_state;
+  ResultMap m_results;
+};
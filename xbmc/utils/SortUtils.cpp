@@ -24,6 +24,7 @@
 #include "Util.h"
 #include "XBDateTime.h"
 #include "utils/CharsetConverter.h"
+#include "utils/Parallel.h"
 #include "utils/StringUtils.h"
 #include "utils/Variant.h"
 
@@ -416,130 +417,76 @@ std::string ByLastUsed(SortAttribute attributes, const SortItem &values)
   return values.at(FieldLastUsed).asString();
 }
 
-bool preliminarySort(const SortItem &left, const SortItem &right, bool handleFolder, bool &result, std::wstring &labelLeft, std::wstring &labelRight)
+/*!
+ \brief The keys of the items to sort, each in an array of its own
+
+ Comparing items looked the keys up in their maps and copied the labels out
+ of their variants every time, which is where sorting spent most of its time.
+ The keys are extracted once instead and an index permutation is sorted.
+ */
+struct SortKeys
 {
-  // make sure both items have the necessary data to do the sorting
-  SortItem::const_iterator itLeftSort, itRightSort;
-  if ((itLeftSort = left.find(FieldSort)) == left.end())
-  {
-    result = false;
-    return true;
-  }
-  if ((itRightSort = right.find(FieldSort)) == right.end())
-  {
-    result = true;
-    return true;
-  }
+  std::vector<std::wstring> labels;
+  std::vector<std::string> collated;  ///< keys of the labels if the locale allows it, see StringUtils::AlphaNumericSortKeys()
+  std::vector<SortSpecial> specials;
+  std::vector<int> folders;           ///< 1 for folders, 0 for files, -1 if unknown
+};
 
-  // look at special sorting behaviour
-  SortItem::const_iterator itLeft, itRight;
-  SortSpecial leftSortSpecial = SortSpecialNone;
-  SortSpecial rightSortSpecial = SortSpecialNone;
-  if ((itLeft = left.find(FieldSortSpecial)) != left.end() && itLeft->second.asInteger() <= (int64_t)SortSpecialOnBottom)
-    leftSortSpecial = (SortSpecial)itLeft->second.asInteger();
-  if ((itRight = right.find(FieldSortSpecial)) != right.end() && itRight->second.asInteger() <= (int64_t)SortSpecialOnBottom)
-    rightSortSpecial = (SortSpecial)itRight->second.asInteger();
-  
-  // one has a special sort
-  if (leftSortSpecial != rightSortSpecial)
-  {
-    // left should be sorted on top
-    // or right should be sorted on bottom
-    // => left is sorted above right
-    if (leftSortSpecial == SortSpecialOnTop ||
-        rightSortSpecial == SortSpecialOnBottom)
-    {
-      result = true;
-      return true;
-    }
-    
-    // otherwise right is sorted above left
-    result = false;
-    return true;
-  }
-  // both have either sort on top or sort on bottom -> leave as-is
-  else if (leftSortSpecial != SortSpecialNone && leftSortSpecial == rightSortSpecial)
+class SortKeyLess
+{
+public:
+  SortKeyLess(const SortKeys &keys, bool handleFolders, bool descending)
+    : m_keys(keys), m_handleFolders(handleFolders), m_descending(descending)
   {
-    result = false;
-    return true;
   }
 
-  if (handleFolder)
+  bool operator()(size_t left, size_t right) const
   {
-    itLeft = left.find(FieldFolder);
-    itRight = right.find(FieldFolder);
-    if (itLeft != left.end() && itRight != right.end() &&
-        itLeft->second.asBoolean() != itRight->second.asBoolean())
-    {
-      result = itLeft->second.asBoolean();
-      return true;
-    }
-  }
+    SortSpecial leftSpecial = m_keys.specials[left];
+    SortSpecial rightSpecial = m_keys.specials[right];
 
-  labelLeft = itLeftSort->second.asWideString();
-  labelRight = itRightSort->second.asWideString();
+    // items sorted on top come first and the ones sorted on bottom last, no matter the order
+    if (leftSpecial != rightSpecial)
+      return leftSpecial == SortSpecialOnTop || rightSpecial == SortSpecialOnBottom;
 
-  return false;
-}
-
-bool SorterAscending(const SortItem &left, const SortItem &right)
-{
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, true, result, labelLeft, labelRight))
-    return result;
-
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) < 0;
-}
-
-bool SorterDescending(const SortItem &left, const SortItem &right)
-{
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, true, result, labelLeft, labelRight))
-    return result;
-
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) > 0;
-}
-
-bool SorterIgnoreFoldersAscending(const SortItem &left, const SortItem &right)
-{
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, false, result, labelLeft, labelRight))
-    return result;
-
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) < 0;
-}
-
-bool SorterIgnoreFoldersDescending(const SortItem &left, const SortItem &right)
-{
-  bool result;
-  std::wstring labelLeft, labelRight;
-  if (preliminarySort(left, right, false, result, labelLeft, labelRight))
-    return result;
-
-  return StringUtils::AlphaNumericCompare(labelLeft.c_str(), labelRight.c_str()) > 0;
-}
+    if (leftSpecial == SortSpecialNone)
+    {
+      if (m_handleFolders)
+      {
+        int leftFolder = m_keys.folders[left];
+        int rightFolder = m_keys.folders[right];
+        if (leftFolder >= 0 && rightFolder >= 0 && leftFolder != rightFolder)
+          return leftFolder > rightFolder;
+      }
 
-bool SorterIndirectAscending(const SortItemPtr &left, const SortItemPtr &right)
-{
-  return SorterAscending(*left, *right);
-}
+      int64_t result;
+      if (!m_keys.collated.empty())
+        result = m_keys.collated[left].compare(m_keys.collated[right]);
+      else
+        result = StringUtils::AlphaNumericCompare(m_keys.labels[left].c_str(), m_keys.labels[right].c_str());
+      if (result != 0)
+        return m_descending ? result > 0 : result < 0;
+    }
 
-bool SorterIndirectDescending(const SortItemPtr &left, const SortItemPtr &right)
-{
-  return SorterDescending(*left, *right);
-}
+    // equal items keep their order
+    return left < right;
+  }
 
-bool SorterIndirectIgnoreFoldersAscending(const SortItemPtr &left, const SortItemPtr &right)
-{
-  return SorterIgnoreFoldersAscending(*left, *right);
-}
+private:
+  const SortKeys &m_keys;
+  bool m_handleFolders;
+  bool m_descending;
+};
 
-bool SorterIndirectIgnoreFoldersDescending(const SortItemPtr &left, const SortItemPtr &right)
+// number of items at the start which end up within the limits and have to be sorted
+static size_t GetSortedCount(size_t count, int limitEnd, int limitStart)
 {
-  return SorterIgnoreFoldersDescending(*left, *right);
+  if (limitEnd <= 0 || (size_t)limitEnd >= count)
+    return count;
+  // an end before the start is ignored
+  if (limitStart > 0 && (size_t)limitStart < count && limitEnd <= limitStart)
+    return count;
+  return limitEnd;
 }
 
 std::map<SortBy, SortUtils::SortPreparator> fillPreparators()
@@ -691,32 +638,19 @@ std::map<SortBy, Fields> SortUtils::m_sortingFields = fillSortingFields();
 
 void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, DatabaseResults& items, int limitEnd /* = -1 */, int limitStart /* = 0 */)
 {
-  if (sortBy != SortByNone)
-  {
-    // get the matching SortPreparator
-    SortPreparator preparator = getPreparator(sortBy);
-    if (preparator != NULL)
-    {
-      Fields sortingFields = GetFieldsForSorting(sortBy);
-
-      // Prepare the string used for sorting and store it under FieldSort
-      for (DatabaseResults::iterator item = items.begin(); item != items.end(); ++item)
-      {
-        // add all fields to the item that are required for sorting if they are currently missing
-        for (Fields::const_iterator field = sortingFields.begin(); field != sortingFields.end(); ++field)
-        {
-          if (item->find(*field) == item->end())
-            item->insert(std::pair<Field, CVariant>(*field, CVariant::ConstNullVariant));
-        }
-
-        std::wstring sortLabel;
-        g_charsetConverter.utf8ToW(preparator(attributes, *item), sortLabel, false);
-        item->insert(std::pair<Field, CVariant>(FieldSort, CVariant(sortLabel)));
-      }
+  std::vector<SortItem*> sortItems;
+  sortItems.reserve(items.size());
+  for (DatabaseResults::iterator item = items.begin(); item != items.end(); ++item)
+    sortItems.push_back(&*item);
 
-      // Do the sorting
-      std::stable_sort(items.begin(), items.end(), getSorter(sortOrder, attributes));
-    }
+  std::vector<size_t> order;
+  if (getSortOrder(sortBy, sortOrder, attributes, sortItems, GetSortedCount(items.size(), limitEnd, limitStart), false, order))
+  {
+    DatabaseResults sorted;
+    sorted.reserve(items.size());
+    for (std::vector<size_t>::const_iterator index = order.begin(); index != order.end(); ++index)
+      sorted.push_back(std::move(items[*index]));
+    items.swap(sorted);
   }
 
   if (limitStart > 0 && (size_t)limitStart < items.size())
@@ -730,32 +664,25 @@ void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attribute
 
 void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd /* = -1 */, int limitStart /* = 0 */)
 {
-  if (sortBy != SortByNone)
-  {
-    // get the matching SortPreparator
-    SortPreparator preparator = getPreparator(sortBy);
-    if (preparator != NULL)
-    {
-      Fields sortingFields = GetFieldsForSorting(sortBy);
+  sortItems(sortBy, sortOrder, attributes, items, limitEnd, limitStart, 0);
+}
 
-      // Prepare the string used for sorting and store it under FieldSort
-      for (SortItems::iterator item = items.begin(); item != items.end(); ++item)
-      {
-        // add all fields to the item that are required for sorting if they are currently missing
-        for (Fields::const_iterator field = sortingFields.begin(); field != sortingFields.end(); ++field)
-        {
-          if ((*item)->find(*field) == (*item)->end())
-            (*item)->insert(std::pair<Field, CVariant>(*field, CVariant::ConstNullVariant));
-        }
-
-        std::wstring sortLabel;
-        g_charsetConverter.utf8ToW(preparator(attributes, **item), sortLabel, false);
-        (*item)->insert(std::pair<Field, CVariant>(FieldSort, CVariant(sortLabel)));
-      }
+void SortUtils::sortItems(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd, int limitStart, size_t parallelThreshold)
+{
+  std::vector<SortItem*> pointers;
+  pointers.reserve(items.size());
+  for (SortItems::iterator item = items.begin(); item != items.end(); ++item)
+    pointers.push_back(item->get());
 
-      // Do the sorting
-      std::stable_sort(items.begin(), items.end(), getSorterIndirect(sortOrder, attributes));
-    }
+  std::vector<size_t> order;
+  bool parallel = parallelThreshold > 0 && items.size() >= parallelThreshold;
+  if (getSortOrder(sortBy, sortOrder, attributes, pointers, GetSortedCount(items.size(), limitEnd, limitStart), parallel, order))
+  {
+    SortItems sorted;
+    sorted.reserve(items.size());
+    for (std::vector<size_t>::const_iterator index = order.begin(); index != order.end(); ++index)
+      sorted.push_back(std::move(items[*index]));
+    items.swap(sorted);
   }
 
   if (limitStart > 0 && (size_t)limitStart < items.size())
@@ -777,6 +704,11 @@ void SortUtils::Sort(const SortDescription &sortDescription, SortItems& items)
   Sort(sortDescription.sortBy, sortDescription.sortOrder, sortDescription.sortAttributes, items, sortDescription.limitEnd, sortDescription.limitStart);
 }
 
+void SortUtils::Sort(const SortDescription &sortDescription, SortItems& items, size_t parallelThreshold)
+{
+  sortItems(sortDescription.sortBy, sortDescription.sortOrder, sortDescription.sortAttributes, items, sortDescription.limitEnd, sortDescription.limitStart, parallelThreshold);
+}
+
 bool SortUtils::SortFromDataset(const SortDescription &sortDescription, const MediaType &mediaType, const std::unique_ptr<dbiplus::Dataset> &dataset, DatabaseResults &results)
 {
   FieldList fields;
@@ -807,20 +739,72 @@ const SortUtils::SortPreparator& SortUtils::getPreparator(SortBy sortBy)
   return m_preparators[SortByNone];
 }
 
-SortUtils::Sorter SortUtils::getSorter(SortOrder sortOrder, SortAttribute attributes)
+bool SortUtils::getSortOrder(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, const std::vector<SortItem*> &items, size_t sortedCount, bool parallel, std::vector<size_t> &order)
 {
-  if (attributes & SortAttributeIgnoreFolders)
-    return sortOrder == SortOrderDescending ? SorterIgnoreFoldersDescending : SorterIgnoreFoldersAscending;
+  if (sortBy == SortByNone)
+    return false;
 
-  return sortOrder == SortOrderDescending ? SorterDescending : SorterAscending;
-}
+  // get the matching SortPreparator
+  SortPreparator preparator = getPreparator(sortBy);
+  if (preparator == NULL)
+    return false;
 
-SortUtils::SorterIndirect SortUtils::getSorterIndirect(SortOrder sortOrder, SortAttribute attributes)
-{
-  if (attributes & SortAttributeIgnoreFolders)
-    return sortOrder == SortOrderDescending ? SorterIndirectIgnoreFoldersDescending : SorterIndirectIgnoreFoldersAscending;
+  const Fields &sortingFields = GetFieldsForSorting(sortBy);
+
+  SortKeys keys;
+  keys.labels.resize(items.size());
+  keys.specials.resize(items.size(), SortSpecialNone);
+  keys.folders.resize(items.size(), -1);
+  auto prepare = [&](size_t i)
+  {
+    SortItem &item = *items[i];
+
+    // add all fields to the item that are required for sorting if they are currently missing
+    for (Fields::const_iterator field = sortingFields.begin(); field != sortingFields.end(); ++field)
+    {
+      if (item.find(*field) == item.end())
+        item.insert(std::pair<Field, CVariant>(*field, CVariant::ConstNullVariant));
+    }
+
+    // Prepare the string used for sorting and store it under FieldSort
+    std::wstring sortLabel;
+    g_charsetConverter.utf8ToW(preparator(attributes, item), sortLabel, false);
+    keys.labels[i] = item.insert(std::pair<Field, CVariant>(FieldSort, CVariant(std::move(sortLabel)))).first->second.asWideString();
+
+    SortItem::const_iterator it = item.find(FieldSortSpecial);
+    if (it != item.end() && it->second.asInteger() <= (int64_t)SortSpecialOnBottom)
+      keys.specials[i] = (SortSpecial)it->second.asInteger();
+
+    it = item.find(FieldFolder);
+    if (it != item.end())
+      keys.folders[i] = it->second.asBoolean() ? 1 : 0;
+  };
 
-  return sortOrder == SortOrderDescending ? SorterIndirectDescending : SorterIndirectAscending;
+  order.resize(items.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+
+  // every item only touches its own keys, so they can be prepared in parts side by side,
+  // except when sorting randomly as CUtil::GetRandomNumber() shares its seed
+  if (parallel && sortBy != SortByRandom)
+    KODI::UTILS::ParallelForEach(order.begin(), order.end(), prepare);
+  else
+    std::for_each(order.begin(), order.end(), prepare);
+
+  // compare the labels by keys made once rather than by walking them through the locale every time
+  if (!StringUtils::AlphaNumericSortKeys(keys.labels, keys.collated))
+    keys.collated.clear();
+
+  // every item is distinct for the comparison, so the result is the same as that of a stable sort
+  SortKeyLess less(keys, !(attributes & SortAttributeIgnoreFolders), sortOrder == SortOrderDescending);
+  if (sortedCount < order.size())
+    std::partial_sort(order.begin(), order.begin() + sortedCount, order.end(), less);
+  else if (parallel)
+    KODI::UTILS::ParallelSort(order.begin(), order.end(), less);
+  else
+    std::sort(order.begin(), order.end(), less);
+
+  return true;
 }
 
 const Fields& SortUtils::GetFieldsForSorting(SortBy sortBy)
@@ -210,19 +210,29 @@ public:
   static void Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd = -1, int limitStart = 0);
   static void Sort(const SortDescription &sortDescription, DatabaseResults& items);
   static void Sort(const SortDescription &sortDescription, SortItems& items);
+  /*! \brief Sort the items, preparing and sorting them on the job manager's pool if there are many of them
+   The order is the same as that of sorting them on the calling thread.
+   \param parallelThreshold number of items from which on they're sorted in parallel, 0 to never do so
+   */
+  static void Sort(const SortDescription &sortDescription, SortItems& items, size_t parallelThreshold);
   static bool SortFromDataset(const SortDescription &sortDescription, const MediaType &mediaType, const std::unique_ptr<dbiplus::Dataset> &dataset, DatabaseResults &results);
   
   static const Fields& GetFieldsForSorting(SortBy sortBy);
   static std::string RemoveArticles(const std::string &label);
   
   typedef std::string (*SortPreparator) (SortAttribute, const SortItem&);
-  typedef bool (*Sorter) (const DatabaseResult &, const DatabaseResult &);
-  typedef bool (*SorterIndirect) (const SortItemPtr &, const SortItemPtr &);
   
 private:
   static const SortPreparator& getPreparator(SortBy sortBy);
-  static Sorter getSorter(SortOrder sortOrder, SortAttribute attributes);
-  static SorterIndirect getSorterIndirect(SortOrder sortOrder, SortAttribute attributes);
+
+  /*! \brief Prepare the sort labels of the items and get the order they're sorted in
+   \param sortedCount number of items at the start of the order which have to be sorted, the rest is left in any order
+   \param parallel whether to prepare and sort the items on the job manager's pool
+   \param order [out] indices of the items in sorted order
+   \return false if the items aren't sorted by anything
+   */
+  static bool getSortOrder(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, const std::vector<SortItem*> &items, size_t sortedCount, bool parallel, std::vector<size_t> &order);
+  static void sortItems(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd, int limitStart, size_t parallelThreshold);
 
   static std::map<SortBy, SortPreparator> m_preparators;
   static std::map<SortBy, Fields> m_sortingFields;
@@ -40,6 +40,7 @@
 #include "Util.h"
 #include <functional>
 #include <array>
+#include <unordered_map>
 #include <assert.h>
 #include <math.h>
 #include <time.h>
@@ -878,6 +879,92 @@ int64_t StringUtils::AlphaNumericCompare(const wchar_t *left, const wchar_t *rig
   return 0; // files are the same
 }
 
+// AlphaNumericCompare() compares characters with ascii letters in lower case
+static inline wchar_t AlphaNumericChar(wchar_t c)
+{
+  return (c >= L'A' && c <= L'Z') ? c + (L'a' - L'A') : c;
+}
+
+static inline void AppendSortKeyBytes(std::string &key, uint64_t value, int bytes)
+{
+  for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+    key += (char)((value >> shift) & 0xff);
+}
+
+bool StringUtils::AlphaNumericSortKeys(const std::vector<std::wstring> &labels, std::vector<std::string> &keys)
+{
+  const std::collate<wchar_t>& coll = std::use_facet<std::collate<wchar_t> >(g_langInfo.GetSystemLocale());
+  auto collLess = [&coll](wchar_t left, wchar_t right) { return coll.compare(&left, &left + 1, &right, &right + 1) < 0; };
+
+  // rank every character of the labels by the collation, characters collating equally get the same rank
+  std::unordered_map<wchar_t, uint32_t> ranks;
+  std::vector<wchar_t> chars;
+  for (wchar_t digit = L'0'; digit <= L'9'; digit++)
+  {
+    ranks[digit] = 0;
+    chars.push_back(digit);
+  }
+  for (std::vector<std::wstring>::const_iterator label = labels.begin(); label != labels.end(); ++label)
+  {
+    for (std::wstring::const_iterator c = label->begin(); c != label->end(); ++c)
+    {
+      if (ranks.insert(std::make_pair(AlphaNumericChar(*c), 0)).second)
+        chars.push_back(AlphaNumericChar(*c));
+    }
+  }
+  std::sort(chars.begin(), chars.end(), collLess);
+
+  uint32_t rank = 0;
+  for (size_t i = 0; i < chars.size(); i++)
+  {
+    if (i > 0 && collLess(chars[i - 1], chars[i]))
+      rank++;
+    ranks[chars[i]] = rank;
+  }
+
+  // a digit compared to anything but a digit is compared like any other character, which a key can only
+  // express if no other character collates in between or equal to the digits
+  uint32_t firstDigit = ranks[L'0'], lastDigit = ranks[L'0'];
+  for (wchar_t digit = L'1'; digit <= L'9'; digit++)
+  {
+    firstDigit = std::min(firstDigit, ranks[digit]);
+    lastDigit = std::max(lastDigit, ranks[digit]);
+  }
+  for (std::vector<wchar_t>::const_iterator c = chars.begin(); c != chars.end(); ++c)
+  {
+    if ((*c < L'0' || *c > L'9') && ranks[*c] >= firstDigit && ranks[*c] <= lastDigit)
+      return false;
+  }
+
+  // a character is its rank, a number the rank of the digits followed by its value
+  const int rankBytes = rank < 0x100 ? 1 : (rank < 0x10000 ? 2 : 3);
+  keys.resize(labels.size());
+  for (size_t i = 0; i < labels.size(); i++)
+  {
+    std::string &key = keys[i];
+    key.clear();
+    key.reserve(labels[i].size() * rankBytes);
+    const wchar_t *c = labels[i].c_str();
+    while (*c != 0)
+    {
+      if (*c >= L'0' && *c <= L'9')
+      {
+        // numbers are compared up to 15 digits at a time, which fit in 7 bytes
+        const wchar_t *end = c + 15;
+        uint64_t number = 0;
+        while (*c >= L'0' && *c <= L'9' && c < end)
+          number = number * 10 + (*c++ - L'0');
+        AppendSortKeyBytes(key, firstDigit, rankBytes);
+        AppendSortKeyBytes(key, number, 7);
+      }
+      else
+        AppendSortKeyBytes(key, ranks[AlphaNumericChar(*c++)], rankBytes);
+    }
+  }
+
+  return true;
+}
+
 int StringUtils::DateStringToYYYYMMDD(const std::string &dateString)
 {
   std::vector<std::string> days = StringUtils::Split(dateString, '-');
@@ -155,6 +155,17 @@ public:
   static std::vector<std::string> SplitMulti(const std::vector<std::string> &input, const std::vector<std::string> &delimiters, unsigned int iMaxStrings = 0);
   static int FindNumber(const std::string& strInput, const std::string &strFind);
   static int64_t AlphaNumericCompare(const wchar_t *left, const wchar_t *right);
+  /*! \brief Turns labels into keys which compare like AlphaNumericCompare() compares the labels
+   The keys compare byte by byte (std::string::compare(), memcmp() and a length check), which is a lot
+   cheaper than comparing the labels character by character using the collation of the system locale.
+   The characters are ranked among those of all labels given, so keys can only be compared to keys
+   made by the same call.
+   \param labels the labels to make keys for
+   \param keys [out] the key of every label
+   \return false if the collation of the system locale can't be expressed by keys, labels then have to be
+   compared using AlphaNumericCompare()
+   */
+  static bool AlphaNumericSortKeys(const std::vector<std::wstring> &labels, std::vector<std::string> &keys);
   static long TimeStringToSeconds(const std::string &timeString);
   static void RemoveCRLF(std::string& strLine);
 
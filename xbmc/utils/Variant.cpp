@@ -139,6 +139,7 @@ CVariant CVariant::ConstNullVariant = CVariant::VariantTypeConstNull;
 CVariant::CVariant(VariantType type)
 {
   m_type = type;
+  m_shortLength = 0;
 
   switch (type)
   {
@@ -155,7 +156,7 @@ CVariant::CVariant(VariantType type)
       m_data.dvalue = 0.0;
       break;
     case VariantTypeString:
-      m_data.string = new std::string();
+      m_data.shortString[0] = '\0';
       break;
     case VariantTypeWideString:
       m_data.wstring = new std::wstring();
@@ -216,26 +217,22 @@ CVariant::CVariant(bool boolean)
 
 CVariant::CVariant(const char *str)
 {
-  m_type = VariantTypeString;
-  m_data.string = new std::string(str);
+  setString(str, strlen(str));
 }
 
 CVariant::CVariant(const char *str, unsigned int length)
 {
-  m_type = VariantTypeString;
-  m_data.string = new std::string(str, length);
+  setString(str, length);
 }
 
 CVariant::CVariant(const std::string &str)
 {
-  m_type = VariantTypeString;
-  m_data.string = new std::string(str);
+  setString(str.c_str(), str.size());
 }
 
 CVariant::CVariant(std::string &&str)
 {
-  m_type = VariantTypeString;
-  m_data.string = new std::string(std::move(str));
+  setString(std::move(str));
 }
 
 CVariant::CVariant(const wchar_t *str)
@@ -276,7 +273,7 @@ CVariant::CVariant(const std::map<std::string, std::string> &strMap)
   m_type = VariantTypeObject;
   m_data.map = new VariantMap;
   for (std::map<std::string, std::string>::const_iterator it = strMap.begin(); it != strMap.end(); ++it)
-    m_data.map->insert(make_pair(it->first, CVariant(it->second)));
+    m_data.map->emplace_hint(m_data.map->end(), it->first, CVariant(it->second));
 }
 
 CVariant::CVariant(const std::map<std::string, CVariant> &variantMap)
@@ -291,7 +288,7 @@ CVariant::CVariant(const CVariant &variant)
   *this = variant;
 }
 
-CVariant::CVariant(CVariant&& rhs)
+CVariant::CVariant(CVariant&& rhs) noexcept
 {
   //Set this so that operator= don't try and run cleanup
   //when we're not initialized.
@@ -310,7 +307,8 @@ void CVariant::cleanup()
   switch (m_type)
   {
   case VariantTypeString:
-    delete m_data.string;
+    if (m_shortLength == LongString)
+      delete m_data.string;
     m_data.string = nullptr;
     break;
 
@@ -400,7 +398,7 @@ int64_t CVariant::asInteger(int64_t fallback) const
     case VariantTypeDouble:
       return (int64_t)m_data.dvalue;
     case VariantTypeString:
-      return str2int64(*m_data.string, fallback);
+      return str2int64(toStdString(), fallback);
     case VariantTypeWideString:
       return str2int64(*m_data.wstring, fallback);
     default:
@@ -421,7 +419,7 @@ uint64_t CVariant::asUnsignedInteger(uint64_t fallback) const
     case VariantTypeDouble:
       return (uint64_t)m_data.dvalue;
     case VariantTypeString:
-      return str2uint64(*m_data.string, fallback);
+      return str2uint64(toStdString(), fallback);
     case VariantTypeWideString:
       return str2uint64(*m_data.wstring, fallback);
     default:
@@ -442,7 +440,7 @@ double CVariant::asDouble(double fallback) const
     case VariantTypeUnsignedInteger:
       return (double)m_data.unsignedinteger;
     case VariantTypeString:
-      return str2double(*m_data.string, fallback);
+      return str2double(toStdString(), fallback);
     case VariantTypeWideString:
       return str2double(*m_data.wstring, fallback);
     default:
@@ -463,7 +461,7 @@ float CVariant::asFloat(float fallback) const
     case VariantTypeUnsignedInteger:
       return (float)m_data.unsignedinteger;
     case VariantTypeString:
-      return (float)str2double(*m_data.string, fallback);
+      return (float)str2double(toStdString(), fallback);
     case VariantTypeWideString:
       return (float)str2double(*m_data.wstring, fallback);
     default:
@@ -486,9 +484,13 @@ bool CVariant::asBoolean(bool fallback) const
     case VariantTypeDouble:
       return (m_data.dvalue != 0);
     case VariantTypeString:
-      if (m_data.string->empty() || m_data.string->compare("0") == 0 || m_data.string->compare("false") == 0)
+    {
+      size_t length = stringSize();
+      const char *str = stringData();
+      if (length == 0 || (length == 1 && str[0] == '0') || (length == 5 && memcmp(str, "false", 5) == 0))
         return false;
       return true;
+    }
     case VariantTypeWideString:
       if (m_data.wstring->empty() || m_data.wstring->compare(L"0") == 0 || m_data.wstring->compare(L"false") == 0)
         return false;
@@ -505,7 +507,7 @@ std::string CVariant::asString(const std::string &fallback /* = "" */) const
   switch (m_type)
   {
     case VariantTypeString:
-      return *m_data.string;
+      return toStdString();
     case VariantTypeBoolean:
       return m_data.boolean ? "true" : "false";
     case VariantTypeInteger:
@@ -557,6 +559,16 @@ std::wstring CVariant::asWideString(const std::wstring &fallback /* = L"" */) co
 }
 
 CVariant &CVariant::operator[](const std::string &key)
+{
+  return findOrInsert(key, nullptr);
+}
+
+CVariant &CVariant::operator[](std::string &&key)
+{
+  return findOrInsert(key, &key);
+}
+
+CVariant &CVariant::findOrInsert(const std::string &key, std::string *movableKey)
 {
   if (m_type == VariantTypeNull)
   {
@@ -564,10 +576,25 @@ CVariant &CVariant::operator[](const std::string &key)
     m_data.map = new VariantMap;
   }
 
-  if (m_type == VariantTypeObject)
-    return (*m_data.map)[key];
-  else
+  if (m_type != VariantTypeObject)
     return ConstNullVariant;
+
+  VariantMap &members = *m_data.map;
+
+  // Objects are mostly built in key order, so try appending first
+  VariantMap::iterator it = members.end();
+  if (!members.empty() && !(members.rbegin()->first < key))
+  {
+    it = members.lower_bound(key);
+    if (it->first == key)
+      return it->second;
+  }
+
+  if (movableKey)
+    it = members.emplace_hint(it, std::move(*movableKey), CVariant());
+  else
+    it = members.emplace_hint(it, key, CVariant());
+  return it->second;
 }
 
 const CVariant &CVariant::operator[](const std::string &key) const
@@ -603,6 +630,7 @@ CVariant &CVariant::operator=(const CVariant &rhs)
   cleanup();
 
   m_type = rhs.m_type;
+  m_shortLength = 0;
 
   switch (m_type)
   {
@@ -619,16 +647,16 @@ CVariant &CVariant::operator=(const CVariant &rhs)
     m_data.dvalue = rhs.m_data.dvalue;
     break;
   case VariantTypeString:
-    m_data.string = new std::string(*rhs.m_data.string);
+    setString(rhs.stringData(), rhs.stringSize());
     break;
   case VariantTypeWideString:
     m_data.wstring = new std::wstring(*rhs.m_data.wstring);
     break;
   case VariantTypeArray:
-    m_data.array = new VariantArray(rhs.m_data.array->begin(), rhs.m_data.array->end());
+    m_data.array = new VariantArray(*rhs.m_data.array);
     break;
   case VariantTypeObject:
-    m_data.map = new VariantMap(rhs.m_data.map->begin(), rhs.m_data.map->end());
+    m_data.map = new VariantMap(*rhs.m_data.map);
     break;
   default:
     break;
@@ -637,7 +665,7 @@ CVariant &CVariant::operator=(const CVariant &rhs)
   return *this;
 }
 
-CVariant& CVariant::operator=(CVariant&& rhs)
+CVariant& CVariant::operator=(CVariant&& rhs) noexcept
 {
   if (m_type == VariantTypeConstNull || this == &rhs)
     return *this;
@@ -648,6 +676,7 @@ CVariant& CVariant::operator=(CVariant&& rhs)
 
   m_type = rhs.m_type;
   m_data = std::move(rhs.m_data);
+  m_shortLength = rhs.m_shortLength;
 
   //Should be enough to just set m_type here
   //but better safe than sorry, could probably lead to coverity warnings
@@ -680,7 +709,7 @@ bool CVariant::operator==(const CVariant &rhs) const
     case VariantTypeDouble:
       return m_data.dvalue == rhs.m_data.dvalue;
     case VariantTypeString:
-      return *m_data.string == *rhs.m_data.string;
+      return stringSize() == rhs.stringSize() && memcmp(stringData(), rhs.stringData(), stringSize()) == 0;
     case VariantTypeWideString:
       return *m_data.wstring == *rhs.m_data.wstring;
     case VariantTypeArray:
@@ -732,21 +761,16 @@ void CVariant::append(CVariant&& variant)
 const char *CVariant::c_str() const
 {
   if (m_type == VariantTypeString)
-    return m_data.string->c_str();
+    return stringData();
   else
     return NULL;
 }
 
 void CVariant::swap(CVariant &rhs)
 {
-  VariantType  temp_type = m_type;
-  VariantUnion temp_data = m_data;
-
-  m_type = rhs.m_type;
-  m_data = rhs.m_data;
-
-  rhs.m_type = temp_type;
-  rhs.m_data = temp_data;
+  std::swap(m_type, rhs.m_type);
+  std::swap(m_data, rhs.m_data);
+  std::swap(m_shortLength, rhs.m_shortLength);
 }
 
 CVariant::iterator_array CVariant::begin_array()
@@ -820,7 +844,7 @@ unsigned int CVariant::size() const
   else if (m_type == VariantTypeArray)
     return m_data.array->size();
   else if (m_type == VariantTypeString)
-    return m_data.string->size();
+    return stringSize();
   else if (m_type == VariantTypeWideString)
     return m_data.wstring->size();
   else
@@ -834,7 +858,7 @@ bool CVariant::empty() const
   else if (m_type == VariantTypeArray)
     return m_data.array->empty();
   else if (m_type == VariantTypeString)
-    return m_data.string->empty();
+    return stringSize() == 0;
   else if (m_type == VariantTypeWideString)
     return m_data.wstring->empty();
   else if (m_type == VariantTypeNull)
@@ -850,7 +874,10 @@ void CVariant::clear()
   else if (m_type == VariantTypeArray)
     m_data.array->clear();
   else if (m_type == VariantTypeString)
-    m_data.string->clear();
+  {
+    cleanup();
+    setString("", 0);
+  }
   else if (m_type == VariantTypeWideString)
     m_data.wstring->clear();
 }
@@ -885,3 +912,49 @@ bool CVariant::isMember(const std::string &key) const
 
   return false;
 }
+
+void CVariant::setString(const char *str, size_t length)
+{
+  m_type = VariantTypeString;
+  if (length <= ShortStringLength)
+  {
+    memcpy(m_data.shortString, str, length);
+    m_data.shortString[length] = '\0';
+    m_shortLength = static_cast<unsigned char>(length);
+  }
+  else
+  {
+    m_data.string = new std::string(str, length);
+    m_shortLength = LongString;
+  }
+}
+
+void CVariant::setString(std::string &&str)
+{
+  if (str.size() <= ShortStringLength)
+  {
+    setString(str.c_str(), str.size());
+    return;
+  }
+
+  m_type = VariantTypeString;
+  m_data.string = new std::string(std::move(str));
+  m_shortLength = LongString;
+}
+
+const char *CVariant::stringData() const
+{
+  return m_shortLength == LongString ? m_data.string->c_str() : m_data.shortString;
+}
+
+size_t CVariant::stringSize() const
+{
+  return m_shortLength == LongString ? m_data.string->size() : m_shortLength;
+}
+
+std::string CVariant::toStdString() const
+{
+  if (m_shortLength == LongString)
+    return *m_data.string;
+  return std::string(m_data.shortString, m_shortLength);
+}
@@ -19,6 +19,7 @@
  *
  */
 #include <map>
+#include <utility>
 #include <vector>
 #include <string>
 #include <stdint.h>
@@ -69,7 +70,7 @@ public:
   CVariant(const std::map<std::string, std::string> &strMap);
   CVariant(const std::map<std::string, CVariant> &variantMap);
   CVariant(const CVariant &variant);
-  CVariant(CVariant &&rhs);
+  CVariant(CVariant &&rhs) noexcept;
   ~CVariant();
 
 
@@ -96,12 +97,13 @@ public:
   float asFloat(float fallback = 0.0f) const;
 
   CVariant &operator[](const std::string &key);
+  CVariant &operator[](std::string &&key);
   const CVariant &operator[](const std::string &key) const;
   CVariant &operator[](unsigned int position);
   const CVariant &operator[](unsigned int position) const;
 
   CVariant &operator=(const CVariant &rhs);
-  CVariant &operator=(CVariant &&rhs);
+  CVariant &operator=(CVariant &&rhs) noexcept;
   bool operator==(const CVariant &rhs) const;
   bool operator!=(const CVariant &rhs) const { return !(*this == rhs); }
 
@@ -147,6 +149,19 @@ public:
 
 private:
   void cleanup();
+
+  // Strings up to this length are stored inline instead of on the heap
+  static const unsigned int ShortStringLength = 15;
+  static const unsigned char LongString = 0xFF;
+
+  void setString(const char *str, size_t length);
+  void setString(std::string &&str);
+  const char *stringData() const;
+  size_t stringSize() const;
+  std::string toStdString() const;
+
+  CVariant &findOrInsert(const std::string &key, std::string *movableKey);
+
   union VariantUnion
   {
     int64_t integer;
@@ -157,8 +172,10 @@ private:
     std::wstring *wstring;
     VariantArray *array;
     VariantMap *map;
+    char shortString[ShortStringLength + 1];
   };
 
-  VariantType m_type;
   VariantUnion m_data;
+  VariantType m_type;
+  unsigned char m_shortLength; // length of an inline string, or LongString
 };
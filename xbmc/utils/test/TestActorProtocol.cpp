@@ -0,0 +1,309 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "threads/Thread.h"
+#include "utils/ActorProtocol.h"
+#include "utils/Stopwatch.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#define BENCHMARK_ROUND_TRIPS 20000
+#define BENCHMARK_MESSAGES 1000000
+
+using namespace Actor;
+
+namespace
+{
+enum Signals
+{
+  PING,
+  PONG,
+  QUIT,
+};
+
+struct SPayload
+{
+  int producer;
+  int sequence;
+};
+
+// answers every sync message on a port, like the state machine of an actor
+class CResponder : public IRunnable
+{
+public:
+  CResponder(Protocol &port, CEvent &outEvent) : m_port(port), m_outEvent(outEvent) {}
+
+  void Run() override
+  {
+    while (true)
+    {
+      Message *msg;
+      if (!m_port.ReceiveOutMessage(&msg))
+      {
+        m_outEvent.WaitMSec(1000);
+        continue;
+      }
+
+      int signal = msg->signal;
+      if (signal == PING)
+        msg->Reply(PONG, msg->data, sizeof(int));
+      msg->Release();
+      if (signal == QUIT)
+        return;
+    }
+  }
+
+private:
+  Protocol &m_port;
+  CEvent &m_outEvent;
+};
+
+class CProducer : public IRunnable
+{
+public:
+  CProducer(Protocol &port, int producer, int count) : m_port(port), m_producer(producer), m_count(count) {}
+
+  void Run() override
+  {
+    for (int i = 0; i < m_count; i++)
+    {
+      SPayload payload = { m_producer, i };
+      m_port.SendOutMessage(PING, &payload, sizeof(payload));
+    }
+  }
+
+private:
+  Protocol &m_port;
+  int m_producer;
+  int m_count;
+};
+}
+
+TEST(TestActorProtocol, OrderAndPayload)
+{
+  CEvent inEvent, outEvent;
+  Protocol port("test", &inEvent, &outEvent);
+
+  // inline and allocated payloads
+  const int sizes[] = { 0, 4, MSG_INTERNAL_BUFFER_SIZE, MSG_INTERNAL_BUFFER_SIZE + 1, 1000 };
+  const int count = sizeof(sizes) / sizeof(sizes[0]);
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = (uint8_t)i;
+
+  for (int i = 0; i < count; i++)
+    EXPECT_TRUE(port.SendOutMessage(i, sizes[i] ? data.data() : NULL, sizes[i]));
+  EXPECT_TRUE(outEvent.WaitMSec(0));
+  EXPECT_TRUE(port.SendInMessage(count));
+  EXPECT_TRUE(inEvent.WaitMSec(0));
+
+  Message *msg;
+  for (int i = 0; i < count; i++)
+  {
+    ASSERT_TRUE(port.ReceiveOutMessage(&msg));
+    EXPECT_EQ(i, msg->signal);
+    EXPECT_TRUE(msg->isOut);
+    if (sizes[i])
+      EXPECT_EQ(0, memcmp(data.data(), msg->data, sizes[i]));
+    else
+      EXPECT_EQ(NULL, msg->data);
+    msg->Release();
+  }
+  EXPECT_FALSE(port.ReceiveOutMessage(&msg));
+
+  ASSERT_TRUE(port.ReceiveInMessage(&msg));
+  EXPECT_EQ(count, msg->signal);
+  EXPECT_FALSE(msg->isOut);
+  msg->Release();
+  EXPECT_FALSE(port.ReceiveInMessage(&msg));
+}
+
+TEST(TestActorProtocol, DeferAndPurge)
+{
+  CEvent inEvent, outEvent;
+  Protocol port("test", &inEvent, &outEvent);
+
+  for (int i = 0; i < 6; i++)
+    port.SendOutMessage(i % 2 ? PONG : PING, &i, sizeof(i));
+
+  Message *msg;
+  port.DeferOut(true);
+  EXPECT_FALSE(port.ReceiveOutMessage(&msg));
+  port.DeferOut(false);
+
+  // the ones left keep their order
+  ASSERT_TRUE(port.ReceiveOutMessage(&msg));
+  EXPECT_EQ(0, *(int*)msg->data);
+  msg->Release();
+  port.PurgeOut(PONG);
+  for (int i = 2; i < 6; i += 2)
+  {
+    ASSERT_TRUE(port.ReceiveOutMessage(&msg));
+    EXPECT_EQ(i, *(int*)msg->data);
+    msg->Release();
+  }
+  EXPECT_FALSE(port.ReceiveOutMessage(&msg));
+
+  port.SendInMessage(PING);
+  port.SendInMessage(PONG);
+  port.PurgeIn(PING);
+  ASSERT_TRUE(port.ReceiveInMessage(&msg));
+  EXPECT_EQ(PONG, msg->signal);
+  msg->Release();
+
+  port.SendInMessage(PING);
+  port.SendOutMessage(PING);
+  port.Purge();
+  EXPECT_FALSE(port.ReceiveInMessage(&msg));
+  EXPECT_FALSE(port.ReceiveOutMessage(&msg));
+}
+
+TEST(TestActorProtocol, SendOutMessageSync)
+{
+  CEvent inEvent, outEvent;
+  Protocol port("test", &inEvent, &outEvent);
+  CResponder responder(port, outEvent);
+  CThread thread(&responder, "Responder");
+  thread.Create();
+
+  for (int i = 0; i < 100; i++)
+  {
+    Message *reply;
+    ASSERT_TRUE(port.SendOutMessageSync(PING, &reply, 5000, &i, sizeof(i)));
+    EXPECT_EQ(PONG, reply->signal);
+    EXPECT_FALSE(reply->isOut);
+    EXPECT_EQ(i, *(int*)reply->data);
+    reply->Release();
+  }
+
+  port.SendOutMessage(QUIT);
+  thread.StopThread();
+}
+
+TEST(TestActorProtocol, SendOutMessageSyncTimeout)
+{
+  CEvent inEvent, outEvent;
+  Protocol port("test", &inEvent, &outEvent);
+
+  Message *reply;
+  int value = 1;
+  EXPECT_FALSE(port.SendOutMessageSync(PING, &reply, 10, &value, sizeof(value)));
+  EXPECT_EQ(NULL, reply);
+
+  // a late reply is dropped, the message goes back once the receiver released it as well
+  Message *msg;
+  ASSERT_TRUE(port.ReceiveOutMessage(&msg));
+  EXPECT_TRUE(msg->isSync);
+  EXPECT_TRUE(msg->Reply(PONG, &value, sizeof(value)));
+  msg->Release();
+  EXPECT_FALSE(port.ReceiveInMessage(&msg));
+}
+
+TEST(TestActorProtocol, MultipleProducers)
+{
+  const int producers = 4;
+  const int count = 10000;
+
+  CEvent inEvent, outEvent;
+  Protocol port("test", &inEvent, &outEvent);
+
+  std::vector<std::unique_ptr<CProducer>> runnables;
+  std::vector<std::unique_ptr<CThread>> threads;
+  for (int i = 0; i < producers; i++)
+  {
+    runnables.push_back(std::unique_ptr<CProducer>(new CProducer(port, i, count)));
+    threads.push_back(std::unique_ptr<CThread>(new CThread(runnables.back().get(), "Producer")));
+    threads.back()->Create();
+  }
+
+  // messages of each producer arrive in the order they were sent
+  std::vector<int> next(producers, 0);
+  int received = 0;
+  while (received < producers * count)
+  {
+    Message *msg;
+    if (!port.ReceiveOutMessage(&msg))
+    {
+      ASSERT_TRUE(outEvent.WaitMSec(5000));
+      continue;
+    }
+    SPayload *payload = (SPayload*)msg->data;
+    ASSERT_EQ(next[payload->producer], payload->sequence);
+    next[payload->producer]++;
+    msg->Release();
+    received++;
+  }
+
+  for (int i = 0; i < producers; i++)
+    threads[i]->StopThread();
+}
+
+// Round trips of BENCHMARK_ROUND_TRIPS synchronous messages to a responder thread.
+// Run with --gtest_also_run_disabled_tests.
+TEST(TestActorProtocol, DISABLED_SyncRoundTripBenchmark)
+{
+  CEvent inEvent, outEvent;
+  Protocol port("benchmark", &inEvent, &outEvent);
+  CResponder responder(port, outEvent);
+  CThread thread(&responder, "Responder");
+  thread.Create();
+
+  CStopWatch timer;
+  timer.StartZero();
+  for (int i = 0; i < BENCHMARK_ROUND_TRIPS; i++)
+  {
+    Message *reply;
+    ASSERT_TRUE(port.SendOutMessageSync(PING, &reply, 5000, &i, sizeof(i)));
+    reply->Release();
+  }
+  float elapsed = timer.GetElapsedMilliseconds();
+
+  port.SendOutMessage(QUIT);
+  thread.StopThread();
+
+  std::cout << "sync round trip: " << elapsed * 1000 / BENCHMARK_ROUND_TRIPS << " us" << std::endl;
+}
+
+// Sends and receives BENCHMARK_MESSAGES messages on a single thread. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestActorProtocol, DISABLED_SendReceiveBenchmark)
+{
+  CEvent inEvent, outEvent;
+  Protocol port("benchmark", &inEvent, &outEvent);
+
+  // the cost of the queue itself, without waking up another thread
+  CStopWatch timer;
+  timer.StartZero();
+  for (int i = 0; i < BENCHMARK_MESSAGES; i++)
+  {
+    SPayload payload = { 0, i };
+    port.SendOutMessage(PING, &payload, sizeof(payload));
+    Message *msg;
+    ASSERT_TRUE(port.ReceiveOutMessage(&msg));
+    msg->Release();
+  }
+  float elapsed = timer.GetElapsedMilliseconds();
+
+  std::cout << "send and receive: " << elapsed * 1000000 / BENCHMARK_MESSAGES << " ns" << std::endl;
+}
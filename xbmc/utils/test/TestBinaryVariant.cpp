@@ -0,0 +1,153 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "utils/BinaryVariant.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/Variant.h"
+
+#include "gtest/gtest.h"
+
+#include <limits>
+
+static CVariant RoundTrip(const CVariant &value)
+{
+  std::string binary;
+  EXPECT_TRUE(CBinaryVariant::Write(value, binary));
+  EXPECT_TRUE(CBinaryVariant::IsBinary(binary.c_str(), binary.size()));
+
+  CVariant result;
+  EXPECT_TRUE(CBinaryVariant::Parse(binary, result));
+  return result;
+}
+
+TEST(TestBinaryVariant, Scalars)
+{
+  EXPECT_TRUE(RoundTrip(CVariant(CVariant::VariantTypeNull)).isNull());
+  EXPECT_EQ(CVariant(true), RoundTrip(CVariant(true)));
+  EXPECT_EQ(CVariant(false), RoundTrip(CVariant(false)));
+
+  const int64_t integers[] = { 0, 1, -1, 63, -64, 1234567, std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() };
+  for (unsigned int i = 0; i < sizeof(integers) / sizeof(integers[0]); i++)
+  {
+    CVariant result = RoundTrip(CVariant(integers[i]));
+    EXPECT_TRUE(result.isInteger());
+    EXPECT_EQ(integers[i], result.asInteger());
+  }
+
+  CVariant result = RoundTrip(CVariant(std::numeric_limits<uint64_t>::max()));
+  EXPECT_TRUE(result.isUnsignedInteger());
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), result.asUnsignedInteger());
+
+  result = RoundTrip(CVariant(-2.5));
+  EXPECT_TRUE(result.isDouble());
+  EXPECT_DOUBLE_EQ(-2.5, result.asDouble());
+}
+
+TEST(TestBinaryVariant, Strings)
+{
+  EXPECT_EQ(CVariant(""), RoundTrip(CVariant("")));
+  EXPECT_EQ(CVariant("\xc3\xa9t\xc3\xa9"), RoundTrip(CVariant("\xc3\xa9t\xc3\xa9")));
+
+  const std::string binary("a\0b", 3);
+  EXPECT_EQ(binary, RoundTrip(CVariant(binary)).asString());
+
+  CVariant result = RoundTrip(CVariant(L"wide \x263a"));
+  EXPECT_TRUE(result.isWideString());
+  EXPECT_EQ(L"wide \x263a", result.asWideString());
+}
+
+TEST(TestBinaryVariant, Containers)
+{
+  CVariant movie(CVariant::VariantTypeObject);
+  movie["title"] = "Big Buck Bunny";
+  movie["year"] = 2008;
+  movie["rating"] = 7.5;
+  movie["genre"].push_back("Animation");
+  movie["genre"].push_back("Comedy");
+  movie["art"] = CVariant(CVariant::VariantTypeObject);
+  movie["tag"] = CVariant(CVariant::VariantTypeArray);
+  for (int i = 0; i < 3; i++)
+  {
+    CVariant actor(CVariant::VariantTypeObject);
+    actor["name"] = "Actor " + std::to_string(i);
+    actor["order"] = i;
+    movie["cast"].push_back(actor);
+  }
+
+  CVariant result = RoundTrip(movie);
+  EXPECT_EQ(movie, result);
+  EXPECT_TRUE(result["art"].isObject());
+  EXPECT_TRUE(result["tag"].isArray());
+}
+
+TEST(TestBinaryVariant, KeysAreInterned)
+{
+  CVariant cast(CVariant::VariantTypeArray);
+  for (int i = 0; i < 100; i++)
+  {
+    CVariant actor(CVariant::VariantTypeObject);
+    actor["thumbnail"] = "";
+    cast.push_back(actor);
+  }
+
+  std::string binary;
+  ASSERT_TRUE(CBinaryVariant::Write(cast, binary));
+  ASSERT_NE(std::string::npos, binary.find("thumbnail"));
+  EXPECT_EQ(binary.find("thumbnail"), binary.rfind("thumbnail"));
+
+  std::string json;
+  ASSERT_TRUE(CJSONVariantWriter::Write(cast, json, true));
+  EXPECT_LT(binary.size(), json.size() / 2);
+}
+
+TEST(TestBinaryVariant, Base64)
+{
+  CVariant object(CVariant::VariantTypeObject);
+  object["path"] = "smb://server/share/file.mkv";
+
+  std::string base64;
+  ASSERT_TRUE(CBinaryVariant::WriteBase64(object, base64));
+  EXPECT_EQ(std::string::npos, base64.find('{'));
+
+  CVariant result;
+  ASSERT_TRUE(CBinaryVariant::ParseBase64(base64, result));
+  EXPECT_EQ(object, result);
+}
+
+TEST(TestBinaryVariant, CannotParseInvalidData)
+{
+  CVariant variant;
+  EXPECT_FALSE(CBinaryVariant::Parse(nullptr, 0, variant));
+  EXPECT_FALSE(CBinaryVariant::Parse(std::string(), variant));
+  EXPECT_FALSE(CBinaryVariant::Parse("{\"a\":1}", variant));
+
+  CVariant object(CVariant::VariantTypeObject);
+  object["key"] = "value";
+  object["list"].push_back(1);
+  std::string binary;
+  ASSERT_TRUE(CBinaryVariant::Write(object, binary));
+
+  // Every truncation is rejected
+  for (size_t length = 1; length < binary.size(); length++)
+    EXPECT_FALSE(CBinaryVariant::Parse(binary.c_str(), length, variant)) << length;
+
+  // So is trailing garbage
+  EXPECT_FALSE(CBinaryVariant::Parse(binary + '\0', variant));
+}
@@ -0,0 +1,138 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "utils/JSONStreamWriter.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/Variant.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+class CTestSink : public IJSONStreamSink
+{
+public:
+  CTestSink() : m_fail(false) { }
+
+  bool Write(const char *data, size_t size) override
+  {
+    if (m_fail)
+      return false;
+
+    m_chunks.push_back(std::string(data, size));
+    return true;
+  }
+
+  std::string GetOutput() const
+  {
+    std::string output;
+    for (std::vector<std::string>::const_iterator chunk = m_chunks.begin(); chunk != m_chunks.end(); ++chunk)
+      output += *chunk;
+    return output;
+  }
+
+  std::vector<std::string> m_chunks;
+  bool m_fail;
+};
+
+static CVariant CreateSong(int id)
+{
+  CVariant song(CVariant::VariantTypeObject);
+  song["songid"] = id;
+  song["label"] = "Song " + std::to_string(id);
+  song["artist"].push_back("Artist");
+  return song;
+}
+
+TEST(TestJSONStreamWriter, MatchesVariantWriter)
+{
+  CVariant result(CVariant::VariantTypeObject);
+  result["limits"]["start"] = 0;
+  result["limits"]["end"] = 3;
+  for (int i = 0; i < 3; i++)
+    result["songs"].push_back(CreateSong(i));
+
+  for (int compact = 0; compact < 2; compact++)
+  {
+    std::string expected;
+    ASSERT_TRUE(CJSONVariantWriter::Write(result, expected, compact != 0));
+
+    // the same document, written event by event
+    CTestSink sink;
+    CJSONStreamWriter writer(sink, compact != 0);
+    EXPECT_TRUE(writer.StartObject());
+    EXPECT_TRUE(writer.Key("limits"));
+    EXPECT_TRUE(writer.Value(result["limits"]));
+    EXPECT_TRUE(writer.Key("songs"));
+    EXPECT_TRUE(writer.StartArray());
+    for (int i = 0; i < 3; i++)
+      EXPECT_TRUE(writer.Value(CreateSong(i)));
+    EXPECT_TRUE(writer.EndArray());
+    EXPECT_FALSE(writer.IsComplete());
+    EXPECT_TRUE(writer.EndObject());
+    EXPECT_TRUE(writer.IsComplete());
+    EXPECT_TRUE(writer.Flush());
+
+    EXPECT_EQ(expected, sink.GetOutput());
+  }
+}
+
+TEST(TestJSONStreamWriter, WritesChunks)
+{
+  CTestSink sink;
+  CJSONStreamWriter writer(sink, true, 64);
+
+  ASSERT_TRUE(writer.StartArray());
+  for (int i = 0; i < 100; i++)
+  {
+    ASSERT_TRUE(writer.Value(CreateSong(i)));
+    EXPECT_LT(writer.GetBufferedSize(), 64u);
+  }
+  ASSERT_TRUE(writer.EndArray());
+  ASSERT_TRUE(writer.Flush());
+  EXPECT_EQ(0u, writer.GetBufferedSize());
+
+  // output reaches the sink while the array is still being written
+  EXPECT_GT(sink.m_chunks.size(), 10u);
+
+  CVariant songs(CVariant::VariantTypeArray);
+  for (int i = 0; i < 100; i++)
+    songs.push_back(CreateSong(i));
+  std::string expected;
+  ASSERT_TRUE(CJSONVariantWriter::Write(songs, expected, true));
+  EXPECT_EQ(expected, sink.GetOutput());
+}
+
+TEST(TestJSONStreamWriter, StopsOnSinkFailure)
+{
+  CTestSink sink;
+  CJSONStreamWriter writer(sink, true, 16);
+
+  ASSERT_TRUE(writer.StartArray());
+  ASSERT_TRUE(writer.Value(CreateSong(0)));
+
+  // e.g. the client went away
+  sink.m_fail = true;
+  EXPECT_FALSE(writer.Value(CreateSong(1)));
+  EXPECT_TRUE(writer.HasFailed());
+  EXPECT_FALSE(writer.EndArray());
+  EXPECT_FALSE(writer.Flush());
+}
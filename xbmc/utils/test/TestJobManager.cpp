@@ -19,12 +19,25 @@
  */
 
 #include "ServiceBroker.h"
+#include "threads/SingleLock.h"
+#include "threads/Thread.h"
 #include "utils/JobManager.h"
 #include "settings/Settings.h"
+#include "utils/Stopwatch.h"
 #include "utils/SystemInfo.h"
+#ifdef TARGET_POSIX
+#include "linux/XTimeUtils.h"
+#endif
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+#define BENCHMARK_JOBS 100000
+
 /* CSysInfoJob::GetInternetState() will test for network connectivity. */
 class TestJobManager : public testing::Test
 {
@@ -48,6 +61,14 @@ protected:
     */
   }
 
+  void TearDown() override
+  {
+    // tests resizing the pool may fail half way, the next one expects the default
+    CJobManager::GetInstance().CancelJobs();
+    CJobManager::GetInstance().SetWorkerCount(CJobManager::DefaultWorkerCount);
+    CJobManager::GetInstance().Restart();
+  }
+
   ~TestJobManager()
   {
     /* Always cancel jobs test completion */
@@ -179,3 +200,157 @@ TEST_F(TestJobManager, IsProcessing)
 
   job->FinishAndStopBlocking();
 }
+
+namespace
+{
+class CountingJob : public CJob
+{
+public:
+  CountingJob(std::atomic<unsigned int> &counter, unsigned int children = 0) :
+    m_counter(counter),
+    m_children(children)
+  {
+  }
+
+  const char * GetType() const
+  {
+    return "CountingJob";
+  }
+
+  bool DoWork()
+  {
+    // jobs added by a worker end up on its own queue and get stolen by the others
+    for (unsigned int i = 0; i < m_children; i++)
+      CJobManager::GetInstance().AddJob(new CountingJob(m_counter), NULL, CJob::PRIORITY_NORMAL);
+
+    m_counter++;
+    return true;
+  }
+
+private:
+  std::atomic<unsigned int> &m_counter;
+  unsigned int m_children;
+};
+
+class StolenJob : public CJob
+{
+public:
+  typedef std::set<ThreadIdentifier> Threads;
+
+  StolenJob(std::atomic<unsigned int> &counter, CCriticalSection &section, Threads &threads, unsigned int children = 0) :
+    m_counter(counter),
+    m_section(section),
+    m_threads(threads),
+    m_children(children)
+  {
+  }
+
+  const char * GetType() const
+  {
+    return "StolenJob";
+  }
+
+  bool DoWork()
+  {
+    if (m_children)
+    {
+      for (unsigned int i = 0; i < m_children; i++)
+        CJobManager::GetInstance().AddJob(new StolenJob(m_counter, m_section, m_threads), NULL, CJob::PRIORITY_NORMAL);
+    }
+    else
+    {
+      // long enough for the idle workers to wake up and steal
+      Sleep(1);
+      CSingleLock lock(m_section);
+      m_threads.insert(CThread::GetCurrentThreadId());
+    }
+
+    m_counter++;
+    return true;
+  }
+
+private:
+  std::atomic<unsigned int> &m_counter;
+  CCriticalSection &m_section;
+  Threads &m_threads;
+  unsigned int m_children;
+};
+
+bool WaitForJobs(std::atomic<unsigned int> &counter, unsigned int jobs)
+{
+  CStopWatch timeout;
+  timeout.StartZero();
+  while (counter < jobs)
+  {
+    if (timeout.GetElapsedSeconds() > 60.0f)
+      return false;
+    Sleep(1);
+  }
+  return true;
+}
+
+void SetWorkerCount(unsigned int workers)
+{
+  CJobManager::GetInstance().CancelJobs();
+  CJobManager::GetInstance().SetWorkerCount(workers);
+  CJobManager::GetInstance().Restart();
+}
+}
+
+TEST_F(TestJobManager, SetWorkerCount)
+{
+  EXPECT_THROW(CJobManager::GetInstance().SetWorkerCount(4), std::logic_error);
+
+  SetWorkerCount(0);
+  EXPECT_EQ(1u, CJobManager::GetInstance().GetWorkerCount());
+
+  // with a single worker even the lowest priority gets it
+  std::atomic<unsigned int> counter(0);
+  CJobManager::GetInstance().AddJob(new CountingJob(counter), NULL, CJob::PRIORITY_LOW_PAUSABLE);
+  EXPECT_TRUE(WaitForJobs(counter, 1));
+}
+
+TEST_F(TestJobManager, StealJobs)
+{
+  SetWorkerCount(4);
+
+  std::atomic<unsigned int> counter(0);
+  for (unsigned int i = 0; i < 100; i++)
+    CJobManager::GetInstance().AddJob(new CountingJob(counter, 100), NULL, CJob::PRIORITY_HIGH);
+  EXPECT_TRUE(WaitForJobs(counter, 100 * 101));
+
+  // all children are queued on the parent's worker, the other workers have to steal them
+  counter = 0;
+  CCriticalSection section;
+  StolenJob::Threads threads;
+  CJobManager::GetInstance().AddJob(new StolenJob(counter, section, threads, 100), NULL, CJob::PRIORITY_HIGH);
+  EXPECT_TRUE(WaitForJobs(counter, 101));
+
+  // more than one thread ran them, so at least one wasn't the parent's worker
+  {
+    CSingleLock lock(section);
+    EXPECT_LT(1u, threads.size());
+  }
+}
+
+// Runs BENCHMARK_JOBS trivial jobs on pools of different sizes. Run with
+// --gtest_also_run_disabled_tests.
+TEST_F(TestJobManager, DISABLED_Benchmark)
+{
+  const unsigned int workers[] = { 1, 4, 16 };
+
+  for (unsigned int i = 0; i < sizeof(workers) / sizeof(workers[0]); i++)
+  {
+    SetWorkerCount(workers[i]);
+
+    std::atomic<unsigned int> counter(0);
+    CStopWatch timer;
+    timer.StartZero();
+    for (unsigned int job = 0; job < BENCHMARK_JOBS; job++)
+      CJobManager::GetInstance().AddJob(new CountingJob(counter), NULL, CJob::PRIORITY_HIGH);
+    ASSERT_TRUE(WaitForJobs(counter, BENCHMARK_JOBS));
+    float elapsed = timer.GetElapsedSeconds();
+
+    std::cout << workers[i] << " workers: " << BENCHMARK_JOBS / elapsed << " jobs/s" << std::endl;
+  }
+}
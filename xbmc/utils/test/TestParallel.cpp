@@ -0,0 +1,83 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "threads/Event.h"
+#include "utils/JobManager.h"
+#include "utils/Parallel.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <utility>
+
+using namespace KODI::UTILS;
+
+TEST(TestParallel, ParallelFor)
+{
+  std::vector<std::atomic<int>> done(100);
+  for (size_t i = 0; i < done.size(); i++)
+    done[i] = 0;
+
+  ParallelFor(done.size(), [&done](size_t part) { done[part]++; });
+  for (size_t i = 0; i < done.size(); i++)
+    EXPECT_EQ(1, done[i]);
+
+  // nothing to do
+  ParallelFor(0, [&done](size_t part) { done[part]++; });
+}
+
+TEST(TestParallel, ParallelForInJob)
+{
+  // jobs waiting for parts can't starve them, the waiting job takes them itself
+  std::atomic<int> done(0);
+  CEvent finished;
+  for (unsigned int i = 0; i <= CJobManager::GetInstance().GetWorkerCount(); i++)
+  {
+    CJobManager::GetInstance().Submit([&done, &finished]()
+    {
+      ParallelFor(10, [&done](size_t part) { done++; });
+      if (done == 10 * (int)(CJobManager::GetInstance().GetWorkerCount() + 1))
+        finished.Set();
+    }, CJob::PRIORITY_HIGH);
+  }
+  EXPECT_TRUE(finished.WaitMSec(10000));
+}
+
+TEST(TestParallel, ParallelSort)
+{
+  // sort by the first only, equal ones have to keep their order
+  std::vector<std::pair<int, int>> values;
+  unsigned int seed = 1;
+  for (int i = 0; i < 10007; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    values.push_back(std::make_pair((int)((seed >> 16) % 100), i));
+  }
+  auto less = [](const std::pair<int, int> &left, const std::pair<int, int> &right) { return left.first < right.first; };
+
+  std::vector<std::pair<int, int>> expected = values;
+  std::stable_sort(expected.begin(), expected.end(), less);
+  ParallelSort(values.begin(), values.end(), less);
+  EXPECT_EQ(expected, values);
+
+  std::vector<int> few = { 3, 1, 2 };
+  ParallelSort(few.begin(), few.end(), std::less<int>());
+  EXPECT_EQ(std::vector<int>({ 1, 2, 3 }), few);
+}
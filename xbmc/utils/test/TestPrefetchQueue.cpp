@@ -0,0 +1,255 @@
+/*
+ *      Copyright (C) 2016 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "filesystem/Directory.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "utils/PrefetchQueue.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+#ifdef TARGET_POSIX
+#include "linux/XTimeUtils.h"
+#endif
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <iostream>
+
+using namespace XFILE;
+
+TEST(TestPrefetchQueue, TakeInAnyOrder)
+{
+  CPrefetchQueue<int> queue(2);
+  for (int i = 0; i < 10; i++)
+    EXPECT_TRUE(queue.Queue(StringUtils::Format("%i", i), [i](int &value) { value = i * 2; }));
+  EXPECT_FALSE(queue.Queue("3", [](int &value) { value = -1; }));
+
+  for (int i = 9; i >= 0; i--)
+  {
+    int value = -1;
+    EXPECT_TRUE(queue.Take(StringUtils::Format("%i", i), value));
+    EXPECT_EQ(i * 2, value);
+  }
+
+  int value;
+  EXPECT_FALSE(queue.IsQueued("3"));
+  EXPECT_FALSE(queue.Take("3", value));
+}
+
+TEST(TestPrefetchQueue, TakeAny)
+{
+  CPrefetchQueue<int> queue(2);
+  queue.Queue("slow", [](int &value) { Sleep(100); value = 1; });
+  queue.Queue("fast", [](int &value) { value = 2; });
+  EXPECT_EQ(2u, queue.GetCount());
+  EXPECT_FALSE(queue.IsFinished("slow"));
+  while (!queue.IsAnyFinished())
+    Sleep(1);
+
+  std::string key;
+  int value = 0;
+  EXPECT_TRUE(queue.TakeAny(key, value));
+  EXPECT_EQ("fast", key);
+  EXPECT_EQ(2, value);
+  EXPECT_TRUE(queue.TakeAny(key, value));
+  EXPECT_EQ("slow", key);
+  EXPECT_EQ(1, value);
+
+  EXPECT_EQ(0u, queue.GetCount());
+  EXPECT_TRUE(queue.IsFinished("slow"));
+  EXPECT_TRUE(queue.IsAnyFinished());
+  EXPECT_FALSE(queue.TakeAny(key, value));
+}
+
+TEST(TestPrefetchQueue, JobsAtOnce)
+{
+  std::atomic<int> running(0);
+  std::atomic<int> maximum(0);
+
+  CPrefetchQueue<int> queue(3);
+  for (int i = 0; i < 20; i++)
+  {
+    queue.Queue(StringUtils::Format("%i", i), [&running, &maximum](int &value)
+    {
+      int now = ++running;
+      int seen = maximum;
+      while (now > seen && !maximum.compare_exchange_weak(seen, now))
+        ;
+      Sleep(5);
+      value = --running;
+    });
+  }
+
+  int value;
+  for (int i = 0; i < 20; i++)
+    EXPECT_TRUE(queue.Take(StringUtils::Format("%i", i), value));
+  EXPECT_LE(maximum, 3);
+  EXPECT_GT(maximum, 1);
+}
+
+TEST(TestPrefetchQueue, Cancel)
+{
+  std::atomic<int> done(0);
+
+  CPrefetchQueue<int> queue(1);
+  for (int i = 0; i < 10; i++)
+    queue.Queue(StringUtils::Format("%i", i), [&done](int &value) { Sleep(10); value = ++done; });
+
+  queue.Cancel();
+  int finished = done;
+  EXPECT_LT(finished, 10);
+  EXPECT_FALSE(queue.IsQueued("9"));
+  EXPECT_FALSE(queue.Queue("10", [](int &value) { value = 0; }));
+
+  // nothing runs anymore once Cancel() returned
+  Sleep(50);
+  EXPECT_EQ(finished, done);
+
+  queue.Reset();
+  int value;
+  EXPECT_TRUE(queue.Queue("10", [](int &value) { value = 10; }));
+  EXPECT_TRUE(queue.Take("10", value));
+  EXPECT_EQ(10, value);
+}
+
+TEST(TestPrefetchQueue, CancelledByJobManager)
+{
+  // jobs the job manager doesn't run anymore are dropped, nobody waits for them
+  CJobManager::GetInstance().CancelJobs();
+
+  CPrefetchQueue<int> queue(2);
+  for (int i = 0; i < 5; i++)
+    EXPECT_TRUE(queue.Queue(StringUtils::Format("%i", i), [](int &value) { value = 1; }));
+  EXPECT_TRUE(queue.IsQueued("0"));
+  EXPECT_TRUE(queue.IsFinished("4"));
+  EXPECT_TRUE(queue.IsAnyFinished());
+
+  int value = 0;
+  EXPECT_FALSE(queue.Take("0", value));
+  std::string key;
+  EXPECT_FALSE(queue.TakeAny(key, value));
+  EXPECT_EQ(0u, queue.GetCount());
+  EXPECT_EQ(0, value);
+
+  CJobManager::GetInstance().Restart();
+  EXPECT_TRUE(queue.Queue("5", [](int &value) { value = 5; }));
+  EXPECT_TRUE(queue.Take("5", value));
+  EXPECT_EQ(5, value);
+}
+
+/*
+ A library scan of a synthetic local tree, the way CVideoInfoScanner does it:
+ folders are listed ahead, every file is looked up by a stub scraper taking a
+ few milliseconds and the results are "added" in order by the scanning thread.
+ */
+static int ScanTree(const std::string &root, int threads)
+{
+  std::unique_ptr<CPrefetchQueue<std::shared_ptr<CFileItemList>>> listings;
+  std::unique_ptr<CPrefetchQueue<std::string>> lookups;
+  if (threads > 1)
+  {
+    listings.reset(new CPrefetchQueue<std::shared_ptr<CFileItemList>>(threads));
+    lookups.reset(new CPrefetchQueue<std::string>(threads));
+  }
+
+  std::function<void(std::shared_ptr<CFileItemList>&, const std::string&)> list =
+    [](std::shared_ptr<CFileItemList> &items, const std::string &path)
+    {
+      items.reset(new CFileItemList);
+      CDirectory::GetDirectory(path, *items, ".mkv");
+    };
+  std::function<void(std::string&, const std::string&)> scrape =
+    [](std::string &title, const std::string &path)
+    {
+      Sleep(2);
+      title = URIUtils::GetFileName(path);
+    };
+
+  CFileItemList folders;
+  CDirectory::GetDirectory(root, folders);
+  if (listings)
+  {
+    for (int i = 0; i < folders.Size(); i++)
+    {
+      std::string path = folders[i]->GetPath();
+      listings->Queue(path, std::bind(list, std::placeholders::_1, path));
+    }
+  }
+
+  int added = 0;
+  for (int i = 0; i < folders.Size(); i++)
+  {
+    std::shared_ptr<CFileItemList> items;
+    if (!listings || !listings->Take(folders[i]->GetPath(), items))
+      list(items, folders[i]->GetPath());
+
+    if (lookups)
+    {
+      for (int j = 0; j < items->Size(); j++)
+      {
+        std::string path = (*items)[j]->GetPath();
+        lookups->Queue(path, std::bind(scrape, std::placeholders::_1, path));
+      }
+    }
+
+    for (int j = 0; j < items->Size(); j++)
+    {
+      std::string title;
+      if (!lookups || !lookups->Take((*items)[j]->GetPath(), title))
+        scrape(title, (*items)[j]->GetPath());
+      if (!title.empty())
+        added++;
+    }
+  }
+  return added;
+}
+
+// Times ScanTree() with and without prefetching. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestPrefetchQueue, DISABLED_ScanBenchmark)
+{
+  std::string root = URIUtils::AddFileToFolder(CSpecialProtocol::TranslatePath("special://temp/"), "TestPrefetchQueue/");
+  for (int i = 0; i < 20; i++)
+  {
+    std::string folder = URIUtils::AddFileToFolder(root, StringUtils::Format("movies%02i/", i));
+    ASSERT_TRUE(CDirectory::Create(folder));
+    for (int j = 0; j < 10; j++)
+    {
+      CFile file;
+      ASSERT_TRUE(file.OpenForWrite(URIUtils::AddFileToFolder(folder, StringUtils::Format("movie%02i.mkv", j)), true));
+      file.Write("data", 4);
+      file.Close();
+    }
+  }
+
+  int threads[] = { 1, 4, 8 };
+  for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+  {
+    CStopWatch timer;
+    timer.StartZero();
+    EXPECT_EQ(200, ScanTree(root, threads[i]));
+    std::cout << threads[i] << " threads: " << timer.GetElapsedMilliseconds() << " ms" << std::endl;
+  }
+
+  CDirectory::RemoveRecursive(root);
+}
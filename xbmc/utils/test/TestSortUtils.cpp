@@ -19,10 +19,14 @@
  */
 
 #include "utils/SortUtils.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
 #include "utils/Variant.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
 TEST(TestSortUtils, Sort_SortBy)
 {
   SortItems items;
@@ -131,3 +135,146 @@ TEST(TestSortUtils, GetFieldsForSorting)
   EXPECT_EQ(FieldTrackNumber, *it);
   EXPECT_EQ((unsigned int)4, fields.size());
 }
+
+TEST(TestSortUtils, Sort_SortSpecialAndFolders)
+{
+  const char *labels[] = { "d", "c", "b", "a", "e" };
+  SortItems items;
+  for (int i = 0; i < 5; i++)
+  {
+    SortItemPtr item(new SortItem());
+    (*item)[FieldLabel] = labels[i];
+    (*item)[FieldFolder] = (i == 2 || i == 4);
+    items.push_back(item);
+  }
+  (*items[0])[FieldSortSpecial] = SortSpecialOnTop;
+  (*items[3])[FieldSortSpecial] = SortSpecialOnBottom;
+
+  SortUtils::Sort(SortByLabel, SortOrderDescending, SortAttributeNone, items);
+
+  // items on top and bottom first, then folders, both kept when descending
+  const char *sorted[] = { "d", "e", "b", "c", "a" };
+  for (int i = 0; i < 5; i++)
+    EXPECT_STREQ(sorted[i], (*items[i])[FieldLabel].asString().c_str());
+}
+
+static SortItems GetSongs(int count)
+{
+  static const char *words[] = { "Black", "Sun", "The", "River", "Night", "Electric", "Stone", "Blue", "Fire", "Dream",
+                                 "Silver", "Road", "Wild", "Heart", "Ghost", "City", "Golden", "Rain", "Echo", "Moon" };
+  SortItems songs;
+  unsigned int seed = 1;
+  for (int i = 0; i < count; i++)
+  {
+    int artist = i / 50;
+    int album = i / 10;
+    seed = seed * 1103515245 + 12345;
+    SortItemPtr song(new SortItem());
+    (*song)[FieldArtist] = StringUtils::Format("%s%s %s %i", artist % 3 == 0 ? "The " : "", words[artist % 20], words[(artist / 20) % 20], artist);
+    (*song)[FieldAlbum] = StringUtils::Format("%s %s", words[(album * 7) % 20], words[(seed >> 16) % 20]);
+    (*song)[FieldTrackNumber] = i % 10 + 1;
+    (*song)[FieldTitle] = StringUtils::Format("%s %s %i", words[(seed >> 8) % 20], words[(seed >> 20) % 20], i);
+    songs.push_back(song);
+  }
+  // the library returns them in the order they were added
+  std::vector<SortItemPtr> shuffled(songs.size());
+  for (size_t i = 0; i < songs.size(); i++)
+    shuffled[(i * 7919) % songs.size()] = songs[i];
+  return shuffled;
+}
+
+TEST(TestSortUtils, Sort_Limits)
+{
+  SortItems all = GetSongs(1000);
+  SortUtils::Sort(SortByTitle, SortOrderAscending, SortAttributeIgnoreArticle, all);
+
+  SortItems some = GetSongs(1000);
+  SortUtils::Sort(SortByTitle, SortOrderAscending, SortAttributeIgnoreArticle, some, 150, 100);
+  ASSERT_EQ(50u, some.size());
+  for (size_t i = 0; i < some.size(); i++)
+    EXPECT_EQ((*all[100 + i])[FieldTitle].asString(), (*some[i])[FieldTitle].asString());
+
+  // an end before the start is ignored, like an end behind the last item
+  some = GetSongs(1000);
+  SortUtils::Sort(SortByTitle, SortOrderAscending, SortAttributeIgnoreArticle, some, 50, 100);
+  ASSERT_EQ(900u, some.size());
+  EXPECT_EQ((*all[100])[FieldTitle].asString(), (*some[0])[FieldTitle].asString());
+  EXPECT_EQ((*all.back())[FieldTitle].asString(), (*some.back())[FieldTitle].asString());
+}
+
+// Full and partial sort of 100000 songs by artist. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestSortUtils, DISABLED_SortBenchmark)
+{
+  const int count = 100000;
+  SortItems songs = GetSongs(count);
+
+  CStopWatch timer;
+  timer.StartZero();
+  SortUtils::Sort(SortByArtist, SortOrderAscending, SortAttributeIgnoreArticle, songs);
+  float all = timer.GetElapsedMilliseconds();
+  ASSERT_EQ((size_t)count, songs.size());
+  for (size_t i = 1; i < songs.size(); i++)
+  {
+    ASSERT_LE(StringUtils::AlphaNumericCompare((*songs[i - 1])[FieldSort].asWideString().c_str(),
+                                               (*songs[i])[FieldSort].asWideString().c_str()), 0);
+  }
+
+  songs = GetSongs(count);
+  timer.StartZero();
+  SortUtils::Sort(SortByArtist, SortOrderAscending, SortAttributeIgnoreArticle, songs, 50);
+  float first = timer.GetElapsedMilliseconds();
+  EXPECT_EQ(50u, songs.size());
+
+  std::cout << count << " songs by artist: " << all << " ms, first 50: " << first << " ms" << std::endl;
+}
+
+TEST(TestSortUtils, Sort_Parallel)
+{
+  SortDescription sorting;
+  sorting.sortBy = SortByArtist;
+  sorting.sortAttributes = SortAttributeIgnoreArticle;
+
+  // many songs share an artist, so ties have to end up in the same order as well
+  SortItems sequential = GetSongs(5000);
+  SortItems parallel = GetSongs(5000);
+  SortUtils::Sort(sorting, sequential);
+  SortUtils::Sort(sorting, parallel, 1000);
+  ASSERT_EQ(sequential.size(), parallel.size());
+  for (size_t i = 0; i < sequential.size(); i++)
+  {
+    EXPECT_EQ((*sequential[i])[FieldTitle].asString(), (*parallel[i])[FieldTitle].asString());
+    EXPECT_EQ((*sequential[i])[FieldSort].asWideString(), (*parallel[i])[FieldSort].asWideString());
+  }
+}
+
+// Sequential against pooled sorting of large song lists. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestSortUtils, DISABLED_ParallelSortBenchmark)
+{
+  SortDescription sorting;
+  sorting.sortBy = SortByArtist;
+  sorting.sortAttributes = SortAttributeIgnoreArticle;
+
+  const int counts[] = { 50000, 200000 };
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+  {
+    SortItems songs = GetSongs(counts[i]);
+    CStopWatch timer;
+    timer.StartZero();
+    SortUtils::Sort(sorting, songs);
+    float sequential = timer.GetElapsedMilliseconds();
+    SortItems expected = songs;
+
+    songs = GetSongs(counts[i]);
+    timer.StartZero();
+    SortUtils::Sort(sorting, songs, 1);
+    float parallel = timer.GetElapsedMilliseconds();
+
+    ASSERT_EQ(expected.size(), songs.size());
+    for (size_t j = 0; j < songs.size(); j++)
+      ASSERT_EQ((*expected[j])[FieldTitle].asString(), (*songs[j])[FieldTitle].asString());
+
+    std::cout << counts[i] << " songs by artist: " << sequential << " ms, in parallel: " << parallel << " ms" << std::endl;
+  }
+}
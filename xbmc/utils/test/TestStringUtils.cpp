@@ -19,7 +19,9 @@
  */
 
 #include "utils/StringUtils.h"
+#include "utils/Stopwatch.h"
 #include <algorithm>
+#include <iostream>
 
 #include "gtest/gtest.h"
 
@@ -313,6 +315,86 @@ TEST(TestStringUtils, AlphaNumericCompare)
   EXPECT_LT(var, ref);
 }
 
+static int Sign(int64_t value)
+{
+  return value < 0 ? -1 : (value > 0 ? 1 : 0);
+}
+
+TEST(TestStringUtils, AlphaNumericSortKeys)
+{
+  // ascii letters of both cases, punctuation, accented letters and numbers with leading zeros and of more than 15 digits
+  static const wchar_t *parts[] = { L"a", L"B", L"b", L"Z", L" ", L"-", L"(", L".", L"_", L"\u00e4", L"\u00c4", L"\u00e9", L"\u00df",
+                                    L"0", L"7", L"007", L"10", L"9", L"1234567890123456", L"000000000000001", L"x2" };
+  const size_t partCount = sizeof(parts) / sizeof(parts[0]);
+
+  std::vector<std::wstring> labels;
+  labels.push_back(L"");
+  labels.push_back(L"123abc");
+  labels.push_back(L"abc123");
+  unsigned int seed = 1;
+  for (int i = 0; i < 300; i++)
+  {
+    std::wstring label;
+    seed = seed * 1103515245 + 12345;
+    int length = 1 + (seed >> 16) % 6;
+    for (int j = 0; j < length; j++)
+    {
+      seed = seed * 1103515245 + 12345;
+      label += parts[(seed >> 16) % partCount];
+    }
+    labels.push_back(label);
+  }
+
+  std::vector<std::string> keys;
+  ASSERT_TRUE(StringUtils::AlphaNumericSortKeys(labels, keys));
+  ASSERT_EQ(labels.size(), keys.size());
+  for (size_t i = 0; i < labels.size(); i++)
+  {
+    for (size_t j = 0; j < labels.size(); j++)
+    {
+      ASSERT_EQ(Sign(StringUtils::AlphaNumericCompare(labels[i].c_str(), labels[j].c_str())), Sign(keys[i].compare(keys[j])))
+        << "labels " << i << " and " << j;
+    }
+  }
+}
+
+// Sorts 100000 labels by comparing them and by their sort keys. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestStringUtils, DISABLED_AlphaNumericSortKeysBenchmark)
+{
+  static const wchar_t *words[] = { L"Black", L"Sun", L"The", L"River", L"Night", L"Electric", L"Stone", L"Blue", L"Fire", L"Dream",
+                                    L"Silver", L"Road", L"Wild", L"Heart", L"Ghost", L"City", L"Golden", L"Rain", L"Echo", L"Moon" };
+  std::vector<std::wstring> labels;
+  unsigned int seed = 1;
+  for (int i = 0; i < 100000; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    labels.push_back(std::wstring(words[(seed >> 8) % 20]) + L" " + words[(seed >> 20) % 20] + L" " + std::to_wstring(i % 1000));
+  }
+  std::vector<size_t> compared(labels.size()), keyed(labels.size());
+  for (size_t i = 0; i < labels.size(); i++)
+    compared[i] = keyed[i] = i;
+
+  CStopWatch timer;
+  timer.StartZero();
+  std::stable_sort(compared.begin(), compared.end(), [&labels](size_t left, size_t right)
+  {
+    return StringUtils::AlphaNumericCompare(labels[left].c_str(), labels[right].c_str()) < 0;
+  });
+  float comparing = timer.GetElapsedMilliseconds();
+
+  timer.StartZero();
+  std::vector<std::string> keys;
+  ASSERT_TRUE(StringUtils::AlphaNumericSortKeys(labels, keys));
+  float making = timer.GetElapsedMilliseconds();
+  std::stable_sort(keyed.begin(), keyed.end(), [&keys](size_t left, size_t right) { return keys[left] < keys[right]; });
+  float keying = timer.GetElapsedMilliseconds();
+
+  EXPECT_EQ(compared, keyed);
+  std::cout << labels.size() << " labels compared: " << comparing << " ms, by keys: " << keying
+            << " ms (" << making << " ms making them)" << std::endl;
+}
+
 TEST(TestStringUtils, TimeStringToSeconds)
 {
   EXPECT_EQ(77455, StringUtils::TimeStringToSeconds("21:30:55"));
@@ -18,10 +18,16 @@
  *
  */
 
+#include "utils/JSONVariantWriter.h"
+#include "utils/Stopwatch.h"
 #include "utils/Variant.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_MOVIES 10000
+
 TEST(TestVariant, VariantTypeInteger)
 {
   CVariant a((int)0), b((int64_t)1);
@@ -348,3 +354,173 @@ TEST(TestVariant, isMember)
   EXPECT_TRUE(a.isMember("key1"));
   EXPECT_FALSE(a.isMember("key2"));
 }
+
+TEST(TestVariant, StringStorage)
+{
+  // Short strings are stored inline, make sure both kinds behave the same
+  CVariant a("short"), b("a string that is too long to be stored inline");
+  EXPECT_STREQ("short", a.c_str());
+  EXPECT_EQ(5u, a.size());
+  EXPECT_STREQ("a string that is too long to be stored inline", b.c_str());
+
+  a = b;
+  EXPECT_EQ(b, a);
+  b = "short";
+  EXPECT_EQ("short", b.asString());
+  a.swap(b);
+  EXPECT_EQ("short", a.asString());
+  EXPECT_EQ("a string that is too long to be stored inline", b.asString());
+
+  CVariant c(std::move(b));
+  EXPECT_EQ("a string that is too long to be stored inline", c.asString());
+  c.clear();
+  EXPECT_TRUE(c.isString());
+  EXPECT_TRUE(c.empty());
+
+  const std::string binary("a\0b", 3);
+  CVariant d(binary);
+  EXPECT_EQ(3u, d.size());
+  EXPECT_EQ(binary, d.asString());
+
+  EXPECT_EQ(42, CVariant("42").asInteger());
+  EXPECT_TRUE(CVariant("true").asBoolean());
+  EXPECT_FALSE(CVariant("0").asBoolean());
+}
+
+TEST(TestVariant, MemberOrder)
+{
+  // Members are kept sorted by key, whatever the insertion order
+  CVariant a;
+  a["c"] = 3;
+  a["a"] = 1;
+  a["b"] = 2;
+  a["a"] = 0;
+
+  std::string keys;
+  for (CVariant::const_iterator_map it = a.begin_map(); it != a.end_map(); ++it)
+    keys += it->first;
+  EXPECT_EQ("abc", keys);
+  EXPECT_EQ(3u, a.size());
+  EXPECT_EQ(0, a["a"].asInteger());
+
+  a.erase("b");
+  EXPECT_FALSE(a.isMember("b"));
+  EXPECT_TRUE(a.isMember("c"));
+
+  const CVariant &b = a;
+  EXPECT_TRUE(b["missing"].isNull());
+  EXPECT_EQ(2u, a.size());
+}
+
+TEST(TestVariant, MemberReferences)
+{
+  // References to members stay valid while other members are added
+  CVariant a;
+  CVariant &m = a["m"];
+  a["z"] = 1;
+  for (int i = 0; i < 100; i++)
+    a["k" + std::to_string(i)] = i;
+  a["a"] = a["m"];
+  m = "value";
+
+  EXPECT_EQ(&m, &a["m"]);
+  EXPECT_EQ("value", a["m"].asString());
+  EXPECT_TRUE(a["a"].isNull());
+
+  a["copy"] = a["m"];
+  EXPECT_EQ("value", a["copy"].asString());
+}
+
+static CVariant CreateMovie(int i)
+{
+  CVariant movie(CVariant::VariantTypeObject);
+  movie["movieid"] = i;
+  movie["label"] = "Movie " + std::to_string(i);
+  movie["title"] = "Movie " + std::to_string(i);
+  movie["originaltitle"] = "";
+  movie["sorttitle"] = "";
+  movie["year"] = 1950 + i % 70;
+  movie["rating"] = 7.5;
+  movie["votes"] = "1234";
+  movie["playcount"] = i % 3;
+  movie["runtime"] = 5400;
+  movie["mpaa"] = "Rated PG-13";
+  movie["tagline"] = "";
+  movie["plot"] = "A plot that is long enough for the heap, as most of them are in a real library";
+  movie["file"] = "smb://server/movies/Movie " + std::to_string(i) + "/movie.mkv";
+  movie["dateadded"] = "2016-01-01 12:00:00";
+  movie["lastplayed"] = "";
+
+  const char *genres[] = { "Action", "Comedy", "Drama" };
+  for (int j = 0; j < 3; j++)
+    movie["genre"].push_back(genres[j]);
+
+  for (int j = 0; j < 5; j++)
+  {
+    CVariant actor(CVariant::VariantTypeObject);
+    actor["name"] = "Actor " + std::to_string(j);
+    actor["role"] = "Role " + std::to_string(j);
+    actor["order"] = j;
+    actor["thumbnail"] = "";
+    movie["cast"].push_back(std::move(actor));
+  }
+
+  CVariant &art = movie["art"];
+  art["fanart"] = "image://smb%3a%2f%2fserver%2fmovies%2ffanart.jpg/";
+  art["poster"] = "image://smb%3a%2f%2fserver%2fmovies%2fposter.jpg/";
+
+  movie["resume"]["position"] = 0;
+  movie["resume"]["total"] = 0;
+
+  return movie;
+}
+
+// Heap blocks held by a variant: strings longer than 15 characters (the
+// string and its buffer), arrays and objects (the container and its buffer)
+// and their members. Counted from the value rather than by replacing the
+// global operator new, which would change allocation for every test.
+static unsigned int HeapBlocks(const CVariant &value)
+{
+  unsigned int blocks = 0;
+  if (value.isString())
+    blocks += value.asString().size() > 15 ? 2 : 0;
+  else if (value.isArray())
+  {
+    blocks += value.empty() ? 1 : 2;
+    for (CVariant::const_iterator_array it = value.begin_array(); it != value.end_array(); ++it)
+      blocks += HeapBlocks(*it);
+  }
+  else if (value.isObject())
+  {
+    blocks += value.empty() ? 1 : 2;
+    for (CVariant::const_iterator_map it = value.begin_map(); it != value.end_map(); ++it)
+      blocks += (it->first.size() > 15 ? 1 : 0) + HeapBlocks(it->second);
+  }
+  return blocks;
+}
+
+// Builds and writes a JSON-RPC style list of BENCHMARK_MOVIES movies. Run with
+// --gtest_also_run_disabled_tests.
+TEST(TestVariant, DISABLED_Benchmark)
+{
+  CStopWatch timer;
+
+  timer.StartZero();
+  CVariant result(CVariant::VariantTypeObject);
+  result["limits"]["start"] = 0;
+  result["limits"]["end"] = BENCHMARK_MOVIES;
+  result["limits"]["total"] = BENCHMARK_MOVIES;
+  for (int i = 0; i < BENCHMARK_MOVIES; i++)
+    result["movies"].push_back(CreateMovie(i));
+  float buildTime = timer.GetElapsedMilliseconds();
+
+  timer.StartZero();
+  std::string json;
+  ASSERT_TRUE(CJSONVariantWriter::Write(result, json, true));
+  float writeTime = timer.GetElapsedMilliseconds();
+
+  EXPECT_EQ(BENCHMARK_MOVIES, (int)result["movies"].size());
+  std::cout << "build: " << buildTime << " ms, " << HeapBlocks(result) << " heap blocks held" << std::endl
+            << "serialize: " << writeTime << " ms, " << json.size() << " bytes" << std::endl
+            << "sizeof(CVariant): " << sizeof(CVariant) << std::endl;
+}
@@ -530,8 +530,8 @@ int CVideoDatabase::GetPathId(const std::string& strPath)
 
     URIUtils::AddSlashAtEnd(strPath1);
 
-    strSQL=PrepareSQL("select idPath from path where strPath='%s'",strPath1.c_str());
-    m_pDS->query(strSQL);
+    strSQL = "select idPath from path where strPath=?";
+    m_pDS->query_prepared(strSQL, { strPath1 });
     if (!m_pDS->eof())
       idPath = m_pDS->fv("path.idPath").get_asInt();
 
@@ -667,11 +667,11 @@ bool CVideoDatabase::GetPathsForTvShow(int idShow, std::set<int>& paths)
   return false;
 }
 
-int CVideoDatabase::RunQuery(const std::string &sql)
+int CVideoDatabase::RunQuery(const std::string &sql, bool forwardOnly /* = false */)
 {
   unsigned int time = XbmcThreads::SystemClockMillis();
   int rows = -1;
-  if (m_pDS->query(sql))
+  if (forwardOnly ? m_pDS->query_cursor(sql) : m_pDS->query(sql))
   {
     rows = m_pDS->num_rows();
     if (rows == 0)
@@ -733,21 +733,10 @@ int CVideoDatabase::AddPath(const std::string& strPath, const std::string &paren
     int idParentPath = GetPathId(parentPath.empty() ? (std::string)URIUtils::GetParentPath(strPath1) : parentPath);
 
     // add the path
-    if (idParentPath < 0)
-    {
-      if (dateAdded.IsValid())
-        strSQL=PrepareSQL("insert into path (idPath, strPath, dateAdded) values (NULL, '%s', '%s')", strPath1.c_str(), dateAdded.GetAsDBDateTime().c_str());
-      else
-        strSQL=PrepareSQL("insert into path (idPath, strPath) values (NULL, '%s')", strPath1.c_str());
-    }
-    else
-    {
-      if (dateAdded.IsValid())
-        strSQL = PrepareSQL("insert into path (idPath, strPath, dateAdded, idParentPath) values (NULL, '%s', '%s', %i)", strPath1.c_str(), dateAdded.GetAsDBDateTime().c_str(), idParentPath);
-      else
-        strSQL=PrepareSQL("insert into path (idPath, strPath, idParentPath) values (NULL, '%s', %i)", strPath1.c_str(), idParentPath);
-    }
-    m_pDS->exec(strSQL);
+    strSQL = "insert into path (idPath, strPath, dateAdded, idParentPath) values (NULL, ?, ?, ?)";
+    m_pDS->exec_prepared(strSQL, { strPath1,
+                                   dateAdded.IsValid() ? field_value(dateAdded.GetAsDBDateTime()) : field_value::null_value(),
+                                   idParentPath < 0 ? field_value::null_value() : field_value(idParentPath) });
     idPath = (int)m_pDS->lastinsertid();
     return idPath;
   }
@@ -879,9 +868,8 @@ int CVideoDatabase::AddFile(const std::string& strFileNameAndPath)
     if (idPath < 0)
       return -1;
 
-    std::string strSQL=PrepareSQL("select idFile from files where strFileName='%s' and idPath=%i", strFileName.c_str(),idPath);
-
-    m_pDS->query(strSQL);
+    strSQL = "select idFile from files where strFileName=? and idPath=?";
+    m_pDS->query_prepared(strSQL, { strFileName, idPath });
     if (m_pDS->num_rows() > 0)
     {
       idFile = m_pDS->fv("idFile").get_asInt() ;
@@ -890,8 +878,8 @@ int CVideoDatabase::AddFile(const std::string& strFileNameAndPath)
     }
     m_pDS->close();
 
-    strSQL=PrepareSQL("insert into files (idFile, idPath, strFileName) values(NULL, %i, '%s')", idPath, strFileName.c_str());
-    m_pDS->exec(strSQL);
+    strSQL = "insert into files (idFile, idPath, strFileName) values(NULL, ?, ?)";
+    m_pDS->exec_prepared(strSQL, { idPath, strFileName });
     idFile = (int)m_pDS->lastinsertid();
     return idFile;
   }
@@ -2167,6 +2155,12 @@ bool CVideoDatabase::GetFileInfo(const std::string& strFilenameAndPath, CVideoIn
 }
 
 std::string CVideoDatabase::GetValueString(const CVideoInfoTag &details, int min, int max, const SDbTableOffsets *offsets) const
+{
+  std::vector<field_value> values;
+  return m_pDB->bind_params(GetValueString(details, min, max, offsets, values), values);
+}
+
+std::string CVideoDatabase::GetValueString(const CVideoInfoTag &details, int min, int max, const SDbTableOffsets *offsets, std::vector<field_value> &values) const
 {
   std::vector<std::string> conditions;
   for (int i = min + 1; i < max; ++i)
@@ -2174,39 +2168,40 @@ std::string CVideoDatabase::GetValueString(const CVideoInfoTag &details, int min
     switch (offsets[i].type)
     {
     case VIDEODB_TYPE_STRING:
-      conditions.emplace_back(PrepareSQL("c%02d='%s'", i, ((std::string*)(((char*)&details)+offsets[i].offset))->c_str()));
+      values.emplace_back(*(std::string*)(((char*)&details)+offsets[i].offset));
       break;
     case VIDEODB_TYPE_INT:
-      conditions.emplace_back(PrepareSQL("c%02d='%i'", i, *(int*)(((char*)&details)+offsets[i].offset)));
+      values.emplace_back(StringUtils::Format("%i", *(int*)(((char*)&details)+offsets[i].offset)));
       break;
     case VIDEODB_TYPE_COUNT:
       {
         int value = *(int*)(((char*)&details)+offsets[i].offset);
         if (value)
-          conditions.emplace_back(PrepareSQL("c%02d=%i", i, value));
+          values.emplace_back(value);
         else
-          conditions.emplace_back(PrepareSQL("c%02d=NULL", i));
+          values.push_back(field_value::null_value());
       }
       break;
     case VIDEODB_TYPE_BOOL:
-      conditions.emplace_back(PrepareSQL("c%02d='%s'", i, *(bool*)(((char*)&details)+offsets[i].offset)?"true":"false"));
+      values.emplace_back(*(bool*)(((char*)&details)+offsets[i].offset)?"true":"false");
       break;
     case VIDEODB_TYPE_FLOAT:
-      conditions.emplace_back(PrepareSQL("c%02d='%f'", i, *(float*)(((char*)&details)+offsets[i].offset)));
+      values.emplace_back(StringUtils::Format("%f", *(float*)(((char*)&details)+offsets[i].offset)));
       break;
     case VIDEODB_TYPE_STRINGARRAY:
-      conditions.emplace_back(PrepareSQL("c%02d='%s'", i, StringUtils::Join(*((std::vector<std::string>*)(((char*)&details)+offsets[i].offset)),
-                                                                          g_advancedSettings.m_videoItemSeparator).c_str()));
+      values.emplace_back(StringUtils::Join(*((std::vector<std::string>*)(((char*)&details)+offsets[i].offset)),
+                                            g_advancedSettings.m_videoItemSeparator));
       break;
     case VIDEODB_TYPE_DATE:
-      conditions.emplace_back(PrepareSQL("c%02d='%s'", i, ((CDateTime*)(((char*)&details)+offsets[i].offset))->GetAsDBDate().c_str()));
+      values.emplace_back(((CDateTime*)(((char*)&details)+offsets[i].offset))->GetAsDBDate());
       break;
     case VIDEODB_TYPE_DATETIME:
-      conditions.emplace_back(PrepareSQL("c%02d='%s'", i, ((CDateTime*)(((char*)&details)+offsets[i].offset))->GetAsDBDateTime().c_str()));
+      values.emplace_back(((CDateTime*)(((char*)&details)+offsets[i].offset))->GetAsDBDateTime());
       break;
     case VIDEODB_TYPE_UNUSED: // Skip the unused field to avoid populating unused data
       continue;
     }
+    conditions.emplace_back(StringUtils::Format("c%02d=?", i));
   }
   return StringUtils::Join(conditions, ",");
 }
@@ -2724,11 +2719,10 @@ int CVideoDatabase::SetDetailsForEpisode(const std::string& strFilenameAndPath,
     { // query DB for any episodes matching idShow, Season and Episode
       std::string strSQL = PrepareSQL("SELECT files.playCount, files.lastPlayed "
                                       "FROM episode INNER JOIN files ON files.idFile=episode.idFile "
-                                      "WHERE episode.c%02d=%i AND episode.c%02d=%i AND episode.idShow=%i "
-                                      "AND episode.idEpisode!=%i AND files.playCount > 0", 
-                                      VIDEODB_ID_EPISODE_SEASON, details.m_iSeason, VIDEODB_ID_EPISODE_EPISODE,
-                                      details.m_iEpisode, idShow, idEpisode);
-      m_pDS->query(strSQL);
+                                      "WHERE episode.c%02d=? AND episode.c%02d=? AND episode.idShow=? "
+                                      "AND episode.idEpisode!=? AND files.playCount > 0", 
+                                      VIDEODB_ID_EPISODE_SEASON, VIDEODB_ID_EPISODE_EPISODE);
+      m_pDS->query_prepared(strSQL, { details.m_iSeason, details.m_iEpisode, idShow, idEpisode });
 
       if (!m_pDS->eof())
       {
@@ -2740,21 +2734,23 @@ int CVideoDatabase::SetDetailsForEpisode(const std::string& strFilenameAndPath,
         int idFile = GetFileId(strFilenameAndPath);
 
         // update with playCount and lastPlayed
-        strSQL = PrepareSQL("update files set playCount=%i,lastPlayed='%s' where idFile=%i", playCount, lastPlayed.GetAsDBDateTime().c_str(), idFile);
-        m_pDS->exec(strSQL);
+        m_pDS->exec_prepared("update files set playCount=?,lastPlayed=? where idFile=?",
+                             { playCount, lastPlayed.GetAsDBDateTime(), idFile });
       }
 
       m_pDS->close();
     }
     // and insert the new row
-    std::string sql = "UPDATE episode SET " + GetValueString(details, VIDEODB_ID_EPISODE_MIN, VIDEODB_ID_EPISODE_MAX, DbEpisodeOffsets);
+    std::vector<field_value> values;
+    std::string sql = "UPDATE episode SET " + GetValueString(details, VIDEODB_ID_EPISODE_MIN, VIDEODB_ID_EPISODE_MAX, DbEpisodeOffsets, values);
+    sql += ", userrating = ?, idSeason = ? where idEpisode=?";
     if (details.m_iUserRating > 0 && details.m_iUserRating < 11)
-      sql += PrepareSQL(", userrating = %i", details.m_iUserRating);
+      values.emplace_back(details.m_iUserRating);
     else
-      sql += ", userrating = NULL";
-    sql += PrepareSQL(", idSeason = %i", idSeason);
-    sql += PrepareSQL(" where idEpisode=%i", idEpisode);
-    m_pDS->exec(sql);
+      values.push_back(field_value::null_value());
+    values.emplace_back(idSeason);
+    values.emplace_back(idEpisode);
+    m_pDS->exec_prepared(sql, values);
     CommitTransaction();
 
     return idEpisode;
@@ -6675,29 +6671,8 @@ bool CVideoDatabase::GetMoviesByWhere(const std::string& strBaseDir, const Filte
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
-    int iRowsFound = RunQuery(strSQL);
-    if (iRowsFound <= 0)
-      return iRowsFound == 0;
-
-    // store the total value of items as a property
-    if (total < iRowsFound)
-      total = iRowsFound;
-    items.SetProperty("total", total);
-    
-    DatabaseResults results;
-    results.reserve(iRowsFound);
-
-    if (!SortUtils::SortFromDataset(sortDescription, MediaTypeMovie, m_pDS, results))
-      return false;
-
-    // get data from returned rows
-    items.Reserve(results.size());
-    const query_data &data = m_pDS->get_result_set().records;
-    for (const auto &i : results)
+    auto addItem = [&](const dbiplus::sql_record* const record)
     {
-      unsigned int targetRow = (unsigned int)i.at(FieldRow).asInteger();
-      const dbiplus::sql_record* const record = data.at(targetRow);
-
       CVideoInfoTag movie = GetDetailsForMovie(record, getDetails);
       if (CProfilesManager::GetInstance().GetMasterProfile().getLockMode() == LOCK_MODE_EVERYONE ||
           g_passwordManager.bMasterUser                                   ||
@@ -6713,6 +6688,46 @@ bool CVideoDatabase::GetMoviesByWhere(const std::string& strBaseDir, const Filte
         pItem->SetOverlayImage(CGUIListItem::ICON_OVERLAY_UNWATCHED,movie.GetPlayCount() > 0);
         items.Add(pItem);
       }
+    };
+
+    if (sortDescription.sortBy == SortByNone)
+    {
+      // nothing to sort in memory, so step through a forward-only cursor
+      // rather than materializing the whole result set first
+      int iRowsFound = RunQuery(strSQL, true);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      for (; !m_pDS->eof(); m_pDS->next())
+        addItem(m_pDS->get_sql_record());
+
+      // store the total value of items as a property
+      if (total < m_pDS->num_rows())
+        total = m_pDS->num_rows();
+      items.SetProperty("total", total);
+    }
+    else
+    {
+      int iRowsFound = RunQuery(strSQL);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      // store the total value of items as a property
+      if (total < iRowsFound)
+        total = iRowsFound;
+      items.SetProperty("total", total);
+    
+      DatabaseResults results;
+      results.reserve(iRowsFound);
+
+      if (!SortUtils::SortFromDataset(sortDescription, MediaTypeMovie, m_pDS, results))
+        return false;
+
+      // get data from returned rows
+      items.Reserve(results.size());
+      const query_data &data = m_pDS->get_result_set().records;
+      for (const auto &i : results)
+        addItem(data.at((unsigned int)i.at(FieldRow).asInteger()));
     }
 
     // cleanup
@@ -6783,28 +6798,8 @@ bool CVideoDatabase::GetTvShowsByWhere(const std::string& strBaseDir, const Filt
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
-    int iRowsFound = RunQuery(strSQL);
-    if (iRowsFound <= 0)
-      return iRowsFound == 0;
-
-    // store the total value of items as a property
-    if (total < iRowsFound)
-      total = iRowsFound;
-    items.SetProperty("total", total);
-    
-    DatabaseResults results;
-    results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sorting, MediaTypeTvShow, m_pDS, results))
-      return false;
-
-    // get data from returned rows
-    items.Reserve(results.size());
-    const query_data &data = m_pDS->get_result_set().records;
-    for (const auto &i : results)
+    auto addItem = [&](const dbiplus::sql_record* const record)
     {
-      unsigned int targetRow = (unsigned int)i.at(FieldRow).asInteger();
-      const dbiplus::sql_record* const record = data.at(targetRow);
-      
       CFileItemPtr pItem(new CFileItem());
       CVideoInfoTag movie = GetDetailsForTvShow(record, getDetails, pItem.get());
       if (CProfilesManager::GetInstance().GetMasterProfile().getLockMode() == LOCK_MODE_EVERYONE ||
@@ -6821,6 +6816,45 @@ bool CVideoDatabase::GetTvShowsByWhere(const std::string& strBaseDir, const Filt
         pItem->SetOverlayImage(CGUIListItem::ICON_OVERLAY_UNWATCHED, (pItem->GetVideoInfoTag()->GetPlayCount() > 0) && (pItem->GetVideoInfoTag()->m_iEpisode > 0));
         items.Add(pItem);
       }
+    };
+
+    if (sorting.sortBy == SortByNone)
+    {
+      // nothing to sort in memory, so step through a forward-only cursor
+      // rather than materializing the whole result set first
+      int iRowsFound = RunQuery(strSQL, true);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      for (; !m_pDS->eof(); m_pDS->next())
+        addItem(m_pDS->get_sql_record());
+
+      // store the total value of items as a property
+      if (total < m_pDS->num_rows())
+        total = m_pDS->num_rows();
+      items.SetProperty("total", total);
+    }
+    else
+    {
+      int iRowsFound = RunQuery(strSQL);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      // store the total value of items as a property
+      if (total < iRowsFound)
+        total = iRowsFound;
+      items.SetProperty("total", total);
+    
+      DatabaseResults results;
+      results.reserve(iRowsFound);
+      if (!SortUtils::SortFromDataset(sorting, MediaTypeTvShow, m_pDS, results))
+        return false;
+
+      // get data from returned rows
+      items.Reserve(results.size());
+      const query_data &data = m_pDS->get_result_set().records;
+      for (const auto &i : results)
+        addItem(data.at((unsigned int)i.at(FieldRow).asInteger()));
     }
 
     // cleanup
@@ -6909,30 +6943,9 @@ bool CVideoDatabase::GetEpisodesByWhere(const std::string& strBaseDir, const Fil
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
-    int iRowsFound = RunQuery(strSQL);
-    if (iRowsFound <= 0)
-      return iRowsFound == 0;
-
-    // store the total value of items as a property
-    if (total < iRowsFound)
-      total = iRowsFound;
-    items.SetProperty("total", total);
-    
-    DatabaseResults results;
-    results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sorting, MediaTypeEpisode, m_pDS, results))
-      return false;
-    
-    // get data from returned rows
-    items.Reserve(results.size());
     CLabelFormatter formatter("%H. %T", "");
-
-    const query_data &data = m_pDS->get_result_set().records;
-    for (const auto &i : results)
+    auto addItem = [&](const dbiplus::sql_record* const record)
     {
-      unsigned int targetRow = (unsigned int)i.at(FieldRow).asInteger();
-      const dbiplus::sql_record* const record = data.at(targetRow);
-
       CVideoInfoTag movie = GetDetailsForEpisode(record, getDetails);
       if (CProfilesManager::GetInstance().GetMasterProfile().getLockMode() == LOCK_MODE_EVERYONE ||
           g_passwordManager.bMasterUser                                     ||
@@ -6956,6 +6969,45 @@ bool CVideoDatabase::GetEpisodesByWhere(const std::string& strBaseDir, const Fil
         pItem->m_dateTime = movie.m_firstAired;
         items.Add(pItem);
       }
+    };
+
+    if (sorting.sortBy == SortByNone)
+    {
+      // nothing to sort in memory, so step through a forward-only cursor
+      // rather than materializing the whole result set first
+      int iRowsFound = RunQuery(strSQL, true);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      for (; !m_pDS->eof(); m_pDS->next())
+        addItem(m_pDS->get_sql_record());
+
+      // store the total value of items as a property
+      if (total < m_pDS->num_rows())
+        total = m_pDS->num_rows();
+      items.SetProperty("total", total);
+    }
+    else
+    {
+      int iRowsFound = RunQuery(strSQL);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      // store the total value of items as a property
+      if (total < iRowsFound)
+        total = iRowsFound;
+      items.SetProperty("total", total);
+    
+      DatabaseResults results;
+      results.reserve(iRowsFound);
+      if (!SortUtils::SortFromDataset(sorting, MediaTypeEpisode, m_pDS, results))
+        return false;
+    
+      // get data from returned rows
+      items.Reserve(results.size());
+      const query_data &data = m_pDS->get_result_set().records;
+      for (const auto &i : results)
+        addItem(data.at((unsigned int)i.at(FieldRow).asInteger()));
     }
 
     // cleanup
@@ -7750,29 +7802,8 @@ bool CVideoDatabase::GetMusicVideosByWhere(const std::string &baseDir, const Fil
 
     strSQL = PrepareSQL(strSQL, !extFilter.fields.empty() ? extFilter.fields.c_str() : "*") + strSQLExtra;
 
-    int iRowsFound = RunQuery(strSQL);
-    if (iRowsFound <= 0)
-      return iRowsFound == 0;
-
-    // store the total value of items as a property
-    if (total < iRowsFound)
-      total = iRowsFound;
-    items.SetProperty("total", total);
-    
-    DatabaseResults results;
-    results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sorting, MediaTypeMusicVideo, m_pDS, results))
-      return false;
-    
-    // get data from returned rows
-    items.Reserve(results.size());
-    // get songs from returned subtable
-    const query_data &data = m_pDS->get_result_set().records;
-    for (const auto &i : results)
-    {
-      unsigned int targetRow = (unsigned int)i.at(FieldRow).asInteger();
-      const dbiplus::sql_record* const record = data.at(targetRow);
-      
+    auto addItem = [&](const dbiplus::sql_record* const record)
+    {
       CVideoInfoTag musicvideo = GetDetailsForMusicVideo(record, getDetails);
       if (!checkLocks || CProfilesManager::GetInstance().GetMasterProfile().getLockMode() == LOCK_MODE_EVERYONE || g_passwordManager.bMasterUser ||
           g_passwordManager.IsDatabasePathUnlocked(musicvideo.m_strPath, *CMediaSourceSettings::GetInstance().GetSources("video")))
@@ -7787,6 +7818,46 @@ bool CVideoDatabase::GetMusicVideosByWhere(const std::string &baseDir, const Fil
         item->SetOverlayImage(CGUIListItem::ICON_OVERLAY_UNWATCHED, musicvideo.GetPlayCount() > 0);
         items.Add(item);
       }
+    };
+
+    if (sorting.sortBy == SortByNone)
+    {
+      // nothing to sort in memory, so step through a forward-only cursor
+      // rather than materializing the whole result set first
+      int iRowsFound = RunQuery(strSQL, true);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      for (; !m_pDS->eof(); m_pDS->next())
+        addItem(m_pDS->get_sql_record());
+
+      // store the total value of items as a property
+      if (total < m_pDS->num_rows())
+        total = m_pDS->num_rows();
+      items.SetProperty("total", total);
+    }
+    else
+    {
+      int iRowsFound = RunQuery(strSQL);
+      if (iRowsFound <= 0)
+        return iRowsFound == 0;
+
+      // store the total value of items as a property
+      if (total < iRowsFound)
+        total = iRowsFound;
+      items.SetProperty("total", total);
+    
+      DatabaseResults results;
+      results.reserve(iRowsFound);
+      if (!SortUtils::SortFromDataset(sorting, MediaTypeMusicVideo, m_pDS, results))
+        return false;
+    
+      // get data from returned rows
+      items.Reserve(results.size());
+      // get songs from returned subtable
+      const query_data &data = m_pDS->get_result_set().records;
+      for (const auto &i : results)
+        addItem(data.at((unsigned int)i.at(FieldRow).asInteger()));
     }
 
     // cleanup
@@ -9533,6 +9604,8 @@ bool CVideoDatabase::CommitTransaction()
 {
   if (CDatabase::CommitTransaction())
   { // number of items in the db has likely changed, so recalculate
+    if (InBatch())
+      return true;
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MOVIES, HasContent(VIDEODB_CONTENT_MOVIES));
     g_infoManager.SetLibraryBool(LIBRARY_HAS_TVSHOWS, HasContent(VIDEODB_CONTENT_TVSHOWS));
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MUSICVIDEOS, HasContent(VIDEODB_CONTENT_MUSICVIDEOS));
@@ -927,6 +927,12 @@ protected:
   void GetDetailsFromDB(const dbiplus::sql_record* const record, int min, int max, const SDbTableOffsets *offsets, CVideoInfoTag &details, int idxOffset = 2);
   std::string GetValueString(const CVideoInfoTag &details, int min, int max, const SDbTableOffsets *offsets) const;
 
+  /*! \brief Get the "cXX=?" assignments of the details for a prepared query
+   \param values [out] the values to bind to the placeholders, appended in order
+   \sa GetValueString, ExecutePreparedQuery
+   */
+  std::string GetValueString(const CVideoInfoTag &details, int min, int max, const SDbTableOffsets *offsets, std::vector<dbiplus::field_value> &values) const;
+
 private:
   virtual void CreateTables();
   virtual void CreateAnalytics();
@@ -949,9 +955,10 @@ private:
   /*! \brief Run a query on the main dataset and return the number of rows
    If no rows are found we close the dataset and return 0.
    \param sql the sql query to run
+   \param forwardOnly whether to open a forward-only cursor, in which case only the rows fetched so far are counted.
    \return the number of rows, -1 for an error.
    */
-  int RunQuery(const std::string &sql);
+  int RunQuery(const std::string &sql, bool forwardOnly = false);
 
   void AppendIdLinkFilter(const char* field, const char *table, const MediaType& mediaType, const char *view, const char *viewKey, const CUrlOptions::UrlOptions& options, Filter &filter);
   void AppendLinkFilter(const char* field, const char *table, const MediaType& mediaType, const char *view, const char *viewKey, const CUrlOptions::UrlOptions& options, Filter &filter);
@@ -30,6 +30,7 @@
 #include "events/MediaLibraryEvent.h"
 #include "FileItem.h"
 #include "filesystem/DirectoryCache.h"
+#include "filesystem/DirectoryIndex.h"
 #include "filesystem/File.h"
 #include "filesystem/MultiPathDirectory.h"
 #include "filesystem/StackDirectory.h"
@@ -116,6 +117,14 @@ namespace VIDEO
 
       m_database.Open();
 
+      // folders are listed and items looked up ahead on other threads, the
+      // database is only accessed from this one
+      if (g_advancedSettings.m_videoScannerThreads > 1)
+      {
+        m_listings.reset(new CPrefetchQueue<SDirectoryListing>(g_advancedSettings.m_videoScannerThreads));
+        m_lookups.reset(new CPrefetchQueue<SVideoLookup>(g_advancedSettings.m_videoScannerThreads));
+      }
+
       m_bCanInterrupt = true;
 
       CLog::Log(LOGNOTICE, "VideoInfoScanner: Starting scan ..");
@@ -154,8 +163,19 @@ namespace VIDEO
           CLog::Log(LOGWARNING, "%s directory '%s' does not exist - skipping scan%s.", __FUNCTION__, CURL::GetRedacted(directory).c_str(), m_bClean ? " and clean" : "");
           m_pathsToScan.erase(m_pathsToScan.begin());
         }
-        else if (!DoScan(directory))
-          bCancelled = true;
+        else
+        {
+          // list the next paths while this one is scanned
+          if (m_listings)
+          {
+            std::set<std::string>::const_iterator next = m_pathsToScan.begin();
+            for (int i = 0; i < g_advancedSettings.m_videoScannerThreads && ++next != m_pathsToScan.end(); i++)
+              PrefetchDirectory(*next);
+          }
+
+          if (!DoScan(directory))
+            bCancelled = true;
+        }
       }
 
       if (!bCancelled)
@@ -180,7 +200,10 @@ namespace VIDEO
     {
       CLog::Log(LOGERROR, "VideoInfoScanner: Exception while scanning.");
     }
-    
+
+    m_listings.reset();
+    m_lookups.reset();
+
     m_bRunning = false;
     ANNOUNCEMENT::CAnnouncementManager::GetInstance().Announce(ANNOUNCEMENT::VideoLibrary, "xbmc", "OnScanFinished");
     
@@ -286,25 +309,18 @@ namespace VIDEO
         m_handle->SetTitle(StringUtils::Format(g_localizeStrings.Get(str).c_str(), info->Name().c_str()));
       }
 
-      std::string fastHash;
-      if (g_advancedSettings.m_bVideoLibraryUseFastHash)
-        fastHash = GetFastHash(strDirectory, regexps);
+      m_database.GetPathHash(strDirectory, dbHash);
 
-      if (m_database.GetPathHash(strDirectory, dbHash) && !fastHash.empty() && fastHash == dbHash)
-      { // fast hashes match - no need to process anything
-        hash = fastHash;
-      }
-      else
-      { // need to fetch the folder
-        CDirectory::GetDirectory(strDirectory, items, g_advancedSettings.m_videoExtensions);
-        items.Stack();
+      // list the folder unless it was listed ahead already, against the same hash
+      SDirectoryListing listing;
+      if (!m_listings || !m_listings->Take(strDirectory, listing) ||
+          (!listing.items && listing.fastHash != dbHash))
+        ListDirectory(strDirectory, dbHash, regexps, listing);
 
-        // check whether to re-use previously computed fast hash
-        if (!CanFastHash(items, regexps) || fastHash.empty())
-          GetPathHash(items, hash);
-        else
-          hash = fastHash;
-      }
+      const std::string &fastHash = listing.fastHash;
+      hash = listing.hash;
+      if (listing.items)
+        items.Assign(*listing.items);
 
       if (hash == dbHash)
       { // hash matches - skipping
@@ -353,6 +369,17 @@ namespace VIDEO
       }
     }
 
+    // list the subfolders while the items of this one are looked up
+    if (m_listings && settings.recurse > 0 && content != CONTENT_TVSHOWS)
+    {
+      for (int i = 0; i < items.Size(); ++i)
+      {
+        const CFileItemPtr &pItem = items[i];
+        if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList())
+          PrefetchDirectory(pItem->GetPath());
+      }
+    }
+
     if (!bSkip)
     {
       if (RetrieveVideoInfo(items, settings.parent_name_root, content))
@@ -417,7 +444,15 @@ namespace VIDEO
 
     m_database.Open();
 
+    // look up movies and music videos on several threads and add them in batches
+    bool prefetched = false;
+    if (m_lookups && !pURL && !pDlgProgress && (content == CONTENT_MOVIES || content == CONTENT_MUSICVIDEOS))
+      prefetched = PrefetchLookups(items, bDirNames, useLocal);
+    if (prefetched)
+      m_database.BeginBatch();
+
     bool FoundSomeInfo = false;
+    int added = 0;
     std::vector<int> seenPaths;
     for (int i = 0; i < (int)items.Size(); ++i)
     {
@@ -440,8 +475,9 @@ namespace VIDEO
           m_handle->SetPercentage(i*100.f/items.Size());
       }
 
-      // clear our scraper cache
-      info2->ClearCache();
+      // clear our scraper cache, unless the lookups running ahead use it already
+      if (!prefetched)
+        info2->ClearCache();
 
       INFO_RET ret = INFO_CANCELLED;
       if (info2->Content() == CONTENT_TVSHOWS)
@@ -465,6 +501,11 @@ namespace VIDEO
         FoundSomeInfo = false;
         break;
       }
+      if (ret == INFO_ADDED && prefetched && ++added % 50 == 0)
+      { // don't keep the database locked for too long
+        m_database.CommitBatch();
+        m_database.BeginBatch();
+      }
       if (ret == INFO_ADDED || ret == INFO_HAVE_ALREADY)
         FoundSomeInfo = true;
       else if (ret == INFO_NOT_FOUND)
@@ -489,6 +530,15 @@ namespace VIDEO
         seenPaths.push_back(m_database.GetPathId(pItem->GetPath()));
     }
 
+    if (prefetched)
+    {
+      m_database.CommitBatch();
+
+      // lookups of the items left when the scan was stopped
+      m_lookups->Cancel();
+      m_lookups->Reset();
+    }
+
     if (content == CONTENT_TVSHOWS && ! seenPaths.empty())
     {
       std::vector<std::pair<int, std::string>> libPaths;
@@ -600,46 +650,16 @@ namespace VIDEO
     if (m_handle)
       m_handle->SetText(pItem->GetMovieName(bDirNames));
 
-    CNfoFile::NFOResult result=CNfoFile::NO_NFO;
-    CScraperUrl scrUrl;
-    // handle .nfo files
-    if (useLocal)
-      result = CheckForNFOFile(pItem, bDirNames, info2, scrUrl);
-    if (result == CNfoFile::FULL_NFO)
+    SVideoLookup lookup;
+    if (m_lookups && TakeLookup(pItem->GetPath(), lookup))
     {
-      pItem->GetVideoInfoTag()->Reset();
-      m_nfoReader.GetDetails(*pItem->GetVideoInfoTag());
-
-      if (AddVideo(pItem, info2->Content(), bDirNames, true) < 0)
-        return INFO_ERROR;
-      return INFO_ADDED;
+      if (lookup.details)
+        *pItem->GetVideoInfoTag() = lookup.tag;
     }
-    if (result == CNfoFile::URL_NFO || result == CNfoFile::COMBINED_NFO)
-      pURL = &scrUrl;
-
-    CScraperUrl url;
-    int retVal = 0;
-    if (pURL && !pURL->m_url.empty())
-      url = *pURL;
-    else if ((retVal = FindVideo(pItem->GetMovieName(bDirNames), info2, url, pDlgProgress)) <= 0)
-      return retVal < 0 ? INFO_CANCELLED : INFO_NOT_FOUND;
-
-    CLog::Log(LOGDEBUG,
-              "VideoInfoScanner: Fetching url '%s' using %s scraper (content: '%s')",
-              url.m_url[0].m_url.c_str(), info2->Name().c_str(),
-              TranslateContent(info2->Content()).c_str());
+    else
+      LookupVideo(*pItem, bDirNames, info2, useLocal, pURL, pDlgProgress, lookup);
 
-    if (GetDetails(pItem, url, info2,
-                   (result == CNfoFile::COMBINED_NFO
-                    || result == CNfoFile::PARTIAL_NFO) ? &m_nfoReader : NULL,
-                   pDlgProgress))
-    {
-      if (AddVideo(pItem, info2->Content(), bDirNames, useLocal) < 0)
-        return INFO_ERROR;
-      return INFO_ADDED;
-    }
-    //! @todo This is not strictly correct as we could fail to download information here or error, or be cancelled
-    return INFO_NOT_FOUND;
+    return AddLookup(pItem, bDirNames, useLocal, lookup, pDlgProgress);
   }
 
   INFO_RET CVideoInfoScanner::RetrieveInfoForMusicVideo(CFileItem *pItem, bool bDirNames, ScraperPtr &info2, bool useLocal, CScraperUrl* pURL, CGUIDialogProgress* pDlgProgress)
@@ -657,46 +677,195 @@ namespace VIDEO
     if (m_handle)
       m_handle->SetText(pItem->GetMovieName(bDirNames));
 
+    SVideoLookup lookup;
+    if (m_lookups && TakeLookup(pItem->GetPath(), lookup))
+    {
+      if (lookup.details)
+        *pItem->GetVideoInfoTag() = lookup.tag;
+    }
+    else
+      LookupVideo(*pItem, bDirNames, info2, useLocal, pURL, pDlgProgress, lookup);
+
+    return AddLookup(pItem, bDirNames, useLocal, lookup, pDlgProgress);
+  }
+
+  bool CVideoInfoScanner::TakeLookup(const std::string &path, SVideoLookup &lookup)
+  {
+    if (!m_database.InBatch() || m_lookups->IsFinished(path))
+      return m_lookups->Take(path, lookup);
+
+    m_database.CommitBatch();
+    bool taken = m_lookups->Take(path, lookup);
+    m_database.BeginBatch();
+    return taken;
+  }
+
+  void CVideoInfoScanner::LookupVideo(CFileItem &item, bool bDirNames, ScraperPtr scraper, bool useLocal, const CScraperUrl *pURL, CGUIDialogProgress *pDialog, SVideoLookup &lookup) const
+  {
+    CNfoFile nfoReader;
     CNfoFile::NFOResult result=CNfoFile::NO_NFO;
     CScraperUrl scrUrl;
     // handle .nfo files
     if (useLocal)
-      result = CheckForNFOFile(pItem, bDirNames, info2, scrUrl);
+      result = CheckForNFOFile(&item, bDirNames, scraper, scrUrl, nfoReader);
+    lookup.scraper = scraper;
     if (result == CNfoFile::FULL_NFO)
     {
-      pItem->GetVideoInfoTag()->Reset();
-      m_nfoReader.GetDetails(*pItem->GetVideoInfoTag());
-
-      if (AddVideo(pItem, info2->Content(), bDirNames, true) < 0)
-        return INFO_ERROR;
-      return INFO_ADDED;
+      item.GetVideoInfoTag()->Reset();
+      nfoReader.GetDetails(*item.GetVideoInfoTag());
+      lookup.details = true;
+      return;
     }
     if (result == CNfoFile::URL_NFO || result == CNfoFile::COMBINED_NFO)
       pURL = &scrUrl;
 
+    CVideoInfoDownloader imdb(scraper);
     CScraperUrl url;
-    int retVal = 0;
     if (pURL && !pURL->m_url.empty())
       url = *pURL;
-    else if ((retVal = FindVideo(pItem->GetMovieName(bDirNames), info2, url, pDlgProgress)) <= 0)
-      return retVal < 0 ? INFO_CANCELLED : INFO_NOT_FOUND;
+    else
+    {
+      MOVIELIST movielist;
+      lookup.found = imdb.FindMovie(item.GetMovieName(bDirNames), movielist, pDialog);
+      if (lookup.found <= 0 || movielist.empty())
+        return;
+      url = movielist[0];
+    }
 
     CLog::Log(LOGDEBUG,
               "VideoInfoScanner: Fetching url '%s' using %s scraper (content: '%s')",
-              url.m_url[0].m_url.c_str(), info2->Name().c_str(),
-              TranslateContent(info2->Content()).c_str());
+              url.m_url[0].m_url.c_str(), scraper->Name().c_str(),
+              TranslateContent(scraper->Content()).c_str());
 
-    if (GetDetails(pItem, url, info2,
-                   (result == CNfoFile::COMBINED_NFO
-                    || result == CNfoFile::PARTIAL_NFO) ? &m_nfoReader : NULL,
-                   pDlgProgress))
+    CVideoInfoTag movieDetails;
+    if (!imdb.GetDetails(url, movieDetails, pDialog))
+      return; // no info found, or cancelled
+
+    if (result == CNfoFile::COMBINED_NFO || result == CNfoFile::PARTIAL_NFO)
+      nfoReader.GetDetails(movieDetails, NULL, true);
+
+    if (pDialog)
     {
-      if (AddVideo(pItem, info2->Content(), bDirNames, useLocal) < 0)
-        return INFO_ERROR;
-      return INFO_ADDED;
+      pDialog->SetLine(1, CVariant{movieDetails.m_strTitle});
+      pDialog->Progress();
+    }
+
+    *item.GetVideoInfoTag() = movieDetails;
+    lookup.title = url.strTitle;
+    lookup.details = true;
+  }
+
+  INFO_RET CVideoInfoScanner::AddLookup(CFileItem *pItem, bool bDirNames, bool useLocal, const SVideoLookup &lookup, CGUIDialogProgress *pDialog)
+  {
+    if (lookup.found < 0 || (lookup.found == 0 && (m_bStop || !DownloadFailed(pDialog))))
+    { // scraper reported an error, or we had an error and user wants to cancel the scan
+      m_bStop = true;
+      return INFO_CANCELLED;
     }
+
     //! @todo This is not strictly correct as we could fail to download information here or error, or be cancelled
-    return INFO_NOT_FOUND;
+    if (!lookup.details)
+      return INFO_NOT_FOUND;
+
+    if (m_handle)
+      m_handle->SetText(!lookup.title.empty() ? lookup.title : pItem->GetVideoInfoTag()->m_strTitle);
+
+    if (AddVideo(pItem, lookup.scraper->Content(), bDirNames, useLocal) < 0)
+      return INFO_ERROR;
+    return INFO_ADDED;
+  }
+
+  void CVideoInfoScanner::ListDirectory(const std::string &directory, const std::string &dbHash, const std::vector<std::string> &excludes, SDirectoryListing &listing) const
+  {
+    listing.fastHash.clear();
+    listing.hash.clear();
+    listing.items.reset();
+
+    if (g_advancedSettings.m_bVideoLibraryUseFastHash)
+      listing.fastHash = GetFastHash(directory, excludes);
+
+    if (!listing.fastHash.empty() && listing.fastHash == dbHash)
+    { // fast hashes match - no need to process anything
+      listing.hash = listing.fastHash;
+      return;
+    }
+
+    // need to fetch the folder
+    listing.items.reset(new CFileItemList);
+    CDirectory::GetDirectory(directory, *listing.items, g_advancedSettings.m_videoExtensions);
+    listing.items->Stack();
+
+    // check whether to re-use previously computed fast hash
+    if (!CanFastHash(*listing.items, excludes) || listing.fastHash.empty())
+      GetPathHash(*listing.items, listing.hash);
+    else
+      listing.hash = listing.fastHash;
+  }
+
+  void CVideoInfoScanner::PrefetchDirectory(const std::string &directory)
+  {
+    if (!m_listings || m_listings->IsQueued(directory))
+      return;
+
+    // DoScan() only lists movie and music video folders itself
+    SScanSettings settings;
+    bool foundDirectly = false;
+    ScraperPtr info = m_database.GetScraperForPath(directory, settings, foundDirectly);
+    if (!info || (info->Content() != CONTENT_MOVIES && info->Content() != CONTENT_MUSICVIDEOS) ||
+        (!m_scanAll && settings.noupdate))
+      return;
+
+    std::string dbHash;
+    m_database.GetPathHash(directory, dbHash);
+    m_listings->Queue(directory, [this, directory, dbHash](SDirectoryListing &listing)
+    {
+      ListDirectory(directory, dbHash, g_advancedSettings.m_moviesExcludeFromScanRegExps, listing);
+    });
+  }
+
+  bool CVideoInfoScanner::PrefetchLookups(const CFileItemList &items, bool bDirNames, bool useLocal)
+  {
+    std::set<std::string> clearedCaches;
+    bool queued = false;
+    for (int i = 0; i < items.Size(); ++i)
+    {
+      const CFileItemPtr &pItem = items[i];
+      if (pItem->m_bIsFolder || !pItem->IsVideo() || pItem->IsNFO() ||
+         (pItem->IsPlayList() && !URIUtils::HasExtension(pItem->GetPath(), ".strm")))
+        continue;
+
+      if (CUtil::ExcludeFileOrFolder(pItem->GetPath(), g_advancedSettings.m_moviesExcludeFromScanRegExps))
+        continue;
+
+      // every lookup gets a scraper of its own
+      ScraperPtr info = m_database.GetScraperForPath(items.GetPath());
+      if (!info)
+        continue;
+      if (info->Content() == CONTENT_MOVIES)
+      {
+        if (m_database.HasMovieInfo(pItem->GetPath()))
+          continue;
+      }
+      else if (info->Content() == CONTENT_MUSICVIDEOS)
+      {
+        if (m_database.HasMusicVideoInfo(pItem->GetPath()))
+          continue;
+      }
+      else
+        continue;
+
+      // the lookups share the cache of the scraper, so clear it once before they start
+      if (clearedCaches.insert(info->ID()).second)
+        info->ClearCache();
+
+      CFileItemPtr item(new CFileItem(*pItem));
+      queued |= m_lookups->Queue(pItem->GetPath(), [this, item, bDirNames, info, useLocal](SVideoLookup &lookup)
+      {
+        LookupVideo(*item, bDirNames, info, useLocal, NULL, NULL, lookup);
+        lookup.tag = *item->GetVideoInfoTag();
+      });
+    }
+    return queued;
   }
 
   INFO_RET CVideoInfoScanner::RetrieveInfoForEpisodes(CFileItem *item, long showID, const ADDON::ScraperPtr &scraper, bool useLocal, CGUIDialogProgress *progress)
@@ -1866,12 +2035,13 @@ namespace VIDEO
     int64_t time = 0;
     for (int i=0; i < items.Size(); ++i)
     {
+      // the directory index checked the directories while they were listed above
       int64_t stat_time = 0;
       struct __stat64 buffer;
-      if (XFILE::CFile::Stat(items[i]->GetPath(), &buffer) == 0)
+      if (XFILE::CDirectoryIndex::GetInstance().GetModificationTime(items[i]->GetPath(), stat_time))
+        time += stat_time;
+      else if (XFILE::CFile::Stat(items[i]->GetPath(), &buffer) == 0)
       {
-        //! @todo some filesystems may return the mtime/ctime inline, in which case this is
-        //! unnecessarily expensive. Consider supporting Stat() in our directory cache?
         stat_time = buffer.st_mtime ? buffer.st_mtime : buffer.st_ctime;
         time += stat_time;
       }
@@ -2008,6 +2178,11 @@ namespace VIDEO
   }
 
   CNfoFile::NFOResult CVideoInfoScanner::CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ScraperPtr& info, CScraperUrl& scrUrl)
+  {
+    return CheckForNFOFile(pItem, bGrabAny, info, scrUrl, m_nfoReader);
+  }
+
+  CNfoFile::NFOResult CVideoInfoScanner::CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ScraperPtr& info, CScraperUrl& scrUrl, CNfoFile& nfoReader) const
   {
     std::string strNfoFile;
     if (info->Content() == CONTENT_MOVIES || info->Content() == CONTENT_MUSICVIDEOS
@@ -2020,9 +2195,9 @@ namespace VIDEO
     if (!strNfoFile.empty() && CFile::Exists(strNfoFile))
     {
       if (info->Content() == CONTENT_TVSHOWS && !pItem->m_bIsFolder)
-        result = m_nfoReader.Create(strNfoFile,info,pItem->GetVideoInfoTag()->m_iEpisode);
+        result = nfoReader.Create(strNfoFile,info,pItem->GetVideoInfoTag()->m_iEpisode);
       else
-        result = m_nfoReader.Create(strNfoFile,info);
+        result = nfoReader.Create(strNfoFile,info);
 
       std::string type;
       switch(result)
@@ -2050,19 +2225,19 @@ namespace VIDEO
       if (result == CNfoFile::FULL_NFO)
       {
         if (info->Content() == CONTENT_TVSHOWS)
-          info = m_nfoReader.GetScraperInfo();
+          info = nfoReader.GetScraperInfo();
       }
       else if (result != CNfoFile::NO_NFO && result != CNfoFile::ERROR_NFO)
       {
         if (result != CNfoFile::PARTIAL_NFO)
         {
-          scrUrl = m_nfoReader.ScraperUrl();
+          scrUrl = nfoReader.ScraperUrl();
           StringUtils::RemoveCRLF(scrUrl.m_url[0].m_url);
-          info = m_nfoReader.GetScraperInfo();
+          info = nfoReader.GetScraperInfo();
         }
 
         if (result != CNfoFile::URL_NFO)
-          m_nfoReader.GetDetails(*pItem->GetVideoInfoTag());
+          nfoReader.GetDetails(*pItem->GetVideoInfoTag());
       }
     }
     else
@@ -19,6 +19,7 @@
  *
  */
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -27,6 +28,7 @@
 #include "NfoFile.h"
 #include "VideoDatabase.h"
 #include "addons/Scraper.h"
+#include "utils/PrefetchQueue.h"
 
 class CRegExp;
 class CFileItem;
@@ -96,6 +98,7 @@ namespace VIDEO
     static void ApplyThumbToFolder(const std::string &folder, const std::string &imdbThumb);
     static bool DownloadFailed(CGUIDialogProgress* pDlgProgress);
     CNfoFile::NFOResult CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ADDON::ScraperPtr& scraper, CScraperUrl& scrUrl);
+    CNfoFile::NFOResult CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ADDON::ScraperPtr& scraper, CScraperUrl& scrUrl, CNfoFile& nfoReader) const;
 
     /*! \brief Retrieve any artwork associated with an item
      \param pItem item to find artwork for.
@@ -127,9 +130,70 @@ namespace VIDEO
     bool EnumerateEpisodeItem(const CFileItem *item, EPISODELIST& episodeList);
 
   protected:
+    /*! \brief Listing of a movie or music video folder, see ListDirectory()
+     */
+    struct SDirectoryListing
+    {
+      std::string fastHash;
+      std::string hash;
+      std::shared_ptr<CFileItemList> items;  /**< NULL if the fast hash matched and the folder wasn't listed */
+    };
+
+    /*! \brief Outcome of the online and nfo lookup of a movie or music video, see LookupVideo()
+     */
+    struct SVideoLookup
+    {
+      SVideoLookup() : found(1), details(false) {}
+      int found;                    /**< result of the search, 0 if downloading failed and <0 on errors */
+      bool details;                 /**< whether tag holds the details to add */
+      std::string title;            /**< title of the scraper url the details were fetched from */
+      CVideoInfoTag tag;
+      ADDON::ScraperPtr scraper;    /**< scraper of the lookup, an nfo file may override the one of the path */
+    };
+
     virtual void Process();
     bool DoScan(const std::string& strDirectory) override;
 
+    /*! \brief Hash and, if needed, list a movie or music video folder
+     Only accesses the filesystem, so it's run ahead of DoScan() when scanning with several threads.
+     \param directory folder to list
+     \param dbHash hash stored in the database, the folder isn't listed if the fast hash matches it
+     \param excludes string array of exclude expressions
+     \param listing [out] hashes and items of the folder
+     */
+    void ListDirectory(const std::string &directory, const std::string &dbHash, const std::vector<std::string> &excludes, SDirectoryListing &listing) const;
+
+    /*! \brief Queue the listing of a folder DoScan() is going to get to later
+     */
+    void PrefetchDirectory(const std::string &directory);
+
+    /*! \brief Queue the lookups of all movies or music videos in a list which aren't in the database yet
+     \return true if any lookup was queued
+     */
+    bool PrefetchLookups(const CFileItemList &items, bool bDirNames, bool useLocal);
+
+    /*! \brief Read the nfo file of a movie or music video and retrieve its details from the scraper
+     Neither accesses the database nor the scanner progress, so it's run ahead of
+     RetrieveVideoInfo() when scanning with several threads.
+     \param item item to look up, its video info tag is filled in
+     \param bDirNames whether we should use folder or file names for lookups.
+     \param scraper scraper to use
+     \param useLocal whether to read nfo files
+     \param pURL an optional URL to retrieve the details from
+     \param pDialog progress dialog to update and check for cancellation, must be NULL on other threads
+     \param lookup [out] the outcome
+     */
+    void LookupVideo(CFileItem &item, bool bDirNames, ADDON::ScraperPtr scraper, bool useLocal, const CScraperUrl *pURL, CGUIDialogProgress *pDialog, SVideoLookup &lookup) const;
+
+    /*! \brief Take the prefetched lookup of an item, see CPrefetchQueue::Take()
+     A batch is committed before waiting for the lookup, so the database isn't locked meanwhile, and started again afterwards.
+     */
+    bool TakeLookup(const std::string &path, SVideoLookup &lookup);
+
+    /*! \brief Add the details of a lookup to the database
+     */
+    INFO_RET AddLookup(CFileItem *pItem, bool bDirNames, bool useLocal, const SVideoLookup &lookup, CGUIDialogProgress *pDialog);
+
     INFO_RET RetrieveInfoForTvShow(CFileItem *pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, bool fetchEpisodes, CGUIDialogProgress* pDlgProgress);
     INFO_RET RetrieveInfoForMovie(CFileItem *pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, CGUIDialogProgress* pDlgProgress);
     INFO_RET RetrieveInfoForMusicVideo(CFileItem *pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, CGUIDialogProgress* pDlgProgress);
@@ -254,6 +318,8 @@ namespace VIDEO
     std::set<std::string> m_pathsToCount;
     std::set<int> m_pathsToClean;
     CNfoFile m_nfoReader;
+    std::unique_ptr<CPrefetchQueue<SDirectoryListing>> m_listings;  /**< folders listed ahead of DoScan(), NULL when scanning sequentially */
+    std::unique_ptr<CPrefetchQueue<SVideoLookup>> m_lookups;        /**< lookups run ahead of RetrieveVideoInfo(), NULL when scanning sequentially */
   };
 }
 
@@ -29,6 +29,7 @@
 #include "guilib/GUIControlFactory.h"
 #include "guilib/GUIFontManager.h"
 #include "guilib/GUITextLayout.h"
+#include "guilib/GUITextLayoutCache.h"
 #include "guilib/GUIWindowManager.h"
 #include "guilib/GUIControlProfiler.h"
 #include "GUIInfoManager.h"
@@ -155,6 +156,12 @@ void CGUIWindowDebugInfo::Process(unsigned int currentTime, CDirtyRegionList &di
       if (control)
         info += StringUtils::Format("Focused: %i (%s)", control->GetID(), CGUIControlFactory::TranslateControlType(control->GetControlType()).c_str());
     }
+    unsigned int evaluations, cacheHits;
+    g_infoManager.GetCacheStats(evaluations, cacheHits);
+    info += StringUtils::Format("\nConditions: %u evaluated, %u cached", evaluations, cacheHits);
+    unsigned int layoutHits, layoutMisses, layouts;
+    CGUITextLayoutCache::GetInstance().GetStats(layoutHits, layoutMisses, layouts);
+    info += StringUtils::Format("\nText layouts: %u cached, %u laid out (%u kept)", layoutHits, layoutMisses, layouts);
   }
 
   float w, h;